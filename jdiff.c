@@ -0,0 +1,358 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_diff.h"
+#include "jrisc_image.h"
+#include "jrisc_inst.h"
+#include "jrisc_inst_string.h"
+#include "jrisc_program.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#define DEFAULT_CONTEXT 3
+
+static void
+version(void)
+{
+	printf("Jaguar RISC Binary Diff Version %d.%d.%d\n",
+		   JDIS_MAJOR, JDIS_MINOR, JDIS_MICRO);
+}
+
+static void
+usage(void)
+{
+	version();
+	printf("\n");
+	printf("Usage: jdiff [-gdlRqhv] [-b <base address>] [-S <section>] [-C <lines>] <old file> <new file>\n");
+	printf("\n");
+	printf("Options:\n");
+	printf("  -g: Parse code as Tom/GPU instructions [default].\n");
+	printf("  -d: Parse code as Jerry/DSP instructions.\n");
+	printf("  -l: Code is stored as little-endian (byte-swapped) 16-bit words.\n");
+	printf("  -R: Treat the files as raw machine code.\n");
+	printf("  -b <base address>: Specify the base load address of raw code.\n");
+	printf("  -S <section>: Compare the named or numbered section of each file.\n");
+	printf("      Defaults to the first code section.\n");
+	printf("  -C <lines>: Print this many unchanged instructions around each\n");
+	printf("      difference [default %d].\n", DEFAULT_CONTEXT);
+	printf("  -q: Only print the number of changed, deleted and inserted\n");
+	printf("      instructions.\n");
+	printf("  -h: Help. Print this text.\n");
+	printf("  -v: Version. Print the version and exit.\n");
+	printf("\n");
+	printf("Lines start with ' ' for unchanged instructions, '-' for deleted\n");
+	printf("  ones, '+' for inserted ones, and '<' and '>' for the old and new\n");
+	printf("  versions of a changed one. Exits with 0 if the code is the same,\n");
+	printf("  1 if it differs, and 2 on error.\n");
+}
+
+static void
+printInstruction(char prefix, const struct JRISC_Program *program, size_t i)
+{
+	const struct JRISC_Instruction *inst = &program->instructions[i];
+	char buf[128];
+	size_t length = sizeof(buf);
+
+	if (inst->opName == JRISC_invalidOpName) {
+		printf("%c%08x: dc.w    $%04x\n", prefix, inst->address,
+			   jriscProgramRaw(program, i));
+		return;
+	}
+
+	jriscInstructionToString(inst, JRISC_STRINGFLAG_ADDRESS, buf, &length);
+	printf("%c%s\n", prefix, buf);
+}
+
+static uint32_t
+addressOf(const struct JRISC_Program *program, size_t i)
+{
+	if (i < program->numInstructions) return program->instructions[i].address;
+
+	return program->baseAddress + (uint32_t)(program->numWords * 2);
+}
+
+static void
+printHunkHeader(const char *fileNames[2],
+				const struct JRISC_Program *oldProgram,
+				size_t oldIndex,
+				const struct JRISC_Program *newProgram,
+				size_t newIndex)
+{
+	static bool filesPrinted = false;
+
+	if (!filesPrinted) {
+		printf("--- %s\n+++ %s\n", fileNames[0], fileNames[1]);
+		filesPrinted = true;
+	}
+
+	printf("@@ -$%x +$%x @@\n", addressOf(oldProgram, oldIndex),
+		   addressOf(newProgram, newIndex));
+}
+
+static void
+printDifference(const struct JRISC_DiffHunk *hunk,
+				const struct JRISC_Program *oldProgram,
+				const struct JRISC_Program *newProgram)
+{
+	size_t k;
+
+	switch (hunk->kind) {
+	case JRISC_diffChanged:
+		for (k = 0; k < hunk->oldCount; k++) {
+			printInstruction('<', oldProgram, hunk->oldIndex + k);
+			printInstruction('>', newProgram, hunk->newIndex + k);
+		}
+		break;
+
+	case JRISC_diffDeleted:
+		for (k = 0; k < hunk->oldCount; k++) {
+			printInstruction('-', oldProgram, hunk->oldIndex + k);
+		}
+		break;
+
+	case JRISC_diffInserted:
+		for (k = 0; k < hunk->newCount; k++) {
+			printInstruction('+', newProgram, hunk->newIndex + k);
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+
+static struct JRISC_Program *
+loadProgram(const char *fileName,
+			enum JRISC_ImageFormat format,
+			const char *sectionName,
+			enum JRISC_CPU cpu,
+			bool littleEndian,
+			bool baseSpecified,
+			uint32_t baseAddress)
+{
+	struct JRISC_Image *image;
+	struct JRISC_Program *program;
+	struct JRISC_Section section;
+	const struct JRISC_Section *found = NULL;
+	unsigned i;
+
+	if (jriscImageOpen(fileName, format, &image) != JRISC_success) {
+		fprintf(stderr, "Could not open %s\n", fileName);
+		exit(2);
+	}
+
+	if (sectionName) {
+		found = jriscImageFindSection(image, sectionName);
+	} else {
+		for (i = 0; !found && (i < image->numSections); i++) {
+			if (image->sections[i].flags & JRISC_SECTIONFLAG_CODE) {
+				found = &image->sections[i];
+			}
+		}
+	}
+
+	if (!found) {
+		fprintf(stderr, "No %s section in %s\n",
+				sectionName ? sectionName : "code", fileName);
+		exit(2);
+	}
+
+	section = *found;
+	if (image->format == JRISC_imageRaw) {
+		if (baseSpecified) {
+			section.address = baseAddress;
+		} else {
+			section.address = (cpu == JRISC_gpu) ? JRISC_GPU_RAM :
+				JRISC_DSP_RAM;
+		}
+	}
+
+	if (littleEndian) image->byteOrder = JRISC_littleEndian;
+
+	if (jriscProgramFromSection(image, &section, cpu, &program) !=
+		JRISC_success) {
+		fprintf(stderr, "Failed to decode %s\n", fileName);
+		exit(2);
+	}
+
+	jriscImageDestroy(image);
+
+	return program;
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct JRISC_Program *oldProgram;
+	struct JRISC_Program *newProgram;
+	struct JRISC_Diff *diff;
+	const struct JRISC_DiffHunk *hunk;
+	const char *fileNames[2] = { NULL, NULL };
+	const char *sectionName = NULL;
+	enum JRISC_CPU cpu = JRISC_gpu;
+	enum JRISC_ImageFormat format = JRISC_imageAuto;
+	bool littleEndian = false;
+	bool quiet = false;
+	bool baseSpecified = false;
+	uint32_t baseAddress = 0;
+	unsigned long contextLines = DEFAULT_CONTEXT;
+	unsigned numFiles = 0;
+	size_t h, k, printed;
+	int i;
+	int j;
+	bool skipParam;
+	char *end;
+
+	for (i = 1; i < argc; i++) {
+		if (argv[i][0] == '-') {
+			for (j = 1, skipParam = false; !skipParam && argv[i][j]; j++) {
+				switch (argv[i][j]) {
+				case 'h':
+					usage();
+					exit(0);
+
+				case 'v':
+					version();
+					exit(0);
+
+				case 'g':
+					cpu = JRISC_gpu;
+					break;
+
+				case 'd':
+					cpu = JRISC_dsp;
+					break;
+
+				case 'l':
+					littleEndian = true;
+					break;
+
+				case 'R':
+					format = JRISC_imageRaw;
+					break;
+
+				case 'q':
+					quiet = true;
+					break;
+
+				case 'S':
+					if ((argv[i][j+1]) || (++i >= argc)) {
+						usage();
+						exit(2);
+					}
+					sectionName = argv[i];
+					skipParam = true;
+					break;
+
+				case 'C':
+					if ((argv[i][j+1]) || (++i >= argc)) {
+						usage();
+						exit(2);
+					}
+					errno = 0;
+					contextLines = strtoul(argv[i], &end, 0);
+					if ((errno != 0) || !argv[i][0] || end[0]) {
+						printf("Error parsing context lines\n\n");
+						usage();
+						exit(2);
+					}
+					skipParam = true;
+					break;
+
+				case 'b':
+					if ((argv[i][j+1]) || (++i >= argc)) {
+						usage();
+						exit(2);
+					}
+					errno = 0;
+					baseAddress = strtol(argv[i], &end, 0);
+					if ((errno != 0) || !argv[i][0] || end[0]) {
+						printf("Error parsing base address\n\n");
+						usage();
+						exit(2);
+					}
+					baseSpecified = true;
+					skipParam = true;
+					break;
+
+				default:
+					usage();
+					exit(2);
+				}
+			}
+		} else if (numFiles < 2) {
+			fileNames[numFiles++] = argv[i];
+		} else {
+			usage();
+			exit(2);
+		}
+	}
+
+	if (numFiles != 2) {
+		usage();
+		exit(2);
+	}
+
+	oldProgram = loadProgram(fileNames[0], format, sectionName, cpu,
+							 littleEndian, baseSpecified, baseAddress);
+	newProgram = loadProgram(fileNames[1], format, sectionName, cpu,
+							 littleEndian, baseSpecified, baseAddress);
+
+	if (jriscDiffPrograms(oldProgram, newProgram, &diff) != JRISC_success) {
+		fprintf(stderr, "Out of memory\n");
+		exit(2);
+	}
+
+	if (quiet) {
+		printf("%zu changed, %zu deleted, %zu inserted\n",
+			   diff->changed, diff->deleted, diff->inserted);
+	}
+
+	for (h = 0; !quiet && (h < diff->numHunks); h++) {
+		hunk = &diff->hunks[h];
+
+		if (hunk->kind != JRISC_diffEqual) {
+			if (!h) {
+				printHunkHeader(fileNames, oldProgram, hunk->oldIndex,
+								newProgram, hunk->newIndex);
+			}
+			printDifference(hunk, oldProgram, newProgram);
+			continue;
+		}
+
+		/* Trailing context for the previous difference */
+		for (printed = 0; h && (printed < hunk->oldCount) &&
+			 (printed < contextLines); printed++) {
+			printInstruction(' ', oldProgram, hunk->oldIndex + printed);
+		}
+
+		if ((h + 1) >= diff->numHunks) continue;
+
+		/* Leading context for the next one, in a new hunk if there is a gap */
+		k = (hunk->oldCount > contextLines) ? hunk->oldCount - contextLines : 0;
+		if (k < printed) k = printed;
+		if (!h || (k > printed)) {
+			printHunkHeader(fileNames, oldProgram, hunk->oldIndex + k,
+							newProgram, hunk->newIndex + k);
+		}
+		for (; k < hunk->oldCount; k++) {
+			printInstruction(' ', oldProgram, hunk->oldIndex + k);
+		}
+	}
+
+	i = (diff->changed || diff->deleted || diff->inserted) ? 1 : 0;
+
+	jriscDiffDestroy(diff);
+	jriscProgramDestroy(oldProgram);
+	jriscProgramDestroy(newProgram);
+
+	return i;
+}
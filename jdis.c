@@ -5,16 +5,71 @@
  */
 
 #include "jrisc_base.h"
+#include "jrisc_bank.h"
+#include "jrisc_bus.h"
+#include "jrisc_cache.h"
+#include "jrisc_classify.h"
+#include "jrisc_const.h"
 #include "jrisc_ctx.h"
-#include "jrisc_ctx_file.h"
+#include "jrisc_ctx_compressed.h"
+#include "jrisc_hash.h"
+#include "jrisc_image.h"
+#include "jrisc_index.h"
 #include "jrisc_inst.h"
 #include "jrisc_inst_string.h"
+#include "jrisc_listing.h"
+#include "jrisc_pipe.h"
+#include "jrisc_program.h"
+#include "jrisc_record.h"
+#include "jrisc_segment.h"
+#include "jrisc_stats.h"
+#include "jrisc_sym.h"
+#include "jrisc_thread.h"
 
 #include <stdbool.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <errno.h>
 
+#if defined(_WIN32)
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+#define MAX_SELECTED_SECTIONS 64
+
+/* Output options folded into the cache key besides the string flags */
+#define CACHE_FLAG_REASSEMBLE		0x80000000
+#define CACHE_FLAG_LITTLE_ENDIAN	0x40000000
+#define CACHE_FLAG_ANNOTATE			0x20000000
+#define CACHE_FLAG_BINARY			0x10000000
+#define CACHE_FLAG_JSON				0x08000000
+
+/* Marks cache entries holding a section's checkpoint index */
+#define CACHE_FLAG_INDEX			0x04000000
+
+#define CACHE_FLAG_SEGMENT			0x02000000
+
+/* Below this, starting the pipeline's threads costs more than it saves */
+#define PIPELINE_MIN_SIZE			(64 * 1024)
+
+/* How each section is printed */
+struct OutputOptions {
+	uint32_t stringFlags;
+	const struct JRISC_SymbolTable *symbols;
+	bool reassemble;
+	bool annotate;
+	bool segment;
+	uint32_t entry;				/* Also followed with segment, if inside */
+	bool busReport;
+	bool bankReport;
+	bool records;
+	enum JRISC_RecordFormat recordFormat;
+	bool pipeline;
+	uint64_t count;				/* If not 0, stop after this many */
+};
+
 static void
 version(void)
 {
@@ -27,40 +82,869 @@ usage(void)
 {
 	version();
 	printf("\n");
-	printf("Usage: jdis [-gdamhv] [-o <offset>] [-b <base address>] <JRISC machine code file>\n");
+	printf("Usage: jdis [-gdGlamrsRneDBKhv] [-f <format>] [-o <offset>] [-b <base address>] [-A <address>] [-N <count>] [-S <section>]... [-y <map file>] [-c <cache dir>] <JRISC machine code file>\n");
+	printf("       jdis -t <csv|json> [-gdlR] [-j <threads>] [-S <section>]... <JRISC machine code file>...\n");
 	printf("\n");
 	printf("Options:\n");
 	printf("  -g: Parse code as Tom/GPU instructions [default].\n");
 	printf("  -d: Parse code as Jerry/DSP instructions.\n");
+	printf("  -G: Guess from the code whether it is for the GPU or DSP, falling\n");
+	printf("      back to the GPU if it can't tell. With -s, print the guess for\n");
+	printf("      each code section.\n");
+	printf("  -l: Code is stored as little-endian (byte-swapped) 16-bit words.\n");
 	printf("  -a: Print address in hex of each disassembled word.\n");
 	printf("  -m: Print machine code in hex of each disassembled word.\n");
+	printf("  -r: Print a labeled listing that rmac can re-assemble into the\n");
+	printf("      same machine code. Overrides -a, -m and -e.\n");
+	printf("  -f <text|binary|json>: Print text [default], fixed-size binary\n");
+	printf("      records, or JSON Lines. Binary and JSON override -a, -m, -r\n");
+	printf("      and -e.\n");
 	printf("  -o <offset>: Specify offset into file (0x<hex> or <decimal>)\n");
 	printf("  -b <base address>: Specify the base load address of the code\n");
+	printf("  -A <address>: Start at the instruction containing this address,\n");
+	printf("      found without decoding everything before it. Only the section\n");
+	printf("      holding the address is disassembled.\n");
+	printf("  -N <count>: Stop after this many instructions.\n");
+	printf("  -s: List the sections of the file and exit.\n");
+	printf("  -S <section>: Disassemble the named or numbered section. May be\n");
+	printf("      repeated. Defaults to every code section.\n");
+	printf("  -R: Treat the file as raw machine code, even if it looks like an\n");
+	printf("      a.out, COFF, ABS, or cartridge image.\n");
+	printf("  -y <map file>: Load symbols from a text file of address/name pairs.\n");
+	printf("  -n: Don't print symbol names, even if the file has a symbol table.\n");
+	printf("  -e: Follow register values through the code, and note where each\n");
+	printf("      jump (rN), load and store goes when it can be worked out.\n");
+	printf("  -D: Split each section into code, reached by following branches\n");
+	printf("      from its start and the entry point, and data, and print the\n");
+	printf("      data and any words that don't decode as dc.l and dc.w\n");
+	printf("      instead of stopping at the first one. -r, -e and -f binary\n");
+	printf("      or json override it.\n");
+	printf("  -B: Instead of disassembling, count the loads and stores of each\n");
+	printf("      basic block and loop that go to local RAM, hardware registers\n");
+	printf("      or external memory over the main bus, and list the ones that\n");
+	printf("      leave local RAM. Overrides -r, -e and -f.\n");
+	printf("  -K: Instead of disassembling, count each register bank's use and\n");
+	printf("      the moveta and movefa in each loop, and suggest free\n");
+	printf("      registers to keep alternate bank values in. Overrides -r, -e\n");
+	printf("      and -f, and can be combined with -B.\n");
+	printf("  -c <cache dir>: Reuse disassembly of identical code from, and save\n");
+	printf("      it to, the given directory. With -A, save the index of\n");
+	printf("      instruction boundaries there instead.\n");
+	printf("  -t <csv|json>: Print opcode, operand and instruction pair counts\n");
+	printf("      for all the given files instead of disassembling them.\n");
+	printf("  -j <threads>: Count statistics on this many threads [default: one\n");
+	printf("      per CPU]. With -j 1, also disassemble on a single thread.\n");
 	printf("  -h: Help. Print this text.\n");
 	printf("  -v: Version. Print the version and exit.\n");
 	printf("\n");
 	printf("Offsets and addresses are parsed as hex if they start '0x',\n");
 	printf("  octal if they start with '0', or decimal otherwise.\n");
+	printf("\n");
+	printf("For container formats, the offset is relative to the start of each\n");
+	printf("  section, and the base address overrides the section's own.\n");
+}
+
+/* Add a section's code, after <fileOffset>, to <guess> */
+static void
+guessSectionCpu(const struct JRISC_Image *image,
+				const struct JRISC_Section *section,
+				uint64_t fileOffset,
+				enum JRISC_ByteOrder byteOrder,
+				struct JRISC_CpuGuess *guess)
+{
+	if ((section->flags & JRISC_SECTIONFLAG_BSS) ||
+		(fileOffset >= section->size)) {
+		return;
+	}
+
+	jriscCpuGuessScan(guess, &image->data[section->offset + fileOffset],
+					  (size_t)(section->size - fileOffset), byteOrder);
+}
+
+static const char *
+cpuName(enum JRISC_CPU cpu)
+{
+	switch (cpu) {
+	case JRISC_gpu:
+		return "GPU";
+
+	case JRISC_dsp:
+		return "DSP";
+
+	default:
+		return "unknown";
+	}
+}
+
+static void
+listSections(const struct JRISC_Image *image,
+			 bool guessCpu,
+			 enum JRISC_ByteOrder byteOrder)
+{
+	const struct JRISC_Section *s;
+	struct JRISC_CpuGuess guess;
+	unsigned i;
+
+	printf("Format: %s, entry: $%x, byte order: %s\n",
+		   jriscImageFormatName(image->format), image->entry,
+		   image->byteOrder == JRISC_bigEndian ? "big" : "little");
+	printf("\n");
+	printf("  #  %-16s %-8s %-8s %-8s Flags%s\n",
+		   "Name", "Address", "Offset", "Size", guessCpu ? "  CPU" : "");
+
+	for (i = 0; i < image->numSections; i++) {
+		s = &image->sections[i];
+		printf("%3u  %-16s %08x %08llx %08llx %s", i, s->name, s->address,
+			   (unsigned long long)s->offset, (unsigned long long)s->size,
+			   (s->flags & JRISC_SECTIONFLAG_CODE) ? "code" :
+			   (s->flags & JRISC_SECTIONFLAG_BSS) ? "bss" : "data");
+
+		if (guessCpu && (s->flags & JRISC_SECTIONFLAG_CODE)) {
+			memset(&guess, 0, sizeof(guess));
+			guessSectionCpu(image, s, 0, byteOrder, &guess);
+			printf("   %s (GPU %u%%, DSP %u%%)", cpuName(guess.cpu),
+				   guess.gpuConfidence, guess.dspConfidence);
+		}
+
+		printf("\n");
+	}
+}
+
+/* Output options that change what is printed, for the cache key */
+static uint32_t
+cacheFlags(const struct OutputOptions *options)
+{
+	uint32_t flags = options->stringFlags;
+
+	if (options->records) {
+		return (options->recordFormat == JRISC_recordBinary) ?
+			CACHE_FLAG_BINARY : CACHE_FLAG_JSON;
+	}
+
+	if (options->reassemble) flags |= CACHE_FLAG_REASSEMBLE;
+	if (options->annotate) flags |= CACHE_FLAG_ANNOTATE;
+	if (options->segment) flags |= CACHE_FLAG_SEGMENT;
+
+	return flags;
+}
+
+/* Anything in the symbol table can change the output, so hash all of it */
+static uint64_t
+hashSymbols(const struct JRISC_SymbolTable *symbols)
+{
+	uint64_t hash = 0;
+	unsigned i;
+
+	if (!symbols) return 0;
+
+	for (i = 0; i < symbols->count; i++) {
+		hash = jriscHashCombine(hash, symbols->symbols[i].address);
+		hash = jriscHashCombine(hash, symbols->symbols[i].size);
+		hash = jriscHashCombine(hash,
+								jriscHash64(symbols->symbols[i].name,
+											strlen(symbols->symbols[i].name),
+											0));
+	}
+
+	return hash;
+}
+
+static void
+printAddress(uint32_t address,
+			 const struct JRISC_SymbolTable *symbols,
+			 FILE *fp)
+{
+	const struct JRISC_Symbol *sym = NULL;
+	uint32_t offset;
+
+	if (symbols) sym = jriscSymbolTableLookup(symbols, address, &offset);
+
+	if (!sym) {
+		fprintf(fp, "$%x", address);
+	} else if (offset) {
+		fprintf(fp, "%s+%u", sym->name, offset);
+	} else {
+		fprintf(fp, "%s", sym->name);
+	}
+}
+
+/*
+ * Decode the whole section up front, propagate constants through it, and
+ * print each instruction with the address it jumps to, loads from or stores
+ * to as a comment, where that is known.
+ */
+static enum JRISC_Error
+disassembleAnnotated(struct JRISC_Context *ctx,
+					 uint64_t size,
+					 enum JRISC_CPU cpu,
+					 const struct OutputOptions *options,
+					 FILE *fp)
+{
+	struct JRISC_Program *program;
+	struct JRISC_ConstProp *constProp = NULL;
+	const struct JRISC_Instruction *inst;
+	char text[128];
+	size_t length;
+	size_t i;
+	uint32_t address;
+	enum JRISC_Error err;
+
+	err = jriscProgramDecode(ctx, size, cpu, &program);
+	if (err != JRISC_success) return err;
+
+	err = jriscConstPropCompute(program, &constProp);
+	if (err != JRISC_success) goto done;
+
+	/* Like a plain listing, stop at the first word that doesn't decode */
+	for (i = 0; i < program->numInstructions; i++) {
+		inst = &program->instructions[i];
+		if (inst->opName == JRISC_invalidOpName) break;
+
+		length = sizeof(text);
+		jriscInstructionToStringSymbolic(inst, options->stringFlags,
+										 options->symbols, text, &length);
+		if (length > sizeof(text)) {
+			err = JRISC_ERROR_outOfMemory;
+			goto done;
+		}
+
+		if (jriscConstPropAddress(constProp, i, &address)) {
+			fprintf(fp, "%s\t; ", text);
+			printAddress(address, options->symbols, fp);
+			fprintf(fp, "\n");
+		} else {
+			fprintf(fp, "%s\n", text);
+		}
+	}
+
+done:
+	jriscConstPropDestroy(constProp);
+	jriscProgramDestroy(program);
+
+	return err;
+}
+
+/* Print a data word or long word as disassembled code would be laid out */
+static void
+printData(uint32_t address,
+		  uint32_t value,
+		  bool isLong,
+		  uint32_t stringFlags,
+		  FILE *fp)
+{
+	const char *indent = stringFlags ? "" : "\t";
+
+	if (stringFlags & JRISC_STRINGFLAG_ADDRESS) {
+		fprintf(fp, "%08x:", address);
+		indent = " ";
+	}
+
+	if (stringFlags & JRISC_STRINGFLAG_MACHINE_CODE) {
+		if (isLong) {
+			fprintf(fp, "%s%04x %04x     ", indent, value >> 16,
+					value & 0xffff);
+		} else {
+			fprintf(fp, "%s%04x          ", indent, value);
+		}
+		indent = "  ";
+	}
+
+	fprintf(fp, isLong ? "%sdc.l    $%08x\n" : "%sdc.w    $%04x\n", indent,
+			value);
+}
+
+/*
+ * Decode the whole section, split it into code and data, and print the code
+ * as instructions and the data as long words where aligned, or words.
+ */
+static enum JRISC_Error
+disassembleSegmented(struct JRISC_Context *ctx,
+					 uint64_t size,
+					 enum JRISC_CPU cpu,
+					 const struct OutputOptions *options,
+					 FILE *fp)
+{
+	struct JRISC_Program *program;
+	struct JRISC_SegmentMap *map = NULL;
+	const struct JRISC_Segment *segment;
+	struct JRISC_Instruction inst;
+	uint64_t numOutput = 0;
+	uint32_t entries[2];
+	uint32_t address;
+	size_t k, w, end;
+	unsigned numWords;
+	enum JRISC_Error err;
+
+	err = jriscProgramDecode(ctx, size, cpu, &program);
+	if (err != JRISC_success) return err;
+
+	entries[0] = program->baseAddress;
+	entries[1] = options->entry;
+	err = jriscSegmentProgram(program, entries, 2, &map);
+	if (err != JRISC_success) goto done;
+
+	for (k = 0; k < map->numSegments; k++) {
+		segment = &map->segments[k];
+		end = segment->firstWord + segment->numWords;
+
+		for (w = segment->firstWord;
+			 (w < end) && (!options->count || (numOutput < options->count));
+			 w += numWords, numOutput++) {
+			address = program->baseAddress + (uint32_t)(w * 2);
+			numWords = segment->code ?
+				jriscProgramDecodeAt(program, w, &inst) : 0;
+
+			if (numWords && ((w + numWords) <= end)) {
+				err = jriscInstructionFilePrintSymbolic(&inst,
+														options->stringFlags,
+														options->symbols,
+														fp);
+				if (err != JRISC_success) goto done;
+			} else if (!segment->code && !(address & 3) && ((w + 1) < end)) {
+				printData(address, ((uint32_t)program->words[w] << 16) |
+						  program->words[w + 1], true, options->stringFlags,
+						  fp);
+				numWords = 2;
+			} else {
+				printData(address, program->words[w], false,
+						  options->stringFlags, fp);
+				numWords = 1;
+			}
+		}
+	}
+
+done:
+	jriscSegmentMapDestroy(map);
+	jriscProgramDestroy(program);
+
+	return err;
+}
+
+/*
+ * Decode the whole section once and print the selected reports instead of
+ * the code: where each load and store goes by block and loop, and how the
+ * register banks are used.
+ */
+static enum JRISC_Error
+report(struct JRISC_Context *ctx,
+	   uint64_t size,
+	   enum JRISC_CPU cpu,
+	   const struct OutputOptions *options,
+	   FILE *fp)
+{
+	struct JRISC_Program *program;
+	struct JRISC_BusMap *busMap;
+	struct JRISC_BankMap *bankMap;
+	enum JRISC_Error err;
+
+	err = jriscProgramDecode(ctx, size, cpu, &program);
+	if (err != JRISC_success) return err;
+
+	if (options->busReport) {
+		err = jriscBusMapCompute(program, &busMap);
+		if (err == JRISC_success) {
+			err = jriscBusMapWrite(busMap, options->stringFlags,
+								   options->symbols, fp);
+			jriscBusMapDestroy(busMap);
+		}
+	}
+
+	if ((err == JRISC_success) && options->bankReport) {
+		if (options->busReport) fprintf(fp, "\n");
+
+		err = jriscBankMapCompute(program, &bankMap);
+		if (err == JRISC_success) {
+			err = jriscBankMapWrite(bankMap, fp);
+			jriscBankMapDestroy(bankMap);
+		}
+	}
+
+	jriscProgramDestroy(program);
+
+	return err;
+}
+
+/* Where each instruction of a section goes as it is decoded */
+struct SectionOutput {
+	const struct OutputOptions *options;
+	FILE *fp;
+	struct JRISC_RecordWriter *writer;
+};
+
+static enum JRISC_Error
+outputInstruction(const struct JRISC_Instruction *inst, void *arg)
+{
+	struct SectionOutput *out = arg;
+	enum JRISC_Error err;
+
+	if (out->writer) {
+		err = jriscRecordWriterAdd(out->writer, inst);
+		if (err != JRISC_success) return err;
+	} else {
+		err = jriscInstructionFilePrintSymbolic(inst,
+												out->options->stringFlags,
+												out->options->symbols,
+												out->fp);
+		if (err != JRISC_success) return err;
+	}
+
+	return JRISC_success;
+}
+
+/* Binary records start with a header, once for the whole output */
+static enum JRISC_Error
+startRecords(const struct OutputOptions *options, enum JRISC_CPU cpu)
+{
+	if (!options->records || (options->recordFormat != JRISC_recordBinary)) {
+		return JRISC_success;
+	}
+
+#if defined(_WIN32)
+	_setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+	return jriscRecordWriteHeader(stdout, cpu);
+}
+
+/* Disassemble a section to fp */
+static enum JRISC_Error
+disassemble(struct JRISC_Context *ctx,
+			uint64_t size,
+			enum JRISC_CPU cpu,
+			const struct OutputOptions *options,
+			FILE *fp)
+{
+	struct SectionOutput out;
+	struct JRISC_Instruction inst;
+	enum JRISC_Error err = JRISC_success;
+	uint64_t numOutput = 0;
+
+	memset(&out, 0, sizeof(out));
+	out.options = options;
+	out.fp = fp;
+
+	if (options->busReport || options->bankReport) {
+		return report(ctx, size, cpu, options, fp);
+	} else if (options->records) {
+		err = jriscRecordWriterCreate(fp, options->recordFormat, &out.writer);
+		if (err != JRISC_success) return err;
+	} else if (options->reassemble) {
+		return jriscListingWrite(ctx, size, cpu, options->symbols, fp);
+	} else if (options->annotate) {
+		return disassembleAnnotated(ctx, size, cpu, options, fp);
+	} else if (options->segment) {
+		return disassembleSegmented(ctx, size, cpu, options, fp);
+	}
+
+	if (options->pipeline && !options->count &&
+		(size >= PIPELINE_MIN_SIZE)) {
+		err = jriscPipeDecode(ctx, size, cpu, outputInstruction, &out);
+	} else {
+		while ((err == JRISC_success) &&
+			   (!options->count || (numOutput < options->count)) &&
+			   (jriscInstructionRead(ctx, cpu, &inst) == JRISC_success)) {
+			err = outputInstruction(&inst, &out);
+			numOutput++;
+		}
+	}
+
+	if (out.writer) {
+		if (err == JRISC_success) err = jriscRecordWriterFlush(out.writer);
+		jriscRecordWriterDestroy(out.writer);
+	}
+
+	return err;
+}
+
+/*
+ * Get a section's checkpoint index from the cache, or build it with one pass
+ * over the code, saving it in the cache for next time.
+ */
+static enum JRISC_Error
+sectionIndex(struct JRISC_Cache *cache,
+			 uint64_t key,
+			 struct JRISC_Context *ctx,
+			 uint64_t size,
+			 enum JRISC_CPU cpu,
+			 struct JRISC_Index **indexOut)
+{
+	struct JRISC_CacheEntry *entry;
+	enum JRISC_Error err;
+	uint8_t *data;
+	size_t dataSize;
+
+	if (cache && (jriscCacheLookup(cache, key, &entry) == JRISC_success)) {
+		err = entry->text ? jriscIndexLoad(entry->text,
+										   (size_t)entry->textSize,
+										   indexOut) :
+			JRISC_ERROR_invalidFormat;
+		jriscCacheEntryRelease(entry);
+		if (err == JRISC_success) return err;
+	}
+
+	err = jriscIndexBuild(ctx, size, cpu, JRISC_INDEX_DEFAULT_INTERVAL,
+						  indexOut);
+	if (err != JRISC_success) return err;
+
+	/* As with disassembly, failing to save the index is not fatal */
+	if (cache && (jriscIndexSave(*indexOut, &data, &dataSize) ==
+				  JRISC_success)) {
+		jriscCacheStore(cache, key, NULL, 0, (const char *)data, dataSize);
+		free(data);
+	}
+
+	return JRISC_success;
+}
+
+/* Disassemble from the instruction containing <offset> */
+static enum JRISC_Error
+disassembleFrom(struct JRISC_Cache *cache,
+				uint64_t indexKey,
+				struct JRISC_Context *ctx,
+				uint64_t size,
+				enum JRISC_CPU cpu,
+				const struct OutputOptions *options,
+				uint64_t offset)
+{
+	struct JRISC_Index *index;
+	enum JRISC_Error err;
+
+	err = sectionIndex(cache, indexKey, ctx, size, cpu, &index);
+	if (err != JRISC_success) return err;
+
+	err = jriscIndexSeek(index, ctx, cpu, offset);
+	jriscIndexDestroy(index);
+	if (err != JRISC_success) return err;
+
+	return disassemble(ctx, size - ctx->readLocation, cpu, options, stdout);
+}
+
+/*
+ * Disassemble through the cache: print the stored text on a hit, otherwise
+ * render to a temporary file, store that, and print it.
+ */
+static enum JRISC_Error
+disassembleCached(struct JRISC_Cache *cache,
+				  uint64_t key,
+				  struct JRISC_Context *ctx,
+				  uint64_t size,
+				  enum JRISC_CPU cpu,
+				  const struct OutputOptions *options)
+{
+	struct JRISC_CacheEntry *entry;
+	char *text = NULL;
+	long textSize;
+	FILE *fp;
+	enum JRISC_Error err;
+
+	if (jriscCacheLookup(cache, key, &entry) == JRISC_success) {
+		if (entry->text) fwrite(entry->text, 1, entry->textSize, stdout);
+		jriscCacheEntryRelease(entry);
+		return JRISC_success;
+	}
+
+	fp = tmpfile();
+	if (!fp) {
+		/* No scratch space. Just skip the cache. */
+		return disassemble(ctx, size, cpu, options, stdout);
+	}
+
+	err = disassemble(ctx, size, cpu, options, fp);
+	if (err != JRISC_success) goto done;
+
+	textSize = ftell(fp);
+	if ((textSize < 0) || !(text = malloc(textSize ? textSize : 1))) {
+		err = JRISC_ERROR_outOfMemory;
+		goto done;
+	}
+
+	rewind(fp);
+	if (fread(text, 1, textSize, fp) != (size_t)textSize) {
+		err = JRISC_ERROR_ioError;
+		goto done;
+	}
+
+	fwrite(text, 1, textSize, stdout);
+
+	/*
+	 * A hit only ever prints the text, so no records are kept. Failing to
+	 * save the result is not fatal; it just isn't cached.
+	 */
+	jriscCacheStore(cache, key, NULL, 0, text, textSize);
+
+done:
+	free(text);
+	fclose(fp);
+
+	return err;
+}
+
+/*
+ * Disassemble raw code from a gzip or xz file as it decompresses, keeping only
+ * a window of it in memory. Returns false, having printed nothing, if the file
+ * isn't compressed in a format this build can read.
+ */
+static bool
+disassembleStreamed(const char *fileName,
+					uint64_t fileOffset,
+					uint32_t baseAddress,
+					enum JRISC_CPU cpu,
+					bool littleEndian,
+					const struct OutputOptions *options)
+{
+	struct OutputOptions streamOptions = *options;
+	struct JRISC_Context *ctx;
+	enum JRISC_Compression compression;
+	uint8_t magic[8];
+	size_t got;
+	enum JRISC_Error err;
+	FILE *fp;
+
+	fp = fopen(fileName, "rb");
+	if (!fp) return false;
+
+	got = fread(magic, 1, sizeof(magic), fp);
+	compression = jriscCompressionDetect(magic, got);
+	if (!jriscCompressionSupported(compression) || fseek(fp, 0, SEEK_SET) ||
+		(jriscContextFromCompressedFile(fp, compression,
+										JRISC_COMPRESSED_WINDOW,
+										(uint32_t)(baseAddress - fileOffset),
+										&ctx) != JRISC_success)) {
+		fclose(fp);
+		return false;
+	}
+
+	if (littleEndian) jriscContextSetByteOrder(ctx, JRISC_littleEndian);
+	jriscContextSeek(ctx, fileOffset);
+
+	/* The pipeline wants the size up front, which isn't known here */
+	streamOptions.pipeline = false;
+
+	err = startRecords(&streamOptions, cpu);
+	if (err == JRISC_success) {
+		err = disassemble(ctx, UINT64_MAX, cpu, &streamOptions, stdout);
+	}
+
+	if (err != JRISC_success) {
+		fprintf(stderr, "Failed to disassemble %s\n", fileName);
+		exit(1);
+	}
+
+	jriscContextDestroy(ctx);
+	fclose(fp);
+
+	return true;
+}
+
+/* Statistics mode: files are shared out to worker threads as they go idle */
+struct StatsJob {
+	const char **fileNames;
+	unsigned numFiles;
+	unsigned nextFile;
+	struct JRISC_Mutex *lock;
+
+	const char **sectionNames;
+	unsigned numSectionNames;
+	enum JRISC_ImageFormat format;
+	enum JRISC_CPU cpu;
+	bool littleEndian;
+	bool failed;
+};
+
+struct StatsWorker {
+	struct StatsJob *job;
+	struct JRISC_Thread *thread;
+	struct JRISC_Stats stats;
+};
+
+static bool
+statsCollectSection(const struct StatsJob *job,
+					const struct JRISC_Image *image,
+					const struct JRISC_Section *section,
+					struct JRISC_Stats *stats)
+{
+	struct JRISC_Context *ctx;
+
+	if (jriscImageSectionContext(image, section, &ctx) != JRISC_success) {
+		return false;
+	}
+
+	if (job->littleEndian) jriscContextSetByteOrder(ctx, JRISC_littleEndian);
+
+	jriscStatsCollect(stats, ctx, section->size, job->cpu);
+	jriscContextDestroy(ctx);
+
+	return true;
+}
+
+static bool
+statsCollectFile(const struct StatsJob *job,
+				 const char *fileName,
+				 struct JRISC_Stats *stats)
+{
+	struct JRISC_Image *image;
+	const struct JRISC_Section *section;
+	bool ok = true;
+	unsigned s;
+
+	if (jriscImageOpen(fileName, job->format, &image) != JRISC_success) {
+		fprintf(stderr, "Could not open %s\n", fileName);
+		return false;
+	}
+
+	for (s = 0; ok && (s < job->numSectionNames); s++) {
+		section = jriscImageFindSection(image, job->sectionNames[s]);
+		if (!section) {
+			fprintf(stderr, "No section '%s' in %s\n",
+					job->sectionNames[s], fileName);
+			ok = false;
+		} else {
+			ok = statsCollectSection(job, image, section, stats);
+		}
+	}
+
+	for (s = 0; ok && !job->numSectionNames && (s < image->numSections);
+		 s++) {
+		if (image->sections[s].flags & JRISC_SECTIONFLAG_CODE) {
+			ok = statsCollectSection(job, image, &image->sections[s], stats);
+		}
+	}
+
+	jriscImageDestroy(image);
+
+	return ok;
+}
+
+static void
+statsWorker(void *arg)
+{
+	struct StatsWorker *worker = arg;
+	struct StatsJob *job = worker->job;
+	const char *fileName;
+
+	for (;;) {
+		jriscMutexLock(job->lock);
+		fileName = (job->nextFile < job->numFiles) ?
+			job->fileNames[job->nextFile++] : NULL;
+		jriscMutexUnlock(job->lock);
+
+		if (!fileName) break;
+
+		if (!statsCollectFile(job, fileName, &worker->stats)) {
+			jriscMutexLock(job->lock);
+			job->failed = true;
+			jriscMutexUnlock(job->lock);
+		}
+	}
+}
+
+/*
+ * Count statistics for every file, each thread into its own counters, then
+ * merge them and print the total.
+ */
+static int
+printStats(struct StatsJob *job,
+		   unsigned numThreads,
+		   enum JRISC_StatsFormat format)
+{
+	struct StatsWorker *workers;
+	unsigned t;
+
+	if (!numThreads) numThreads = jriscThreadCpuCount();
+	if (numThreads > job->numFiles) numThreads = job->numFiles;
+
+	workers = calloc(numThreads, sizeof(*workers));
+	if (!workers || (jriscMutexCreate(&job->lock) != JRISC_success)) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+
+	for (t = 0; t < numThreads; t++) {
+		workers[t].job = job;
+		jriscStatsInit(&workers[t].stats);
+	}
+
+	/* The calling thread does the first worker's share itself */
+	for (t = 1; t < numThreads; t++) {
+		if (jriscThreadCreate(statsWorker, &workers[t], &workers[t].thread) !=
+			JRISC_success) {
+			workers[t].thread = NULL;
+		}
+	}
+
+	statsWorker(&workers[0]);
+
+	for (t = 1; t < numThreads; t++) {
+		jriscThreadJoin(workers[t].thread);
+		jriscStatsMerge(&workers[0].stats, &workers[t].stats);
+	}
+
+	jriscMutexDestroy(job->lock);
+
+	if (!job->failed &&
+		(jriscStatsWrite(&workers[0].stats, format, stdout) != JRISC_success)) {
+		fprintf(stderr, "Failed to write statistics\n");
+		job->failed = true;
+	}
+
+	free(workers);
+
+	return job->failed ? 1 : 0;
 }
 
 int
 main(int argc, char *argv[])
 {
-	FILE *fp;
+	struct JRISC_Image *image;
 	struct JRISC_Context *ctx;
-	struct JRISC_Instruction inst;
+	struct JRISC_Section section;
+	const struct JRISC_Section *selected[MAX_SELECTED_SECTIONS];
+	const char *selectedNames[MAX_SELECTED_SECTIONS];
+	unsigned numSelected = 0;
 	enum JRISC_Error err;
 	const char *fileName = NULL;
+	const char **fileNames;
+	unsigned numFiles = 0;
+	struct StatsJob statsJob;
+	bool stats = false;
+	enum JRISC_StatsFormat statsFormat = JRISC_statsCsv;
+	unsigned long numThreads = 0;
 	enum JRISC_CPU cpu = JRISC_gpu;
+	bool guessCpu = false;
+	struct JRISC_CpuGuess guess;
+	enum JRISC_ByteOrder byteOrder;
+	enum JRISC_ImageFormat format = JRISC_imageAuto;
+	struct JRISC_SymbolTable *symbols = NULL;
+	const char *mapFileName = NULL;
+	const char *cacheDir = NULL;
+	struct JRISC_Cache *cache = NULL;
+	uint64_t cacheSalt = 0;
+	uint64_t cacheKey;
+	bool useSymbols = true;
+	struct OutputOptions output;
+	bool littleEndian = false;
+	bool list = false;
 	uint64_t fileOffset = 0;
 	uint32_t baseAddress = 0;
 	bool baseSpecified = false;
-	uint32_t stringFlags = 0;
+	uint32_t startAddress = 0;
+	bool startSpecified = false;
+	bool startFound = false;
+	uint32_t cacheFlagsLE;
+	unsigned s;
 	int i;
 	int j;
 	bool skipParam;
 	char *end;
 
+	memset(&output, 0, sizeof(output));
+
+	fileNames = calloc(argc, sizeof(*fileNames));
+	if (!fileNames) {
+		fprintf(stderr, "Out of memory\n");
+		exit(1);
+	}
+
 	for (i = 1; i < argc; i++) {
 		if (argv[i][0] == '-') {
 			for (j = 1, skipParam = false; !skipParam && argv[i][j]; j++) {
@@ -81,12 +965,134 @@ main(int argc, char *argv[])
 					cpu = JRISC_dsp;
 					break;
 
+				case 'G':
+					guessCpu = true;
+					break;
+
+				case 'l':
+					littleEndian = true;
+					break;
+
+				case 's':
+					list = true;
+					break;
+
+				case 'R':
+					format = JRISC_imageRaw;
+					break;
+
+				case 'n':
+					useSymbols = false;
+					break;
+
+				case 'e':
+					output.annotate = true;
+					break;
+
+				case 'D':
+					output.segment = true;
+					break;
+
+				case 'B':
+					output.busReport = true;
+					break;
+
+				case 'K':
+					output.bankReport = true;
+					break;
+
+				case 'f':
+					if ((argv[i][j+1]) || (++i >= argc)) {
+						usage();
+						exit(1);
+					}
+					if (!strcmp(argv[i], "text")) {
+						output.records = false;
+					} else if (!strcmp(argv[i], "binary")) {
+						output.records = true;
+						output.recordFormat = JRISC_recordBinary;
+					} else if (!strcmp(argv[i], "json")) {
+						output.records = true;
+						output.recordFormat = JRISC_recordJson;
+					} else {
+						printf("Unknown output format '%s'\n\n", argv[i]);
+						usage();
+						exit(1);
+					}
+					skipParam = true;
+					break;
+
+				case 'y':
+					if ((argv[i][j+1]) || (++i >= argc)) {
+						usage();
+						exit(1);
+					}
+					mapFileName = argv[i];
+					skipParam = true;
+					break;
+
+				case 'c':
+					if ((argv[i][j+1]) || (++i >= argc)) {
+						usage();
+						exit(1);
+					}
+					cacheDir = argv[i];
+					skipParam = true;
+					break;
+
+				case 't':
+					if ((argv[i][j+1]) || (++i >= argc)) {
+						usage();
+						exit(1);
+					}
+					if (!strcmp(argv[i], "csv")) {
+						statsFormat = JRISC_statsCsv;
+					} else if (!strcmp(argv[i], "json")) {
+						statsFormat = JRISC_statsJson;
+					} else {
+						printf("Unknown statistics format '%s'\n\n", argv[i]);
+						usage();
+						exit(1);
+					}
+					stats = true;
+					skipParam = true;
+					break;
+
+				case 'j':
+					if ((argv[i][j+1]) || (++i >= argc)) {
+						usage();
+						exit(1);
+					}
+					errno = 0;
+					numThreads = strtoul(argv[i], &end, 0);
+					if ((errno != 0) || !argv[i][0] || end[0] || !numThreads) {
+						printf("Error parsing thread count\n\n");
+						usage();
+						exit(1);
+					}
+					skipParam = true;
+					break;
+
+				case 'S':
+					if ((argv[i][j+1]) || (++i >= argc) ||
+						(numSelected >= MAX_SELECTED_SECTIONS)) {
+						usage();
+						exit(1);
+					}
+					selectedNames[numSelected++] = argv[i];
+					skipParam = true;
+					break;
+
 				case 'a':
-					stringFlags |= JRISC_STRINGFLAG_ADDRESS;
+					output.stringFlags |= JRISC_STRINGFLAG_ADDRESS;
 					break;
 
 				case 'm':
-					stringFlags |= JRISC_STRINGFLAG_MACHINE_CODE;
+					output.stringFlags |= JRISC_STRINGFLAG_MACHINE_CODE;
+					break;
+
+				case 'r':
+					output.reassemble = true;
 					break;
 
 				case 'o':
@@ -110,6 +1116,38 @@ main(int argc, char *argv[])
 					skipParam = true;
 					break;
 
+				case 'A':
+					if ((argv[i][j+1]) || (++i >= argc)) {
+						usage();
+						exit(1);
+					}
+					errno = 0;
+					startAddress = strtoul(argv[i], &end, 0);
+					if ((errno != 0) || !argv[i][0] || end[0]) {
+						printf("Error parsing start address\n\n");
+						usage();
+						exit(1);
+					}
+					startSpecified = true;
+					skipParam = true;
+					break;
+
+				case 'N':
+					if ((argv[i][j+1]) || (++i >= argc)) {
+						usage();
+						exit(1);
+					}
+					errno = 0;
+					output.count = strtoull(argv[i], &end, 0);
+					if ((errno != 0) || !argv[i][0] || end[0] ||
+						!output.count) {
+						printf("Error parsing instruction count\n\n");
+						usage();
+						exit(1);
+					}
+					skipParam = true;
+					break;
+
 				case 'b':
 					if ((argv[i][j+1]) || (++i >= argc)) {
 						usage();
@@ -137,44 +1175,239 @@ main(int argc, char *argv[])
 					exit(1);
 				}
 			}
-		} else if (!fileName) {
-			fileName = argv[i];
 		} else {
-			usage();
-			exit(1);
+			fileNames[numFiles++] = argv[i];
 		}
 	}
 
-	if (!baseSpecified) {
-		baseAddress = (cpu == JRISC_gpu) ? JRISC_GPU_RAM : JRISC_DSP_RAM;
+	if (stats && numFiles) {
+		memset(&statsJob, 0, sizeof(statsJob));
+		statsJob.fileNames = fileNames;
+		statsJob.numFiles = numFiles;
+		statsJob.sectionNames = selectedNames;
+		statsJob.numSectionNames = numSelected;
+		statsJob.format = format;
+		statsJob.cpu = cpu;
+		statsJob.littleEndian = littleEndian;
+
+		i = printStats(&statsJob, numThreads, statsFormat);
+		free(fileNames);
+		return i;
 	}
-	
-	if (!fileName) {
+
+	if (numFiles != 1) {
 		usage();
 		exit(1);
 	}
 
-	fp = fopen(fileName, "rb");
+	if (output.busReport || output.bankReport) output.records = false;
 
-	if (!fp) {
-		fprintf(stderr, "Could not open %s\n", fileName);
+	/* A listing, annotations or a report need the whole section */
+	if ((startSpecified || output.count) &&
+		(output.busReport || output.bankReport ||
+		 (!output.records && (output.reassemble || output.annotate)))) {
+		printf("-A and -N can't be used with -r, -e, -B or -K\n\n");
+		usage();
+		exit(1);
+	}
+
+	/* As can splitting it into code and data */
+	if (startSpecified && output.segment) {
+		printf("-A can't be used with -D\n\n");
+		usage();
 		exit(1);
 	}
 
-	err = jriscContextFromFile(fp, fileOffset,		/* read file */
-							   NULL, 0,				/* write file+offset */
-							   baseAddress,
-							   &ctx);
+	fileName = fileNames[0];
+	free(fileNames);
+
+	/* Printing raw code straight through needs only a window of it at once */
+	if ((format == JRISC_imageRaw) && !list && !guessCpu && !cacheDir &&
+		!mapFileName && !numSelected && !startSpecified &&
+		!output.reassemble && !output.annotate && !output.segment &&
+		!output.busReport && !output.bankReport) {
+		if (!baseSpecified) {
+			baseAddress = (cpu == JRISC_gpu) ? JRISC_GPU_RAM : JRISC_DSP_RAM;
+		}
+
+		if (disassembleStreamed(fileName, fileOffset, baseAddress, cpu,
+								littleEndian, &output)) {
+			return 0;
+		}
+	}
+
+	err = jriscImageOpen(fileName, format, &image);
 
 	if (err != JRISC_success) {
-		fprintf(stderr, "Failed to create context\n");
+		fprintf(stderr, "Could not open %s\n", fileName);
 		exit(1);
 	}
 
-	while ((err = jriscInstructionRead(ctx, cpu, &inst)) == JRISC_success)
-		jriscInstructionPrint(&inst, stringFlags);
+	byteOrder = littleEndian ? JRISC_littleEndian : image->byteOrder;
 
-	jriscContextDestroy(ctx);
+	if (list) {
+		listSections(image, guessCpu, byteOrder);
+		jriscImageDestroy(image);
+		return 0;
+	}
+
+	if (useSymbols) {
+		/* Map file names take precedence over the image's own */
+		err = jriscSymbolTableCreate(&symbols);
+		if ((err == JRISC_success) && mapFileName) {
+			err = jriscSymbolTableLoadMap(symbols, mapFileName);
+		}
+		if (err == JRISC_success) {
+			err = jriscSymbolTableLoadImage(symbols, image);
+		}
+		if (err == JRISC_success) err = jriscSymbolTableFinalize(symbols);
+
+		if (err != JRISC_success) {
+			fprintf(stderr, "Failed to load symbols\n");
+			exit(1);
+		}
+
+		if (!symbols->count) {
+			jriscSymbolTableDestroy(symbols);
+			symbols = NULL;
+		}
+	}
+
+	output.symbols = symbols;
+	output.entry = image->entry;
+
+	/* Decoding and printing overlap when there are CPUs to spare */
+	output.pipeline = (numThreads != 1) && (jriscThreadCpuCount() > 1);
+
+	for (s = 0; s < numSelected; s++) {
+		selected[s] = jriscImageFindSection(image, selectedNames[s]);
+		if (!selected[s]) {
+			fprintf(stderr, "No section '%s' in %s\n",
+					selectedNames[s], fileName);
+			exit(1);
+		}
+	}
+
+	if (!numSelected) {
+		for (s = 0; s < image->numSections; s++) {
+			if ((image->sections[s].flags & JRISC_SECTIONFLAG_CODE) &&
+				(numSelected < MAX_SELECTED_SECTIONS)) {
+				selected[numSelected++] = &image->sections[s];
+			}
+		}
+	}
+
+	if (guessCpu) {
+		memset(&guess, 0, sizeof(guess));
+		for (s = 0; s < numSelected; s++) {
+			guessSectionCpu(image, selected[s], fileOffset, byteOrder, &guess);
+		}
+		if (guess.cpu != JRISC_both) cpu = guess.cpu;
+
+		fprintf(stderr, "Guessed %s code (GPU %u%%, DSP %u%%)\n",
+				cpuName(guess.cpu), guess.gpuConfidence, guess.dspConfidence);
+	}
+
+	if (cacheDir) {
+		err = jriscCacheOpen(cacheDir, JRISC_CACHE_DEFAULT_MAX_SIZE, &cache);
+		if (err != JRISC_success) {
+			fprintf(stderr, "Failed to open cache %s\n", cacheDir);
+			exit(1);
+		}
+		cacheSalt = hashSymbols(symbols);
+
+		/* Segmenting follows code from the entry point too */
+		if (output.segment) {
+			cacheSalt = jriscHashCombine(cacheSalt, output.entry);
+		}
+	}
+
+	/* Raw code is assumed to be loaded at the start of the CPU's local RAM */
+	if (!baseSpecified && (image->format == JRISC_imageRaw)) {
+		baseAddress = (cpu == JRISC_gpu) ? JRISC_GPU_RAM : JRISC_DSP_RAM;
+		baseSpecified = true;
+	}
+
+	if (startRecords(&output, cpu) != JRISC_success) {
+		fprintf(stderr, "Failed to write output\n");
+		exit(1);
+	}
+
+	for (s = 0; s < numSelected; s++) {
+		section = *selected[s];
+
+		if (fileOffset > section.size) continue;
+		section.offset += fileOffset;
+		section.size -= fileOffset;
+		if (baseSpecified) section.address = baseAddress;
+
+		if (startSpecified &&
+			((startAddress < section.address) ||
+			 ((startAddress - section.address) >= section.size))) {
+			continue;
+		}
+		startFound = true;
+
+		err = jriscImageSectionContext(image, &section, &ctx);
+
+		if (err != JRISC_success) {
+			fprintf(stderr, "Failed to create context for section %s\n",
+					section.name);
+			exit(1);
+		}
+
+		if (littleEndian) jriscContextSetByteOrder(ctx, JRISC_littleEndian);
+
+		if ((image->format != JRISC_imageRaw) && !output.records) {
+			printf("; Section %s at $%x\n", section.name, section.address);
+		}
+
+		cacheFlagsLE = (ctx->byteOrder == JRISC_littleEndian) ?
+			CACHE_FLAG_LITTLE_ENDIAN : 0;
+
+		if (startSpecified) {
+			/* The index only depends on the code, not on how it's printed */
+			cacheKey = cache ? jriscCacheKey(&image->data[section.offset],
+											 (size_t)section.size,
+											 section.offset,
+											 section.address,
+											 cpu,
+											 CACHE_FLAG_INDEX | cacheFlagsLE,
+											 0) : 0;
+			err = disassembleFrom(cache, cacheKey, ctx, section.size, cpu,
+								  &output, startAddress - section.address);
+		} else if (cache && !output.count && !output.busReport &&
+				   !output.bankReport) {
+			cacheKey = jriscCacheKey(&image->data[section.offset],
+									 (size_t)section.size,
+									 section.offset,
+									 section.address,
+									 cpu,
+									 cacheFlags(&output) | cacheFlagsLE,
+									 cacheSalt);
+			err = disassembleCached(cache, cacheKey, ctx, section.size, cpu,
+									&output);
+		} else {
+			err = disassemble(ctx, section.size, cpu, &output, stdout);
+		}
+
+		if (err != JRISC_success) {
+			fprintf(stderr, "Failed to disassemble section %s\n",
+					section.name);
+			exit(1);
+		}
+
+		jriscContextDestroy(ctx);
+	}
+
+	if (startSpecified && !startFound) {
+		fprintf(stderr, "No selected section contains $%x\n", startAddress);
+		exit(1);
+	}
+
+	jriscCacheClose(cache);
+	jriscSymbolTableDestroy(symbols);
+	jriscImageDestroy(image);
 
 	return 0;
 }
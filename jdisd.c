@@ -0,0 +1,654 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_endian.h"
+#include "jrisc_image.h"
+#include "jrisc_inst.h"
+#include "jrisc_server.h"
+#include "jrisc_thread.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#define DEFAULT_MAX_IMAGES		16
+#define MAX_EVENTS				64
+
+struct Connection {
+	int fd;
+
+	/* Bytes received but not yet handed to a worker */
+	uint8_t in[JRISC_SERVER_FRAME_HEADER_SIZE + JRISC_SERVER_MAX_REQUEST];
+	size_t inUsed;
+
+	/* The response frame being sent */
+	uint8_t *out;
+	size_t outSize;
+	size_t outSent;
+
+	/*
+	 * A worker has this connection's request. Each connection has at most one
+	 * request in flight, so responses go back in order; further requests wait
+	 * in <in>. If the client goes away meanwhile, the connection is only
+	 * marked closed, and freed once the worker is done with it.
+	 */
+	bool busy;
+	bool closed;
+
+	/* Closed connections are freed between batches of events */
+	struct Connection *nextClosed;
+};
+
+struct Job {
+	struct Connection *conn;
+	char *request;
+	size_t requestSize;
+	char *response;
+	size_t responseSize;
+	struct Job *next;
+};
+
+/* A list of jobs, in the order they were added */
+struct JobQueue {
+	struct Job *head;
+	struct Job *tail;
+};
+
+struct Daemon {
+	struct JRISC_Server *server;
+
+	int epollFd;
+	int listenFd;
+	int doneFd;				/* eventfd: jobs are waiting in <done> */
+	int signalFd;
+
+	/* Guards everything below */
+	struct JRISC_Mutex *lock;
+	struct JRISC_Cond *ready;
+	struct JobQueue pending;
+	struct JobQueue done;
+	bool stopping;
+
+	/* Only touched by the event loop */
+	struct Connection *closed;
+};
+
+/* epoll hands back one of these, or a connection, with each event */
+static int listenTag;
+static int doneTag;
+static int signalTag;
+
+static void
+version(void)
+{
+	printf("Jaguar RISC Disassembly Server Version %d.%d.%d\n",
+		   JDIS_MAJOR, JDIS_MINOR, JDIS_MICRO);
+}
+
+static void
+usage(void)
+{
+	version();
+	printf("\n");
+	printf("Usage: jdisd [-gdlRhv] [-b <base address>] [-j <threads>] [-m <images>] <socket path>\n");
+	printf("\n");
+	printf("Options:\n");
+	printf("  -g: Parse code as Tom/GPU instructions [default].\n");
+	printf("  -d: Parse code as Jerry/DSP instructions.\n");
+	printf("  -l: Code is stored as little-endian (byte-swapped) 16-bit words.\n");
+	printf("  -R: Treat files as raw machine code.\n");
+	printf("  -b <base address>: Specify the base load address of raw code.\n");
+	printf("  -j <threads>: Answer requests on this many threads [default: one\n");
+	printf("      per CPU].\n");
+	printf("  -m <images>: Keep up to this many decoded images resident\n");
+	printf("      [default %u].\n", DEFAULT_MAX_IMAGES);
+	printf("  -h: Help. Print this text.\n");
+	printf("  -v: Version. Print the version and exit.\n");
+	printf("\n");
+	printf("Listens on a Unix domain socket until interrupted. Each request and\n");
+	printf("  response is a 32-bit little-endian length followed by that many\n");
+	printf("  bytes of text. Requests are tab-separated:\n");
+	printf("\n");
+	printf("    disassemble <file> <start address> <end address>\n");
+	printf("    lookup <file> <address>\n");
+	printf("    stats\n");
+}
+
+static void
+queuePush(struct JobQueue *queue, struct Job *job)
+{
+	job->next = NULL;
+	if (queue->tail) {
+		queue->tail->next = job;
+	} else {
+		queue->head = job;
+	}
+	queue->tail = job;
+}
+
+static struct Job *
+queuePop(struct JobQueue *queue)
+{
+	struct Job *job = queue->head;
+
+	if (job) {
+		queue->head = job->next;
+		if (!queue->head) queue->tail = NULL;
+	}
+
+	return job;
+}
+
+static void
+freeJob(struct Job *job)
+{
+	free(job->request);
+	free(job->response);
+	free(job);
+}
+
+static void
+worker(void *arg)
+{
+	struct Daemon *daemon = arg;
+	struct Job *job;
+	uint64_t one = 1;
+
+	for (;;) {
+		jriscMutexLock(daemon->lock);
+		while (!daemon->stopping && !daemon->pending.head) {
+			jriscCondWait(daemon->ready, daemon->lock);
+		}
+		job = queuePop(&daemon->pending);
+		jriscMutexUnlock(daemon->lock);
+
+		if (!job) return;
+
+		/* No response at all means out of memory; the client is dropped */
+		if (jriscServerHandle(daemon->server, job->request, job->requestSize,
+							  &job->response, &job->responseSize) !=
+			JRISC_success) {
+			job->response = NULL;
+		}
+
+		jriscMutexLock(daemon->lock);
+		queuePush(&daemon->done, job);
+		jriscMutexUnlock(daemon->lock);
+
+		if (write(daemon->doneFd, &one, sizeof(one)) != sizeof(one)) {
+			/* Only fails if the counter would overflow, so a wakeup is due */
+		}
+	}
+}
+
+static void
+watch(struct Daemon *daemon, struct Connection *conn)
+{
+	struct epoll_event event;
+
+	/* While a request is with a worker, nothing more is read */
+	memset(&event, 0, sizeof(event));
+	event.events = conn->out ? EPOLLOUT : (conn->busy ? 0 : EPOLLIN);
+	event.data.ptr = conn;
+
+	epoll_ctl(daemon->epollFd, EPOLL_CTL_MOD, conn->fd, &event);
+}
+
+static void
+closeConnection(struct Daemon *daemon, struct Connection *conn)
+{
+	epoll_ctl(daemon->epollFd, EPOLL_CTL_DEL, conn->fd, NULL);
+	close(conn->fd);
+	conn->fd = -1;
+	conn->closed = true;
+
+	/* Until a busy connection's job is back, the worker may still use it */
+	if (!conn->busy) {
+		conn->nextClosed = daemon->closed;
+		daemon->closed = conn;
+	}
+}
+
+static void
+freeClosed(struct Daemon *daemon)
+{
+	struct Connection *conn;
+
+	while ((conn = daemon->closed)) {
+		daemon->closed = conn->nextClosed;
+		free(conn->out);
+		free(conn);
+	}
+}
+
+/* Hand the next complete request in the connection's buffer to a worker */
+static void
+dispatch(struct Daemon *daemon, struct Connection *conn)
+{
+	struct Job *job;
+	uint32_t length;
+
+	if (conn->busy || conn->out) return;
+	if (conn->inUsed < JRISC_SERVER_FRAME_HEADER_SIZE) goto wait;
+
+	length = jriscLoadLE32(conn->in);
+	if (length > JRISC_SERVER_MAX_REQUEST) {
+		closeConnection(daemon, conn);
+		return;
+	}
+
+	if (conn->inUsed < (JRISC_SERVER_FRAME_HEADER_SIZE + length)) goto wait;
+
+	job = calloc(1, sizeof(*job));
+	if (job) job->request = malloc(length + 1);
+	if (!job || !job->request) {
+		free(job);
+		closeConnection(daemon, conn);
+		return;
+	}
+
+	job->conn = conn;
+	job->requestSize = length;
+	memcpy(job->request, &conn->in[JRISC_SERVER_FRAME_HEADER_SIZE], length);
+
+	conn->inUsed -= JRISC_SERVER_FRAME_HEADER_SIZE + length;
+	memmove(conn->in, &conn->in[JRISC_SERVER_FRAME_HEADER_SIZE + length],
+			conn->inUsed);
+	conn->busy = true;
+
+	jriscMutexLock(daemon->lock);
+	queuePush(&daemon->pending, job);
+	jriscCondSignal(daemon->ready);
+	jriscMutexUnlock(daemon->lock);
+
+wait:
+	watch(daemon, conn);
+}
+
+static void
+sendResponse(struct Daemon *daemon, struct Connection *conn)
+{
+	ssize_t sent;
+
+	while (conn->outSent < conn->outSize) {
+		sent = send(conn->fd, &conn->out[conn->outSent],
+					conn->outSize - conn->outSent, MSG_NOSIGNAL);
+		if (sent < 0) {
+			if (errno == EINTR) continue;
+			if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+				watch(daemon, conn);
+				return;
+			}
+
+			closeConnection(daemon, conn);
+			return;
+		}
+
+		conn->outSent += sent;
+	}
+
+	free(conn->out);
+	conn->out = NULL;
+
+	/* The client may have sent its next request already */
+	dispatch(daemon, conn);
+}
+
+static void
+receive(struct Daemon *daemon, struct Connection *conn)
+{
+	ssize_t received;
+
+	while (conn->inUsed < sizeof(conn->in)) {
+		received = recv(conn->fd, &conn->in[conn->inUsed],
+						sizeof(conn->in) - conn->inUsed, 0);
+		if (received < 0) {
+			if (errno == EINTR) continue;
+			if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) break;
+		}
+
+		if (received <= 0) {
+			closeConnection(daemon, conn);
+			return;
+		}
+
+		conn->inUsed += received;
+	}
+
+	dispatch(daemon, conn);
+}
+
+/* Frame the finished responses and start sending them */
+static void
+complete(struct Daemon *daemon)
+{
+	struct Connection *conn;
+	struct JobQueue done;
+	struct Job *job;
+	uint64_t count;
+
+	if (read(daemon->doneFd, &count, sizeof(count)) != sizeof(count)) return;
+
+	jriscMutexLock(daemon->lock);
+	done = daemon->done;
+	daemon->done.head = daemon->done.tail = NULL;
+	jriscMutexUnlock(daemon->lock);
+
+	while ((job = queuePop(&done))) {
+		conn = job->conn;
+		conn->busy = false;
+
+		if (conn->closed) {
+			conn->nextClosed = daemon->closed;
+			daemon->closed = conn;
+		} else if (!job->response) {
+			closeConnection(daemon, conn);
+		} else {
+			conn->out = malloc(JRISC_SERVER_FRAME_HEADER_SIZE +
+							   job->responseSize);
+			if (!conn->out) {
+				closeConnection(daemon, conn);
+			} else {
+				jriscStoreLE32(conn->out, (uint32_t)job->responseSize);
+				memcpy(&conn->out[JRISC_SERVER_FRAME_HEADER_SIZE],
+					   job->response, job->responseSize);
+				conn->outSize = JRISC_SERVER_FRAME_HEADER_SIZE +
+					job->responseSize;
+				conn->outSent = 0;
+				sendResponse(daemon, conn);
+			}
+		}
+
+		freeJob(job);
+	}
+}
+
+static void
+accepted(struct Daemon *daemon)
+{
+	struct Connection *conn;
+	struct epoll_event event;
+	int fd;
+
+	while ((fd = accept(daemon->listenFd, NULL, NULL)) >= 0) {
+		conn = calloc(1, sizeof(*conn));
+		if (!conn || (fcntl(fd, F_SETFL, O_NONBLOCK) < 0)) {
+			free(conn);
+			close(fd);
+			continue;
+		}
+
+		conn->fd = fd;
+
+		memset(&event, 0, sizeof(event));
+		event.events = EPOLLIN;
+		event.data.ptr = conn;
+		if (epoll_ctl(daemon->epollFd, EPOLL_CTL_ADD, fd, &event)) {
+			close(fd);
+			free(conn);
+		}
+	}
+}
+
+static bool
+addFd(struct Daemon *daemon, int fd, void *tag)
+{
+	struct epoll_event event;
+
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	event.data.ptr = tag;
+
+	return !epoll_ctl(daemon->epollFd, EPOLL_CTL_ADD, fd, &event);
+}
+
+static int
+listenOn(const char *socketPath)
+{
+	struct sockaddr_un addr;
+	struct stat st;
+	int fd;
+
+	if (strlen(socketPath) >= sizeof(addr.sun_path)) {
+		fprintf(stderr, "Socket path is too long\n");
+		return -1;
+	}
+
+	/* Replace a socket left behind by an earlier run, but nothing else */
+	if (!lstat(socketPath, &st)) {
+		if (!S_ISSOCK(st.st_mode)) {
+			fprintf(stderr, "%s exists and is not a socket\n", socketPath);
+			return -1;
+		}
+		unlink(socketPath);
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, socketPath);
+
+	fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (fd < 0) return -1;
+
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) ||
+		listen(fd, SOMAXCONN)) {
+		fprintf(stderr, "Could not listen on %s\n", socketPath);
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+static void
+run(struct Daemon *daemon)
+{
+	struct epoll_event events[MAX_EVENTS];
+	struct Connection *conn;
+	int numEvents;
+	int e;
+
+	for (;;) {
+		numEvents = epoll_wait(daemon->epollFd, events, MAX_EVENTS, -1);
+		if (numEvents < 0) {
+			if (errno == EINTR) continue;
+			return;
+		}
+
+		for (e = 0; e < numEvents; e++) {
+			if (events[e].data.ptr == &signalTag) return;
+
+			if (events[e].data.ptr == &listenTag) {
+				accepted(daemon);
+			} else if (events[e].data.ptr == &doneTag) {
+				complete(daemon);
+			} else {
+				conn = events[e].data.ptr;
+
+				/* An earlier event in this batch may have closed it */
+				if (conn->closed) continue;
+
+				/* Once both directions are shut, nothing can be answered */
+				if (events[e].events & (EPOLLHUP | EPOLLERR)) {
+					closeConnection(daemon, conn);
+				} else if (events[e].events & EPOLLOUT) {
+					sendResponse(daemon, conn);
+				} else if (events[e].events & EPOLLIN) {
+					receive(daemon, conn);
+				}
+			}
+		}
+
+		freeClosed(daemon);
+	}
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct Daemon daemon;
+	struct JRISC_ServerOptions options;
+	struct JRISC_Thread **threads;
+	const char *socketPath = NULL;
+	unsigned long numThreads = 0;
+	unsigned long value;
+	unsigned t;
+	sigset_t signals;
+	int i;
+	int j;
+	bool skipParam;
+	char *end;
+
+	memset(&options, 0, sizeof(options));
+	options.cpu = JRISC_gpu;
+	options.format = JRISC_imageAuto;
+	options.maxImages = DEFAULT_MAX_IMAGES;
+
+	for (i = 1; i < argc; i++) {
+		if (argv[i][0] == '-') {
+			for (j = 1, skipParam = false; !skipParam && argv[i][j]; j++) {
+				switch (argv[i][j]) {
+				case 'h':
+					usage();
+					exit(0);
+
+				case 'v':
+					version();
+					exit(0);
+
+				case 'g':
+					options.cpu = JRISC_gpu;
+					break;
+
+				case 'd':
+					options.cpu = JRISC_dsp;
+					break;
+
+				case 'l':
+					options.littleEndian = true;
+					break;
+
+				case 'R':
+					options.format = JRISC_imageRaw;
+					break;
+
+				case 'b':
+				case 'j':
+				case 'm':
+					if ((argv[i][j+1]) || (i + 1 >= argc)) {
+						usage();
+						exit(1);
+					}
+					errno = 0;
+					value = strtoul(argv[i + 1], &end, 0);
+					if ((errno != 0) || !argv[i + 1][0] || end[0]) {
+						printf("Error parsing -%c\n\n", argv[i][j]);
+						usage();
+						exit(1);
+					}
+					if (argv[i][j] == 'b') {
+						options.baseAddress = (uint32_t)value;
+						options.baseSpecified = true;
+					} else if (argv[i][j] == 'j') {
+						numThreads = value;
+					} else {
+						options.maxImages = (unsigned)value;
+					}
+					i++;
+					skipParam = true;
+					break;
+
+				default:
+					usage();
+					exit(1);
+				}
+			}
+		} else if (!socketPath) {
+			socketPath = argv[i];
+		} else {
+			usage();
+			exit(1);
+		}
+	}
+
+	if (!socketPath) {
+		usage();
+		exit(1);
+	}
+
+	if (!numThreads) numThreads = jriscThreadCpuCount();
+
+	memset(&daemon, 0, sizeof(daemon));
+
+	/* Signals are read from signalfd, so keep them from workers too */
+	sigemptyset(&signals);
+	sigaddset(&signals, SIGINT);
+	sigaddset(&signals, SIGTERM);
+	sigprocmask(SIG_BLOCK, &signals, NULL);
+
+	if ((jriscServerCreate(&options, &daemon.server) != JRISC_success) ||
+		(jriscMutexCreate(&daemon.lock) != JRISC_success) ||
+		(jriscCondCreate(&daemon.ready) != JRISC_success) ||
+		!(threads = calloc(numThreads, sizeof(*threads)))) {
+		fprintf(stderr, "Out of memory\n");
+		exit(1);
+	}
+
+	daemon.listenFd = listenOn(socketPath);
+	if (daemon.listenFd < 0) exit(1);
+
+	daemon.epollFd = epoll_create1(EPOLL_CLOEXEC);
+	daemon.doneFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	daemon.signalFd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+	if ((daemon.epollFd < 0) || (daemon.doneFd < 0) ||
+		(daemon.signalFd < 0) ||
+		!addFd(&daemon, daemon.listenFd, &listenTag) ||
+		!addFd(&daemon, daemon.doneFd, &doneTag) ||
+		!addFd(&daemon, daemon.signalFd, &signalTag)) {
+		fprintf(stderr, "Could not set up the event loop\n");
+		unlink(socketPath);
+		exit(1);
+	}
+
+	for (t = 0; t < numThreads; t++) {
+		if (jriscThreadCreate(worker, &daemon, &threads[t]) !=
+			JRISC_success) {
+			fprintf(stderr, "Could not start worker threads\n");
+			unlink(socketPath);
+			exit(1);
+		}
+	}
+
+	run(&daemon);
+
+	jriscMutexLock(daemon.lock);
+	daemon.stopping = true;
+	jriscCondBroadcast(daemon.ready);
+	jriscMutexUnlock(daemon.lock);
+
+	for (t = 0; t < numThreads; t++) jriscThreadJoin(threads[t]);
+
+	unlink(socketPath);
+
+	free(threads);
+	jriscCondDestroy(daemon.ready);
+	jriscMutexDestroy(daemon.lock);
+	jriscServerDestroy(daemon.server);
+
+	return 0;
+}
@@ -0,0 +1,423 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_dup.h"
+#include "jrisc_image.h"
+#include "jrisc_program.h"
+#include "jrisc_thread.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+/* Each file's routines, found by whichever worker thread took it */
+struct DupFile {
+	const char *name;
+	struct JRISC_DupRoutine *routines;
+	size_t numRoutines;
+	bool failed;
+};
+
+/* Files are shared out to worker threads as they go idle */
+struct DupJob {
+	struct DupFile *files;
+	unsigned numFiles;
+	unsigned nextFile;
+	struct JRISC_Mutex *lock;
+
+	const char **sectionNames;
+	unsigned numSectionNames;
+	enum JRISC_ImageFormat format;
+	enum JRISC_CPU cpu;
+	bool littleEndian;
+	bool baseSpecified;
+	uint32_t baseAddress;
+	unsigned minInstructions;
+};
+
+static void
+version(void)
+{
+	printf("Jaguar RISC Duplicate Routine Finder Version %d.%d.%d\n",
+		   JDIS_MAJOR, JDIS_MINOR, JDIS_MICRO);
+}
+
+static void
+usage(void)
+{
+	version();
+	printf("\n");
+	printf("Usage: jdup [-gdlRhv] [-b <base address>] [-m <instructions>] [-j <threads>] [-S <section>]... <file>...\n");
+	printf("\n");
+	printf("Options:\n");
+	printf("  -g: Parse code as Tom/GPU instructions [default].\n");
+	printf("  -d: Parse code as Jerry/DSP instructions.\n");
+	printf("  -l: Code is stored as little-endian (byte-swapped) 16-bit words.\n");
+	printf("  -R: Treat the files as raw machine code.\n");
+	printf("  -b <base address>: Specify the base load address of raw code.\n");
+	printf("  -m <instructions>: Ignore routines shorter than this [default: %d].\n",
+		   JRISC_DUP_MIN_INSTRUCTIONS);
+	printf("  -j <threads>: Read files on this many threads [default: one per\n");
+	printf("      CPU].\n");
+	printf("  -S <section>: Search the named or numbered section of each file.\n");
+	printf("      May be repeated. Defaults to every code section.\n");
+	printf("  -h: Help. Print this text.\n");
+	printf("  -v: Version. Print the version and exit.\n");
+	printf("\n");
+	printf("Lists routines found more than once across all the files, largest\n");
+	printf("  first. Routines match wherever they are linked and whatever they\n");
+	printf("  call. Copies that only differ in their registers or constants are\n");
+	printf("  listed together as variants.\n");
+}
+
+static bool
+addSection(const struct DupJob *job,
+		   struct DupFile *file,
+		   uint32_t source,
+		   const struct JRISC_Image *image,
+		   const struct JRISC_Section *imageSection)
+{
+	struct JRISC_Section section = *imageSection;
+	struct JRISC_Program *program;
+	struct JRISC_DupRoutine *routines;
+	struct JRISC_DupRoutine *newRoutines;
+	size_t numRoutines;
+	enum JRISC_Error err;
+
+	if (image->format == JRISC_imageRaw) {
+		if (job->baseSpecified) {
+			section.address = job->baseAddress;
+		} else {
+			section.address = (job->cpu == JRISC_gpu) ? JRISC_GPU_RAM :
+				JRISC_DSP_RAM;
+		}
+	}
+
+	if (jriscProgramFromSection(image, &section, job->cpu, &program) !=
+		JRISC_success) {
+		fprintf(stderr, "Failed to decode %s\n", file->name);
+		return false;
+	}
+
+	err = jriscDupFingerprint(program, source, job->minInstructions,
+							  &routines, &numRoutines);
+	jriscProgramDestroy(program);
+	if (err != JRISC_success) {
+		fprintf(stderr, "Out of memory\n");
+		return false;
+	}
+
+	newRoutines = realloc(file->routines, (file->numRoutines + numRoutines) *
+						  sizeof(*file->routines));
+	if (!newRoutines && (file->numRoutines + numRoutines)) {
+		fprintf(stderr, "Out of memory\n");
+		free(routines);
+		return false;
+	}
+
+	memcpy(newRoutines + file->numRoutines, routines,
+		   numRoutines * sizeof(*routines));
+	file->routines = newRoutines;
+	file->numRoutines += numRoutines;
+	free(routines);
+
+	return true;
+}
+
+static bool
+addFile(const struct DupJob *job, struct DupFile *file, uint32_t source)
+{
+	struct JRISC_Image *image;
+	const struct JRISC_Section *section;
+	bool ok = true;
+	unsigned s;
+
+	if (jriscImageOpen(file->name, job->format, &image) != JRISC_success) {
+		fprintf(stderr, "Could not open %s\n", file->name);
+		return false;
+	}
+
+	if (job->littleEndian) image->byteOrder = JRISC_littleEndian;
+
+	for (s = 0; ok && (s < job->numSectionNames); s++) {
+		section = jriscImageFindSection(image, job->sectionNames[s]);
+		if (!section) {
+			fprintf(stderr, "No section '%s' in %s\n",
+					job->sectionNames[s], file->name);
+			ok = false;
+		} else {
+			ok = addSection(job, file, source, image, section);
+		}
+	}
+
+	for (s = 0; ok && !job->numSectionNames && (s < image->numSections);
+		 s++) {
+		if (image->sections[s].flags & JRISC_SECTIONFLAG_CODE) {
+			ok = addSection(job, file, source, image, &image->sections[s]);
+		}
+	}
+
+	jriscImageDestroy(image);
+
+	return ok;
+}
+
+static void
+dupWorker(void *arg)
+{
+	struct DupJob *job = arg;
+	unsigned f;
+
+	for (;;) {
+		jriscMutexLock(job->lock);
+		f = job->nextFile;
+		if (f < job->numFiles) job->nextFile++;
+		jriscMutexUnlock(job->lock);
+
+		if (f >= job->numFiles) break;
+
+		job->files[f].failed = !addFile(job, &job->files[f], f);
+	}
+}
+
+/* Find every file's routines, each file on whichever thread is free */
+static bool
+findRoutines(struct DupJob *job, unsigned numThreads)
+{
+	struct JRISC_Thread **threads;
+	unsigned t, f;
+	bool ok = true;
+
+	if (!numThreads) numThreads = jriscThreadCpuCount();
+	if (numThreads > job->numFiles) numThreads = job->numFiles;
+
+	threads = calloc(numThreads, sizeof(*threads));
+	if (!threads || (jriscMutexCreate(&job->lock) != JRISC_success)) {
+		fprintf(stderr, "Out of memory\n");
+		exit(1);
+	}
+
+	/* The calling thread does the first worker's share itself */
+	for (t = 1; t < numThreads; t++) {
+		if (jriscThreadCreate(dupWorker, job, &threads[t]) != JRISC_success) {
+			threads[t] = NULL;
+		}
+	}
+
+	dupWorker(job);
+
+	for (t = 1; t < numThreads; t++) {
+		if (threads[t]) jriscThreadJoin(threads[t]);
+	}
+
+	jriscMutexDestroy(job->lock);
+	free(threads);
+
+	for (f = 0; f < job->numFiles; f++) {
+		if (job->files[f].failed) ok = false;
+	}
+
+	return ok;
+}
+
+static void
+printReport(const struct DupJob *job,
+			const struct JRISC_DupIndex *index,
+			const struct JRISC_DupReport *report)
+{
+	const struct JRISC_DupCluster *cluster;
+	const struct JRISC_DupMember *member;
+	const struct JRISC_DupRoutine *routine;
+	size_t c, m;
+
+	for (c = 0; c < report->numClusters; c++) {
+		cluster = &report->clusters[c];
+
+		printf("Cluster %zu: %u instructions, %zu copies, ", c + 1,
+			   (unsigned)cluster->numInstructions, cluster->numMembers);
+		if (cluster->numVariants == 1) {
+			printf("identical\n");
+		} else {
+			printf("%u variants\n", cluster->numVariants);
+		}
+
+		for (m = 0; m < cluster->numMembers; m++) {
+			member = &report->members[cluster->firstMember + m];
+			routine = jriscDupIndexRoutine(index, member->routine);
+
+			printf("\t%s $%06x", job->files[routine->source].name,
+				   (unsigned)routine->address);
+			if (cluster->numVariants > 1) {
+				printf(" variant %u", member->variant + 1);
+			}
+			printf("\n");
+		}
+	}
+
+	printf("%zu routines of at least %u instructions in %u files, "
+		   "%zu found more than once\n",
+		   jriscDupIndexNumRoutines(index), job->minInstructions,
+		   job->numFiles, report->numMembers);
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct DupJob job;
+	struct JRISC_DupIndex *index;
+	struct JRISC_DupReport *report;
+	unsigned numThreads = 0;
+	unsigned f;
+	int i;
+	int j;
+	bool skipParam;
+	char *end;
+
+	memset(&job, 0, sizeof(job));
+	job.format = JRISC_imageAuto;
+	job.cpu = JRISC_gpu;
+	job.minInstructions = JRISC_DUP_MIN_INSTRUCTIONS;
+
+	job.files = calloc(argc, sizeof(*job.files));
+	job.sectionNames = calloc(argc, sizeof(*job.sectionNames));
+	if (!job.files || !job.sectionNames) {
+		fprintf(stderr, "Out of memory\n");
+		exit(1);
+	}
+
+	for (i = 1; i < argc; i++) {
+		if (argv[i][0] == '-') {
+			for (j = 1, skipParam = false; !skipParam && argv[i][j]; j++) {
+				switch (argv[i][j]) {
+				case 'h':
+					usage();
+					exit(0);
+
+				case 'v':
+					version();
+					exit(0);
+
+				case 'g':
+					job.cpu = JRISC_gpu;
+					break;
+
+				case 'd':
+					job.cpu = JRISC_dsp;
+					break;
+
+				case 'l':
+					job.littleEndian = true;
+					break;
+
+				case 'R':
+					job.format = JRISC_imageRaw;
+					break;
+
+				case 'S':
+					if ((argv[i][j+1]) || (++i >= argc)) {
+						usage();
+						exit(1);
+					}
+					job.sectionNames[job.numSectionNames++] = argv[i];
+					skipParam = true;
+					break;
+
+				case 'b':
+					if ((argv[i][j+1]) || (++i >= argc)) {
+						usage();
+						exit(1);
+					}
+					errno = 0;
+					job.baseAddress = strtol(argv[i], &end, 0);
+					if ((errno != 0) || !argv[i][0] || end[0]) {
+						printf("Error parsing base address\n\n");
+						usage();
+						exit(1);
+					}
+					job.baseSpecified = true;
+					skipParam = true;
+					break;
+
+				case 'm':
+					if ((argv[i][j+1]) || (++i >= argc)) {
+						usage();
+						exit(1);
+					}
+					errno = 0;
+					job.minInstructions = strtoul(argv[i], &end, 0);
+					if ((errno != 0) || !argv[i][0] || end[0] ||
+						!job.minInstructions) {
+						printf("Error parsing minimum routine size\n\n");
+						usage();
+						exit(1);
+					}
+					skipParam = true;
+					break;
+
+				case 'j':
+					if ((argv[i][j+1]) || (++i >= argc)) {
+						usage();
+						exit(1);
+					}
+					errno = 0;
+					numThreads = strtoul(argv[i], &end, 0);
+					if ((errno != 0) || !argv[i][0] || end[0]) {
+						printf("Error parsing thread count\n\n");
+						usage();
+						exit(1);
+					}
+					skipParam = true;
+					break;
+
+				default:
+					usage();
+					exit(1);
+				}
+			}
+		} else {
+			job.files[job.numFiles++].name = argv[i];
+		}
+	}
+
+	if (!job.numFiles) {
+		usage();
+		exit(1);
+	}
+
+	if (!findRoutines(&job, numThreads)) exit(1);
+
+	/* Index the routines in file order, so the report doesn't vary */
+	if (jriscDupIndexCreate(&index) != JRISC_success) {
+		fprintf(stderr, "Out of memory\n");
+		exit(1);
+	}
+
+	for (f = 0; f < job.numFiles; f++) {
+		if (jriscDupIndexAdd(index, job.files[f].routines,
+							 job.files[f].numRoutines) != JRISC_success) {
+			fprintf(stderr, "Out of memory\n");
+			exit(1);
+		}
+		free(job.files[f].routines);
+	}
+
+	if (jriscDupIndexReport(index, &report) != JRISC_success) {
+		fprintf(stderr, "Out of memory\n");
+		exit(1);
+	}
+
+	printReport(&job, index, report);
+
+	jriscDupReportDestroy(report);
+	jriscDupIndexDestroy(index);
+	free(job.sectionNames);
+	free(job.files);
+
+	return 0;
+}
@@ -0,0 +1,323 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_ctx.h"
+#include "jrisc_grep.h"
+#include "jrisc_image.h"
+#include "jrisc_inst.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+struct GrepState {
+	const struct JRISC_Grep *grep;
+	const char *fileName;
+	bool countOnly;
+	bool showFileName;
+	unsigned long count;
+};
+
+static void
+version(void)
+{
+	printf("Jaguar RISC Instruction Search Version %d.%d.%d\n",
+		   JDIS_MAJOR, JDIS_MINOR, JDIS_MICRO);
+}
+
+static void
+usage(void)
+{
+	version();
+	printf("\n");
+	printf("Usage: jgrep [-gdlRchv] [-b <base address>] [-e <pattern>]... [-f <pattern file>] [<pattern>] <file>...\n");
+	printf("\n");
+	printf("Options:\n");
+	printf("  -g: Parse code as Tom/GPU instructions [default].\n");
+	printf("  -d: Parse code as Jerry/DSP instructions.\n");
+	printf("  -l: Code is stored as little-endian (byte-swapped) 16-bit words.\n");
+	printf("  -R: Treat the files as raw machine code.\n");
+	printf("  -b <base address>: Specify the base load address of raw code.\n");
+	printf("  -e <pattern>: Search for this pattern. May be given many times.\n");
+	printf("  -f <pattern file>: Search for each pattern in this file, one per\n");
+	printf("      line. Blank lines and lines starting with '//' are skipped.\n");
+	printf("  -c: Only print the number of matches in each file.\n");
+	printf("  -h: Help. Print this text.\n");
+	printf("  -v: Version. Print the version and exit.\n");
+	printf("\n");
+	printf("If neither -e nor -f is given, the first argument is the pattern.\n");
+	printf("  Patterns are instructions separated by ';', written as jdis prints\n");
+	printf("  them. '*' matches any instruction, or any operand or part of one,\n");
+	printf("  and %%name captures a value that must match wherever it is used\n");
+	printf("  again, e.g.:\n");
+	printf("\n");
+	printf("    jgrep 'movei #%%addr, %%r; jump (%%r)' game.abs\n");
+	printf("\n");
+	printf("  Exits with 0 if anything matched, 1 if nothing did, and 2 on\n");
+	printf("  error.\n");
+}
+
+static void
+addPattern(struct JRISC_Grep *grep, const char *pattern)
+{
+	switch (jriscGrepAddPattern(grep, pattern, NULL)) {
+	case JRISC_success:
+		break;
+
+	case JRISC_ERROR_invalidValue:
+		fprintf(stderr, "Invalid pattern: %s\n", pattern);
+		exit(2);
+
+	default:
+		fprintf(stderr, "Out of memory\n");
+		exit(2);
+	}
+}
+
+static void
+addPatternFile(struct JRISC_Grep *grep, const char *fileName)
+{
+	FILE *fp = fopen(fileName, "r");
+	char line[1024];
+	char *s;
+	size_t length;
+
+	if (!fp) {
+		fprintf(stderr, "Could not open %s\n", fileName);
+		exit(2);
+	}
+
+	while (fgets(line, sizeof(line), fp)) {
+		length = strcspn(line, "\r\n");
+		line[length] = '\0';
+
+		for (s = line; (*s == ' ') || (*s == '\t'); s++);
+		if (!*s || !strncmp(s, "//", 2)) continue;
+
+		addPattern(grep, s);
+	}
+
+	fclose(fp);
+}
+
+static void
+printMatch(void *userData, const struct JRISC_GrepMatch *match)
+{
+	struct GrepState *state = userData;
+	const char *name;
+	unsigned c;
+
+	state->count++;
+	if (state->countOnly) return;
+
+	if (state->showFileName) printf("%s:", state->fileName);
+	printf("%08x: %s", match->address,
+		   jriscGrepPatternString(state->grep, match->pattern));
+
+	for (c = 0; c < match->numCaptures; c++) {
+		name = jriscGrepCaptureName(state->grep, match->pattern, c);
+		printf("%s%s=$%x", c ? ", " : " [", name, match->captures[c]);
+	}
+
+	printf("%s\n", match->numCaptures ? "]" : "");
+}
+
+static void
+searchFile(struct JRISC_Grep *grep,
+		   struct GrepState *state,
+		   enum JRISC_ImageFormat format,
+		   enum JRISC_CPU cpu,
+		   bool littleEndian,
+		   bool baseSpecified,
+		   uint32_t baseAddress)
+{
+	struct JRISC_Image *image;
+	struct JRISC_Context *ctx;
+	struct JRISC_Section section;
+	unsigned i;
+
+	if (jriscImageOpen(state->fileName, format, &image) != JRISC_success) {
+		fprintf(stderr, "Could not open %s\n", state->fileName);
+		exit(2);
+	}
+
+	if (littleEndian) image->byteOrder = JRISC_littleEndian;
+
+	for (i = 0; i < image->numSections; i++) {
+		if (!(image->sections[i].flags & JRISC_SECTIONFLAG_CODE)) continue;
+
+		section = image->sections[i];
+		if (image->format == JRISC_imageRaw) {
+			if (baseSpecified) {
+				section.address = baseAddress;
+			} else {
+				section.address = (cpu == JRISC_gpu) ? JRISC_GPU_RAM :
+					JRISC_DSP_RAM;
+			}
+		}
+
+		if (jriscImageSectionContext(image, &section, &ctx) !=
+			JRISC_success) {
+			fprintf(stderr, "Failed to read %s\n", state->fileName);
+			exit(2);
+		}
+
+		if (jriscGrepScan(grep, ctx, section.size, cpu,
+						  printMatch, state) != JRISC_success) {
+			fprintf(stderr, "Out of memory\n");
+			exit(2);
+		}
+
+		jriscContextDestroy(ctx);
+	}
+
+	jriscImageDestroy(image);
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct JRISC_Grep *grep;
+	struct GrepState state;
+	const char **fileNames;
+	enum JRISC_CPU cpu = JRISC_gpu;
+	enum JRISC_ImageFormat format = JRISC_imageAuto;
+	bool littleEndian = false;
+	bool countOnly = false;
+	bool havePatterns = false;
+	bool baseSpecified = false;
+	uint32_t baseAddress = 0;
+	unsigned long total = 0;
+	unsigned numFiles = 0;
+	int i;
+	int j;
+	bool skipParam;
+	char *end;
+
+	if (jriscGrepCreate(&grep) != JRISC_success) {
+		fprintf(stderr, "Out of memory\n");
+		exit(2);
+	}
+
+	fileNames = calloc(argc, sizeof(*fileNames));
+	if (!fileNames) {
+		fprintf(stderr, "Out of memory\n");
+		exit(2);
+	}
+
+	for (i = 1; i < argc; i++) {
+		if (argv[i][0] == '-') {
+			for (j = 1, skipParam = false; !skipParam && argv[i][j]; j++) {
+				switch (argv[i][j]) {
+				case 'h':
+					usage();
+					exit(0);
+
+				case 'v':
+					version();
+					exit(0);
+
+				case 'g':
+					cpu = JRISC_gpu;
+					break;
+
+				case 'd':
+					cpu = JRISC_dsp;
+					break;
+
+				case 'l':
+					littleEndian = true;
+					break;
+
+				case 'R':
+					format = JRISC_imageRaw;
+					break;
+
+				case 'c':
+					countOnly = true;
+					break;
+
+				case 'e':
+					if ((argv[i][j+1]) || (++i >= argc)) {
+						usage();
+						exit(2);
+					}
+					addPattern(grep, argv[i]);
+					havePatterns = true;
+					skipParam = true;
+					break;
+
+				case 'f':
+					if ((argv[i][j+1]) || (++i >= argc)) {
+						usage();
+						exit(2);
+					}
+					addPatternFile(grep, argv[i]);
+					havePatterns = true;
+					skipParam = true;
+					break;
+
+				case 'b':
+					if ((argv[i][j+1]) || (++i >= argc)) {
+						usage();
+						exit(2);
+					}
+					errno = 0;
+					baseAddress = strtol(argv[i], &end, 0);
+					if ((errno != 0) || !argv[i][0] || end[0]) {
+						printf("Error parsing base address\n\n");
+						usage();
+						exit(2);
+					}
+					baseSpecified = true;
+					skipParam = true;
+					break;
+
+				default:
+					usage();
+					exit(2);
+				}
+			}
+		} else if (!havePatterns) {
+			addPattern(grep, argv[i]);
+			havePatterns = true;
+		} else {
+			fileNames[numFiles++] = argv[i];
+		}
+	}
+
+	if (!havePatterns || !numFiles) {
+		usage();
+		exit(2);
+	}
+
+	memset(&state, 0, sizeof(state));
+	state.grep = grep;
+	state.countOnly = countOnly;
+	state.showFileName = (numFiles > 1);
+
+	for (i = 0; i < (int)numFiles; i++) {
+		state.fileName = fileNames[i];
+		state.count = 0;
+
+		searchFile(grep, &state, format, cpu, littleEndian,
+				   baseSpecified, baseAddress);
+
+		if (countOnly) {
+			if (state.showFileName) printf("%s:", state.fileName);
+			printf("%lu\n", state.count);
+		}
+		total += state.count;
+	}
+
+	jriscGrepDestroy(grep);
+	free(fileNames);
+
+	return total ? 0 : 1;
+}
@@ -0,0 +1,290 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_ctx.h"
+#include "jrisc_ctx_file.h"
+#include "jrisc_image.h"
+#include "jrisc_inst.h"
+#include "jrisc_opt.h"
+#include "jrisc_program.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+static void
+version(void)
+{
+	printf("Jaguar RISC Peephole Optimizer Version %d.%d.%d\n",
+		   JDIS_MAJOR, JDIS_MINOR, JDIS_MICRO);
+}
+
+static void
+usage(void)
+{
+	version();
+	printf("\n");
+	printf("Usage: jopt [-gdlRnhv] [-b <base address>] [-S <section>] [-x <rule>]... <input file> [<output file>]\n");
+	printf("\n");
+	printf("Options:\n");
+	printf("  -g: Parse code as Tom/GPU instructions [default].\n");
+	printf("  -d: Parse code as Jerry/DSP instructions.\n");
+	printf("  -l: Code is stored as little-endian (byte-swapped) 16-bit words.\n");
+	printf("  -R: Treat the input as raw machine code.\n");
+	printf("  -b <base address>: Specify the base load address of raw code.\n");
+	printf("  -S <section>: Optimize the named or numbered section. Defaults to\n");
+	printf("      the first code section.\n");
+	printf("  -x <rule>: Don't apply the given rule. May be repeated.\n");
+	printf("  -n: Only print what would be saved; don't write any output.\n");
+	printf("  -h: Help. Print this text.\n");
+	printf("  -v: Version. Print the version and exit.\n");
+	printf("\n");
+	printf("Rules:\n");
+	printf("  moveq: Replace a movei of 0-31 with a moveq.\n");
+	printf("  move:  Delete moves of a register to itself.\n");
+	printf("  dead:  Delete instructions whose results are never used.\n");
+	printf("  delay: Move the instruction before a jump or jr into an empty\n");
+	printf("         (nop) delay slot.\n");
+	printf("  sched: Reorder each basic block to move instructions away from\n");
+	printf("         loads and divides they wait on. Also lets delay fill a\n");
+	printf("         slot with any instruction in the block that can move.\n");
+	printf("\n");
+	printf("The optimized code is written as raw machine code, in the same byte\n");
+	printf("  order as the input.\n");
+}
+
+static struct JRISC_Image *
+loadImage(const char *fileName,
+		  enum JRISC_ImageFormat format,
+		  const char *sectionName,
+		  enum JRISC_CPU cpu,
+		  bool littleEndian,
+		  bool baseSpecified,
+		  uint32_t baseAddress,
+		  struct JRISC_Section *sectionOut)
+{
+	struct JRISC_Image *image;
+	const struct JRISC_Section *found = NULL;
+	unsigned i;
+
+	if (jriscImageOpen(fileName, format, &image) != JRISC_success) {
+		fprintf(stderr, "Could not open %s\n", fileName);
+		exit(1);
+	}
+
+	if (sectionName) {
+		found = jriscImageFindSection(image, sectionName);
+	} else {
+		for (i = 0; !found && (i < image->numSections); i++) {
+			if (image->sections[i].flags & JRISC_SECTIONFLAG_CODE) {
+				found = &image->sections[i];
+			}
+		}
+	}
+
+	if (!found) {
+		fprintf(stderr, "No %s section in %s\n",
+				sectionName ? sectionName : "code", fileName);
+		exit(1);
+	}
+
+	*sectionOut = *found;
+	if (image->format == JRISC_imageRaw) {
+		if (baseSpecified) {
+			sectionOut->address = baseAddress;
+		} else {
+			sectionOut->address = (cpu == JRISC_gpu) ? JRISC_GPU_RAM :
+				JRISC_DSP_RAM;
+		}
+	}
+
+	if (littleEndian) image->byteOrder = JRISC_littleEndian;
+
+	return image;
+}
+
+static void
+writeProgram(const struct JRISC_Program *program,
+			 enum JRISC_ByteOrder byteOrder,
+			 const char *fileName)
+{
+	struct JRISC_Context *ctx;
+	FILE *fp = fopen(fileName, "wb");
+
+	if (!fp) {
+		fprintf(stderr, "Could not create %s\n", fileName);
+		exit(1);
+	}
+
+	if (jriscContextFromFile(NULL, 0, fp, 0, program->baseAddress, &ctx) !=
+		JRISC_success) {
+		fprintf(stderr, "Out of memory\n");
+		exit(1);
+	}
+
+	jriscContextSetByteOrder(ctx, byteOrder);
+
+	if ((jriscProgramWrite(program, ctx) != JRISC_success) || fclose(fp)) {
+		fprintf(stderr, "Failed to write %s\n", fileName);
+		exit(1);
+	}
+
+	jriscContextDestroy(ctx);
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct JRISC_Image *image;
+	struct JRISC_Section section;
+	struct JRISC_Program *program;
+	struct JRISC_Program *optimized;
+	struct JRISC_OptReport report;
+	const char *fileNames[2] = { NULL, NULL };
+	const char *sectionName = NULL;
+	enum JRISC_CPU cpu = JRISC_gpu;
+	enum JRISC_ImageFormat format = JRISC_imageAuto;
+	enum JRISC_Error err;
+	uint32_t rules = JRISC_OPT_ALL_RULES;
+	bool littleEndian = false;
+	bool dryRun = false;
+	bool baseSpecified = false;
+	uint32_t baseAddress = 0;
+	unsigned numFiles = 0;
+	unsigned r;
+	int i;
+	int j;
+	bool skipParam;
+	char *end;
+
+	for (i = 1; i < argc; i++) {
+		if (argv[i][0] == '-') {
+			for (j = 1, skipParam = false; !skipParam && argv[i][j]; j++) {
+				switch (argv[i][j]) {
+				case 'h':
+					usage();
+					exit(0);
+
+				case 'v':
+					version();
+					exit(0);
+
+				case 'g':
+					cpu = JRISC_gpu;
+					break;
+
+				case 'd':
+					cpu = JRISC_dsp;
+					break;
+
+				case 'l':
+					littleEndian = true;
+					break;
+
+				case 'R':
+					format = JRISC_imageRaw;
+					break;
+
+				case 'n':
+					dryRun = true;
+					break;
+
+				case 'S':
+					if ((argv[i][j+1]) || (++i >= argc)) {
+						usage();
+						exit(1);
+					}
+					sectionName = argv[i];
+					skipParam = true;
+					break;
+
+				case 'x':
+					if ((argv[i][j+1]) || (++i >= argc)) {
+						usage();
+						exit(1);
+					}
+					for (r = 0; r < JRISC_optNumRules; r++) {
+						if (!strcmp(argv[i], jriscOptRuleName(r))) break;
+					}
+					if (r >= JRISC_optNumRules) {
+						printf("Unknown rule '%s'\n\n", argv[i]);
+						usage();
+						exit(1);
+					}
+					rules &= ~JRISC_OPT_RULE(r);
+					skipParam = true;
+					break;
+
+				case 'b':
+					if ((argv[i][j+1]) || (++i >= argc)) {
+						usage();
+						exit(1);
+					}
+					errno = 0;
+					baseAddress = strtol(argv[i], &end, 0);
+					if ((errno != 0) || !argv[i][0] || end[0]) {
+						printf("Error parsing base address\n\n");
+						usage();
+						exit(1);
+					}
+					baseSpecified = true;
+					skipParam = true;
+					break;
+
+				default:
+					usage();
+					exit(1);
+				}
+			}
+		} else if (numFiles < 2) {
+			fileNames[numFiles++] = argv[i];
+		} else {
+			usage();
+			exit(1);
+		}
+	}
+
+	if (!numFiles || (!dryRun && (numFiles != 2))) {
+		usage();
+		exit(1);
+	}
+
+	image = loadImage(fileNames[0], format, sectionName, cpu, littleEndian,
+					  baseSpecified, baseAddress, &section);
+
+	if (jriscProgramFromSection(image, &section, cpu, &program) !=
+		JRISC_success) {
+		fprintf(stderr, "Failed to decode %s\n", fileNames[0]);
+		exit(1);
+	}
+
+	err = jriscOptimize(program, rules, &optimized, &report);
+	if (err == JRISC_ERROR_invalidValue) {
+		fprintf(stderr, "A jr out of the code would be out of range\n");
+		exit(1);
+	} else if (err != JRISC_success) {
+		fprintf(stderr, "Out of memory\n");
+		exit(1);
+	}
+
+	for (r = 0; r < JRISC_optNumRules; r++) {
+		printf("%-6s %zu\n", jriscOptRuleName(r), report.applied[r]);
+	}
+	printf("%zu -> %zu bytes (%zu saved), about %zu cycles saved\n",
+		   report.bytesBefore, report.bytesAfter,
+		   report.bytesBefore - report.bytesAfter, report.cyclesSaved);
+
+	if (!dryRun) writeProgram(optimized, image->byteOrder, fileNames[1]);
+
+	jriscProgramDestroy(optimized);
+	jriscProgramDestroy(program);
+	jriscImageDestroy(image);
+
+	return 0;
+}
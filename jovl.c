@@ -0,0 +1,262 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_image.h"
+#include "jrisc_overlay.h"
+#include "jrisc_program.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+static void
+version(void)
+{
+	printf("Jaguar RISC Overlay Planner Version %d.%d.%d\n",
+		   JDIS_MAJOR, JDIS_MINOR, JDIS_MICRO);
+}
+
+static void
+usage(void)
+{
+	version();
+	printf("\n");
+	printf("Usage: jovl [-gdlRhv] [-b <base address>] [-S <section>] <file>[@<entry>]...\n");
+	printf("\n");
+	printf("Options:\n");
+	printf("  -g: Parse code as Tom/GPU instructions [default].\n");
+	printf("  -d: Parse code as Jerry/DSP instructions.\n");
+	printf("  -l: Code is stored as little-endian (byte-swapped) 16-bit words.\n");
+	printf("  -R: Treat the inputs as raw machine code.\n");
+	printf("  -b <base address>: Specify the base load address of raw code.\n");
+	printf("  -S <section>: Measure the named or numbered section of each\n");
+	printf("      file. Defaults to the first code section.\n");
+	printf("  -h: Help. Print this text.\n");
+	printf("  -v: Version. Print the version and exit.\n");
+	printf("\n");
+	printf("Each file is an overlay uploaded to the same CPU's local RAM, and\n");
+	printf("  each frame runs them once in the order given. An overlay's entry\n");
+	printf("  point defaults to the image's entry point if that is in the\n");
+	printf("  section, or the start of the section otherwise.\n");
+}
+
+static struct JRISC_Image *
+loadImage(const char *fileName,
+		  enum JRISC_ImageFormat format,
+		  const char *sectionName,
+		  enum JRISC_CPU cpu,
+		  bool littleEndian,
+		  bool baseSpecified,
+		  uint32_t baseAddress,
+		  struct JRISC_Section *sectionOut)
+{
+	struct JRISC_Image *image;
+	const struct JRISC_Section *found = NULL;
+	unsigned i;
+
+	if (jriscImageOpen(fileName, format, &image) != JRISC_success) {
+		fprintf(stderr, "Could not open %s\n", fileName);
+		exit(1);
+	}
+
+	if (sectionName) {
+		found = jriscImageFindSection(image, sectionName);
+	} else {
+		for (i = 0; !found && (i < image->numSections); i++) {
+			if (image->sections[i].flags & JRISC_SECTIONFLAG_CODE) {
+				found = &image->sections[i];
+			}
+		}
+	}
+
+	if (!found) {
+		fprintf(stderr, "No %s section in %s\n",
+				sectionName ? sectionName : "code", fileName);
+		exit(1);
+	}
+
+	*sectionOut = *found;
+	if (image->format == JRISC_imageRaw) {
+		if (baseSpecified) {
+			sectionOut->address = baseAddress;
+		} else {
+			sectionOut->address = (cpu == JRISC_gpu) ? JRISC_GPU_RAM :
+				JRISC_DSP_RAM;
+		}
+	}
+
+	if (littleEndian) image->byteOrder = JRISC_littleEndian;
+
+	return image;
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct JRISC_Image **images;
+	struct JRISC_Program **programs;
+	struct JRISC_Section section;
+	struct JRISC_Overlay *overlays;
+	struct JRISC_OverlayPlan *plan;
+	char **fileNames;
+	const char *sectionName = NULL;
+	enum JRISC_CPU cpu = JRISC_gpu;
+	enum JRISC_ImageFormat format = JRISC_imageAuto;
+	enum JRISC_Error err;
+	bool littleEndian = false;
+	bool baseSpecified = false;
+	bool entrySpecified;
+	uint32_t baseAddress = 0;
+	unsigned numFiles = 0;
+	unsigned k;
+	int i;
+	int j;
+	bool skipParam;
+	char *at;
+	char *end;
+
+	fileNames = calloc(argc, sizeof(*fileNames));
+	images = calloc(argc, sizeof(*images));
+	programs = calloc(argc, sizeof(*programs));
+	overlays = calloc(argc, sizeof(*overlays));
+	if (!fileNames || !images || !programs || !overlays) {
+		fprintf(stderr, "Out of memory\n");
+		exit(1);
+	}
+
+	for (i = 1; i < argc; i++) {
+		if (argv[i][0] == '-') {
+			for (j = 1, skipParam = false; !skipParam && argv[i][j]; j++) {
+				switch (argv[i][j]) {
+				case 'h':
+					usage();
+					exit(0);
+
+				case 'v':
+					version();
+					exit(0);
+
+				case 'g':
+					cpu = JRISC_gpu;
+					break;
+
+				case 'd':
+					cpu = JRISC_dsp;
+					break;
+
+				case 'l':
+					littleEndian = true;
+					break;
+
+				case 'R':
+					format = JRISC_imageRaw;
+					break;
+
+				case 'S':
+					if ((argv[i][j+1]) || (++i >= argc)) {
+						usage();
+						exit(1);
+					}
+					sectionName = argv[i];
+					skipParam = true;
+					break;
+
+				case 'b':
+					if ((argv[i][j+1]) || (++i >= argc)) {
+						usage();
+						exit(1);
+					}
+					errno = 0;
+					baseAddress = strtol(argv[i], &end, 0);
+					if ((errno != 0) || !argv[i][0] || end[0]) {
+						printf("Error parsing base address\n\n");
+						usage();
+						exit(1);
+					}
+					baseSpecified = true;
+					skipParam = true;
+					break;
+
+				default:
+					usage();
+					exit(1);
+				}
+			}
+		} else {
+			fileNames[numFiles++] = argv[i];
+		}
+	}
+
+	if (!numFiles) {
+		usage();
+		exit(1);
+	}
+
+	for (k = 0; k < numFiles; k++) {
+		entrySpecified = false;
+		at = strrchr(fileNames[k], '@');
+		if (at) {
+			*at++ = '\0';
+			errno = 0;
+			overlays[k].entry = strtol(at, &end, 0);
+			if ((errno != 0) || !at[0] || end[0]) {
+				printf("Error parsing entry point of %s\n\n", fileNames[k]);
+				usage();
+				exit(1);
+			}
+			entrySpecified = true;
+		}
+
+		images[k] = loadImage(fileNames[k], format, sectionName, cpu,
+							  littleEndian, baseSpecified, baseAddress,
+							  &section);
+
+		if (jriscProgramFromSection(images[k], &section, cpu, &programs[k]) !=
+			JRISC_success) {
+			fprintf(stderr, "Failed to decode %s\n", fileNames[k]);
+			exit(1);
+		}
+
+		if (!entrySpecified) {
+			overlays[k].entry = section.address;
+			if (jriscProgramContains(programs[k], images[k]->entry)) {
+				overlays[k].entry = images[k]->entry;
+			}
+		}
+
+		overlays[k].name = fileNames[k];
+		overlays[k].program = programs[k];
+	}
+
+	err = jriscOverlayPlan(overlays, numFiles, &plan);
+	if (err == JRISC_ERROR_invalidValue) {
+		fprintf(stderr, "An entry point is outside its overlay's code\n");
+		exit(1);
+	} else if (err != JRISC_success) {
+		fprintf(stderr, "Out of memory\n");
+		exit(1);
+	}
+
+	if (jriscOverlayPlanWrite(overlays, plan, stdout) != JRISC_success) {
+		fprintf(stderr, "Failed to write the plan\n");
+		exit(1);
+	}
+
+	jriscOverlayPlanDestroy(plan);
+	for (k = 0; k < numFiles; k++) {
+		jriscProgramDestroy(programs[k]);
+		jriscImageDestroy(images[k]);
+	}
+	free(overlays);
+	free(programs);
+	free(images);
+	free(fileNames);
+
+	return 0;
+}
@@ -0,0 +1,212 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_image.h"
+#include "jrisc_program.h"
+#include "jrisc_recomp.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#define DEFAULT_NAME	"jriscRoutine"
+
+static void
+version(void)
+{
+	printf("Jaguar RISC Static Recompiler Version %d.%d.%d\n",
+		   JDIS_MAJOR, JDIS_MINOR, JDIS_MICRO);
+}
+
+static void
+usage(void)
+{
+	version();
+	printf("\n");
+	printf("Usage: jrecomp [-gdlRHhv] [-b <base address>] [-S <section>] [-n <name>] <file>\n");
+	printf("\n");
+	printf("Options:\n");
+	printf("  -g: Parse code as Tom/GPU instructions [default].\n");
+	printf("  -d: Parse code as Jerry/DSP instructions.\n");
+	printf("  -l: Code is stored as little-endian (byte-swapped) 16-bit words.\n");
+	printf("  -R: Treat the input as raw machine code.\n");
+	printf("  -b <base address>: Specify the base load address of raw code.\n");
+	printf("  -S <section>: Recompile the named or numbered section. Defaults\n");
+	printf("      to the first code section.\n");
+	printf("  -n <name>: Name the C function [default: %s].\n", DEFAULT_NAME);
+	printf("  -H: Write only the declarations, as a header.\n");
+	printf("  -h: Help. Print this text.\n");
+	printf("  -v: Version. Print the version and exit.\n");
+	printf("\n");
+	printf("Writes C to standard output that runs the code natively, from\n");
+	printf("  any instruction, on a struct holding its registers, flags and\n");
+	printf("  local RAM. It stops where the code leaves the section, for the\n");
+	printf("  caller to carry on.\n");
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct JRISC_Image *image;
+	struct JRISC_Program *program;
+	struct JRISC_Section section;
+	const struct JRISC_Section *found = NULL;
+	const char *fileName = NULL;
+	const char *sectionName = NULL;
+	const char *name = DEFAULT_NAME;
+	enum JRISC_CPU cpu = JRISC_gpu;
+	enum JRISC_ImageFormat format = JRISC_imageAuto;
+	enum JRISC_Error err;
+	bool littleEndian = false;
+	bool baseSpecified = false;
+	bool header = false;
+	uint32_t baseAddress = 0;
+	unsigned k;
+	int i;
+	int j;
+	bool skipParam;
+	char *end;
+
+	for (i = 1; i < argc; i++) {
+		if (argv[i][0] == '-') {
+			for (j = 1, skipParam = false; !skipParam && argv[i][j]; j++) {
+				switch (argv[i][j]) {
+				case 'h':
+					usage();
+					exit(0);
+
+				case 'v':
+					version();
+					exit(0);
+
+				case 'g':
+					cpu = JRISC_gpu;
+					break;
+
+				case 'd':
+					cpu = JRISC_dsp;
+					break;
+
+				case 'l':
+					littleEndian = true;
+					break;
+
+				case 'R':
+					format = JRISC_imageRaw;
+					break;
+
+				case 'H':
+					header = true;
+					break;
+
+				case 'S':
+					if ((argv[i][j+1]) || (++i >= argc)) {
+						usage();
+						exit(1);
+					}
+					sectionName = argv[i];
+					skipParam = true;
+					break;
+
+				case 'n':
+					if ((argv[i][j+1]) || (++i >= argc)) {
+						usage();
+						exit(1);
+					}
+					name = argv[i];
+					skipParam = true;
+					break;
+
+				case 'b':
+					if ((argv[i][j+1]) || (++i >= argc)) {
+						usage();
+						exit(1);
+					}
+					errno = 0;
+					baseAddress = strtol(argv[i], &end, 0);
+					if ((errno != 0) || !argv[i][0] || end[0]) {
+						printf("Error parsing base address\n\n");
+						usage();
+						exit(1);
+					}
+					baseSpecified = true;
+					skipParam = true;
+					break;
+
+				default:
+					usage();
+					exit(1);
+				}
+			}
+		} else if (!fileName) {
+			fileName = argv[i];
+		} else {
+			usage();
+			exit(1);
+		}
+	}
+
+	if (!fileName) {
+		usage();
+		exit(1);
+	}
+
+	if (jriscImageOpen(fileName, format, &image) != JRISC_success) {
+		fprintf(stderr, "Could not open %s\n", fileName);
+		exit(1);
+	}
+
+	if (sectionName) {
+		found = jriscImageFindSection(image, sectionName);
+	} else {
+		for (k = 0; !found && (k < image->numSections); k++) {
+			if (image->sections[k].flags & JRISC_SECTIONFLAG_CODE) {
+				found = &image->sections[k];
+			}
+		}
+	}
+
+	if (!found) {
+		fprintf(stderr, "No %s section in %s\n",
+				sectionName ? sectionName : "code", fileName);
+		exit(1);
+	}
+
+	section = *found;
+	if (image->format == JRISC_imageRaw) {
+		if (baseSpecified) {
+			section.address = baseAddress;
+		} else {
+			section.address = (cpu == JRISC_gpu) ? JRISC_GPU_RAM :
+				JRISC_DSP_RAM;
+		}
+	}
+
+	if (littleEndian) image->byteOrder = JRISC_littleEndian;
+
+	if (jriscProgramFromSection(image, &section, cpu, &program) !=
+		JRISC_success) {
+		fprintf(stderr, "Failed to decode %s\n", fileName);
+		exit(1);
+	}
+
+	err = jriscRecompWrite(program, name, header, stdout);
+	if (err == JRISC_ERROR_invalidValue) {
+		fprintf(stderr, "'%s' is not a C identifier\n", name);
+		exit(1);
+	} else if (err != JRISC_success) {
+		fprintf(stderr, "Failed to write the C\n");
+		exit(1);
+	}
+
+	jriscProgramDestroy(program);
+	jriscImageDestroy(image);
+
+	return 0;
+}
@@ -0,0 +1,294 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_bank.h"
+#include "jrisc_cfg.h"
+#include "jrisc_const.h"
+#include "jrisc_inst.h"
+#include "jrisc_live.h"
+#include "jrisc_program.h"
+#include "jrisc_regs.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Assign free registers to the loop's alternate bank registers */
+static void
+jriscBankHoist(struct JRISC_BankLoop *loop)
+{
+	JRISC_RegMask free = loop->free;
+	uint32_t used, pass;
+	unsigned alt, r;
+
+	memset(loop->hoistTo, JRISC_BANK_NO_REG, sizeof(loop->hoistTo));
+	if (loop->switchesBanks) return;
+
+	/* Values that bounce back and forth gain the most, so go first */
+	for (pass = 0; pass < 2; pass++) {
+		for (alt = 0; alt < 32; alt++) {
+			used = (loop->moveta[alt] || loop->movefa[alt]) ? 1 : 0;
+			if (!used || (((loop->bouncing >> alt) & 1) == pass)) continue;
+
+			for (r = 0; (r < 32) && !(free & JRISC_REGMASK_REG(r)); r++) {
+			}
+			if (r >= 32) return;
+
+			loop->hoistTo[alt] = (uint8_t)r;
+			free &= ~JRISC_REGMASK_REG(r);
+		}
+	}
+}
+
+/*
+ * Count what a loop does with the banks, and what it leaves free. <flagsRegs>
+ * are the registers some movei points at the flags register.
+ */
+static void
+jriscBankLoop(const struct JRISC_BankMap *map,
+			  const struct JRISC_Liveness *live,
+			  JRISC_RegMask flagsRegs,
+			  struct JRISC_BankLoop *loop)
+{
+	const struct JRISC_Program *program = map->program;
+	const struct JRISC_Cfg *cfg = map->constProp->cfg;
+	const struct JRISC_Block *first = &cfg->blocks[loop->firstBlock];
+	const struct JRISC_Block *last = &cfg->blocks[loop->lastBlock];
+	const uint32_t flags = (program->cpu == JRISC_dsp) ?
+		JRISC_DSP_FLAGS : JRISC_GPU_FLAGS;
+	const struct JRISC_Instruction *inst;
+	JRISC_RegMask reads, writes, mask, used = 0;
+	JRISC_RegMask liveIn, liveOut;
+	uint32_t address;
+	size_t i;
+	unsigned alt;
+
+	for (i = first->first; i < last->first + last->count; i++) {
+		inst = &program->instructions[i];
+		jriscInstructionRegMasks(inst, &reads, &writes);
+		used |= reads | writes;
+
+		if (inst->opName == JRISC_op_moveta) {
+			loop->moveta[inst->regDst.val.reg]++;
+		} else if (inst->opName == JRISC_op_movefa) {
+			loop->movefa[inst->regSrc.val.reg]++;
+		} else if (inst->opName == JRISC_op_store) {
+			/*
+			 * The store itself makes everything unknown, so after the first
+			 * time round, the address is only known to be whatever the
+			 * register was pointed at.
+			 */
+			mask = JRISC_REGMASK_REG(inst->regSrc.val.reg);
+			if (jriscConstPropAddress(map->constProp, i, &address) ?
+				(address == flags) : ((flagsRegs & mask) != 0)) {
+				loop->switchesBanks = true;
+			}
+		}
+	}
+
+	for (alt = 0; alt < 32; alt++) {
+		if (loop->moveta[alt] && loop->movefa[alt]) {
+			loop->bouncing |= 1u << alt;
+			loop->roundTrips += (loop->moveta[alt] < loop->movefa[alt]) ?
+				loop->moveta[alt] : loop->movefa[alt];
+		}
+	}
+
+	jriscLivenessAtIndex(live, first->first, &liveIn, &liveOut);
+	loop->free = JRISC_REGMASK_REGS & ~used & ~liveIn;
+
+	jriscBankHoist(loop);
+}
+
+static bool
+jriscBankLoopUsesAlt(const struct JRISC_BankLoop *loop)
+{
+	unsigned alt;
+
+	for (alt = 0; alt < 32; alt++) {
+		if (loop->moveta[alt] || loop->movefa[alt]) return true;
+	}
+
+	return false;
+}
+
+enum JRISC_Error
+jriscBankMapCompute(const struct JRISC_Program *program,
+					struct JRISC_BankMap **mapOut)
+{
+	struct JRISC_BankMap *map;
+	struct JRISC_Liveness *live = NULL;
+	struct JRISC_Loop *loops = NULL;
+	unsigned *depths = NULL;
+	const struct JRISC_Instruction *inst;
+	const uint32_t flags = (program->cpu == JRISC_dsp) ?
+		JRISC_DSP_FLAGS : JRISC_GPU_FLAGS;
+	JRISC_RegMask reads, writes;
+	JRISC_RegMask flagsRegs = 0;
+	size_t numLoops = 0;
+	size_t i, k;
+	unsigned r;
+	enum JRISC_Error ret;
+
+	map = calloc(1, sizeof(*map));
+	if (!map) return JRISC_ERROR_outOfMemory;
+
+	map->program = program;
+	ret = jriscConstPropCompute(program, &map->constProp);
+	if (ret != JRISC_success) goto done;
+
+	ret = jriscLivenessCompute(program, &live);
+	if (ret != JRISC_success) goto done;
+
+	for (i = 0; i < program->numInstructions; i++) {
+		inst = &program->instructions[i];
+		jriscInstructionRegMasks(inst, &reads, &writes);
+
+		for (r = 0; r < 32; r++) {
+			if (reads & JRISC_REGMASK_REG(r)) map->reads[r]++;
+			if (writes & JRISC_REGMASK_REG(r)) map->writes[r]++;
+		}
+
+		if (inst->opName == JRISC_op_moveta) {
+			map->moveta[inst->regDst.val.reg]++;
+		} else if (inst->opName == JRISC_op_movefa) {
+			map->movefa[inst->regSrc.val.reg]++;
+		} else if ((inst->opName == JRISC_op_movei) &&
+				   (inst->longImmediate == flags)) {
+			flagsRegs |= JRISC_REGMASK_REG(inst->regDst.val.reg);
+		}
+	}
+
+	ret = JRISC_ERROR_outOfMemory;
+	depths = malloc((map->constProp->cfg->numBlocks + 1) * sizeof(*depths));
+	if (!depths) goto done;
+
+	ret = jriscCfgFindLoops(map->constProp->cfg, &loops, &numLoops, depths);
+	if (ret != JRISC_success) goto done;
+
+	ret = JRISC_ERROR_outOfMemory;
+	map->loops = calloc(numLoops + 1, sizeof(*map->loops));
+	if (!map->loops) goto done;
+
+	for (k = 0; k < numLoops; k++) {
+		map->loops[map->numLoops].firstBlock = loops[k].firstBlock;
+		map->loops[map->numLoops].lastBlock = loops[k].lastBlock;
+		map->loops[map->numLoops].depth = loops[k].depth;
+		jriscBankLoop(map, live, flagsRegs, &map->loops[map->numLoops]);
+
+		if (jriscBankLoopUsesAlt(&map->loops[map->numLoops])) {
+			map->numLoops++;
+		} else {
+			memset(&map->loops[map->numLoops], 0, sizeof(*map->loops));
+		}
+	}
+
+	ret = JRISC_success;
+
+done:
+	free(loops);
+	free(depths);
+	if (live) jriscLivenessDestroy(live);
+
+	if (ret == JRISC_success) {
+		*mapOut = map;
+	} else {
+		jriscBankMapDestroy(map);
+	}
+
+	return ret;
+}
+
+void
+jriscBankMapDestroy(struct JRISC_BankMap *map)
+{
+	if (!map) return;
+
+	if (map->constProp) jriscConstPropDestroy(map->constProp);
+	free(map->loops);
+	free(map);
+}
+
+/* Print a set of registers, or "none" */
+static void
+jriscBankWriteRegs(JRISC_RegMask mask, FILE *fp)
+{
+	char text[160];
+	size_t length = sizeof(text);
+
+	jriscRegMaskToString(mask, text, &length);
+	fprintf(fp, "%s\n", mask ? text : "none");
+}
+
+enum JRISC_Error
+jriscBankMapWrite(const struct JRISC_BankMap *map, FILE *fp)
+{
+	const struct JRISC_Program *program = map->program;
+	const struct JRISC_Cfg *cfg = map->constProp->cfg;
+	const struct JRISC_Block *first, *last;
+	const struct JRISC_Instruction *end;
+	const struct JRISC_BankLoop *loop;
+	JRISC_RegMask current = 0, alternate = 0;
+	size_t moveta = 0, movefa = 0;
+	size_t loopMoveta, loopMovefa;
+	size_t k;
+	unsigned r;
+
+	for (r = 0; r < 32; r++) {
+		if (map->reads[r] || map->writes[r]) current |= JRISC_REGMASK_REG(r);
+		if (map->moveta[r] || map->movefa[r]) {
+			alternate |= JRISC_REGMASK_REG(r);
+		}
+		moveta += map->moveta[r];
+		movefa += map->movefa[r];
+	}
+
+	fprintf(fp, "Current bank: ");
+	jriscBankWriteRegs(current, fp);
+	fprintf(fp, "Alternate bank: ");
+	jriscBankWriteRegs(alternate, fp);
+	fprintf(fp, "%zu moveta, %zu movefa\n", moveta, movefa);
+
+	for (k = 0; k < map->numLoops; k++) {
+		loop = &map->loops[k];
+		first = &cfg->blocks[loop->firstBlock];
+		last = &cfg->blocks[loop->lastBlock];
+		end = &program->instructions[last->first + last->count - 1];
+
+		loopMoveta = loopMovefa = 0;
+		for (r = 0; r < 32; r++) {
+			loopMoveta += loop->moveta[r];
+			loopMovefa += loop->movefa[r];
+		}
+
+		fprintf(fp, "\nLoop $%x-$%x, depth %u: %zu moveta, %zu movefa, "
+				"%zu round trips\n",
+				program->instructions[first->first].address,
+				end->address + jriscProgramInstructionSize(end) - 1,
+				loop->depth, loopMoveta, loopMovefa, loop->roundTrips);
+
+		for (r = 0; r < 32; r++) {
+			if (!loop->moveta[r] && !loop->movefa[r]) continue;
+
+			fprintf(fp, "  alt r%u: %u moveta, %u movefa%s", r,
+					loop->moveta[r], loop->movefa[r],
+					((loop->bouncing >> r) & 1) ? ", bounces" : "");
+			if (loop->hoistTo[r] != JRISC_BANK_NO_REG) {
+				fprintf(fp, "; keep in r%u", loop->hoistTo[r]);
+			}
+			fprintf(fp, "\n");
+		}
+
+		if (loop->switchesBanks) {
+			fprintf(fp, "  May switch banks\n");
+		} else {
+			fprintf(fp, "  Free: ");
+			jriscBankWriteRegs(loop->free, fp);
+		}
+	}
+
+	return ferror(fp) ? JRISC_ERROR_ioError : JRISC_success;
+}
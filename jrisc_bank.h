@@ -0,0 +1,101 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#ifndef JRISC_BANK_H_
+#define JRISC_BANK_H_
+
+#include "jrisc_base.h"
+#include "jrisc_cfg.h"
+#include "jrisc_const.h"
+#include "jrisc_program.h"
+#include "jrisc_regs.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#define JRISC_BANK_NO_REG	0xff
+
+/* What a loop does with the alternate register bank */
+struct JRISC_BankLoop {
+	uint32_t firstBlock;
+	uint32_t lastBlock;
+	unsigned depth;			/* 1 for an outermost loop */
+
+	/* By alternate bank register */
+	uint32_t moveta[32];
+	uint32_t movefa[32];
+
+	/*
+	 * A moveta matched with a movefa of the same register, e.g. a value
+	 * fetched from the other bank, updated and put back each time round
+	 */
+	size_t roundTrips;
+
+	/* Alternate bank registers both written and read in the loop */
+	uint32_t bouncing;
+
+	/*
+	 * Current bank registers the loop neither uses nor needs kept, so any of
+	 * them could hold an alternate bank register for the whole loop
+	 */
+	JRISC_RegMask free;
+
+	/*
+	 * By alternate bank register: a free register suggested to hold it,
+	 * moved in before the loop and back out after it, or JRISC_BANK_NO_REG
+	 */
+	uint8_t hoistTo[32];
+
+	/*
+	 * A store to the flags register, or through a register a movei pointed
+	 * at it, may swap the banks, so no suggestions are made
+	 */
+	bool switchesBanks;
+};
+
+struct JRISC_BankMap {
+	const struct JRISC_Program *program;
+	struct JRISC_ConstProp *constProp;	/* Its control flow graph's blocks */
+
+	/* Instructions reading and writing each current bank register */
+	size_t reads[32];
+	size_t writes[32];
+
+	/* By alternate bank register, over the whole program */
+	size_t moveta[32];
+	size_t movefa[32];
+
+	/* Only loops that use the alternate bank, in order of their first block */
+	struct JRISC_BankLoop *loops;
+	size_t numLoops;
+};
+
+/*
+ * Count how each bank's registers are used, and find the loops that move
+ * values to and from the alternate bank with moveta and movefa. For each
+ * such loop, suggest current bank registers that are free throughout it to
+ * keep those values in instead, bouncing values first.
+ *
+ * A register is free in a loop if no instruction in the loop reads or writes
+ * it and liveness shows its value isn't needed on entry to the loop. Loops are
+ * found as jriscCfgFindLoops does, on the graph constant propagation builds.
+ *
+ * <program> must outlive the result.
+ */
+extern enum JRISC_Error
+jriscBankMapCompute(const struct JRISC_Program *program,
+					struct JRISC_BankMap **mapOut);
+
+extern void
+jriscBankMapDestroy(struct JRISC_BankMap *map);
+
+/* Print the register counts, then each loop with its suggestions */
+extern enum JRISC_Error
+jriscBankMapWrite(const struct JRISC_BankMap *map, FILE *fp);
+
+#endif /* JRISC_BANK_H_ */
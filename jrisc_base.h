@@ -16,4 +16,13 @@ enum JRISC_Error {
 #define JRISC_GPU_RAM 0xf03000
 #define JRISC_DSP_RAM 0xf1b000
 
+#define JRISC_GPU_RAM_SIZE 0x1000
+#define JRISC_DSP_RAM_SIZE 0x2000
+
+#define JRISC_GPU_FLAGS 0xf02100
+#define JRISC_DSP_FLAGS 0xf1a100
+
+#define JRISC_HARDWARE 0xf00000
+#define JRISC_HARDWARE_SIZE 0x100000
+
 #endif /* JRISC_BASE_H_ */
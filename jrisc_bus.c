@@ -0,0 +1,521 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_bus.h"
+#include "jrisc_cfg.h"
+#include "jrisc_const.h"
+#include "jrisc_inst.h"
+#include "jrisc_inst_string.h"
+#include "jrisc_program.h"
+#include "jrisc_regs.h"
+#include "jrisc_sym.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* The region each of r0-r31 points into */
+struct BusRegs {
+	uint8_t regions[32];
+};
+
+static const char *jriscBusRegionNames[] = {
+	"local",
+	"hardware",
+	"external",
+	"unknown",
+};
+
+enum JRISC_BusRegion
+jriscBusRegion(enum JRISC_CPU cpu, uint32_t address)
+{
+	const uint32_t ram = (cpu == JRISC_dsp) ? JRISC_DSP_RAM : JRISC_GPU_RAM;
+	const uint32_t ramSize = (cpu == JRISC_dsp) ?
+		JRISC_DSP_RAM_SIZE : JRISC_GPU_RAM_SIZE;
+
+	if ((address - ram) < ramSize) return JRISC_busLocal;
+	if ((address - JRISC_HARDWARE) < JRISC_HARDWARE_SIZE) {
+		return JRISC_busHardware;
+	}
+
+	return JRISC_busExternal;
+}
+
+const char *
+jriscBusRegionName(enum JRISC_BusRegion region)
+{
+	if (region >= JRISC_busNumRegions) return "?";
+
+	return jriscBusRegionNames[region];
+}
+
+/* The register holding a load or store's address, or its base for (rN+x) */
+static bool
+jriscBusAddressReg(const struct JRISC_Instruction *inst,
+				   enum JRISC_Reg *regOut,
+				   bool *storeOut)
+{
+	switch (inst->opName) {
+	case JRISC_op_loadb:		/* Fall through */
+	case JRISC_op_loadw:		/* Fall through */
+	case JRISC_op_load:			/* Fall through */
+	case JRISC_op_loadp:
+		*regOut = inst->regSrc.val.reg;
+		*storeOut = false;
+		return true;
+
+	case JRISC_op_storeb:		/* Fall through */
+	case JRISC_op_storew:		/* Fall through */
+	case JRISC_op_store:		/* Fall through */
+	case JRISC_op_storep:
+		*regOut = inst->regSrc.val.reg;
+		*storeOut = true;
+		return true;
+
+	case JRISC_op_loadr14n:		/* Fall through */
+	case JRISC_op_loadr14r:
+		*regOut = r14;
+		*storeOut = false;
+		return true;
+
+	case JRISC_op_loadr15n:		/* Fall through */
+	case JRISC_op_loadr15r:
+		*regOut = r15;
+		*storeOut = false;
+		return true;
+
+	case JRISC_op_storer14n:	/* Fall through */
+	case JRISC_op_storer14r:
+		*regOut = r14;
+		*storeOut = true;
+		return true;
+
+	case JRISC_op_storer15n:	/* Fall through */
+	case JRISC_op_storer15r:
+		*regOut = r15;
+		*storeOut = true;
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+/* Step forward over instruction <index>, updating where registers point */
+static void
+jriscBusStep(const struct JRISC_BusMap *map,
+			 size_t index,
+			 struct BusRegs *regs)
+{
+	const struct JRISC_Program *program = map->program;
+	const struct JRISC_Instruction *inst = &program->instructions[index];
+	const uint32_t flags = (program->cpu == JRISC_dsp) ?
+		JRISC_DSP_FLAGS : JRISC_GPU_FLAGS;
+	const uint8_t srcRegion = (inst->regSrc.type == JRISC_reg) ?
+		regs->regions[inst->regSrc.val.reg] : JRISC_busUnknown;
+	const uint8_t dstRegion = (inst->regDst.type == JRISC_reg) ?
+		regs->regions[inst->regDst.val.reg] : JRISC_busUnknown;
+	JRISC_RegMask reads, writes;
+	uint32_t address;
+	unsigned r;
+
+	jriscInstructionRegMasks(inst, &reads, &writes);
+	for (r = 0; r < 32; r++) {
+		if (writes & JRISC_REGMASK_REG(r)) {
+			regs->regions[r] = JRISC_busUnknown;
+		}
+	}
+
+	switch (inst->opName) {
+	case JRISC_op_movei:
+		regs->regions[inst->regDst.val.reg] =
+			jriscBusRegion(program->cpu, inst->longImmediate);
+		break;
+
+	case JRISC_op_move:
+		regs->regions[inst->regDst.val.reg] = srcRegion;
+		break;
+
+	/* Stepping a pointer, or adding an index to it, rarely leaves a region */
+	case JRISC_op_add:			/* Fall through */
+	case JRISC_op_addq:			/* Fall through */
+	case JRISC_op_addqt:		/* Fall through */
+	case JRISC_op_sub:			/* Fall through */
+	case JRISC_op_subq:			/* Fall through */
+	case JRISC_op_subqt:
+		regs->regions[inst->regDst.val.reg] = dstRegion;
+		break;
+
+	case JRISC_op_store:
+		/* Writing the flags register may switch register banks */
+		if (jriscConstPropAddress(map->constProp, index, &address) &&
+			(address == flags)) {
+			memset(regs->regions, JRISC_busUnknown, sizeof(regs->regions));
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+
+/*
+ * Solve for where each register points on entry to each block, as constant
+ * propagation does for values: forward, with a worklist, keeping a region
+ * only where every incoming edge agrees on it.
+ */
+static enum JRISC_Error
+jriscBusSolve(const struct JRISC_BusMap *map, struct BusRegs *blockRegs)
+{
+	const struct JRISC_Program *program = map->program;
+	const struct JRISC_Cfg *cfg = map->constProp->cfg;
+	const size_t numBlocks = cfg->numBlocks;
+	const struct JRISC_Block *block;
+	struct BusRegs regs;
+	struct BusRegs *in;
+	uint32_t *stack = NULL;
+	uint8_t *queued = NULL;
+	uint8_t *reached = NULL;
+	uint8_t *entry = NULL;
+	size_t numStack;
+	size_t b, e, i;
+	uint32_t s, r, target;
+	bool changed;
+	enum JRISC_Error ret = JRISC_ERROR_outOfMemory;
+
+	stack = malloc((numBlocks + 1) * sizeof(*stack));
+	queued = calloc(numBlocks + 1, 1);
+	reached = calloc(numBlocks + 1, 1);
+	entry = malloc(numBlocks + 1);
+	if (!stack || !queued || !reached || !entry) goto done;
+
+	/* The same entry points as constant propagation, knowing nothing */
+	memset(entry, 1, numBlocks + 1);
+	for (b = 0; b < numBlocks; b++) {
+		block = &cfg->blocks[b];
+		for (e = 0; e < block->numSuccessors; e++) {
+			entry[cfg->edges[block->firstSuccessor + e]] = 0;
+		}
+	}
+	if (numBlocks) entry[0] = 1;
+
+	for (i = 0; i < program->numInstructions; i++) {
+		if ((program->instructions[i].opName == JRISC_op_jump) &&
+			jriscConstPropAddress(map->constProp, i, &s)) {
+			target = jriscProgramFind(program, s);
+			if (target != JRISC_PROGRAM_NO_INSTRUCTION) {
+				entry[jriscCfgFindBlock(cfg, target)] = 1;
+			}
+		}
+	}
+
+	numStack = 0;
+	for (b = numBlocks; b-- > 0;) {
+		memset(blockRegs[b].regions, JRISC_busUnknown,
+			   sizeof(blockRegs[b].regions));
+		if (!entry[b]) continue;
+		reached[b] = queued[b] = 1;
+		stack[numStack++] = (uint32_t)b;
+	}
+
+	while (numStack) {
+		b = stack[--numStack];
+		queued[b] = 0;
+		block = &cfg->blocks[b];
+		regs = blockRegs[b];
+
+		for (i = block->first; i < block->first + block->count; i++) {
+			jriscBusStep(map, i, &regs);
+		}
+
+		for (e = 0; e < block->numSuccessors; e++) {
+			s = cfg->edges[block->firstSuccessor + e];
+			if (entry[s]) continue;
+			in = &blockRegs[s];
+
+			if (!reached[s]) {
+				reached[s] = 1;
+				*in = regs;
+			} else {
+				changed = false;
+				for (r = 0; r < 32; r++) {
+					if ((in->regions[r] != regs.regions[r]) &&
+						(in->regions[r] != JRISC_busUnknown)) {
+						in->regions[r] = JRISC_busUnknown;
+						changed = true;
+					}
+				}
+				if (!changed) continue;
+			}
+
+			if (!queued[s]) {
+				queued[s] = 1;
+				stack[numStack++] = s;
+			}
+		}
+	}
+
+	ret = JRISC_success;
+
+done:
+	free(entry);
+	free(reached);
+	free(queued);
+	free(stack);
+
+	return ret;
+}
+
+/* Group back edges into loops, and count what each loop and block does */
+static enum JRISC_Error
+jriscBusLoops(struct JRISC_BusMap *map)
+{
+	const struct JRISC_Cfg *cfg = map->constProp->cfg;
+	const size_t numBlocks = cfg->numBlocks;
+	struct JRISC_BusLoop *loop;
+	struct JRISC_Loop *loops = NULL;
+	unsigned *depths = NULL;
+	size_t (*sums)[JRISC_busNumRegions] = NULL;
+	size_t b, e, k;
+	enum JRISC_Error ret = JRISC_ERROR_outOfMemory;
+
+	depths = malloc((numBlocks + 1) * sizeof(*depths));
+	sums = calloc(numBlocks + 1, sizeof(*sums));
+	if (!depths || !sums) goto done;
+
+	ret = jriscCfgFindLoops(cfg, &loops, &map->numLoops, depths);
+	if (ret != JRISC_success) goto done;
+
+	ret = JRISC_ERROR_outOfMemory;
+	map->loops = calloc(map->numLoops + 1, sizeof(*map->loops));
+	if (!map->loops) goto done;
+
+	/* Running totals, so each loop's counts are one subtraction */
+	for (b = 0; b < numBlocks; b++) {
+		map->blocks[b].loopDepth = depths[b];
+
+		for (k = 0; k < JRISC_busNumRegions; k++) {
+			sums[b + 1][k] = sums[b][k] + map->blocks[b].counts[k];
+		}
+	}
+
+	for (k = 0; k < map->numLoops; k++) {
+		loop = &map->loops[k];
+		loop->firstBlock = loops[k].firstBlock;
+		loop->lastBlock = loops[k].lastBlock;
+		loop->depth = loops[k].depth;
+
+		for (e = 0; e < JRISC_busNumRegions; e++) {
+			loop->counts[e] = sums[loop->lastBlock + 1][e] -
+				sums[loop->firstBlock][e];
+		}
+	}
+
+	ret = JRISC_success;
+
+done:
+	free(loops);
+	free(sums);
+	free(depths);
+
+	return ret;
+}
+
+enum JRISC_Error
+jriscBusMapCompute(const struct JRISC_Program *program,
+				   struct JRISC_BusMap **mapOut)
+{
+	struct JRISC_BusMap *map;
+	const struct JRISC_Cfg *cfg;
+	const struct JRISC_Block *block;
+	struct JRISC_BusAccess *access;
+	struct BusRegs *blockRegs = NULL;
+	struct BusRegs regs;
+	enum JRISC_Reg reg;
+	size_t b, i;
+	bool store;
+	enum JRISC_Error ret = JRISC_ERROR_outOfMemory;
+
+	map = calloc(1, sizeof(*map));
+	if (!map) return JRISC_ERROR_outOfMemory;
+
+	map->program = program;
+	ret = jriscConstPropCompute(program, &map->constProp);
+	if (ret != JRISC_success) goto done;
+	ret = JRISC_ERROR_outOfMemory;
+	cfg = map->constProp->cfg;
+
+	for (i = 0; i < program->numInstructions; i++) {
+		if (jriscBusAddressReg(&program->instructions[i], &reg, &store)) {
+			map->numAccesses++;
+		}
+	}
+
+	map->accesses = calloc(map->numAccesses + 1, sizeof(*map->accesses));
+	map->blocks = calloc(cfg->numBlocks + 1, sizeof(*map->blocks));
+	blockRegs = malloc((cfg->numBlocks + 1) * sizeof(*blockRegs));
+	if (!map->accesses || !map->blocks || !blockRegs) goto done;
+
+	ret = jriscBusSolve(map, blockRegs);
+	if (ret != JRISC_success) goto done;
+	ret = JRISC_ERROR_outOfMemory;
+
+	map->numAccesses = 0;
+	for (b = 0; b < cfg->numBlocks; b++) {
+		block = &cfg->blocks[b];
+		regs = blockRegs[b];
+		map->blocks[b].firstAccess = (uint32_t)map->numAccesses;
+
+		for (i = block->first; i < block->first + block->count; i++) {
+			if (jriscBusAddressReg(&program->instructions[i], &reg, &store)) {
+				access = &map->accesses[map->numAccesses++];
+				access->index = (uint32_t)i;
+				access->store = store;
+				access->addressKnown =
+					jriscConstPropAddress(map->constProp, i, &access->address);
+				access->region = access->addressKnown ?
+					jriscBusRegion(program->cpu, access->address) :
+					(enum JRISC_BusRegion)regs.regions[reg];
+
+				map->blocks[b].counts[access->region]++;
+				map->counts[access->region]++;
+			}
+
+			jriscBusStep(map, i, &regs);
+		}
+
+		map->blocks[b].numAccesses =
+			(uint32_t)map->numAccesses - map->blocks[b].firstAccess;
+	}
+
+	ret = jriscBusLoops(map);
+
+done:
+	free(blockRegs);
+
+	if (ret != JRISC_success) {
+		jriscBusMapDestroy(map);
+	} else {
+		*mapOut = map;
+	}
+
+	return ret;
+}
+
+void
+jriscBusMapDestroy(struct JRISC_BusMap *map)
+{
+	if (!map) return;
+
+	jriscConstPropDestroy(map->constProp);
+	free(map->accesses);
+	free(map->blocks);
+	free(map->loops);
+	free(map);
+}
+
+static void
+jriscBusWriteCounts(const size_t *counts, FILE *fp)
+{
+	unsigned r;
+
+	for (r = 0; r < JRISC_busNumRegions; r++) {
+		fprintf(fp, "%s%zu %s", r ? ", " : "", counts[r],
+				jriscBusRegionNames[r]);
+	}
+	fprintf(fp, "\n");
+}
+
+static bool
+jriscBusLeavesLocal(const size_t *counts)
+{
+	return counts[JRISC_busHardware] || counts[JRISC_busExternal] ||
+		counts[JRISC_busUnknown];
+}
+
+/* The address of the last byte of a block's instructions */
+static uint32_t
+jriscBusBlockEnd(const struct JRISC_Program *program,
+				 const struct JRISC_Block *block)
+{
+	const struct JRISC_Instruction *last =
+		&program->instructions[block->first + block->count - 1];
+
+	return last->address + jriscProgramInstructionSize(last) - 1;
+}
+
+enum JRISC_Error
+jriscBusMapWrite(const struct JRISC_BusMap *map,
+				 uint32_t flags,
+				 const struct JRISC_SymbolTable *symbols,
+				 FILE *fp)
+{
+	const struct JRISC_Program *program = map->program;
+	const struct JRISC_Cfg *cfg = map->constProp->cfg;
+	const struct JRISC_Block *first, *last;
+	const struct JRISC_BusBlock *busBlock;
+	const struct JRISC_BusLoop *loop;
+	const struct JRISC_BusAccess *access;
+	char text[128];
+	size_t length;
+	size_t b, k;
+
+	fprintf(fp, "Loads and stores: ");
+	jriscBusWriteCounts(map->counts, fp);
+
+	/* Only loops and blocks that leave local RAM are interesting */
+	for (k = 0; k < map->numLoops; k++) {
+		loop = &map->loops[k];
+		if (!jriscBusLeavesLocal(loop->counts)) continue;
+
+		first = &cfg->blocks[loop->firstBlock];
+		last = &cfg->blocks[loop->lastBlock];
+
+		fprintf(fp, "Loop $%x-$%x, depth %u: ",
+				program->instructions[first->first].address,
+				jriscBusBlockEnd(program, last), loop->depth);
+		jriscBusWriteCounts(loop->counts, fp);
+	}
+
+	for (b = 0; b < cfg->numBlocks; b++) {
+		busBlock = &map->blocks[b];
+		if (!jriscBusLeavesLocal(busBlock->counts)) continue;
+
+		first = &cfg->blocks[b];
+		fprintf(fp, "\nBlock $%x-$%x",
+				program->instructions[first->first].address,
+				jriscBusBlockEnd(program, first));
+		if (busBlock->loopDepth) {
+			fprintf(fp, ", loop depth %u", busBlock->loopDepth);
+		}
+		fprintf(fp, ": ");
+		jriscBusWriteCounts(busBlock->counts, fp);
+
+		for (k = 0; k < busBlock->numAccesses; k++) {
+			access = &map->accesses[busBlock->firstAccess + k];
+			if (access->region == JRISC_busLocal) continue;
+
+			length = sizeof(text);
+			jriscInstructionToStringSymbolic(
+				&program->instructions[access->index],
+				flags | JRISC_STRINGFLAG_ADDRESS, symbols, text, &length);
+			if (length > sizeof(text)) return JRISC_ERROR_outOfMemory;
+
+			if (access->addressKnown) {
+				fprintf(fp, "%s\t; %s $%x\n", text,
+						jriscBusRegionNames[access->region], access->address);
+			} else if (access->region != JRISC_busUnknown) {
+				fprintf(fp, "%s\t; %s, by where the pointer was set\n", text,
+						jriscBusRegionNames[access->region]);
+			} else {
+				fprintf(fp, "%s\t; %s\n", text,
+						jriscBusRegionNames[access->region]);
+			}
+		}
+	}
+
+	return ferror(fp) ? JRISC_ERROR_ioError : JRISC_success;
+}
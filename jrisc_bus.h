@@ -0,0 +1,116 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#ifndef JRISC_BUS_H_
+#define JRISC_BUS_H_
+
+#include "jrisc_base.h"
+#include "jrisc_const.h"
+#include "jrisc_inst.h"
+#include "jrisc_program.h"
+#include "jrisc_sym.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+/* Where a load or store goes, from fastest to slowest */
+enum JRISC_BusRegion {
+	JRISC_busLocal,			/* The CPU's own local RAM */
+	JRISC_busHardware,		/* Registers and the other CPU's RAM, $f00000 up */
+	JRISC_busExternal,		/* DRAM, ROM and cartridge, over the main bus */
+	JRISC_busUnknown,		/* Couldn't be worked out */
+	JRISC_busNumRegions
+};
+
+struct JRISC_BusAccess {
+	uint32_t index;			/* Of the load or store */
+	uint32_t address;		/* If addressKnown */
+	enum JRISC_BusRegion region;
+
+	/*
+	 * If false, the region is only where the address register was last
+	 * pointed, e.g. by a movei before a loop that steps through memory with
+	 * addq, and the access may land elsewhere.
+	 */
+	bool addressKnown;
+	bool store;
+};
+
+struct JRISC_BusBlock {
+	size_t counts[JRISC_busNumRegions];
+	unsigned loopDepth;
+	uint32_t firstAccess;	/* Index into the map's accesses */
+	uint32_t numAccesses;
+};
+
+/*
+ * A jr or jump back to an earlier block, taken to loop over every block from
+ * its target to the branch. Back edges to the same block are merged.
+ */
+struct JRISC_BusLoop {
+	uint32_t firstBlock;
+	uint32_t lastBlock;
+	unsigned depth;			/* 1 for an outermost loop */
+	size_t counts[JRISC_busNumRegions];
+};
+
+struct JRISC_BusMap {
+	const struct JRISC_Program *program;
+	struct JRISC_ConstProp *constProp;	/* Its control flow graph's blocks */
+
+	/* Every load and store, in program order */
+	struct JRISC_BusAccess *accesses;
+	size_t numAccesses;
+
+	/* Indexed like constProp->cfg->blocks */
+	struct JRISC_BusBlock *blocks;
+
+	/* In order of their first block */
+	struct JRISC_BusLoop *loops;
+	size_t numLoops;
+
+	size_t counts[JRISC_busNumRegions];
+};
+
+/* Which region of <cpu>'s address space <address> is in */
+extern enum JRISC_BusRegion
+jriscBusRegion(enum JRISC_CPU cpu, uint32_t address);
+
+/* e.g. "local" */
+extern const char *
+jriscBusRegionName(enum JRISC_BusRegion region);
+
+/*
+ * Classify every load, store, loadp and storep in a program, including the
+ * (r14+n) and (r15+rN) forms. Addresses that propagated constants pin down
+ * are classified exactly. Otherwise, the region each register points into is
+ * tracked from movei and move, and kept by add, sub and their quick forms as
+ * a pointer steps through memory, so a loop walking a buffer in DRAM is still
+ * counted as external.
+ *
+ * <program> must outlive the result.
+ */
+extern enum JRISC_Error
+jriscBusMapCompute(const struct JRISC_Program *program,
+				   struct JRISC_BusMap **mapOut);
+
+extern void
+jriscBusMapDestroy(struct JRISC_BusMap *map);
+
+/*
+ * Print the totals, then each loop's, then each block that leaves local RAM
+ * with the instructions that do, formatted as by <flags> and <symbols>,
+ * which may be NULL.
+ */
+extern enum JRISC_Error
+jriscBusMapWrite(const struct JRISC_BusMap *map,
+				 uint32_t flags,
+				 const struct JRISC_SymbolTable *symbols,
+				 FILE *fp);
+
+#endif /* JRISC_BUS_H_ */
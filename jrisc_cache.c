@@ -0,0 +1,451 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_cache.h"
+#include "jrisc_hash.h"
+#include "jrisc_inst.h"
+#include "jrisc_map.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <process.h>
+#define getpid _getpid
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <utime.h>
+#endif
+
+#define CACHE_VERSION		1
+#define CACHE_SUFFIX		".jrc"
+
+/*
+ * Cache files are only ever read back on the machine that wrote them, so the
+ * header is stored in host byte order. The magic number doubles as a check of
+ * that assumption.
+ */
+struct CacheHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t recordSize;
+	uint64_t key;
+	uint64_t numRecords;
+	uint64_t textSize;
+};
+
+static const char cacheMagic[8] = { 'J', 'R', 'I', 'S', 'C', 'C', 'A', 'C' };
+
+uint64_t
+jriscCacheKey(const void *data,
+			  size_t size,
+			  uint64_t offset,
+			  uint32_t baseAddress,
+			  enum JRISC_CPU cpu,
+			  uint32_t flags,
+			  uint64_t salt)
+{
+	uint64_t key = jriscHash64(data, size, CACHE_VERSION);
+
+	key = jriscHashCombine(key, size);
+	key = jriscHashCombine(key, offset);
+	key = jriscHashCombine(key, baseAddress);
+	key = jriscHashCombine(key, cpu);
+	key = jriscHashCombine(key, flags);
+	key = jriscHashCombine(key, salt);
+
+	return key;
+}
+
+static char *
+jriscCachePath(const struct JRISC_Cache *cache, uint64_t key, const char *tail)
+{
+	size_t length = strlen(cache->directory) + 64;
+	char *path = malloc(length);
+
+	if (!path) return NULL;
+
+	snprintf(path, length, "%s/%016llx%s%s", cache->directory,
+			 (unsigned long long)key, CACHE_SUFFIX, tail ? tail : "");
+
+	return path;
+}
+
+static void
+jriscCacheEvict(struct JRISC_Cache *cache);
+
+enum JRISC_Error
+jriscCacheOpen(const char *directory,
+			   uint64_t maxSize,
+			   struct JRISC_Cache **cacheOut)
+{
+	struct JRISC_Cache *cache = calloc(1, sizeof(*cache));
+
+	if (!cache) return JRISC_ERROR_outOfMemory;
+
+#if defined(_WIN32)
+	CreateDirectoryA(directory, NULL);
+#else
+	mkdir(directory, 0777);
+#endif
+
+	cache->directory = malloc(strlen(directory) + 1);
+	if (!cache->directory) {
+		free(cache);
+		return JRISC_ERROR_outOfMemory;
+	}
+	strcpy(cache->directory, directory);
+	cache->maxSize = maxSize;
+
+	/* Find the starting size, trimming the cache if the budget shrank */
+	jriscCacheEvict(cache);
+
+	*cacheOut = cache;
+
+	return JRISC_success;
+}
+
+void
+jriscCacheClose(struct JRISC_Cache *cache)
+{
+	if (!cache) return;
+
+	free(cache->directory);
+	free(cache);
+}
+
+/* Mark an entry as recently used, for eviction purposes */
+static void
+jriscCacheTouch(const char *path)
+{
+#if defined(_WIN32)
+	HANDLE file = CreateFileA(path, FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ,
+							  NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+							  NULL);
+	FILETIME now;
+
+	if (file == INVALID_HANDLE_VALUE) return;
+	GetSystemTimeAsFileTime(&now);
+	SetFileTime(file, NULL, NULL, &now);
+	CloseHandle(file);
+#else
+	utime(path, NULL);
+#endif
+}
+
+enum JRISC_Error
+jriscCacheLookup(struct JRISC_Cache *cache,
+				 uint64_t key,
+				 struct JRISC_CacheEntry **entryOut)
+{
+	struct JRISC_CacheEntry *entry;
+	struct JRISC_MappedFile *map;
+	struct CacheHeader header;
+	uint64_t recordBytes;
+	char *path = jriscCachePath(cache, key, NULL);
+	enum JRISC_Error ret;
+
+	if (!path) return JRISC_ERROR_outOfMemory;
+
+	ret = jriscMapFile(path, &map);
+	if (ret != JRISC_success) {
+		free(path);
+		return JRISC_ERROR_notFound;
+	}
+
+	jriscCacheTouch(path);
+	free(path);
+
+	if (map->size < sizeof(header)) goto stale;
+	memcpy(&header, map->data, sizeof(header));
+
+	if (memcmp(header.magic, cacheMagic, sizeof(cacheMagic)) ||
+		(header.version != CACHE_VERSION) ||
+		(header.recordSize != sizeof(struct JRISC_CacheRecord)) ||
+		(header.key != key)) {
+		goto stale;
+	}
+
+	/* Check each part against what's left, so no sum can wrap */
+	if (header.numRecords >
+		((map->size - sizeof(header)) / sizeof(struct JRISC_CacheRecord))) {
+		goto stale;
+	}
+	recordBytes = header.numRecords * sizeof(struct JRISC_CacheRecord);
+	if (header.textSize != (map->size - sizeof(header) - recordBytes)) {
+		goto stale;
+	}
+
+	entry = calloc(1, sizeof(*entry));
+	if (!entry) {
+		jriscUnmapFile(map);
+		return JRISC_ERROR_outOfMemory;
+	}
+
+	entry->map = map;
+	entry->numRecords = header.numRecords;
+	entry->records =
+		(const struct JRISC_CacheRecord *)&map->data[sizeof(header)];
+	entry->textSize = header.textSize;
+	if (header.textSize) {
+		entry->text = (const char *)&map->data[sizeof(header) + recordBytes];
+	}
+
+	*entryOut = entry;
+
+	return JRISC_success;
+
+stale:
+	/* A truncated or foreign file. Treat it as a miss; a store replaces it. */
+	jriscUnmapFile(map);
+
+	return JRISC_ERROR_notFound;
+}
+
+void
+jriscCacheEntryRelease(struct JRISC_CacheEntry *entry)
+{
+	if (!entry) return;
+
+	jriscUnmapFile(entry->map);
+	free(entry);
+}
+
+struct CacheFile {
+	char *path;
+	uint64_t size;
+	int64_t lastUse;
+};
+
+static int
+jriscCompareCacheFiles(const void *a, const void *b)
+{
+	const struct CacheFile *fileA = a;
+	const struct CacheFile *fileB = b;
+
+	if (fileA->lastUse != fileB->lastUse) {
+		return (fileA->lastUse < fileB->lastUse) ? -1 : 1;
+	}
+
+	return strcmp(fileA->path, fileB->path);
+}
+
+static bool
+jriscCacheAddFile(struct CacheFile **files,
+				  size_t *numFiles,
+				  size_t *maxFiles,
+				  const struct JRISC_Cache *cache,
+				  const char *name,
+				  uint64_t size,
+				  int64_t lastUse)
+{
+	struct CacheFile *newFiles;
+	size_t nameLength = strlen(name);
+	size_t length;
+
+	if ((nameLength < strlen(CACHE_SUFFIX)) ||
+		strcmp(&name[nameLength - strlen(CACHE_SUFFIX)], CACHE_SUFFIX)) {
+		return true;
+	}
+
+	if (*numFiles == *maxFiles) {
+		*maxFiles = *maxFiles ? *maxFiles * 2 : 64;
+		newFiles = realloc(*files, *maxFiles * sizeof(**files));
+		if (!newFiles) return false;
+		*files = newFiles;
+	}
+
+	length = strlen(cache->directory) + nameLength + 2;
+	(*files)[*numFiles].path = malloc(length);
+	if (!(*files)[*numFiles].path) return false;
+	snprintf((*files)[*numFiles].path, length, "%s/%s", cache->directory, name);
+	(*files)[*numFiles].size = size;
+	(*files)[*numFiles].lastUse = lastUse;
+	(*numFiles)++;
+
+	return true;
+}
+
+/*
+ * Scan the cache's files for its size, deleting least recently used entries
+ * until it fits in its budget.
+ */
+static void
+jriscCacheEvict(struct JRISC_Cache *cache)
+{
+	struct CacheFile *files = NULL;
+	size_t numFiles = 0;
+	size_t maxFiles = 0;
+	uint64_t total = 0;
+	size_t i;
+	bool ok = true;
+
+#if defined(_WIN32)
+	WIN32_FIND_DATAA findData;
+	HANDLE find;
+	size_t length = strlen(cache->directory) + 8;
+	char *pattern = malloc(length);
+
+	if (!pattern) return;
+	snprintf(pattern, length, "%s/*%s", cache->directory, CACHE_SUFFIX);
+	find = FindFirstFileA(pattern, &findData);
+	free(pattern);
+	if (find == INVALID_HANDLE_VALUE) return;
+
+	do {
+		ok = jriscCacheAddFile(&files, &numFiles, &maxFiles, cache,
+							   findData.cFileName,
+							   ((uint64_t)findData.nFileSizeHigh << 32) |
+							   findData.nFileSizeLow,
+							   ((int64_t)findData.ftLastWriteTime.dwHighDateTime
+								<< 32) |
+							   findData.ftLastWriteTime.dwLowDateTime);
+	} while (ok && FindNextFileA(find, &findData));
+
+	FindClose(find);
+#else
+	struct dirent *dirEntry;
+	struct stat st;
+	DIR *dir = opendir(cache->directory);
+	char *path;
+	size_t length;
+
+	if (!dir) return;
+
+	while (ok && (dirEntry = readdir(dir))) {
+		length = strlen(cache->directory) + strlen(dirEntry->d_name) + 2;
+		path = malloc(length);
+		if (!path) break;
+		snprintf(path, length, "%s/%s", cache->directory, dirEntry->d_name);
+
+		if (!stat(path, &st) && S_ISREG(st.st_mode)) {
+			ok = jriscCacheAddFile(&files, &numFiles, &maxFiles, cache,
+								   dirEntry->d_name, st.st_size, st.st_mtime);
+		}
+
+		free(path);
+	}
+
+	closedir(dir);
+#endif
+
+	for (i = 0; i < numFiles; i++) total += files[i].size;
+
+	if (total > cache->maxSize) {
+		qsort(files, numFiles, sizeof(files[0]), jriscCompareCacheFiles);
+
+		for (i = 0; (i < numFiles) && (total > cache->maxSize); i++) {
+			if (!remove(files[i].path)) total -= files[i].size;
+		}
+	}
+
+	cache->size = total;
+
+	for (i = 0; i < numFiles; i++) free(files[i].path);
+	free(files);
+}
+
+enum JRISC_Error
+jriscCacheStore(struct JRISC_Cache *cache,
+				uint64_t key,
+				const struct JRISC_CacheRecord *records,
+				uint64_t numRecords,
+				const char *text,
+				uint64_t textSize)
+{
+	struct CacheHeader header;
+	char tail[32];
+	char *path = NULL;
+	char *tempPath = NULL;
+	FILE *fp = NULL;
+	enum JRISC_Error ret = JRISC_ERROR_ioError;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+	header.version = CACHE_VERSION;
+	header.recordSize = sizeof(struct JRISC_CacheRecord);
+	header.key = key;
+	header.numRecords = numRecords;
+	header.textSize = text ? textSize : 0;
+
+	/* Write under a private name, then rename, so readers never see a part */
+	snprintf(tail, sizeof(tail), ".%ld.tmp", (long)getpid());
+	path = jriscCachePath(cache, key, NULL);
+	tempPath = jriscCachePath(cache, key, tail);
+	if (!path || !tempPath) {
+		ret = JRISC_ERROR_outOfMemory;
+		goto done;
+	}
+
+	fp = fopen(tempPath, "wb");
+	if (!fp) goto done;
+
+	if ((fwrite(&header, sizeof(header), 1, fp) != 1) ||
+		(numRecords &&
+		 (fwrite(records, sizeof(*records), numRecords, fp) != numRecords)) ||
+		(header.textSize &&
+		 (fwrite(text, 1, textSize, fp) != textSize))) {
+		fclose(fp);
+		remove(tempPath);
+		goto done;
+	}
+
+	if (fclose(fp)) {
+		remove(tempPath);
+		goto done;
+	}
+
+#if defined(_WIN32)
+	remove(path);
+#endif
+	if (rename(tempPath, path)) {
+		remove(tempPath);
+		goto done;
+	}
+
+	/*
+	 * Replacing a stale entry or other processes' stores can throw the total
+	 * off, but only until the next scan, which counts what's really there.
+	 */
+	cache->size += sizeof(header) + numRecords * sizeof(*records) +
+		header.textSize;
+	if (cache->size > cache->maxSize) jriscCacheEvict(cache);
+
+	ret = JRISC_success;
+
+done:
+	free(tempPath);
+	free(path);
+
+	return ret;
+}
+
+void
+jriscCacheRecordFromInstruction(const struct JRISC_Instruction *instruction,
+								struct JRISC_CacheRecord *recordOut)
+{
+	recordOut->address = instruction->address;
+	recordOut->longImmediate = instruction->longImmediate;
+	recordOut->raw = jriscInstructionToRaw(instruction);
+	recordOut->opName = (uint8_t)instruction->opName;
+	recordOut->reserved = 0;
+}
+
+void
+jriscCacheRecordToInstruction(const struct JRISC_CacheRecord *record,
+							  struct JRISC_Instruction *instructionOut)
+{
+	/* Records only ever hold instructions that decoded successfully */
+	jriscInstructionDecodeAs((enum JRISC_OpName)record->opName, record->raw,
+							 record->address, instructionOut);
+	instructionOut->longImmediate = record->longImmediate;
+}
@@ -0,0 +1,96 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#ifndef JRISC_CACHE_H_
+#define JRISC_CACHE_H_
+
+#include "jrisc_base.h"
+#include "jrisc_inst.h"
+#include "jrisc_map.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define JRISC_CACHE_DEFAULT_MAX_SIZE	(256ull * 1024 * 1024)
+
+/*
+ * A compact, fixed-size record of one decoded instruction. The raw word plus
+ * opName is enough to rebuild the full instruction without searching the
+ * opcode table.
+ */
+struct JRISC_CacheRecord {
+	uint32_t address;
+	uint32_t longImmediate;
+	uint16_t raw;
+	uint8_t opName;
+	uint8_t reserved;
+};
+
+struct JRISC_Cache {
+	char *directory;
+	uint64_t maxSize;
+	uint64_t size;			/* Of the entries, as of the last scan plus stores */
+};
+
+struct JRISC_CacheEntry {
+	const struct JRISC_CacheRecord *records;
+	uint64_t numRecords;
+	const char *text;		/* Not NUL-terminated. NULL if none was stored */
+	uint64_t textSize;
+
+	/* Private */
+	struct JRISC_MappedFile *map;
+};
+
+/*
+ * Compute a cache key from the input bytes and everything else that affects
+ * the decoded output. <salt> covers anything not otherwise listed, such as
+ * the contents of a symbol table.
+ */
+extern uint64_t
+jriscCacheKey(const void *data,
+			  size_t size,
+			  uint64_t offset,
+			  uint32_t baseAddress,
+			  enum JRISC_CPU cpu,
+			  uint32_t flags,
+			  uint64_t salt);
+
+/* Entries beyond maxSize bytes in total are evicted, least recently used first */
+extern enum JRISC_Error
+jriscCacheOpen(const char *directory,
+			   uint64_t maxSize,
+			   struct JRISC_Cache **cacheOut);
+
+extern void
+jriscCacheClose(struct JRISC_Cache *cache);
+
+/* Returns JRISC_ERROR_notFound on a miss. Hits are memory-mapped. */
+extern enum JRISC_Error
+jriscCacheLookup(struct JRISC_Cache *cache,
+				 uint64_t key,
+				 struct JRISC_CacheEntry **entryOut);
+
+extern void
+jriscCacheEntryRelease(struct JRISC_CacheEntry *entry);
+
+extern enum JRISC_Error
+jriscCacheStore(struct JRISC_Cache *cache,
+				uint64_t key,
+				const struct JRISC_CacheRecord *records,
+				uint64_t numRecords,
+				const char *text,
+				uint64_t textSize);
+
+extern void
+jriscCacheRecordFromInstruction(const struct JRISC_Instruction *instruction,
+								struct JRISC_CacheRecord *recordOut);
+
+extern void
+jriscCacheRecordToInstruction(const struct JRISC_CacheRecord *record,
+							  struct JRISC_Instruction *instructionOut);
+
+#endif /* JRISC_CACHE_H_ */
@@ -0,0 +1,312 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_cfg.h"
+#include "jrisc_inst.h"
+#include "jrisc_program.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+bool
+jriscInstructionIsBranch(const struct JRISC_Instruction *instruction)
+{
+	return (instruction->opName == JRISC_op_jump) ||
+		(instruction->opName == JRISC_op_jr);
+}
+
+/* The index of the instruction a jr lands on, if it lands on one */
+static uint32_t
+jriscCfgBranchTarget(const struct JRISC_Program *program,
+					 const struct JRISC_Instruction *instruction)
+{
+	const uint32_t target = jriscInstructionBranchTarget(instruction);
+	const uint32_t index = jriscProgramFind(program, target);
+
+	if ((index == JRISC_PROGRAM_NO_INSTRUCTION) ||
+		(program->instructions[index].address != target)) {
+		return JRISC_PROGRAM_NO_INSTRUCTION;
+	}
+
+	return index;
+}
+
+static bool
+jriscCfgAddEdge(struct JRISC_Cfg *cfg,
+				size_t *maxEdges,
+				struct JRISC_Block *block,
+				uint32_t successor)
+{
+	uint32_t *newEdges;
+	uint32_t e;
+
+	for (e = 0; e < block->numSuccessors; e++) {
+		if (cfg->edges[block->firstSuccessor + e] == successor) return true;
+	}
+
+	if (cfg->numEdges == *maxEdges) {
+		*maxEdges = *maxEdges ? *maxEdges * 2 : 256;
+		newEdges = realloc(cfg->edges, *maxEdges * sizeof(*cfg->edges));
+		if (!newEdges) return false;
+		cfg->edges = newEdges;
+	}
+
+	cfg->edges[cfg->numEdges++] = successor;
+	block->numSuccessors++;
+
+	return true;
+}
+
+/* Add the edges a branch at instruction <index> creates */
+static bool
+jriscCfgAddBranchEdges(struct JRISC_Cfg *cfg,
+					   const uint32_t *jumpTargets,
+					   size_t *maxEdges,
+					   struct JRISC_Block *block,
+					   size_t index)
+{
+	const struct JRISC_Program *program = cfg->program;
+	const struct JRISC_Instruction *inst = &program->instructions[index];
+	uint32_t target;
+
+	if (inst->opName == JRISC_op_jr) {
+		target = jriscCfgBranchTarget(program, inst);
+		if (target == JRISC_PROGRAM_NO_INSTRUCTION) {
+			block->flags |= JRISC_BLOCKFLAG_UNKNOWN_EXIT;
+		} else if (!jriscCfgAddEdge(cfg, maxEdges, block,
+									jriscCfgFindBlock(cfg, target))) {
+			return false;
+		}
+	} else if (jumpTargets &&
+			   (jumpTargets[index] != JRISC_PROGRAM_NO_INSTRUCTION)) {
+		if (!jriscCfgAddEdge(cfg, maxEdges, block,
+							 jriscCfgFindBlock(cfg, jumpTargets[index]))) {
+			return false;
+		}
+	} else {
+		block->flags |= JRISC_BLOCKFLAG_UNKNOWN_EXIT;
+	}
+
+	/* Conditional branches may also fall through past the delay slot */
+	if (inst->regDst.val.condition) {
+		if ((index + 2) >= program->numInstructions) {
+			block->flags |= JRISC_BLOCKFLAG_UNKNOWN_EXIT;
+		} else if (!jriscCfgAddEdge(cfg, maxEdges, block,
+									jriscCfgFindBlock(cfg, index + 2))) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+enum JRISC_Error
+jriscCfgBuild(const struct JRISC_Program *program,
+			  struct JRISC_Cfg **cfgOut)
+{
+	return jriscCfgBuildWithTargets(program, NULL, cfgOut);
+}
+
+enum JRISC_Error
+jriscCfgBuildWithTargets(const struct JRISC_Program *program,
+						 const uint32_t *jumpTargets,
+						 struct JRISC_Cfg **cfgOut)
+{
+	const size_t n = program->numInstructions;
+	const struct JRISC_Instruction *inst;
+	struct JRISC_Cfg *cfg;
+	struct JRISC_Block *block;
+	uint8_t *leaders;
+	size_t maxEdges = 0;
+	size_t i, last;
+	uint32_t b, target;
+
+	cfg = calloc(1, sizeof(*cfg));
+	leaders = calloc(n + 1, 1);
+	if (!cfg || !leaders) goto oom;
+
+	cfg->program = program;
+
+	if (n) leaders[0] = 1;
+	for (i = 0; i < n; i++) {
+		inst = &program->instructions[i];
+
+		if (inst->opName == JRISC_invalidOpName) {
+			leaders[i] = leaders[i + 1] = 1;
+		} else if (jriscInstructionIsBranch(inst)) {
+			if ((i + 2) <= n) leaders[i + 2] = 1;
+
+			if (inst->opName == JRISC_op_jr) {
+				target = jriscCfgBranchTarget(program, inst);
+			} else {
+				target = jumpTargets ? jumpTargets[i] :
+					JRISC_PROGRAM_NO_INSTRUCTION;
+			}
+
+			if (target != JRISC_PROGRAM_NO_INSTRUCTION) leaders[target] = 1;
+		}
+	}
+
+	for (i = 0; i < n; i++) cfg->numBlocks += leaders[i];
+
+	cfg->blocks = calloc(cfg->numBlocks ? cfg->numBlocks : 1,
+						 sizeof(*cfg->blocks));
+	if (!cfg->blocks) goto oom;
+
+	for (i = 0, b = 0; i < n; i++) {
+		if (leaders[i]) {
+			cfg->blocks[b].first = (uint32_t)i;
+			b++;
+		}
+		cfg->blocks[b - 1].count++;
+	}
+
+	for (b = 0; b < cfg->numBlocks; b++) {
+		block = &cfg->blocks[b];
+		block->firstSuccessor = (uint32_t)cfg->numEdges;
+		last = block->first + block->count - 1;
+		inst = &program->instructions[last];
+
+		if (inst->opName == JRISC_invalidOpName) {
+			block->flags |= JRISC_BLOCKFLAG_UNKNOWN_EXIT;
+		} else if ((block->count >= 2) &&
+				   jriscInstructionIsBranch(&program->instructions[last - 1])) {
+			if (!jriscCfgAddBranchEdges(cfg, jumpTargets, &maxEdges, block,
+									   last - 1)) {
+				goto oom;
+			}
+		} else if ((last + 1) >= n) {
+			block->flags |= JRISC_BLOCKFLAG_UNKNOWN_EXIT;
+		} else if (!jriscCfgAddEdge(cfg, &maxEdges, block, b + 1)) {
+			goto oom;
+		}
+
+		/*
+		 * A jr target can split a branch from its delay slot. The delay slot's
+		 * block then also goes wherever the branch does.
+		 */
+		i = block->first;
+		if (i && jriscInstructionIsBranch(&program->instructions[i - 1]) &&
+			!jriscCfgAddBranchEdges(cfg, jumpTargets, &maxEdges, block,
+									i - 1)) {
+			goto oom;
+		}
+	}
+
+	free(leaders);
+	*cfgOut = cfg;
+
+	return JRISC_success;
+
+oom:
+	free(leaders);
+	jriscCfgDestroy(cfg);
+
+	return JRISC_ERROR_outOfMemory;
+}
+
+void
+jriscCfgDestroy(struct JRISC_Cfg *cfg)
+{
+	if (!cfg) return;
+
+	free(cfg->blocks);
+	free(cfg->edges);
+	free(cfg);
+}
+
+uint32_t
+jriscCfgFindBlock(const struct JRISC_Cfg *cfg, size_t index)
+{
+	size_t low = 0;
+	size_t high = cfg->numBlocks;
+	size_t mid;
+
+	while (low < high) {
+		mid = low + (high - low) / 2;
+
+		if (index < cfg->blocks[mid].first) {
+			high = mid;
+		} else if (index >= (cfg->blocks[mid].first +
+							 cfg->blocks[mid].count)) {
+			low = mid + 1;
+		} else {
+			return (uint32_t)mid;
+		}
+	}
+
+	return JRISC_CFG_NO_BLOCK;
+}
+
+enum JRISC_Error
+jriscCfgFindLoops(const struct JRISC_Cfg *cfg,
+				  struct JRISC_Loop **loopsOut,
+				  size_t *numLoopsOut,
+				  unsigned *blockDepths)
+{
+	const size_t numBlocks = cfg->numBlocks;
+	const struct JRISC_Block *block;
+	struct JRISC_Loop *loops = NULL;
+	uint32_t *lastBlock = NULL;		/* By loop header, or NO_BLOCK */
+	int *depthChange = NULL;
+	size_t numLoops = 0;
+	size_t b, e, k;
+	uint32_t s;
+	int depth;
+	enum JRISC_Error ret = JRISC_ERROR_outOfMemory;
+
+	lastBlock = malloc((numBlocks + 1) * sizeof(*lastBlock));
+	depthChange = calloc(numBlocks + 1, sizeof(*depthChange));
+	if (!lastBlock || !depthChange) goto done;
+
+	for (b = 0; b <= numBlocks; b++) lastBlock[b] = JRISC_CFG_NO_BLOCK;
+
+	for (b = 0; b < numBlocks; b++) {
+		block = &cfg->blocks[b];
+		for (e = 0; e < block->numSuccessors; e++) {
+			s = cfg->edges[block->firstSuccessor + e];
+			if ((s > b) || ((lastBlock[s] != JRISC_CFG_NO_BLOCK) &&
+							(lastBlock[s] >= b))) {
+				continue;
+			}
+			if (lastBlock[s] == JRISC_CFG_NO_BLOCK) numLoops++;
+			lastBlock[s] = (uint32_t)b;
+		}
+	}
+
+	loops = calloc(numLoops + 1, sizeof(*loops));
+	if (!loops) goto done;
+
+	for (b = 0, k = 0; b < numBlocks; b++) {
+		if (lastBlock[b] == JRISC_CFG_NO_BLOCK) continue;
+		loops[k].firstBlock = (uint32_t)b;
+		loops[k++].lastBlock = lastBlock[b];
+		depthChange[b]++;
+		depthChange[lastBlock[b] + 1]--;
+	}
+
+	for (b = 0, depth = 0; b < numBlocks; b++) {
+		depth += depthChange[b];
+		blockDepths[b] = (unsigned)depth;
+	}
+
+	for (k = 0; k < numLoops; k++) {
+		loops[k].depth = blockDepths[loops[k].firstBlock];
+	}
+
+	*loopsOut = loops;
+	*numLoopsOut = numLoops;
+	loops = NULL;
+	ret = JRISC_success;
+
+done:
+	free(loops);
+	free(depthChange);
+	free(lastBlock);
+
+	return ret;
+}
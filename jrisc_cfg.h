@@ -0,0 +1,102 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#ifndef JRISC_CFG_H_
+#define JRISC_CFG_H_
+
+#include "jrisc_base.h"
+#include "jrisc_program.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define JRISC_CFG_NO_BLOCK ((uint32_t)-1)
+
+/* The block can also leave to somewhere not in the program */
+#define JRISC_BLOCKFLAG_UNKNOWN_EXIT	0x1
+
+/*
+ * A straight-line run of instructions. A block that ends in a jump or jr
+ * includes the instruction in its delay slot, which runs before the branch
+ * is taken.
+ */
+struct JRISC_Block {
+	uint32_t first;			/* Index of the first instruction */
+	uint32_t count;
+	uint32_t firstSuccessor;	/* Index into the control flow graph's edges */
+	uint32_t numSuccessors;
+	uint32_t flags;
+};
+
+/*
+ * A jr or jump back to an earlier block, taken to loop over every block from
+ * its target to the branch. Back edges to the same block are merged.
+ */
+struct JRISC_Loop {
+	uint32_t firstBlock;
+	uint32_t lastBlock;
+	unsigned depth;			/* 1 for an outermost loop */
+};
+
+struct JRISC_Cfg {
+	const struct JRISC_Program *program;
+
+	/* In address order */
+	struct JRISC_Block *blocks;
+	size_t numBlocks;
+
+	/* Successor block indices, in runs of each block's numSuccessors */
+	uint32_t *edges;
+	size_t numEdges;
+};
+
+/*
+ * Split a program into basic blocks at jr targets, after each branch's delay
+ * slot, and at undecodable words. Blocks ending in jump (rN), a jr out of the
+ * program, or an invalid word, or running off the end of the program, are
+ * marked with JRISC_BLOCKFLAG_UNKNOWN_EXIT.
+ *
+ * <program> must outlive the graph.
+ */
+extern enum JRISC_Error
+jriscCfgBuild(const struct JRISC_Program *program,
+			  struct JRISC_Cfg **cfgOut);
+
+/*
+ * As above, also following jump (rN) instructions whose targets are already
+ * known. <jumpTargets> is indexed by instruction, and holds the index of the
+ * instruction each jump lands on, or JRISC_PROGRAM_NO_INSTRUCTION if it isn't
+ * known. Other entries are ignored. A jump with a known target is not an
+ * unknown exit.
+ */
+extern enum JRISC_Error
+jriscCfgBuildWithTargets(const struct JRISC_Program *program,
+						 const uint32_t *jumpTargets,
+						 struct JRISC_Cfg **cfgOut);
+
+extern void
+jriscCfgDestroy(struct JRISC_Cfg *cfg);
+
+/* The block containing instruction <index> */
+extern uint32_t
+jriscCfgFindBlock(const struct JRISC_Cfg *cfg, size_t index);
+
+/*
+ * Find the loops in a control flow graph, in order of their first block, and
+ * store each block's loop depth, 0 outside any loop, in <blockDepths>, which
+ * must have room for every block. Free the loops with free().
+ */
+extern enum JRISC_Error
+jriscCfgFindLoops(const struct JRISC_Cfg *cfg,
+				  struct JRISC_Loop **loopsOut,
+				  size_t *numLoopsOut,
+				  unsigned *blockDepths);
+
+/* True for jump and jr, which have a delay slot */
+extern bool
+jriscInstructionIsBranch(const struct JRISC_Instruction *instruction);
+
+#endif /* JRISC_CFG_H_ */
@@ -0,0 +1,148 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_classify.h"
+#include "jrisc_inst.h"
+
+#include <string.h>
+
+#define CLASSIFY_NUM_OPCODES	64
+#define CLASSIFY_ANY_SRC		0xffffffffu
+
+/* Bit n of an opcode's entry is set if a rawSrc of n makes sense with it */
+struct ClassifyTables {
+	uint32_t gpu[CLASSIFY_NUM_OPCODES];
+	uint32_t dsp[CLASSIFY_NUM_OPCODES];
+};
+
+static void
+jriscClassifyTables(struct ClassifyTables *tables)
+{
+	const struct JRISC_Instruction *inst;
+	uint32_t srcs;
+	unsigned i;
+
+	memset(tables, 0, sizeof(*tables));
+
+	for (i = 0; i < JRISC_invalidOpName; i++) {
+		inst = &jriscInstructionTable[i];
+
+		/* pack and unpack are told apart by rawSrc, as when decoding */
+		if (inst->opName == JRISC_op_pack) {
+			srcs = 1u << 0;
+		} else if (inst->opName == JRISC_op_unpack) {
+			srcs = 1u << 1;
+		} else if (inst->regSrc.type == JRISC_unused) {
+			srcs = 1u << 0;
+		} else {
+			srcs = CLASSIFY_ANY_SRC;
+		}
+
+		if (inst->cpu != JRISC_dsp) tables->gpu[inst->opCode] |= srcs;
+		if (inst->cpu != JRISC_gpu) tables->dsp[inst->opCode] |= srcs;
+	}
+}
+
+/* <high> is the offset of the most significant byte in each word */
+static inline uint16_t
+jriscClassifyWord(const uint8_t *bytes, unsigned high)
+{
+	return (uint16_t)((bytes[high] << 8) | bytes[high ^ 1]);
+}
+
+/* In the CPU's local RAM, or the block of control registers at its flags */
+static bool
+jriscClassifyOwnAddress(uint32_t value, uint32_t ram, uint32_t ramSize,
+						uint32_t flags)
+{
+	return ((value >= ram) && (value < ram + ramSize)) ||
+		((value >= flags) && (value < flags + 0x100));
+}
+
+static void
+jriscClassifyDecide(struct JRISC_CpuGuess *guess)
+{
+	const double gpuEvidence = (double)guess->gpuOnly +
+		(double)guess->gpuAddresses * JRISC_CLASSIFY_ADDRESS_WEIGHT;
+	const double dspEvidence = (double)guess->dspOnly +
+		(double)guess->dspAddresses * JRISC_CLASSIFY_ADDRESS_WEIGHT;
+	double gpuFit = 0.0, dspFit = 0.0;
+
+	if (guess->words) {
+		gpuFit = (double)(guess->words - guess->gpuInvalid) / guess->words;
+		dspFit = (double)(guess->words - guess->dspInvalid) / guess->words;
+	}
+
+	/* With no evidence either way, each gets an even share */
+	guess->gpuConfidence = (unsigned)(100.0 * gpuFit * (gpuEvidence + 1.0) /
+									  (gpuEvidence + dspEvidence + 2.0) + 0.5);
+	guess->dspConfidence = (unsigned)(100.0 * dspFit * (dspEvidence + 1.0) /
+									  (gpuEvidence + dspEvidence + 2.0) + 0.5);
+
+	if ((guess->gpuConfidence > guess->dspConfidence) &&
+		(guess->gpuConfidence >= JRISC_CLASSIFY_MIN_CONFIDENCE)) {
+		guess->cpu = JRISC_gpu;
+	} else if ((guess->dspConfidence > guess->gpuConfidence) &&
+			   (guess->dspConfidence >= JRISC_CLASSIFY_MIN_CONFIDENCE)) {
+		guess->cpu = JRISC_dsp;
+	} else {
+		guess->cpu = JRISC_both;
+	}
+}
+
+void
+jriscCpuGuessScan(struct JRISC_CpuGuess *guess,
+				  const uint8_t *data,
+				  size_t size,
+				  enum JRISC_ByteOrder byteOrder)
+{
+	struct ClassifyTables tables;
+	const uint8_t movei = jriscInstructionTable[JRISC_op_movei].opCode;
+	const size_t numWords = size / 2;
+	const unsigned high = (byteOrder == JRISC_littleEndian) ? 1 : 0;
+	uint16_t word;
+	uint32_t value;
+	unsigned op, src;
+	bool gpu, dsp;
+	size_t i;
+
+	jriscClassifyTables(&tables);
+
+	for (i = 0; i < numWords; i++) {
+		word = jriscClassifyWord(&data[i * 2], high);
+		op = word >> JRISC_OPCODE_SHIFT;
+		src = (word >> JRISC_REGSRC_SHIFT) & JRISC_REG_MASK;
+
+		gpu = (tables.gpu[op] >> src) & 1;
+		dsp = (tables.dsp[op] >> src) & 1;
+
+		guess->words++;
+		if (!gpu) guess->gpuInvalid++;
+		if (!dsp) guess->dspInvalid++;
+		if (gpu && !dsp) guess->gpuOnly++;
+		if (dsp && !gpu) guess->dspOnly++;
+
+		/* The low word of the value comes first */
+		if ((op == movei) && ((i + 2) < numWords)) {
+			value = jriscClassifyWord(&data[(i + 1) * 2], high) |
+				((uint32_t)jriscClassifyWord(&data[(i + 2) * 2], high) << 16);
+			i += 2;
+
+			if (jriscClassifyOwnAddress(value, JRISC_GPU_RAM,
+										JRISC_GPU_RAM_SIZE,
+										JRISC_GPU_FLAGS)) {
+				guess->gpuAddresses++;
+			} else if (jriscClassifyOwnAddress(value, JRISC_DSP_RAM,
+											   JRISC_DSP_RAM_SIZE,
+											   JRISC_DSP_FLAGS)) {
+				guess->dspAddresses++;
+			}
+		}
+	}
+
+	jriscClassifyDecide(guess);
+}
@@ -0,0 +1,69 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#ifndef JRISC_CLASSIFY_H_
+#define JRISC_CLASSIFY_H_
+
+#include "jrisc_base.h"
+#include "jrisc_ctx.h"
+#include "jrisc_inst.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* How much more a movei of a CPU's own address counts than an opcode */
+#define JRISC_CLASSIFY_ADDRESS_WEIGHT	4
+
+/*
+ * The least confidence a guess needs. Random data scores around 50% for one
+ * CPU or the other, as each has encodings the other doesn't.
+ */
+#define JRISC_CLASSIFY_MIN_CONFIDENCE	60
+
+/*
+ * Evidence of whether code was written for the GPU or the DSP. Zero it before
+ * the first scan. Counts are totals over everything scanned so far.
+ */
+struct JRISC_CpuGuess {
+	/* Instruction words, not counting movei immediates */
+	uint64_t words;
+
+	/*
+	 * Words that don't decode for the CPU, or set bits in a field the
+	 * instruction doesn't use, which assemblers leave clear
+	 */
+	uint64_t gpuInvalid;
+	uint64_t dspInvalid;
+
+	/* Words that only make sense as an instruction of that CPU */
+	uint64_t gpuOnly;
+	uint64_t dspOnly;
+
+	/* movei values in the CPU's own local RAM or control registers */
+	uint64_t gpuAddresses;
+	uint64_t dspAddresses;
+
+	/* JRISC_both when neither is confidently ahead */
+	enum JRISC_CPU cpu;
+
+	/* Percentages, from how well each decodes and the evidence for each */
+	unsigned gpuConfidence;
+	unsigned dspConfidence;
+};
+
+/*
+ * Decode <size> bytes of code as both GPU and DSP instructions in one pass,
+ * without building instructions, and add what they show to <guess>. The CPU
+ * and confidences are then worked out again from the new totals, so several
+ * sections of one file can be scanned into the same guess.
+ */
+extern void
+jriscCpuGuessScan(struct JRISC_CpuGuess *guess,
+				  const uint8_t *data,
+				  size_t size,
+				  enum JRISC_ByteOrder byteOrder);
+
+#endif /* JRISC_CLASSIFY_H_ */
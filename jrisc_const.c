@@ -0,0 +1,480 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_cfg.h"
+#include "jrisc_const.h"
+#include "jrisc_inst.h"
+#include "jrisc_program.h"
+#include "jrisc_regs.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define REG_BIT(reg) ((uint32_t)1 << (reg))
+
+/* The value of an immediate operand of 1-32, stored as 0-31 */
+static inline uint32_t
+jriscConstUnsigned(const struct JRISC_OpReg *reg)
+{
+	return reg->val.uimmediate ? reg->val.uimmediate : 32;
+}
+
+/* The value of a register operand, if it is known */
+static inline bool
+jriscConstReg(const struct JRISC_ConstRegs *regs,
+			  const struct JRISC_OpReg *reg,
+			  uint32_t *valueOut)
+{
+	if ((reg->type != JRISC_reg) && (reg->type != JRISC_indirect)) {
+		return false;
+	}
+
+	if (!(regs->known & REG_BIT(reg->val.reg))) return false;
+
+	*valueOut = regs->values[reg->val.reg];
+
+	return true;
+}
+
+/* The address a jump (rN), load or store uses, if it is known */
+static bool
+jriscConstEffectiveAddress(const struct JRISC_Instruction *inst,
+						   const struct JRISC_ConstRegs *regs,
+						   uint32_t *addressOut)
+{
+	const struct JRISC_OpReg *src = &inst->regSrc;
+	enum JRISC_Reg base;
+	uint32_t offset;
+
+	switch (inst->opName) {
+	case JRISC_op_loadb:
+	case JRISC_op_loadw:
+	case JRISC_op_load:
+	case JRISC_op_loadp:
+	case JRISC_op_storeb:
+	case JRISC_op_storew:
+	case JRISC_op_store:
+	case JRISC_op_storep:
+	case JRISC_op_jump:
+		return jriscConstReg(regs, src, addressOut);
+
+	case JRISC_op_loadr14n:
+	case JRISC_op_storer14n:
+		base = r14;
+		offset = jriscConstUnsigned(src) * 4;
+		break;
+
+	case JRISC_op_loadr15n:
+	case JRISC_op_storer15n:
+		base = r15;
+		offset = jriscConstUnsigned(src) * 4;
+		break;
+
+	case JRISC_op_loadr14r:
+	case JRISC_op_storer14r:
+		base = r14;
+		if (!jriscConstReg(regs, src, &offset)) return false;
+		break;
+
+	case JRISC_op_loadr15r:
+	case JRISC_op_storer15r:
+		base = r15;
+		if (!jriscConstReg(regs, src, &offset)) return false;
+		break;
+
+	default:
+		return false;
+	}
+
+	if (!(regs->known & REG_BIT(base))) return false;
+
+	*addressOut = regs->values[base] + offset;
+
+	return true;
+}
+
+/*
+ * Step forward over one instruction. Returns true and the effective address
+ * if the instruction is a jump (rN), load or store and its address is known.
+ */
+static bool
+jriscConstStep(const struct JRISC_Instruction *inst,
+			   enum JRISC_CPU cpu,
+			   struct JRISC_ConstRegs *regs,
+			   uint32_t *addressOut)
+{
+	const struct JRISC_OpReg *src = &inst->regSrc;
+	const struct JRISC_OpReg *dst = &inst->regDst;
+	JRISC_RegMask reads, writes;
+	uint32_t s = 0, d = 0;
+	uint32_t result = 0;
+	uint32_t shift;
+	bool sk = jriscConstReg(regs, src, &s);
+	bool dk = jriscConstReg(regs, dst, &d);
+	bool known = false;
+	bool hasAddress;
+
+	hasAddress = jriscConstEffectiveAddress(inst, regs, addressOut);
+
+	switch (inst->opName) {
+	case JRISC_op_movei:
+		known = true;
+		result = inst->longImmediate;
+		break;
+
+	case JRISC_op_moveq:
+		known = true;
+		result = src->val.uimmediate;
+		break;
+
+	case JRISC_op_move:
+		known = sk;
+		result = s;
+		break;
+
+	case JRISC_op_addq:
+	case JRISC_op_addqt:
+		known = dk;
+		result = d + jriscConstUnsigned(src);
+		break;
+
+	case JRISC_op_subq:
+	case JRISC_op_subqt:
+		known = dk;
+		result = d - jriscConstUnsigned(src);
+		break;
+
+	case JRISC_op_add:
+		known = sk && dk;
+		result = d + s;
+		break;
+
+	case JRISC_op_sub:
+		known = sk && dk;
+		result = d - s;
+		break;
+
+	case JRISC_op_and:
+		known = sk && dk;
+		result = d & s;
+		break;
+
+	case JRISC_op_or:
+		known = sk && dk;
+		result = d | s;
+		break;
+
+	case JRISC_op_xor:
+		known = sk && dk;
+		result = d ^ s;
+		break;
+
+	case JRISC_op_neg:
+		known = dk;
+		result = 0 - d;
+		break;
+
+	case JRISC_op_not:
+		known = dk;
+		result = ~d;
+		break;
+
+	case JRISC_op_bset:
+		known = dk;
+		result = d | REG_BIT(src->val.uimmediate);
+		break;
+
+	case JRISC_op_bclr:
+		known = dk;
+		result = d & ~REG_BIT(src->val.uimmediate);
+		break;
+
+	case JRISC_op_shlq:
+		known = dk;
+		result = d << (32 - jriscConstUnsigned(src));
+		break;
+
+	case JRISC_op_shrq:
+		shift = jriscConstUnsigned(src);
+		known = dk;
+		result = (shift < 32) ? (d >> shift) : 0;
+		break;
+
+	case JRISC_op_sharq:
+		shift = jriscConstUnsigned(src);
+		if (shift > 31) shift = 31;		/* Same result once all sign bits */
+		known = dk;
+		result = d >> shift;
+		if (d & 0x80000000) result |= ~(0xffffffff >> shift);
+		break;
+
+	case JRISC_op_rorq:
+		shift = jriscConstUnsigned(src) % 32;
+		known = dk;
+		result = shift ? ((d >> shift) | (d << (32 - shift))) : d;
+		break;
+
+	default:
+		break;
+	}
+
+	jriscInstructionRegMasks(inst, &reads, &writes);
+	regs->known &= ~(uint32_t)(writes & JRISC_REGMASK_REGS);
+
+	if (known) {
+		regs->known |= REG_BIT(dst->val.reg);
+		regs->values[dst->val.reg] = result;
+	}
+
+	/* Writing the flags register may switch register banks */
+	if (hasAddress && (inst->opName == JRISC_op_store) &&
+		(*addressOut == ((cpu == JRISC_dsp) ? JRISC_DSP_FLAGS :
+						 JRISC_GPU_FLAGS))) {
+		regs->known = 0;
+	}
+
+	return hasAddress;
+}
+
+/*
+ * Solve for what is known on entry to each block of the current control flow
+ * graph, then record the address each jump, load and store uses.
+ */
+static enum JRISC_Error
+jriscConstSolve(struct JRISC_ConstProp *cp, const uint32_t *jumpTargets)
+{
+	const struct JRISC_Program *program = cp->program;
+	const struct JRISC_Cfg *cfg = cp->cfg;
+	const size_t numBlocks = cfg->numBlocks;
+	const struct JRISC_Block *block;
+	struct JRISC_ConstRegs regs;
+	struct JRISC_ConstRegs *in;
+	uint32_t *stack = NULL;
+	uint8_t *queued = NULL;
+	uint8_t *reached = NULL;
+	uint8_t *entry = NULL;
+	size_t numStack;
+	size_t b, e, i;
+	uint32_t known, s, r;
+	enum JRISC_Error ret = JRISC_ERROR_outOfMemory;
+
+	cp->blockRegs = calloc(numBlocks + 1, sizeof(*cp->blockRegs));
+	stack = malloc((numBlocks + 1) * sizeof(*stack));
+	queued = calloc(numBlocks + 1, 1);
+	reached = calloc(numBlocks + 1, 1);
+	entry = malloc(numBlocks + 1);
+	if (!cp->blockRegs || !stack || !queued || !reached || !entry) goto done;
+
+	/*
+	 * Blocks with no known predecessors, and jump targets, may be entered
+	 * from anywhere. Start from those, knowing nothing.
+	 */
+	memset(entry, 1, numBlocks + 1);
+	for (b = 0; b < numBlocks; b++) {
+		block = &cfg->blocks[b];
+		for (e = 0; e < block->numSuccessors; e++) {
+			entry[cfg->edges[block->firstSuccessor + e]] = 0;
+		}
+	}
+	if (numBlocks) entry[0] = 1;
+
+	for (i = 0; i < program->numInstructions; i++) {
+		if (jumpTargets[i] != JRISC_PROGRAM_NO_INSTRUCTION) {
+			entry[jriscCfgFindBlock(cfg, jumpTargets[i])] = 1;
+		}
+	}
+
+	/* Stacked in reverse, so the first block is visited first */
+	numStack = 0;
+	for (b = numBlocks; b-- > 0;) {
+		if (!entry[b]) continue;
+		reached[b] = queued[b] = 1;
+		stack[numStack++] = (uint32_t)b;
+	}
+
+	while (numStack) {
+		b = stack[--numStack];
+		queued[b] = 0;
+		block = &cfg->blocks[b];
+		regs = cp->blockRegs[b];
+
+		for (i = block->first; i < block->first + block->count; i++) {
+			jriscConstStep(&program->instructions[i], program->cpu, &regs,
+						   &s);
+		}
+
+		for (e = 0; e < block->numSuccessors; e++) {
+			s = cfg->edges[block->firstSuccessor + e];
+			if (entry[s]) continue;
+			in = &cp->blockRegs[s];
+
+			if (!reached[s]) {
+				reached[s] = 1;
+				*in = regs;
+			} else {
+				/* Keep only the values that agree on every incoming edge */
+				known = in->known & regs.known;
+				for (r = 0; r < 32; r++) {
+					if ((known & REG_BIT(r)) &&
+						(in->values[r] != regs.values[r])) {
+						known &= ~REG_BIT(r);
+					}
+				}
+				if (known == in->known) continue;
+				in->known = known;
+			}
+
+			if (!queued[s]) {
+				queued[s] = 1;
+				stack[numStack++] = s;
+			}
+		}
+	}
+
+	for (b = 0; b < numBlocks; b++) {
+		block = &cfg->blocks[b];
+		regs = cp->blockRegs[b];
+
+		for (i = block->first; i < block->first + block->count; i++) {
+			cp->addressKnown[i] =
+				jriscConstStep(&program->instructions[i], program->cpu,
+							   &regs, &cp->addresses[i]);
+		}
+	}
+
+	ret = JRISC_success;
+
+done:
+	free(entry);
+	free(reached);
+	free(queued);
+	free(stack);
+
+	return ret;
+}
+
+enum JRISC_Error
+jriscConstPropCompute(const struct JRISC_Program *program,
+					  struct JRISC_ConstProp **constPropOut)
+{
+	const size_t n = program->numInstructions;
+	struct JRISC_ConstProp *cp;
+	uint32_t *jumpTargets;
+	uint32_t target;
+	bool found;
+	size_t i;
+	enum JRISC_Error ret = JRISC_ERROR_outOfMemory;
+
+	cp = calloc(1, sizeof(*cp));
+	jumpTargets = malloc((n + 1) * sizeof(*jumpTargets));
+	if (!cp || !jumpTargets) goto done;
+
+	cp->program = program;
+	cp->addresses = calloc(n + 1, sizeof(*cp->addresses));
+	cp->addressKnown = calloc(n + 1, 1);
+	if (!cp->addresses || !cp->addressKnown) goto done;
+
+	for (i = 0; i < n; i++) jumpTargets[i] = JRISC_PROGRAM_NO_INSTRUCTION;
+
+	for (;;) {
+		ret = jriscCfgBuildWithTargets(program, jumpTargets, &cp->cfg);
+		if (ret != JRISC_success) goto done;
+
+		ret = jriscConstSolve(cp, jumpTargets);
+		if (ret != JRISC_success) goto done;
+
+		/*
+		 * New edges can split blocks and make a target found earlier
+		 * unknown. Targets are never forgotten, so this always ends.
+		 */
+		found = false;
+		for (i = 0; i < n; i++) {
+			if (program->instructions[i].opName != JRISC_op_jump) continue;
+
+			if (jumpTargets[i] != JRISC_PROGRAM_NO_INSTRUCTION) {
+				cp->addresses[i] =
+					program->instructions[jumpTargets[i]].address;
+				cp->addressKnown[i] = 1;
+				continue;
+			}
+
+			if (!cp->addressKnown[i]) continue;
+
+			target = jriscProgramFind(program, cp->addresses[i]);
+			if ((target != JRISC_PROGRAM_NO_INSTRUCTION) &&
+				(program->instructions[target].address == cp->addresses[i])) {
+				jumpTargets[i] = target;
+				found = true;
+			}
+		}
+
+		if (!found) break;
+
+		jriscCfgDestroy(cp->cfg);
+		cp->cfg = NULL;
+		free(cp->blockRegs);
+		cp->blockRegs = NULL;
+	}
+
+	ret = JRISC_success;
+
+done:
+	free(jumpTargets);
+
+	if (ret != JRISC_success) {
+		jriscConstPropDestroy(cp);
+	} else {
+		*constPropOut = cp;
+	}
+
+	return ret;
+}
+
+void
+jriscConstPropDestroy(struct JRISC_ConstProp *constProp)
+{
+	if (!constProp) return;
+
+	jriscCfgDestroy(constProp->cfg);
+	free(constProp->blockRegs);
+	free(constProp->addresses);
+	free(constProp->addressKnown);
+	free(constProp);
+}
+
+bool
+jriscConstPropAddress(const struct JRISC_ConstProp *constProp,
+					  size_t index,
+					  uint32_t *addressOut)
+{
+	if ((index >= constProp->program->numInstructions) ||
+		!constProp->addressKnown[index]) {
+		return false;
+	}
+
+	*addressOut = constProp->addresses[index];
+
+	return true;
+}
+
+void
+jriscConstPropRegsAt(const struct JRISC_ConstProp *constProp,
+					 size_t index,
+					 struct JRISC_ConstRegs *regsOut)
+{
+	const struct JRISC_Program *program = constProp->program;
+	const uint32_t b = jriscCfgFindBlock(constProp->cfg, index);
+	size_t i;
+	uint32_t address;
+
+	*regsOut = constProp->blockRegs[b];
+
+	for (i = constProp->cfg->blocks[b].first; i < index; i++) {
+		jriscConstStep(&program->instructions[i], program->cpu, regsOut,
+					   &address);
+	}
+}
@@ -0,0 +1,88 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#ifndef JRISC_CONST_H_
+#define JRISC_CONST_H_
+
+#include "jrisc_base.h"
+#include "jrisc_cfg.h"
+#include "jrisc_program.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/* Which of r0-r31 hold a known value, and what those values are */
+struct JRISC_ConstRegs {
+	uint32_t known;
+	uint32_t values[32];
+};
+
+/*
+ * Register values known at compile time, from movei, moveq, move, addq, subq,
+ * shifts by a constant, and simple arithmetic and logic on known values.
+ *
+ * Only the current bank is tracked. Anything read from memory or the other
+ * bank is unknown, and a store to the CPU's flags register makes everything
+ * unknown, since it may switch banks.
+ */
+struct JRISC_ConstProp {
+	const struct JRISC_Program *program;
+
+	/*
+	 * The control flow graph, including an edge for every jump (rN) whose
+	 * target was found to be an instruction in the program.
+	 */
+	struct JRISC_Cfg *cfg;
+
+	/* Indexed by block: what is known when the block is entered */
+	struct JRISC_ConstRegs *blockRegs;
+
+	/*
+	 * Indexed by instruction: where a jump (rN) goes, or the effective address
+	 * of a load or store, if it is known.
+	 */
+	uint32_t *addresses;
+	uint8_t *addressKnown;
+};
+
+/*
+ * Propagate constants forward over the program's basic blocks with a
+ * worklist. A block is only revisited when what is known on entry to it
+ * changes, which can happen at most once per register, so each pass is
+ * linear in the size of the program.
+ *
+ * Jump targets found by one pass are added to the control flow graph and
+ * the pass is repeated, until no new targets are found. A jump target, like
+ * any block nothing is known to reach, may be entered from anywhere, so
+ * nothing is assumed known at its start.
+ *
+ * <program> must outlive the result.
+ */
+extern enum JRISC_Error
+jriscConstPropCompute(const struct JRISC_Program *program,
+					  struct JRISC_ConstProp **constPropOut);
+
+extern void
+jriscConstPropDestroy(struct JRISC_ConstProp *constProp);
+
+/*
+ * The target of the jump (rN), or the effective address of the load or store,
+ * at instruction <index>. Returns false if it isn't known, or the instruction
+ * is something else.
+ */
+extern bool
+jriscConstPropAddress(const struct JRISC_ConstProp *constProp,
+					  size_t index,
+					  uint32_t *addressOut);
+
+/* What is known just before instruction <index> runs */
+extern void
+jriscConstPropRegsAt(const struct JRISC_ConstProp *constProp,
+					 size_t index,
+					 struct JRISC_ConstRegs *regsOut);
+
+#endif /* JRISC_CONST_H_ */
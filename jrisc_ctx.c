@@ -6,6 +6,7 @@
 
 #include "jrisc_base.h"
 #include "jrisc_ctx.h"
+#include "jrisc_endian.h"
 
 #include <stdlib.h>
 
@@ -49,6 +50,90 @@ jriscContextWrite(struct JRISC_Context *context,
 	return ret;
 }
 
+/*
+ * Generate the word readers and writer for each of the two possible conversions:
+ * none, when the context's byte order matches the host's, and a full swap when
+ * it doesn't.
+ */
+#define JRISC_WORD_ACCESSORS(suffix, convert)							\
+	static enum JRISC_Error												\
+	jriscContextReadWord##suffix(struct JRISC_Context *context,			\
+								 uint16_t *word,						\
+								 uint32_t *address)						\
+	{																	\
+		uint16_t raw;													\
+		enum JRISC_Error ret = context->read(context, sizeof(raw),		\
+											 &raw, address);			\
+																		\
+		if (JRISC_success == ret) *word = convert(raw);					\
+																		\
+		return ret;														\
+	}																	\
+																		\
+	static enum JRISC_Error												\
+	jriscContextWriteWord##suffix(struct JRISC_Context *context,		\
+								  uint16_t word,						\
+								  uint32_t *address)					\
+	{																	\
+		uint16_t raw = convert(word);									\
+																		\
+		return context->write(context, sizeof(raw), &raw, address);		\
+	}																	\
+																		\
+	static enum JRISC_Error												\
+	jriscContextReadWords##suffix(struct JRISC_Context *context,		\
+								  uint16_t *words,						\
+								  size_t count,							\
+								  uint32_t *address)					\
+	{																	\
+		size_t i;														\
+		enum JRISC_Error ret = context->read(context,					\
+											 count * sizeof(*words),	\
+											 words, address);			\
+																		\
+		if (JRISC_success == ret) {										\
+			for (i = 0; i < count; i++) words[i] = convert(words[i]);	\
+		}																\
+																		\
+		return ret;														\
+	}
+
+#define JRISC_NO_SWAP(x) (x)
+
+JRISC_WORD_ACCESSORS(Native, JRISC_NO_SWAP)
+JRISC_WORD_ACCESSORS(Swapped, JRISC_BSWAP16)
+
+#undef JRISC_NO_SWAP
+#undef JRISC_WORD_ACCESSORS
+
+void
+jriscContextSeek(struct JRISC_Context *context,
+				 uint64_t location)
+{
+	context->readAddress += (uint32_t)(location - context->readLocation);
+	context->readLocation = location;
+}
+
+void
+jriscContextSetByteOrder(struct JRISC_Context *context,
+						 enum JRISC_ByteOrder byteOrder)
+{
+	const enum JRISC_ByteOrder hostOrder =
+		JRISC_HOST_BIG_ENDIAN ? JRISC_bigEndian : JRISC_littleEndian;
+
+	context->byteOrder = byteOrder;
+
+	if (byteOrder == hostOrder) {
+		context->readWord = jriscContextReadWordNative;
+		context->writeWord = jriscContextWriteWordNative;
+		context->readWords = jriscContextReadWordsNative;
+	} else {
+		context->readWord = jriscContextReadWordSwapped;
+		context->writeWord = jriscContextWriteWordSwapped;
+		context->readWords = jriscContextReadWordsSwapped;
+	}
+}
+
 enum JRISC_Error
 jriscContextCreate(JRISC_ReadFunc readFunc,
 				   JRISC_WriteFunc writeFunc,
@@ -74,6 +159,7 @@ jriscContextCreate(JRISC_ReadFunc readFunc,
 	ctx->writeAddress = baseAddress;
 	ctx->read = jriscContextRead;
 	ctx->write = jriscContextWrite;
+	jriscContextSetByteOrder(ctx, JRISC_bigEndian);
 
 	*contextOut = ctx;
 
@@ -9,6 +9,7 @@
 
 #include "jrisc_base.h"
 
+#include <stddef.h>
 #include <stdint.h>
 
 typedef enum JRISC_Error (*JRISC_ReadFunc)(void *userData,
@@ -23,6 +24,11 @@ typedef enum JRISC_Error (*JRISC_WriteFunc)(void *userData,
 
 typedef void (*JRISC_DestructorFunc)(void *userData);
 
+enum JRISC_ByteOrder {
+	JRISC_bigEndian,		/* Native Jaguar order */
+	JRISC_littleEndian		/* Each 16-bit word byte-swapped */
+};
+
 struct JRISC_Context {
 	JRISC_ReadFunc readFunc;
 	JRISC_WriteFunc writeFunc;
@@ -34,6 +40,8 @@ struct JRISC_Context {
 	uint64_t writeLocation;
 	uint32_t writeAddress;
 
+	enum JRISC_ByteOrder byteOrder;
+
 	enum JRISC_Error (*read)(struct JRISC_Context *context,
 							 uint64_t size,
 							 void *dst,
@@ -42,6 +50,24 @@ struct JRISC_Context {
 							  uint64_t size,
 							  const void *src,
 							  uint32_t *address);
+
+	/*
+	 * Read/write one 16-bit instruction word, converting between the context's
+	 * byte order and the host's. These are selected once, when the byte order
+	 * is set, so callers never branch on it per-word.
+	 */
+	enum JRISC_Error (*readWord)(struct JRISC_Context *context,
+								 uint16_t *word,
+								 uint32_t *address);
+	enum JRISC_Error (*writeWord)(struct JRISC_Context *context,
+								  uint16_t word,
+								  uint32_t *address);
+
+	/* Read <count> words at once, converting them as readWord does */
+	enum JRISC_Error (*readWords)(struct JRISC_Context *context,
+								  uint16_t *words,
+								  size_t count,
+								  uint32_t *address);
 };
 
 extern enum JRISC_Error
@@ -52,6 +78,15 @@ jriscContextCreate(JRISC_ReadFunc readfunc,
 				   uint32_t baseAddress,
 				   struct JRISC_Context **contextOut);
 
+/* Move the read position, keeping the address in step with it */
+extern void
+jriscContextSeek(struct JRISC_Context *context,
+				 uint64_t location);
+
+extern void
+jriscContextSetByteOrder(struct JRISC_Context *context,
+						 enum JRISC_ByteOrder byteOrder);
+
 extern void
 jriscContextDestroy(struct JRISC_Context *context);
 
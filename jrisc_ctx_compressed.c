@@ -0,0 +1,500 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_ctx.h"
+#include "jrisc_ctx_compressed.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(JRISC_HAVE_ZLIB)
+#include <zlib.h>
+#endif
+#if defined(JRISC_HAVE_LZMA)
+#include <lzma.h>
+#endif
+
+/* Compressed bytes read from the file at a time */
+#define COMPRESSED_INPUT_SIZE	(64 * 1024)
+
+struct CompressedStream {
+	/* Compressed data comes from either a file or memory */
+	FILE *fp;
+	long start;					/* Of the compressed data, or -1 */
+	const uint8_t *data;
+	size_t dataSize;
+	bool dataUsed;
+
+	enum JRISC_Compression compression;
+	bool started;
+	bool inputEnded;
+	bool ended;
+
+#if defined(JRISC_HAVE_ZLIB)
+	z_stream z;
+#endif
+#if defined(JRISC_HAVE_LZMA)
+	lzma_stream x;
+#endif
+
+	uint8_t input[COMPRESSED_INPUT_SIZE];
+};
+
+struct CompressedContext {
+	struct CompressedStream stream;
+
+	/* Decompressed bytes [windowStart, windowStart + windowFill) */
+	uint8_t *window;
+	size_t windowSize;
+	uint64_t windowStart;
+	size_t windowFill;
+};
+
+static const uint8_t jriscGzipMagic[] = { 0x1f, 0x8b, 0x08 };
+static const uint8_t jriscXzMagic[] = { 0xfd, '7', 'z', 'X', 'Z', 0x00 };
+
+enum JRISC_Compression
+jriscCompressionDetect(const void *data, size_t size)
+{
+	const uint8_t *bytes = data;
+
+	/* The gzip flags byte's top three bits are reserved, and always 0 */
+	if ((size >= 4) &&
+		!memcmp(bytes, jriscGzipMagic, sizeof(jriscGzipMagic)) &&
+		!(bytes[3] & 0xe0)) {
+		return JRISC_compressionGzip;
+	}
+
+	if ((size >= sizeof(jriscXzMagic)) &&
+		!memcmp(bytes, jriscXzMagic, sizeof(jriscXzMagic))) {
+		return JRISC_compressionXz;
+	}
+
+	return JRISC_compressionNone;
+}
+
+const char *
+jriscCompressionName(enum JRISC_Compression compression)
+{
+	switch (compression) {
+	case JRISC_compressionNone:
+		return "none";
+
+	case JRISC_compressionGzip:
+		return "gzip";
+
+	case JRISC_compressionXz:
+		return "xz";
+
+	default:
+		return "unknown";
+	}
+}
+
+bool
+jriscCompressionSupported(enum JRISC_Compression compression)
+{
+	switch (compression) {
+#if defined(JRISC_HAVE_ZLIB)
+	case JRISC_compressionGzip:
+		return true;
+#endif
+#if defined(JRISC_HAVE_LZMA)
+	case JRISC_compressionXz:
+		return true;
+#endif
+	default:
+		return false;
+	}
+}
+
+static void
+jriscStreamEnd(struct CompressedStream *s)
+{
+	if (!s->started) return;
+
+	switch (s->compression) {
+#if defined(JRISC_HAVE_ZLIB)
+	case JRISC_compressionGzip:
+		inflateEnd(&s->z);
+		break;
+#endif
+#if defined(JRISC_HAVE_LZMA)
+	case JRISC_compressionXz:
+		lzma_end(&s->x);
+		break;
+#endif
+	default:
+		break;
+	}
+
+	s->started = false;
+}
+
+/* Start decompressing, or start again from the beginning */
+static enum JRISC_Error
+jriscStreamStart(struct CompressedStream *s)
+{
+	if (s->started) {
+		jriscStreamEnd(s);
+		if (s->fp && ((s->start < 0) || fseek(s->fp, s->start, SEEK_SET))) {
+			return JRISC_ERROR_ioError;
+		}
+	}
+
+	s->dataUsed = false;
+	s->inputEnded = false;
+	s->ended = false;
+
+	switch (s->compression) {
+#if defined(JRISC_HAVE_ZLIB)
+	case JRISC_compressionGzip:
+		memset(&s->z, 0, sizeof(s->z));
+		/* 32 lets zlib find the gzip header itself */
+		if (inflateInit2(&s->z, 15 + 32) != Z_OK) {
+			return JRISC_ERROR_outOfMemory;
+		}
+		break;
+#endif
+#if defined(JRISC_HAVE_LZMA)
+	case JRISC_compressionXz:
+		memset(&s->x, 0, sizeof(s->x));
+		if (lzma_stream_decoder(&s->x, UINT64_MAX, LZMA_CONCATENATED) !=
+			LZMA_OK) {
+			return JRISC_ERROR_outOfMemory;
+		}
+		break;
+#endif
+	default:
+		return JRISC_ERROR_invalidFormat;
+	}
+
+	s->started = true;
+
+	return JRISC_success;
+}
+
+#if defined(JRISC_HAVE_ZLIB) || defined(JRISC_HAVE_LZMA)
+/* Get the next piece of the compressed data */
+static enum JRISC_Error
+jriscStreamFill(struct CompressedStream *s,
+				const uint8_t **nextOut,
+				size_t *gotOut)
+{
+	if (!s->fp) {
+		*nextOut = s->data;
+		*gotOut = s->dataUsed ? 0 : s->dataSize;
+		s->dataUsed = true;
+	} else {
+		*nextOut = s->input;
+		*gotOut = fread(s->input, 1, sizeof(s->input), s->fp);
+		if (!*gotOut && ferror(s->fp)) return JRISC_ERROR_ioError;
+	}
+
+	if (!*gotOut) s->inputEnded = true;
+
+	return JRISC_success;
+}
+#endif
+
+#if defined(JRISC_HAVE_ZLIB)
+static enum JRISC_Error
+jriscStreamInflate(struct CompressedStream *s, uint8_t *dst, size_t size)
+{
+	const uint8_t *next;
+	size_t got;
+	enum JRISC_Error ret;
+	int zret;
+
+	s->z.next_out = dst;
+	s->z.avail_out = (uInt)size;
+
+	while (s->z.avail_out && !s->ended) {
+		if (!s->z.avail_in && !s->inputEnded) {
+			ret = jriscStreamFill(s, &next, &got);
+			if (ret != JRISC_success) return ret;
+			s->z.next_in = (Bytef *)next;
+			s->z.avail_in = (uInt)got;
+		}
+
+		zret = inflate(&s->z, Z_NO_FLUSH);
+		if (zret == Z_STREAM_END) {
+			/* A gzip file may hold several members, one after another */
+			if (!s->z.avail_in && !s->inputEnded) {
+				ret = jriscStreamFill(s, &next, &got);
+				if (ret != JRISC_success) return ret;
+				s->z.next_in = (Bytef *)next;
+				s->z.avail_in = (uInt)got;
+			}
+
+			if (!s->z.avail_in) {
+				s->ended = true;
+			} else if (inflateReset(&s->z) != Z_OK) {
+				return JRISC_ERROR_invalidFormat;
+			}
+		} else if ((zret == Z_BUF_ERROR) && s->inputEnded) {
+			return JRISC_ERROR_ioError;		/* Cut short */
+		} else if (zret == Z_MEM_ERROR) {
+			return JRISC_ERROR_outOfMemory;
+		} else if ((zret != Z_OK) && (zret != Z_BUF_ERROR)) {
+			return JRISC_ERROR_invalidFormat;
+		}
+	}
+
+	return JRISC_success;
+}
+#endif
+
+#if defined(JRISC_HAVE_LZMA)
+static enum JRISC_Error
+jriscStreamUnxz(struct CompressedStream *s, uint8_t *dst, size_t size)
+{
+	const uint8_t *next;
+	size_t got;
+	enum JRISC_Error ret;
+	lzma_ret xret;
+
+	s->x.next_out = dst;
+	s->x.avail_out = size;
+
+	while (s->x.avail_out && !s->ended) {
+		if (!s->x.avail_in && !s->inputEnded) {
+			ret = jriscStreamFill(s, &next, &got);
+			if (ret != JRISC_success) return ret;
+			s->x.next_in = next;
+			s->x.avail_in = got;
+		}
+
+		xret = lzma_code(&s->x, s->inputEnded ? LZMA_FINISH : LZMA_RUN);
+		if (xret == LZMA_STREAM_END) {
+			s->ended = true;
+		} else if (xret == LZMA_BUF_ERROR) {
+			return JRISC_ERROR_ioError;		/* Cut short */
+		} else if (xret == LZMA_MEM_ERROR) {
+			return JRISC_ERROR_outOfMemory;
+		} else if (xret != LZMA_OK) {
+			return JRISC_ERROR_invalidFormat;
+		}
+	}
+
+	return JRISC_success;
+}
+#endif
+
+/* Decompress up to <size> bytes. Fewer are returned only at the end. */
+static enum JRISC_Error
+jriscStreamRead(struct CompressedStream *s,
+				uint8_t *dst,
+				size_t size,
+				size_t *gotOut)
+{
+	enum JRISC_Error ret;
+
+	*gotOut = 0;
+	if (s->ended) return JRISC_success;
+
+	switch (s->compression) {
+#if defined(JRISC_HAVE_ZLIB)
+	case JRISC_compressionGzip:
+		ret = jriscStreamInflate(s, dst, size);
+		*gotOut = size - s->z.avail_out;
+		break;
+#endif
+#if defined(JRISC_HAVE_LZMA)
+	case JRISC_compressionXz:
+		ret = jriscStreamUnxz(s, dst, size);
+		*gotOut = size - s->x.avail_out;
+		break;
+#endif
+	default:
+		(void)dst;
+		(void)size;
+		ret = JRISC_ERROR_invalidFormat;
+		break;
+	}
+
+	return ret;
+}
+
+static enum JRISC_Error
+jriscCompressedRead(void *userData,
+					uint64_t location,
+					uint64_t size,
+					void *dst)
+{
+	struct CompressedContext *cCtx = (struct CompressedContext *)userData;
+	const size_t half = cCtx->windowSize / 2;
+	enum JRISC_Error ret;
+	size_t got;
+
+	if (size > half) return JRISC_ERROR_invalidValue;
+
+	if (location < cCtx->windowStart) {
+		ret = jriscStreamStart(&cCtx->stream);
+		if (ret != JRISC_success) return ret;
+		cCtx->windowStart = 0;
+		cCtx->windowFill = 0;
+	}
+
+	while (location + size > cCtx->windowStart + cCtx->windowFill) {
+		if (location >= cCtx->windowStart + cCtx->windowSize) {
+			/* Nothing in the window is wanted */
+			cCtx->windowStart += cCtx->windowFill;
+			cCtx->windowFill = 0;
+		} else if (cCtx->windowFill == cCtx->windowSize) {
+			/* Keep the newer half for reading back */
+			memmove(cCtx->window, cCtx->window + half,
+					cCtx->windowSize - half);
+			cCtx->windowStart += half;
+			cCtx->windowFill -= half;
+		}
+
+		ret = jriscStreamRead(&cCtx->stream,
+							  cCtx->window + cCtx->windowFill,
+							  cCtx->windowSize - cCtx->windowFill,
+							  &got);
+		if (ret != JRISC_success) return ret;
+		if (!got) return JRISC_ERROR_ioError;	/* Past the end */
+
+		cCtx->windowFill += got;
+	}
+
+	memcpy(dst, cCtx->window + (location - cCtx->windowStart), size);
+
+	return JRISC_success;
+}
+
+static enum JRISC_Error
+jriscCompressedWrite(void *userData,
+					 uint64_t location,
+					 uint64_t size,
+					 const void *src)
+{
+	(void)userData;
+	(void)location;
+	(void)size;
+	(void)src;
+
+	return JRISC_ERROR_ioError;
+}
+
+static void
+jriscDestroyCompressedData(void *userData)
+{
+	struct CompressedContext *cCtx = (struct CompressedContext *)userData;
+
+	jriscStreamEnd(&cCtx->stream);
+	free(cCtx->window);
+	free(cCtx);
+}
+
+enum JRISC_Error
+jriscContextFromCompressedFile(FILE *fp,
+							   enum JRISC_Compression compression,
+							   size_t windowSize,
+							   uint32_t baseAddress,
+							   struct JRISC_Context **contextOut)
+{
+	struct CompressedContext *cCtx;
+	enum JRISC_Error ret;
+
+	if (!jriscCompressionSupported(compression)) {
+		return JRISC_ERROR_invalidFormat;
+	}
+
+	if (windowSize < 2) return JRISC_ERROR_invalidValue;
+
+	cCtx = calloc(1, sizeof(*cCtx));
+	if (!cCtx) return JRISC_ERROR_outOfMemory;
+
+	cCtx->window = malloc(windowSize);
+	if (!cCtx->window) {
+		free(cCtx);
+		return JRISC_ERROR_outOfMemory;
+	}
+
+	cCtx->windowSize = windowSize;
+	cCtx->stream.fp = fp;
+	cCtx->stream.start = ftell(fp);
+	cCtx->stream.compression = compression;
+
+	ret = jriscStreamStart(&cCtx->stream);
+	if (ret == JRISC_success) {
+		ret = jriscContextCreate(jriscCompressedRead,
+								 jriscCompressedWrite,
+								 jriscDestroyCompressedData,
+								 cCtx,
+								 baseAddress,
+								 contextOut);
+	}
+
+	if (ret != JRISC_success) jriscDestroyCompressedData(cCtx);
+
+	return ret;
+}
+
+enum JRISC_Error
+jriscDecompress(const void *data,
+				size_t size,
+				enum JRISC_Compression compression,
+				size_t maxSize,
+				uint8_t **dataOut,
+				size_t *sizeOut)
+{
+	struct CompressedStream *s;
+	uint8_t *buf = NULL;
+	uint8_t *newBuf;
+	size_t capacity = 0;
+	size_t bufSize = 0;
+	size_t got;
+	enum JRISC_Error ret;
+
+	s = calloc(1, sizeof(*s));
+	if (!s) return JRISC_ERROR_outOfMemory;
+
+	s->data = data;
+	s->dataSize = size;
+	s->compression = compression;
+
+	ret = jriscStreamStart(s);
+
+	while (ret == JRISC_success) {
+		if (bufSize > maxSize) {
+			ret = JRISC_ERROR_invalidValue;
+			break;
+		}
+
+		if (bufSize == capacity) {
+			/* One byte more than the limit is enough to see it's too much */
+			capacity = capacity ? capacity * 2 : 256 * 1024;
+			if (capacity > maxSize) capacity = maxSize + 1;
+			newBuf = realloc(buf, capacity);
+			if (!newBuf) {
+				ret = JRISC_ERROR_outOfMemory;
+				break;
+			}
+			buf = newBuf;
+		}
+
+		ret = jriscStreamRead(s, &buf[bufSize], capacity - bufSize, &got);
+		bufSize += got;
+		if (!got) break;
+	}
+
+	jriscStreamEnd(s);
+	free(s);
+
+	if (ret != JRISC_success) {
+		free(buf);
+		return ret;
+	}
+
+	*dataOut = buf;
+	*sizeOut = bufSize;
+
+	return JRISC_success;
+}
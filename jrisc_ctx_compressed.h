@@ -0,0 +1,70 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#ifndef JRISC_CONTEXT_COMPRESSED_H_
+#define JRISC_CONTEXT_COMPRESSED_H_
+
+#include "jrisc_ctx.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/* The default amount of decompressed data kept for reading back */
+#define JRISC_COMPRESSED_WINDOW		(1024 * 1024)
+
+enum JRISC_Compression {
+	JRISC_compressionNone,
+	JRISC_compressionGzip,		/* Needs zlib: JRISC_HAVE_ZLIB */
+	JRISC_compressionXz			/* Needs liblzma: JRISC_HAVE_LZMA */
+};
+
+/* Recognize a compressed file by the magic number in its first bytes */
+extern enum JRISC_Compression
+jriscCompressionDetect(const void *data, size_t size);
+
+/* e.g. "gzip" */
+extern const char *
+jriscCompressionName(enum JRISC_Compression compression);
+
+/* Whether this build can decompress the format */
+extern bool
+jriscCompressionSupported(enum JRISC_Compression compression);
+
+/*
+ * A read-only context that decompresses <fp>, from its current position, as
+ * it is read. The last <windowSize> bytes or so decompressed are kept, so
+ * reads may go forward freely and back a short way cheaply. Reading further
+ * back starts decompressing again from the beginning. A single read can't be
+ * more than half the window.
+ *
+ * Returns JRISC_ERROR_invalidFormat if the build can't decompress the format.
+ * <fp> must stay open until the context is destroyed.
+ */
+extern enum JRISC_Error
+jriscContextFromCompressedFile(FILE *fp,
+							   enum JRISC_Compression compression,
+							   size_t windowSize,
+							   uint32_t baseAddress,
+							   struct JRISC_Context **contextOut);
+
+/* Far more than the largest (6MB) cartridge, but bounded */
+#define JRISC_DECOMPRESS_MAX_SIZE	(16 * 6 * 1024 * 1024)
+
+/*
+ * Decompress all of <data>, which may hold several compressed streams one
+ * after another, into a buffer to be freed with free(). Returns
+ * JRISC_ERROR_invalidValue rather than decompress more than <maxSize> bytes.
+ */
+extern enum JRISC_Error
+jriscDecompress(const void *data,
+				size_t size,
+				enum JRISC_Compression compression,
+				size_t maxSize,
+				uint8_t **dataOut,
+				size_t *sizeOut);
+
+#endif /* JRISC_CONTEXT_COMPRESSED_H_ */
@@ -0,0 +1,652 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_diff.h"
+#include "jrisc_inst.h"
+#include "jrisc_program.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Length of the instruction runs first used as anchors */
+#define DIFF_WINDOW			16
+
+/* Gaps with no anchors at all are aligned by LCS if no bigger than this */
+#define DIFF_LCS_LIMIT		(1 << 16)
+
+/* Tokens hold the opName above this bit */
+#define DIFF_OPNAME_SHIFT	40
+
+#define DIFF_ROLL_PRIME		0x100000001b3ull
+#define NO_MATCH			((uint32_t)-1)
+
+struct DiffRange {
+	uint32_t aLo, aHi;
+	uint32_t bLo, bHi;
+	uint32_t window;
+};
+
+/*
+ * Window positions, relative to the start of the range, or one of the
+ * markers below.
+ */
+#define SLOT_EMPTY			0xffffffffu
+#define SLOT_REPEATED		0xfffffffeu
+
+struct DiffSlot {
+	uint64_t hash;
+	uint32_t posA;
+	uint32_t posB;
+};
+
+struct DiffAnchor {
+	uint32_t a;
+	uint32_t b;
+};
+
+struct DiffState {
+	const struct JRISC_Program *a;
+	const struct JRISC_Program *b;
+
+	/* Normalized instructions: equal tokens are candidates for alignment */
+	uint64_t *tokensA;
+	uint64_t *tokensB;
+	uint32_t *matchA;
+	uint32_t *matchB;
+
+	struct DiffRange *ranges;
+	size_t numRanges;
+	size_t maxRanges;
+
+	/* Scratch space, sized for the largest range */
+	uint64_t *hashesA;
+	uint32_t *positionsA;
+	struct DiffSlot *slots;
+	struct DiffAnchor *anchors;
+	uint32_t *lisTails;
+	uint32_t *lisPrev;
+};
+
+static uint64_t
+jriscDiffToken(const struct JRISC_Program *p, size_t index)
+{
+	const struct JRISC_Instruction *inst = &p->instructions[index];
+	uint64_t opName = (uint64_t)inst->opName << DIFF_OPNAME_SHIFT;
+
+	switch (inst->opName) {
+	case JRISC_invalidOpName:
+		return opName | jriscProgramRaw(p, index);
+
+	case JRISC_op_jr:
+		/* Where it leads is checked once the programs are aligned */
+		return opName | inst->regDst.val.condition;
+
+	case JRISC_op_movei:
+		if (jriscProgramContains(p, inst->longImmediate)) {
+			return opName | (1ull << 39) | inst->regDst.val.reg;
+		}
+		return opName | ((uint64_t)inst->regDst.val.reg << 32) |
+			inst->longImmediate;
+
+	default:
+		return opName | jriscProgramRaw(p, index);
+	}
+}
+
+/* Spread the bits of a token before it goes into a rolling hash */
+static uint64_t
+jriscDiffMix(uint64_t token)
+{
+	token ^= token >> 30;
+	token *= 0xbf58476d1ce4e5b9ull;
+	token ^= token >> 27;
+	token *= 0x94d049bb133111ebull;
+	token ^= token >> 31;
+
+	return token;
+}
+
+static void
+jriscDiffMatch(struct DiffState *s, uint32_t a, uint32_t b)
+{
+	s->matchA[a] = b;
+	s->matchB[b] = a;
+}
+
+static bool
+jriscDiffPush(struct DiffState *s,
+			  uint32_t aLo, uint32_t aHi,
+			  uint32_t bLo, uint32_t bHi,
+			  uint32_t window)
+{
+	struct DiffRange *newRanges;
+
+	if ((aLo >= aHi) || (bLo >= bHi)) return true;
+
+	if (s->numRanges == s->maxRanges) {
+		s->maxRanges = s->maxRanges ? s->maxRanges * 2 : 64;
+		newRanges = realloc(s->ranges, s->maxRanges * sizeof(*s->ranges));
+		if (!newRanges) return false;
+		s->ranges = newRanges;
+	}
+
+	s->ranges[s->numRanges].aLo = aLo;
+	s->ranges[s->numRanges].aHi = aHi;
+	s->ranges[s->numRanges].bLo = bLo;
+	s->ranges[s->numRanges].bHi = bHi;
+	s->ranges[s->numRanges].window = window;
+	s->numRanges++;
+
+	return true;
+}
+
+static struct DiffSlot *
+jriscDiffSlot(struct DiffSlot *slots, size_t mask, uint64_t hash)
+{
+	/* The low bits of a polynomial hash are weak; use the high ones */
+	size_t i = (size_t)((hash ^ (hash >> 32)) * 0x9e3779b97f4a7c15ull >> 32) &
+		mask;
+
+	while ((slots[i].posA != SLOT_EMPTY) && (slots[i].hash != hash)) {
+		i = (i + 1) & mask;
+	}
+
+	return &slots[i];
+}
+
+/*
+ * Once a range has more than DIFF_SAMPLE_MIN windows, only those whose hash
+ * has DIFF_SAMPLE_BITS leading zero bits are considered as anchors. Identical
+ * code is sampled identically in both programs, and the gaps between the
+ * sparser anchors are filled in by the recursion, but the hash table shrinks
+ * enough to stay mostly in cache.
+ */
+#define DIFF_SAMPLE_BITS	4
+#define DIFF_SAMPLE_MIN		4096
+
+static uint64_t
+jriscDiffRollInit(const uint64_t *tokens, uint32_t w)
+{
+	uint64_t hash = 0;
+	uint32_t i;
+
+	for (i = 0; i < w; i++) {
+		hash = hash * DIFF_ROLL_PRIME + jriscDiffMix(tokens[i]);
+	}
+
+	return hash;
+}
+
+static uint64_t
+jriscDiffRoll(uint64_t hash, uint64_t out, uint64_t in, uint64_t power)
+{
+	return (hash - jriscDiffMix(out) * power) * DIFF_ROLL_PRIME +
+		jriscDiffMix(in);
+}
+
+/*
+ * Find pairs of windows that occur exactly once in each side of the range.
+ * Returns them in increasing order of their position in a.
+ */
+static size_t
+jriscDiffAnchors(struct DiffState *s, const struct DiffRange *r)
+{
+	const uint32_t w = r->window;
+	const uint32_t numA = r->aHi - r->aLo - w + 1;
+	const uint32_t numB = r->bHi - r->bLo - w + 1;
+	const uint64_t *tokensA = &s->tokensA[r->aLo];
+	const uint64_t *tokensB = &s->tokensB[r->bLo];
+	const bool sample = numA > DIFF_SAMPLE_MIN;
+	struct DiffSlot *slot;
+	uint64_t power = 1;
+	uint64_t hash;
+	size_t tableSize = 16;
+	size_t numSampled = 0;
+	size_t numAnchors = 0;
+	uint32_t i;
+
+#define SAMPLED(hash) (!sample || !((hash) >> (64 - DIFF_SAMPLE_BITS)))
+
+	for (i = 1; i < w; i++) power *= DIFF_ROLL_PRIME;
+
+	for (i = 0, hash = jriscDiffRollInit(tokensA, w); i < numA; i++) {
+		if (i) hash = jriscDiffRoll(hash, tokensA[i - 1], tokensA[i + w - 1],
+									power);
+		if (SAMPLED(hash)) {
+			s->hashesA[numSampled] = hash;
+			s->positionsA[numSampled] = i;
+			numSampled++;
+		}
+	}
+
+	while (tableSize < (numSampled + numSampled / 2)) tableSize *= 2;
+	memset(s->slots, 0xff, tableSize * sizeof(*s->slots));
+
+	for (i = 0; i < numSampled; i++) {
+		slot = jriscDiffSlot(s->slots, tableSize - 1, s->hashesA[i]);
+		slot->hash = s->hashesA[i];
+		slot->posA = (slot->posA == SLOT_EMPTY) ? s->positionsA[i] :
+			SLOT_REPEATED;
+	}
+
+	for (i = 0, hash = jriscDiffRollInit(tokensB, w); i < numB; i++) {
+		if (i) hash = jriscDiffRoll(hash, tokensB[i - 1], tokensB[i + w - 1],
+									power);
+		if (!SAMPLED(hash)) continue;
+
+		slot = jriscDiffSlot(s->slots, tableSize - 1, hash);
+		if (slot->posA == SLOT_EMPTY) continue;
+		slot->posB = (slot->posB == SLOT_EMPTY) ? i : SLOT_REPEATED;
+	}
+
+	for (i = 0; i < numSampled; i++) {
+		slot = jriscDiffSlot(s->slots, tableSize - 1, s->hashesA[i]);
+		if ((slot->posA >= SLOT_REPEATED) || (slot->posB >= SLOT_REPEATED)) {
+			continue;
+		}
+
+		/* Rule out hash collisions */
+		if (memcmp(&tokensA[slot->posA], &tokensB[slot->posB],
+				   w * sizeof(*tokensA))) {
+			continue;
+		}
+
+		s->anchors[numAnchors].a = r->aLo + slot->posA;
+		s->anchors[numAnchors].b = r->bLo + slot->posB;
+		numAnchors++;
+	}
+#undef SAMPLED
+
+	return numAnchors;
+}
+
+/*
+ * Keep the longest chain of anchors that increases in b as well as a. The
+ * chain is moved to the front of the anchor array.
+ */
+static size_t
+jriscDiffLongestChain(struct DiffState *s, size_t numAnchors)
+{
+	uint32_t length = 0;
+	uint32_t lo, hi, mid;
+	uint32_t i, k;
+
+	for (i = 0; i < (uint32_t)numAnchors; i++) {
+		lo = 0;
+		hi = length;
+		while (lo < hi) {
+			mid = (lo + hi) / 2;
+			if (s->anchors[s->lisTails[mid]].b < s->anchors[i].b) {
+				lo = mid + 1;
+			} else {
+				hi = mid;
+			}
+		}
+
+		s->lisPrev[i] = lo ? s->lisTails[lo - 1] : NO_MATCH;
+		s->lisTails[lo] = i;
+		if (lo == length) length++;
+	}
+
+	/* Walk back from the end, filling the front of the array from the back */
+	for (i = length ? s->lisTails[length - 1] : NO_MATCH, k = length;
+		 i != NO_MATCH; i = s->lisPrev[i]) {
+		s->anchors[--k] = s->anchors[i];
+	}
+
+	return length;
+}
+
+/*
+ * Match up the longest common subsequence of a small range. Tokens are
+ * compared after shifting right by <shift>: 0 compares them exactly, and
+ * DIFF_OPNAME_SHIFT compares only the opName.
+ */
+static bool
+jriscDiffLcs(struct DiffState *s, const struct DiffRange *r, unsigned shift)
+{
+	const uint32_t n = r->aHi - r->aLo;
+	const uint32_t m = r->bHi - r->bLo;
+	const uint64_t *tokensA = &s->tokensA[r->aLo];
+	const uint64_t *tokensB = &s->tokensB[r->bLo];
+	uint32_t *table = calloc((size_t)(n + 1) * (m + 1), sizeof(*table));
+	uint32_t i, j;
+
+#define LCS(i, j) table[(size_t)(i) * (m + 1) + (j)]
+#define SAME(i, j) ((tokensA[i] >> shift) == (tokensB[j] >> shift))
+	if (!table) return false;
+
+	for (i = n; i-- > 0; ) {
+		for (j = m; j-- > 0; ) {
+			if (SAME(i, j)) {
+				LCS(i, j) = LCS(i + 1, j + 1) + 1;
+			} else if (LCS(i + 1, j) >= LCS(i, j + 1)) {
+				LCS(i, j) = LCS(i + 1, j);
+			} else {
+				LCS(i, j) = LCS(i, j + 1);
+			}
+		}
+	}
+
+	for (i = 0, j = 0; (i < n) && (j < m); ) {
+		if (SAME(i, j)) {
+			jriscDiffMatch(s, r->aLo + i, r->bLo + j);
+			i++;
+			j++;
+		} else if (LCS(i + 1, j) >= LCS(i, j + 1)) {
+			i++;
+		} else {
+			j++;
+		}
+	}
+#undef SAME
+#undef LCS
+
+	free(table);
+
+	return true;
+}
+
+static bool
+jriscDiffRange(struct DiffState *s, struct DiffRange r)
+{
+	size_t numAnchors;
+	uint32_t prevA, prevB;
+	size_t i;
+
+	while ((r.aLo < r.aHi) && (r.bLo < r.bHi) &&
+		   (s->tokensA[r.aLo] == s->tokensB[r.bLo])) {
+		jriscDiffMatch(s, r.aLo++, r.bLo++);
+	}
+
+	while ((r.aLo < r.aHi) && (r.bLo < r.bHi) &&
+		   (s->tokensA[r.aHi - 1] == s->tokensB[r.bHi - 1])) {
+		jriscDiffMatch(s, --r.aHi, --r.bHi);
+	}
+
+	if ((r.aLo == r.aHi) || (r.bLo == r.bHi)) return true;
+
+	if (r.window > (r.aHi - r.aLo)) r.window = r.aHi - r.aLo;
+	if (r.window > (r.bHi - r.bLo)) r.window = r.bHi - r.bLo;
+
+	numAnchors = jriscDiffAnchors(s, &r);
+
+	if (!numAnchors) {
+		if (r.window > 1) {
+			return jriscDiffPush(s, r.aLo, r.aHi, r.bLo, r.bHi, r.window / 2);
+		}
+
+		/* Nothing in common is unique. Leave big gaps unaligned. */
+		if (((uint64_t)(r.aHi - r.aLo) * (r.bHi - r.bLo)) <= DIFF_LCS_LIMIT) {
+			return jriscDiffLcs(s, &r, 0);
+		}
+
+		return true;
+	}
+
+	numAnchors = jriscDiffLongestChain(s, numAnchors);
+
+	prevA = r.aLo;
+	prevB = r.bLo;
+	for (i = 0; i < numAnchors; i++) {
+		jriscDiffMatch(s, s->anchors[i].a, s->anchors[i].b);
+		if (!jriscDiffPush(s, prevA, s->anchors[i].a,
+						   prevB, s->anchors[i].b, r.window)) {
+			return false;
+		}
+		prevA = s->anchors[i].a + 1;
+		prevB = s->anchors[i].b + 1;
+	}
+
+	return jriscDiffPush(s, prevA, r.aHi, prevB, r.bHi, r.window);
+}
+
+/*
+ * Pair up instructions left over in a gap between aligned ones, so that e.g.
+ * a register change reads as one changed instruction rather than a deletion
+ * and an insertion. Small gaps pair instructions with the same opName; big
+ * ones just pair them in order.
+ */
+static bool
+jriscDiffPairGap(struct DiffState *s, const struct DiffRange *r)
+{
+	uint32_t k;
+
+	if ((r->aLo >= r->aHi) || (r->bLo >= r->bHi)) return true;
+
+	if (((uint64_t)(r->aHi - r->aLo) * (r->bHi - r->bLo)) <= DIFF_LCS_LIMIT) {
+		return jriscDiffLcs(s, r, DIFF_OPNAME_SHIFT);
+	}
+
+	for (k = 0; ((r->aLo + k) < r->aHi) && ((r->bLo + k) < r->bHi); k++) {
+		jriscDiffMatch(s, r->aLo + k, r->bLo + k);
+	}
+
+	return true;
+}
+
+/*
+ * Translate an address in the old program to the new one, through whatever
+ * instruction contains it. Addresses outside the old program are unchanged.
+ */
+static bool
+jriscDiffMapAddress(const struct DiffState *s,
+					uint32_t address,
+					uint32_t *addressOut)
+{
+	uint32_t index = jriscProgramFind(s->a, address);
+
+	if (index == JRISC_PROGRAM_NO_INSTRUCTION) {
+		*addressOut = address;
+		return true;
+	}
+
+	if (s->matchA[index] == NO_MATCH) return false;
+
+	*addressOut = s->b->instructions[s->matchA[index]].address +
+		(address - s->a->instructions[index].address);
+
+	return true;
+}
+
+/* Whether two aligned instructions really do the same thing */
+static bool
+jriscDiffSame(const struct DiffState *s, uint32_t a, uint32_t b)
+{
+	const struct JRISC_Instruction *instA = &s->a->instructions[a];
+	const struct JRISC_Instruction *instB = &s->b->instructions[b];
+	uint32_t target;
+
+	if (s->tokensA[a] != s->tokensB[b]) return false;
+
+	switch (instA->opName) {
+	case JRISC_op_jr:
+		if (!jriscProgramContains(s->a, jriscInstructionBranchTarget(instA))) {
+			return instA->regSrc.val.simmediate ==
+				instB->regSrc.val.simmediate;
+		}
+		return jriscDiffMapAddress(s, jriscInstructionBranchTarget(instA),
+								   &target) &&
+			(target == jriscInstructionBranchTarget(instB));
+
+	case JRISC_op_movei:
+		if (!jriscProgramContains(s->a, instA->longImmediate)) return true;
+		return jriscDiffMapAddress(s, instA->longImmediate, &target) &&
+			(target == instB->longImmediate);
+
+	default:
+		return true;
+	}
+}
+
+static bool
+jriscDiffAppend(struct JRISC_Diff *diff,
+				size_t *maxHunks,
+				enum JRISC_DiffKind kind,
+				size_t a,
+				size_t b)
+{
+	struct JRISC_DiffHunk *hunk;
+	struct JRISC_DiffHunk *newHunks;
+	size_t numOld = (kind == JRISC_diffInserted) ? 0 : 1;
+	size_t numNew = (kind == JRISC_diffDeleted) ? 0 : 1;
+
+	switch (kind) {
+	case JRISC_diffChanged: diff->changed++; break;
+	case JRISC_diffDeleted: diff->deleted++; break;
+	case JRISC_diffInserted: diff->inserted++; break;
+	default: break;
+	}
+
+	if (diff->numHunks && (diff->hunks[diff->numHunks - 1].kind == kind)) {
+		hunk = &diff->hunks[diff->numHunks - 1];
+		hunk->oldCount += numOld;
+		hunk->newCount += numNew;
+		return true;
+	}
+
+	if (diff->numHunks == *maxHunks) {
+		*maxHunks = *maxHunks ? *maxHunks * 2 : 64;
+		newHunks = realloc(diff->hunks, *maxHunks * sizeof(*diff->hunks));
+		if (!newHunks) return false;
+		diff->hunks = newHunks;
+	}
+
+	hunk = &diff->hunks[diff->numHunks++];
+	hunk->kind = kind;
+	hunk->oldIndex = a;
+	hunk->oldCount = numOld;
+	hunk->newIndex = b;
+	hunk->newCount = numNew;
+
+	return true;
+}
+
+static void
+jriscDiffFreeState(struct DiffState *s)
+{
+	free(s->tokensA);
+	free(s->tokensB);
+	free(s->matchA);
+	free(s->matchB);
+	free(s->ranges);
+	free(s->hashesA);
+	free(s->positionsA);
+	free(s->slots);
+	free(s->anchors);
+	free(s->lisTails);
+	free(s->lisPrev);
+}
+
+enum JRISC_Error
+jriscDiffPrograms(const struct JRISC_Program *oldProgram,
+				  const struct JRISC_Program *newProgram,
+				  struct JRISC_Diff **diffOut)
+{
+	const uint32_t nA = (uint32_t)oldProgram->numInstructions;
+	const uint32_t nB = (uint32_t)newProgram->numInstructions;
+	const size_t nMax = ((nA > nB) ? nA : nB) + 1;
+	struct DiffState s;
+	struct DiffRange gap;
+	struct JRISC_Diff *diff = NULL;
+	enum JRISC_DiffKind kind;
+	size_t tableSize = 16;
+	size_t maxHunks = 0;
+	uint32_t i, j;
+
+	memset(&s, 0, sizeof(s));
+	s.a = oldProgram;
+	s.b = newProgram;
+
+	while (tableSize < (nMax + nMax / 2)) tableSize *= 2;
+
+	s.tokensA = malloc(((size_t)nA + 1) * sizeof(*s.tokensA));
+	s.tokensB = malloc(((size_t)nB + 1) * sizeof(*s.tokensB));
+	s.matchA = malloc(((size_t)nA + 1) * sizeof(*s.matchA));
+	s.matchB = malloc(((size_t)nB + 1) * sizeof(*s.matchB));
+	s.hashesA = malloc(nMax * sizeof(*s.hashesA));
+	s.positionsA = malloc(nMax * sizeof(*s.positionsA));
+	s.slots = malloc(tableSize * sizeof(*s.slots));
+	s.anchors = malloc(nMax * sizeof(*s.anchors));
+	s.lisTails = malloc(nMax * sizeof(*s.lisTails));
+	s.lisPrev = malloc(nMax * sizeof(*s.lisPrev));
+	diff = calloc(1, sizeof(*diff));
+
+	if (!s.tokensA || !s.tokensB || !s.matchA || !s.matchB || !s.hashesA ||
+		!s.positionsA || !s.slots || !s.anchors || !s.lisTails ||
+		!s.lisPrev || !diff) {
+		goto oom;
+	}
+
+	for (i = 0; i < nA; i++) {
+		s.tokensA[i] = jriscDiffToken(oldProgram, i);
+		s.matchA[i] = NO_MATCH;
+	}
+	for (j = 0; j < nB; j++) {
+		s.tokensB[j] = jriscDiffToken(newProgram, j);
+		s.matchB[j] = NO_MATCH;
+	}
+
+	/* Ranges are independent, so the order they are worked in is arbitrary */
+	if (!jriscDiffPush(&s, 0, nA, 0, nB, DIFF_WINDOW)) goto oom;
+	while (s.numRanges) {
+		if (!jriscDiffRange(&s, s.ranges[--s.numRanges])) goto oom;
+	}
+
+	for (i = 0, j = 0; (i < nA) && (j < nB); i = gap.aHi, j = gap.bHi) {
+		if (s.matchA[i] == j) {
+			gap.aHi = i + 1;
+			gap.bHi = j + 1;
+			continue;
+		}
+
+		gap.aLo = i;
+		gap.bLo = j;
+		for (gap.aHi = i; (gap.aHi < nA) && (s.matchA[gap.aHi] == NO_MATCH);
+			 gap.aHi++);
+		for (gap.bHi = j; (gap.bHi < nB) && (s.matchB[gap.bHi] == NO_MATCH);
+			 gap.bHi++);
+
+		if (!jriscDiffPairGap(&s, &gap)) goto oom;
+	}
+
+	for (i = 0, j = 0; (i < nA) || (j < nB); ) {
+		if ((i < nA) && (j < nB) && (s.matchA[i] == j)) {
+			kind = jriscDiffSame(&s, i, j) ?
+				JRISC_diffEqual : JRISC_diffChanged;
+		} else if ((i < nA) && (s.matchA[i] == NO_MATCH)) {
+			kind = JRISC_diffDeleted;
+		} else {
+			kind = JRISC_diffInserted;
+		}
+
+		if (!jriscDiffAppend(diff, &maxHunks, kind, i, j)) goto oom;
+
+		if (kind != JRISC_diffInserted) i++;
+		if (kind != JRISC_diffDeleted) j++;
+	}
+
+	jriscDiffFreeState(&s);
+	*diffOut = diff;
+
+	return JRISC_success;
+
+oom:
+	jriscDiffFreeState(&s);
+	jriscDiffDestroy(diff);
+
+	return JRISC_ERROR_outOfMemory;
+}
+
+void
+jriscDiffDestroy(struct JRISC_Diff *diff)
+{
+	if (!diff) return;
+
+	free(diff->hunks);
+	free(diff);
+}
@@ -0,0 +1,66 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#ifndef JRISC_DIFF_H_
+#define JRISC_DIFF_H_
+
+#include "jrisc_base.h"
+#include "jrisc_program.h"
+
+#include <stddef.h>
+
+enum JRISC_DiffKind {
+	JRISC_diffEqual,
+	JRISC_diffChanged,
+	JRISC_diffDeleted,		/* Only in the old program */
+	JRISC_diffInserted		/* Only in the new program */
+};
+
+/*
+ * A run of instructions of the same kind. Indices are into each program's
+ * instructions[]. Equal and changed runs have equal counts; deleted runs have
+ * no new instructions and inserted runs no old ones.
+ */
+struct JRISC_DiffHunk {
+	enum JRISC_DiffKind kind;
+	size_t oldIndex;
+	size_t oldCount;
+	size_t newIndex;
+	size_t newCount;
+};
+
+struct JRISC_Diff {
+	struct JRISC_DiffHunk *hunks;
+	size_t numHunks;
+
+	/* Totals, in instructions */
+	size_t changed;
+	size_t deleted;
+	size_t inserted;
+};
+
+/*
+ * Align two decoded programs and classify every instruction. Aligned
+ * instructions with the same opName but different operands are changed;
+ * anything else that doesn't align is deleted or inserted.
+ *
+ * jr offsets, and movei values that point into the program, are compared by
+ * where they lead rather than by their encoding, so code that has only moved
+ * compares equal.
+ *
+ * Alignment anchors on runs of instructions whose rolling hash is unique in
+ * both programs, keeps the longest increasing chain of them, and repeats
+ * within each gap with shorter runs. It runs in O(n log n) time.
+ */
+extern enum JRISC_Error
+jriscDiffPrograms(const struct JRISC_Program *oldProgram,
+				  const struct JRISC_Program *newProgram,
+				  struct JRISC_Diff **diffOut);
+
+extern void
+jriscDiffDestroy(struct JRISC_Diff *diff);
+
+#endif /* JRISC_DIFF_H_ */
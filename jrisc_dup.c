@@ -0,0 +1,653 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_cfg.h"
+#include "jrisc_const.h"
+#include "jrisc_dup.h"
+#include "jrisc_hash.h"
+#include "jrisc_inst.h"
+#include "jrisc_program.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Tokens hold the opName above this bit */
+#define DUP_OPNAME_SHIFT	40
+
+/* Where a branch or movei leads, if it isn't outside the program */
+#define DUP_LOCAL			(1ull << 39)	/* Into the routine */
+#define DUP_ELSEWHERE		(1ull << 38)	/* Elsewhere in the program */
+
+/* What is known about each block */
+#define DUP_BLOCK_INVALID	0x01	/* A word that doesn't decode */
+#define DUP_BLOCK_MOVEPC	0x02	/* Holds a move pc, so a jump is a call */
+#define DUP_BLOCK_CALLED	0x04	/* The target of a call */
+#define DUP_BLOCK_START		0x08	/* Starts a routine */
+
+#define DUP_SLOT_EMPTY		0xffffffffu
+
+/* Entries in a hash table must start with their key */
+struct DupTable {
+	uint32_t *slots;			/* Entry indices, or DUP_SLOT_EMPTY */
+	size_t mask;
+};
+
+/* Routines of the same shape */
+struct DupGroup {
+	uint64_t shapeHash;
+	uint32_t numInstructions;
+	size_t firstRoutine;
+	size_t numMembers;
+	unsigned numVariants;
+};
+
+/* Identical routines */
+struct DupVariant {
+	uint64_t hash;
+	uint32_t group;
+	unsigned number;			/* In order of appearance within the group */
+	size_t numMembers;
+};
+
+struct JRISC_DupIndex {
+	struct JRISC_DupRoutine *routines;
+	size_t numRoutines;
+	size_t maxRoutines;
+
+	/* Indexed by routine */
+	uint32_t *routineVariants;
+	size_t maxRoutineVariants;
+
+	struct DupGroup *groups;
+	size_t numGroups;
+	size_t maxGroups;
+	struct DupTable groupTable;
+
+	struct DupVariant *variants;
+	size_t numVariants;
+	size_t maxVariants;
+	struct DupTable variantTable;
+};
+
+/* Sorts the report's clusters */
+struct DupOrder {
+	uint32_t numInstructions;
+	size_t firstRoutine;
+	uint32_t group;
+};
+
+static uint64_t
+jriscDupWhere(const struct JRISC_Program *program,
+			  uint32_t address,
+			  uint32_t start,
+			  uint32_t end)
+{
+	if ((address >= start) && (address < end)) {
+		return DUP_LOCAL | (address - start);
+	}
+	if (jriscProgramContains(program, address)) return DUP_ELSEWHERE;
+
+	return address;
+}
+
+/* Instruction <i> of the routine at [start, end), without its position */
+static uint64_t
+jriscDupToken(const struct JRISC_ConstProp *constProp,
+			  size_t i,
+			  uint32_t start,
+			  uint32_t end)
+{
+	const struct JRISC_Program *program = constProp->program;
+	const struct JRISC_Instruction *inst = &program->instructions[i];
+	const uint64_t opName = (uint64_t)inst->opName << DUP_OPNAME_SHIFT;
+	uint32_t address;
+
+	switch (inst->opName) {
+	case JRISC_op_jr:
+		address = jriscInstructionBranchTarget(inst);
+		return jriscHashCombine(opName | inst->regDst.val.condition,
+								jriscDupWhere(program, address, start, end));
+
+	case JRISC_op_jump:
+		if (!jriscConstPropAddress(constProp, i, &address)) break;
+		return jriscHashCombine(opName | jriscProgramRaw(program, i),
+								jriscDupWhere(program, address, start, end));
+
+	case JRISC_op_movei:
+		return jriscHashCombine(opName | inst->regDst.val.reg,
+								jriscDupWhere(program, inst->longImmediate,
+											  start, end));
+
+	default:
+		break;
+	}
+
+	return opName | jriscProgramRaw(program, i);
+}
+
+/* Whether the instruction at <i> can be fallen into from the one before */
+static bool
+jriscDupFallsInto(const struct JRISC_Cfg *cfg,
+				  const uint8_t *flags,
+				  size_t i)
+{
+	const struct JRISC_Instruction *inst;
+
+	/* Not past the delay slot of an unconditional branch that isn't a call */
+	if (i < 2) return true;
+
+	inst = &cfg->program->instructions[i - 2];
+	return !jriscInstructionIsBranch(inst) || inst->regDst.val.condition ||
+		(flags[jriscCfgFindBlock(cfg, i - 2)] & DUP_BLOCK_MOVEPC);
+}
+
+/* The instruction a branch lands on, or JRISC_PROGRAM_NO_INSTRUCTION */
+static uint32_t
+jriscDupLanding(const struct JRISC_Program *program, uint32_t address)
+{
+	const uint32_t index = jriscProgramFind(program, address);
+
+	if ((index == JRISC_PROGRAM_NO_INSTRUCTION) ||
+		(program->instructions[index].address != address)) {
+		return JRISC_PROGRAM_NO_INSTRUCTION;
+	}
+
+	return index;
+}
+
+/* Mark words that don't decode, calls and what they call */
+static void
+jriscDupMarkCalls(const struct JRISC_ConstProp *constProp, uint8_t *flags)
+{
+	const struct JRISC_Cfg *cfg = constProp->cfg;
+	const struct JRISC_Program *program = constProp->program;
+	const struct JRISC_Block *block;
+	enum JRISC_OpName opName;
+	uint32_t address, index;
+	size_t b, i;
+
+	for (b = 0; b < cfg->numBlocks; b++) {
+		block = &cfg->blocks[b];
+		for (i = block->first; i < block->first + block->count; i++) {
+			opName = program->instructions[i].opName;
+			if (opName == JRISC_invalidOpName) flags[b] |= DUP_BLOCK_INVALID;
+			if (opName == JRISC_op_movepc) flags[b] |= DUP_BLOCK_MOVEPC;
+		}
+	}
+
+	for (b = 0; b < cfg->numBlocks; b++) {
+		if (!(flags[b] & DUP_BLOCK_MOVEPC)) continue;
+
+		block = &cfg->blocks[b];
+		for (i = block->first; i < block->first + block->count; i++) {
+			if ((program->instructions[i].opName != JRISC_op_jump) ||
+				!jriscConstPropAddress(constProp, i, &address)) {
+				continue;
+			}
+
+			index = jriscDupLanding(program, address);
+			if (index != JRISC_PROGRAM_NO_INSTRUCTION) {
+				flags[jriscCfgFindBlock(cfg, index)] |= DUP_BLOCK_CALLED;
+			}
+		}
+	}
+}
+
+/* Mark the blocks that start routines, in one pass over the blocks */
+static void
+jriscDupMarkStarts(const struct JRISC_ConstProp *constProp, uint8_t *flags)
+{
+	const struct JRISC_Cfg *cfg = constProp->cfg;
+	const struct JRISC_Program *program = constProp->program;
+	const struct JRISC_Block *block;
+	const struct JRISC_Instruction *inst;
+	uint32_t address, index;
+	size_t b, i, reach = 0;
+	bool inRoutine = false;
+
+	for (b = 0; b < cfg->numBlocks; b++) {
+		block = &cfg->blocks[b];
+		if (flags[b] & DUP_BLOCK_INVALID) {
+			inRoutine = false;
+			continue;
+		}
+
+		if (!inRoutine || (flags[b] & DUP_BLOCK_CALLED) ||
+			(!jriscDupFallsInto(cfg, flags, block->first) &&
+			 (block->first > reach))) {
+			flags[b] |= DUP_BLOCK_START;
+			inRoutine = true;
+			reach = 0;
+		}
+
+		/* How far branches within the routine reach, other than calls */
+		for (i = block->first; i < block->first + block->count; i++) {
+			inst = &program->instructions[i];
+			index = JRISC_PROGRAM_NO_INSTRUCTION;
+
+			if (inst->opName == JRISC_op_jr) {
+				index = jriscDupLanding(program,
+										jriscInstructionBranchTarget(inst));
+			} else if ((inst->opName == JRISC_op_jump) &&
+					   !(flags[b] & DUP_BLOCK_MOVEPC) &&
+					   jriscConstPropAddress(constProp, i, &address)) {
+				index = jriscDupLanding(program, address);
+			}
+
+			if ((index != JRISC_PROGRAM_NO_INSTRUCTION) && (index > reach)) {
+				reach = index;
+			}
+		}
+	}
+}
+
+/* Fingerprint the routine made of blocks [firstBlock, endBlock) */
+static void
+jriscDupHashRoutine(const struct JRISC_ConstProp *constProp,
+					size_t firstBlock,
+					size_t endBlock,
+					struct JRISC_DupRoutine *routine)
+{
+	const struct JRISC_Cfg *cfg = constProp->cfg;
+	const struct JRISC_Program *program = constProp->program;
+	const struct JRISC_Block *block;
+	const struct JRISC_Instruction *last;
+	uint64_t blockHash, blockShape;
+	uint32_t start, end;
+	size_t b, i;
+
+	block = &cfg->blocks[endBlock - 1];
+	last = &program->instructions[block->first + block->count - 1];
+	start = program->instructions[cfg->blocks[firstBlock].first].address;
+	end = last->address + jriscProgramInstructionSize(last);
+
+	routine->address = start;
+	routine->numInstructions = 0;
+	routine->hash = 0;
+	routine->shapeHash = 0;
+
+	for (b = firstBlock; b < endBlock; b++) {
+		block = &cfg->blocks[b];
+		blockHash = blockShape = 0;
+
+		for (i = block->first; i < block->first + block->count; i++) {
+			blockHash = jriscHashCombine(blockHash,
+										 jriscDupToken(constProp, i,
+													   start, end));
+			blockShape = jriscHashCombine(blockShape,
+										  program->instructions[i].opName);
+		}
+
+		routine->hash = jriscHashCombine(routine->hash, blockHash);
+		routine->shapeHash = jriscHashCombine(routine->shapeHash, blockShape);
+		routine->numInstructions += block->count;
+	}
+
+	routine->hash = jriscHashCombine(routine->hash, routine->numInstructions);
+	routine->shapeHash = jriscHashCombine(routine->shapeHash,
+										  routine->numInstructions);
+}
+
+enum JRISC_Error
+jriscDupFingerprint(const struct JRISC_Program *program,
+					uint32_t source,
+					unsigned minInstructions,
+					struct JRISC_DupRoutine **routinesOut,
+					size_t *numRoutinesOut)
+{
+	struct JRISC_ConstProp *constProp = NULL;
+	struct JRISC_DupRoutine *routines = NULL;
+	struct JRISC_DupRoutine *routine;
+	const struct JRISC_Cfg *cfg;
+	uint8_t *flags = NULL;
+	size_t numRoutines = 0;
+	size_t b, end;
+	enum JRISC_Error ret;
+
+	ret = jriscConstPropCompute(program, &constProp);
+	if (ret != JRISC_success) goto done;
+
+	cfg = constProp->cfg;
+
+	ret = JRISC_ERROR_outOfMemory;
+	flags = calloc(cfg->numBlocks + 1, sizeof(*flags));
+	routines = malloc((cfg->numBlocks ? cfg->numBlocks : 1) *
+					  sizeof(*routines));
+	if (!flags || !routines) goto done;
+
+	jriscDupMarkCalls(constProp, flags);
+	jriscDupMarkStarts(constProp, flags);
+
+	for (b = 0; b < cfg->numBlocks; b = end) {
+		for (end = b + 1; (end < cfg->numBlocks) &&
+			 !(flags[end] & (DUP_BLOCK_START | DUP_BLOCK_INVALID)); end++) {
+		}
+		if (!(flags[b] & DUP_BLOCK_START)) continue;
+
+		routine = &routines[numRoutines];
+		routine->source = source;
+		jriscDupHashRoutine(constProp, b, end, routine);
+		if (routine->numInstructions >= minInstructions) numRoutines++;
+	}
+
+	ret = JRISC_success;
+
+done:
+	free(flags);
+	jriscConstPropDestroy(constProp);
+
+	if (ret == JRISC_success) {
+		*routinesOut = routines;
+		*numRoutinesOut = numRoutines;
+	} else {
+		free(routines);
+	}
+
+	return ret;
+}
+
+/*
+ * The slot holding the entry with <key>, or the empty slot it would go in.
+ * <entries> are <entrySize> bytes each.
+ */
+static uint32_t *
+jriscDupSlot(const struct DupTable *table,
+			 const void *entries,
+			 size_t entrySize,
+			 uint64_t key)
+{
+	const char *base = entries;
+	size_t i = (size_t)((key ^ (key >> 32)) * 0x9e3779b97f4a7c15ull >> 32) &
+		table->mask;
+	uint64_t entryKey;
+
+	while (table->slots[i] != DUP_SLOT_EMPTY) {
+		memcpy(&entryKey, base + table->slots[i] * entrySize,
+			   sizeof(entryKey));
+		if (entryKey == key) break;
+		i = (i + 1) & table->mask;
+	}
+
+	return &table->slots[i];
+}
+
+/* Keep the table at most half full once it holds <numEntries> entries */
+static bool
+jriscDupTableReserve(struct DupTable *table,
+					 const void *entries,
+					 size_t entrySize,
+					 size_t numEntries)
+{
+	const char *base = entries;
+	uint32_t *oldSlots = table->slots;
+	size_t oldSize = oldSlots ? table->mask + 1 : 0;
+	size_t size = oldSize ? oldSize : 256;
+	uint64_t key;
+	size_t i;
+
+	if ((numEntries * 2) <= oldSize) return true;
+	while ((numEntries * 2) > size) size *= 2;
+
+	table->slots = malloc(size * sizeof(*table->slots));
+	if (!table->slots) {
+		table->slots = oldSlots;
+		return false;
+	}
+	table->mask = size - 1;
+	memset(table->slots, 0xff, size * sizeof(*table->slots));
+
+	for (i = 0; i < oldSize; i++) {
+		if (oldSlots[i] == DUP_SLOT_EMPTY) continue;
+		memcpy(&key, base + oldSlots[i] * entrySize, sizeof(key));
+		*jriscDupSlot(table, entries, entrySize, key) = oldSlots[i];
+	}
+
+	free(oldSlots);
+
+	return true;
+}
+
+/* Make room for <count> more of an array's entries */
+static bool
+jriscDupGrow(void **array, size_t *max, size_t num, size_t count,
+			 size_t entrySize)
+{
+	void *newArray;
+	size_t newMax = *max ? *max : 64;
+
+	if ((num + count) <= *max) return true;
+	while ((num + count) > newMax) newMax *= 2;
+
+	newArray = realloc(*array, newMax * entrySize);
+	if (!newArray) return false;
+
+	*array = newArray;
+	*max = newMax;
+
+	return true;
+}
+
+enum JRISC_Error
+jriscDupIndexCreate(struct JRISC_DupIndex **indexOut)
+{
+	struct JRISC_DupIndex *index = calloc(1, sizeof(*index));
+
+	if (!index) return JRISC_ERROR_outOfMemory;
+
+	*indexOut = index;
+
+	return JRISC_success;
+}
+
+void
+jriscDupIndexDestroy(struct JRISC_DupIndex *index)
+{
+	if (!index) return;
+
+	free(index->variantTable.slots);
+	free(index->variants);
+	free(index->groupTable.slots);
+	free(index->groups);
+	free(index->routineVariants);
+	free(index->routines);
+	free(index);
+}
+
+enum JRISC_Error
+jriscDupIndexAdd(struct JRISC_DupIndex *index,
+				 const struct JRISC_DupRoutine *routines,
+				 size_t numRoutines)
+{
+	const struct JRISC_DupRoutine *routine;
+	struct DupGroup *group;
+	struct DupVariant *variant;
+	uint32_t *slot;
+	size_t r;
+
+	if (!jriscDupGrow((void **)&index->routines, &index->maxRoutines,
+					  index->numRoutines, numRoutines,
+					  sizeof(*index->routines)) ||
+		!jriscDupGrow((void **)&index->routineVariants,
+					  &index->maxRoutineVariants,
+					  index->numRoutines, numRoutines,
+					  sizeof(*index->routineVariants)) ||
+		!jriscDupGrow((void **)&index->groups, &index->maxGroups,
+					  index->numGroups, numRoutines,
+					  sizeof(*index->groups)) ||
+		!jriscDupGrow((void **)&index->variants, &index->maxVariants,
+					  index->numVariants, numRoutines,
+					  sizeof(*index->variants)) ||
+		!jriscDupTableReserve(&index->groupTable, index->groups,
+							  sizeof(*index->groups),
+							  index->numGroups + numRoutines) ||
+		!jriscDupTableReserve(&index->variantTable, index->variants,
+							  sizeof(*index->variants),
+							  index->numVariants + numRoutines)) {
+		return JRISC_ERROR_outOfMemory;
+	}
+
+	for (r = 0; r < numRoutines; r++) {
+		routine = &routines[r];
+
+		slot = jriscDupSlot(&index->groupTable, index->groups,
+							sizeof(*index->groups), routine->shapeHash);
+		if (*slot == DUP_SLOT_EMPTY) {
+			*slot = (uint32_t)index->numGroups;
+			group = &index->groups[index->numGroups++];
+			group->shapeHash = routine->shapeHash;
+			group->numInstructions = routine->numInstructions;
+			group->firstRoutine = index->numRoutines;
+			group->numMembers = 0;
+			group->numVariants = 0;
+		}
+		group = &index->groups[*slot];
+		group->numMembers++;
+
+		slot = jriscDupSlot(&index->variantTable, index->variants,
+							sizeof(*index->variants), routine->hash);
+		if (*slot == DUP_SLOT_EMPTY) {
+			*slot = (uint32_t)index->numVariants;
+			variant = &index->variants[index->numVariants++];
+			variant->hash = routine->hash;
+			variant->group = (uint32_t)(group - index->groups);
+			variant->number = group->numVariants++;
+			variant->numMembers = 0;
+		}
+		index->variants[*slot].numMembers++;
+
+		index->routineVariants[index->numRoutines] = *slot;
+		index->routines[index->numRoutines++] = *routine;
+	}
+
+	return JRISC_success;
+}
+
+size_t
+jriscDupIndexNumRoutines(const struct JRISC_DupIndex *index)
+{
+	return index->numRoutines;
+}
+
+const struct JRISC_DupRoutine *
+jriscDupIndexRoutine(const struct JRISC_DupIndex *index, size_t routine)
+{
+	return &index->routines[routine];
+}
+
+static int
+jriscDupCompareOrder(const void *a, const void *b)
+{
+	const struct DupOrder *orderA = a;
+	const struct DupOrder *orderB = b;
+
+	if (orderA->numInstructions != orderB->numInstructions) {
+		return (orderA->numInstructions > orderB->numInstructions) ? -1 : 1;
+	}
+	if (orderA->firstRoutine != orderB->firstRoutine) {
+		return (orderA->firstRoutine < orderB->firstRoutine) ? -1 : 1;
+	}
+
+	return 0;
+}
+
+enum JRISC_Error
+jriscDupIndexReport(const struct JRISC_DupIndex *index,
+					struct JRISC_DupReport **reportOut)
+{
+	const struct DupGroup *group;
+	const struct DupVariant *variant;
+	struct JRISC_DupReport *report;
+	struct JRISC_DupCluster *cluster;
+	struct DupOrder *order = NULL;
+	size_t *cursors = NULL;
+	size_t *variantCursors = NULL;
+	size_t g, v, r, c;
+	size_t n = 0;
+	enum JRISC_Error ret = JRISC_ERROR_outOfMemory;
+
+	report = calloc(1, sizeof(*report));
+	order = malloc((index->numGroups + 1) * sizeof(*order));
+	cursors = malloc((index->numGroups + 1) * sizeof(*cursors));
+	variantCursors = malloc((index->numVariants + 1) *
+							sizeof(*variantCursors));
+	if (!report || !order || !cursors || !variantCursors) goto done;
+
+	for (g = 0; g < index->numGroups; g++) {
+		group = &index->groups[g];
+		cursors[g] = (size_t)-1;
+		if (group->numMembers < 2) continue;
+
+		order[n].numInstructions = group->numInstructions;
+		order[n].firstRoutine = group->firstRoutine;
+		order[n].group = (uint32_t)g;
+		report->numMembers += group->numMembers;
+		n++;
+	}
+
+	qsort(order, n, sizeof(*order), jriscDupCompareOrder);
+
+	report->clusters = malloc((n ? n : 1) * sizeof(*report->clusters));
+	report->members = malloc((report->numMembers ? report->numMembers : 1) *
+							 sizeof(*report->members));
+	if (!report->clusters || !report->members) goto done;
+	report->numClusters = n;
+
+	/* Lay out each cluster, then each variant within it */
+	for (c = 0, r = 0; c < n; c++) {
+		group = &index->groups[order[c].group];
+		cluster = &report->clusters[c];
+		cluster->numInstructions = group->numInstructions;
+		cluster->firstMember = r;
+		cluster->numMembers = group->numMembers;
+		cluster->numVariants = group->numVariants;
+
+		cursors[order[c].group] = r;
+		r += group->numMembers;
+	}
+
+	for (v = 0; v < index->numVariants; v++) {
+		variant = &index->variants[v];
+		variantCursors[v] = cursors[variant->group];
+		if (variantCursors[v] == (size_t)-1) continue;
+		cursors[variant->group] += variant->numMembers;
+	}
+
+	for (r = 0; r < index->numRoutines; r++) {
+		v = index->routineVariants[r];
+		if (variantCursors[v] == (size_t)-1) continue;
+
+		report->members[variantCursors[v]].routine = r;
+		report->members[variantCursors[v]].variant =
+			index->variants[v].number;
+		variantCursors[v]++;
+	}
+
+	ret = JRISC_success;
+
+done:
+	free(variantCursors);
+	free(cursors);
+	free(order);
+
+	if (ret == JRISC_success) {
+		*reportOut = report;
+	} else {
+		jriscDupReportDestroy(report);
+	}
+
+	return ret;
+}
+
+void
+jriscDupReportDestroy(struct JRISC_DupReport *report)
+{
+	if (!report) return;
+
+	free(report->members);
+	free(report->clusters);
+	free(report);
+}
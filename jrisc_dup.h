@@ -0,0 +1,119 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#ifndef JRISC_DUP_H_
+#define JRISC_DUP_H_
+
+#include "jrisc_base.h"
+#include "jrisc_program.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Shorter routines match too often by chance to be worth reporting */
+#define JRISC_DUP_MIN_INSTRUCTIONS	8
+
+/* A routine found in a program, and fingerprints of its code */
+struct JRISC_DupRoutine {
+	uint32_t source;			/* Set by the caller, e.g. a file number */
+	uint32_t address;			/* Of its first instruction */
+	uint32_t numInstructions;
+
+	/*
+	 * Hashes of its basic blocks' normalized instructions, and of their
+	 * opNames alone, each combined over the blocks in order
+	 */
+	uint64_t hash;
+	uint64_t shapeHash;
+};
+
+/* A routine in a cluster */
+struct JRISC_DupMember {
+	size_t routine;				/* Index, in the order routines were added */
+	unsigned variant;			/* Members with equal variants are identical */
+};
+
+/*
+ * Routines with the same instructions in the same order. Their operands may
+ * differ, unless there is only one variant.
+ */
+struct JRISC_DupCluster {
+	uint32_t numInstructions;
+	size_t firstMember;			/* Index into the report's members */
+	size_t numMembers;
+	unsigned numVariants;
+};
+
+struct JRISC_DupReport {
+	/* Largest routines first, then in order of their first member */
+	struct JRISC_DupCluster *clusters;
+	size_t numClusters;
+
+	/* By cluster, then variant, then the order they were added */
+	struct JRISC_DupMember *members;
+	size_t numMembers;
+};
+
+struct JRISC_DupIndex;
+
+/*
+ * Split a program into routines and fingerprint each one. A routine starts
+ * at the start of the program, after a word that doesn't decode, at the
+ * target of a call, i.e. a jump (rN) in a block with a move pc, and at code
+ * that can't be fallen into, after an unconditional branch that isn't a call,
+ * which no branch earlier in the same routine reaches at or beyond. jump (rN)
+ * targets are found by constant propagation. A routine ends where the next
+ * one starts, or at a word that doesn't decode.
+ *
+ * Fingerprints are position independent: jr and jump (rN) targets, and movei
+ * addresses, inside the routine are hashed as offsets from its start, and
+ * those elsewhere in the program as just being elsewhere, so a routine hashes
+ * the same wherever it is linked and whatever it calls. movei values outside
+ * the program, e.g. hardware registers, are hashed as they are.
+ *
+ * Routines of fewer than <minInstructions> instructions are left out. Free
+ * the routines with free().
+ */
+extern enum JRISC_Error
+jriscDupFingerprint(const struct JRISC_Program *program,
+					uint32_t source,
+					unsigned minInstructions,
+					struct JRISC_DupRoutine **routinesOut,
+					size_t *numRoutinesOut);
+
+extern enum JRISC_Error
+jriscDupIndexCreate(struct JRISC_DupIndex **indexOut);
+
+extern void
+jriscDupIndexDestroy(struct JRISC_DupIndex *index);
+
+/*
+ * Copy routines into the index, in hash tables of their shapes and their
+ * exact fingerprints, in amortized constant time each
+ */
+extern enum JRISC_Error
+jriscDupIndexAdd(struct JRISC_DupIndex *index,
+				 const struct JRISC_DupRoutine *routines,
+				 size_t numRoutines);
+
+extern size_t
+jriscDupIndexNumRoutines(const struct JRISC_DupIndex *index);
+
+extern const struct JRISC_DupRoutine *
+jriscDupIndexRoutine(const struct JRISC_DupIndex *index, size_t routine);
+
+/*
+ * Cluster the routines found more than once, whether identical or with only
+ * their operands changed, e.g. with other registers or constants
+ */
+extern enum JRISC_Error
+jriscDupIndexReport(const struct JRISC_DupIndex *index,
+					struct JRISC_DupReport **reportOut);
+
+extern void
+jriscDupReportDestroy(struct JRISC_DupReport *report);
+
+#endif /* JRISC_DUP_H_ */
@@ -0,0 +1,94 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#ifndef JRISC_ENDIAN_H_
+#define JRISC_ENDIAN_H_
+
+#include <stdint.h>
+
+#if defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__) && \
+	(__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#define JRISC_HOST_BIG_ENDIAN 1
+#else
+#define JRISC_HOST_BIG_ENDIAN 0
+#endif
+
+#if defined(_MSC_VER)
+#include <stdlib.h>
+#define JRISC_BSWAP16(x) _byteswap_ushort(x)
+#define JRISC_BSWAP32(x) _byteswap_ulong(x)
+#elif defined(__GNUC__) || defined(__clang__)
+#define JRISC_BSWAP16(x) __builtin_bswap16(x)
+#define JRISC_BSWAP32(x) __builtin_bswap32(x)
+#else
+#define JRISC_BSWAP16(x) ((uint16_t)(((x) << 8) | ((x) >> 8)))
+#define JRISC_BSWAP32(x) ((((x) & 0xff) << 24) | (((x) & 0xff00) << 8) | \
+						  (((x) >> 8) & 0xff00) | ((x) >> 24))
+#endif
+
+/*
+ * Helpers for pulling big-endian fields out of file headers. These work a byte
+ * at a time, so they're safe on unaligned data and any host byte order.
+ */
+static inline uint16_t
+jriscLoadBE16(const uint8_t *p)
+{
+	return ((uint16_t)p[0] << 8) | p[1];
+}
+
+static inline uint32_t
+jriscLoadBE32(const uint8_t *p)
+{
+	return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+		((uint32_t)p[2] << 8) | p[3];
+}
+
+static inline uint16_t
+jriscLoadLE16(const uint8_t *p)
+{
+	return ((uint16_t)p[1] << 8) | p[0];
+}
+
+static inline uint32_t
+jriscLoadLE32(const uint8_t *p)
+{
+	return ((uint32_t)p[3] << 24) | ((uint32_t)p[2] << 16) |
+		((uint32_t)p[1] << 8) | p[0];
+}
+
+static inline void
+jriscStoreBE16(uint8_t *p, uint16_t val)
+{
+	p[0] = val >> 8;
+	p[1] = val & 0xff;
+}
+
+static inline void
+jriscStoreBE32(uint8_t *p, uint32_t val)
+{
+	p[0] = val >> 24;
+	p[1] = (val >> 16) & 0xff;
+	p[2] = (val >> 8) & 0xff;
+	p[3] = val & 0xff;
+}
+
+static inline void
+jriscStoreLE16(uint8_t *p, uint16_t val)
+{
+	p[0] = val & 0xff;
+	p[1] = val >> 8;
+}
+
+static inline void
+jriscStoreLE32(uint8_t *p, uint32_t val)
+{
+	p[0] = val & 0xff;
+	p[1] = (val >> 8) & 0xff;
+	p[2] = (val >> 16) & 0xff;
+	p[3] = val >> 24;
+}
+
+#endif /* JRISC_ENDIAN_H_ */
@@ -22,3 +22,5 @@ JRISC_ERROR(ERROR_invalidValue)
 JRISC_ERROR(ERROR_invalidReg)
 JRISC_ERROR(ERROR_invalidRegType)
 JRISC_ERROR(ERROR_invalidOpCode)
+JRISC_ERROR(ERROR_invalidFormat)
+JRISC_ERROR(ERROR_notFound)
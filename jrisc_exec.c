@@ -0,0 +1,909 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_exec.h"
+#include "jrisc_inst.h"
+#include "jrisc_program.h"
+#include "jrisc_thread.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define W			JRISC_EXEC_WIDTH
+#define ALL_LANES	0xffffffffu
+
+/* The flags register's bits */
+#define FLAG_Z		0x0001
+#define FLAG_C		0x0002
+#define FLAG_N		0x0004
+#define FLAG_REGPAGE	0x4000
+
+/* Take <value> in lanes whose mask is set, keeping <old> in the others */
+#define BLEND(mask, old, value) (((value) & (mask)) | ((old) & ~(mask)))
+
+/*
+ * Up to W states, held lane by lane in arrays so each instruction can be
+ * executed by simple loops over the lanes. Masks are 0 or ALL_LANES.
+ */
+struct ExecGroup {
+	/* Registers 0-31 are the current bank, and 32-63 the other */
+	uint32_t regs[64][W];
+	uint32_t z[W];
+	uint32_t c[W];
+	uint32_t n[W];
+	uint32_t bank[W];			/* The REGPAGE flag, 0 or 1 */
+	int64_t acc[W];
+
+	uint32_t pc[W];
+	uint32_t target[W];			/* Where a taken branch goes */
+	uint32_t branching[W];		/* Mask: the next instruction is a delay slot */
+	uint32_t live[W];			/* Mask: still running */
+	uint64_t steps[W];
+	uint8_t *ram[W];
+	enum JRISC_ExecStatus status[W];
+};
+
+struct Exec {
+	const struct JRISC_Program *program;
+	uint32_t entry;
+	uint64_t maxSteps;
+
+	uint32_t programSize;		/* In bytes */
+	uint32_t ramAddress;
+	uint32_t ramSize;
+	uint32_t flagsAddress;
+
+	struct JRISC_ExecState *states;
+	size_t numStates;
+	size_t numGroups;
+
+	/* The next group a thread should take */
+	struct JRISC_Mutex *mutex;
+	size_t nextGroup;
+	size_t numDone;
+};
+
+/* The value of an immediate operand of 1-32, stored as 0-31 */
+static inline uint32_t
+jriscExecUnsigned(const struct JRISC_OpReg *reg)
+{
+	return reg->val.uimmediate ? reg->val.uimmediate : 32;
+}
+
+/*
+ * The index of the instruction starting at <address>, or
+ * JRISC_PROGRAM_NO_INSTRUCTION if it is outside the program. Sets *badOut if
+ * the address is inside it but not the start of an instruction.
+ */
+static uint32_t
+jriscExecFind(const struct JRISC_Program *program,
+			  uint32_t address,
+			  bool *badOut)
+{
+	uint32_t offset = address - program->baseAddress;
+	uint32_t index;
+
+	*badOut = false;
+
+	if ((address < program->baseAddress) ||
+		((offset / 2) >= program->numWords)) {
+		return JRISC_PROGRAM_NO_INSTRUCTION;
+	}
+
+	index = program->wordToInstruction[offset / 2];
+	if (program->instructions[index].address != address) *badOut = true;
+
+	return index;
+}
+
+static void
+jriscExecStop(struct ExecGroup *g,
+			  uint32_t *m,
+			  unsigned l,
+			  enum JRISC_ExecStatus status)
+{
+	g->status[l] = status;
+	g->live[l] = 0;
+	m[l] = 0;
+}
+
+static uint32_t
+jriscExecFlags(const struct ExecGroup *g, unsigned l)
+{
+	return (g->z[l] ? FLAG_Z : 0) | (g->c[l] ? FLAG_C : 0) |
+		(g->n[l] ? FLAG_N : 0) | (g->bank[l] ? FLAG_REGPAGE : 0);
+}
+
+static void
+jriscExecSetFlags(struct ExecGroup *g, unsigned l, uint32_t flags)
+{
+	uint32_t bank = (flags & FLAG_REGPAGE) ? 1 : 0;
+	uint32_t t;
+	unsigned i;
+
+	g->z[l] = (flags & FLAG_Z) ? 1 : 0;
+	g->c[l] = (flags & FLAG_C) ? 1 : 0;
+	g->n[l] = (flags & FLAG_N) ? 1 : 0;
+
+	if (bank != g->bank[l]) {
+		for (i = 0; i < 32; i++) {
+			t = g->regs[i][l];
+			g->regs[i][l] = g->regs[32 + i][l];
+			g->regs[32 + i][l] = t;
+		}
+		g->bank[l] = bank;
+	}
+}
+
+/*
+ * Load or store <size> bytes at <address> for one lane. Local RAM is
+ * big-endian and, as on the hardware, ignores the low address bits below the
+ * access size. The flags register is the only other address handled.
+ */
+static bool
+jriscExecAccess(const struct Exec *ex,
+				struct ExecGroup *g,
+				unsigned l,
+				uint32_t address,
+				unsigned size,
+				bool store,
+				uint32_t *value)
+{
+	uint8_t *p;
+	uint32_t offset;
+	unsigned i;
+
+	address &= ~(uint32_t)(size - 1);
+
+	if ((size == 4) && (address == ex->flagsAddress)) {
+		if (store) {
+			jriscExecSetFlags(g, l, *value);
+		} else {
+			*value = jriscExecFlags(g, l);
+		}
+		return true;
+	}
+
+	offset = address - ex->ramAddress;
+	if (!g->ram[l] || (address < ex->ramAddress) || (offset >= ex->ramSize)) {
+		return false;
+	}
+
+	p = g->ram[l] + offset;
+
+	if (store) {
+		for (i = 0; i < size; i++) {
+			p[i] = (uint8_t)(*value >> ((size - 1 - i) * 8));
+		}
+	} else {
+		*value = 0;
+		for (i = 0; i < size; i++) *value = (*value << 8) | p[i];
+	}
+
+	return true;
+}
+
+/* Whether the flags in each lane satisfy a jump or jr condition */
+static void
+jriscExecCondition(const struct ExecGroup *g, uint8_t cond, uint32_t *out)
+{
+	unsigned l;
+	uint32_t f;
+
+	for (l = 0; l < W; l++) {
+		f = (cond & 0x10) ? g->n[l] : g->c[l];
+		out[l] = (((cond & 0x1) && g->z[l]) || ((cond & 0x2) && !g->z[l]) ||
+				  ((cond & 0x4) && f) || ((cond & 0x8) && !f)) ?
+			0 : ALL_LANES;
+	}
+}
+
+/* Loads and stores. Returns false if the instruction isn't one. */
+static bool
+jriscExecMemory(const struct Exec *ex,
+				struct ExecGroup *g,
+				const struct JRISC_Instruction *inst,
+				uint32_t *m)
+{
+	const uint32_t *S;
+	uint32_t *D;
+	const uint32_t *base;
+	uint32_t offset = 0;
+	uint32_t value;
+	unsigned size = 4;
+	bool store = false;
+	bool indexed = false;
+	unsigned l;
+
+	switch (inst->opName) {
+	case JRISC_op_loadb:
+		size = 1;
+		break;
+
+	case JRISC_op_loadw:
+		size = 2;
+		break;
+
+	case JRISC_op_load:
+		break;
+
+	case JRISC_op_storeb:
+		size = 1;
+		store = true;
+		break;
+
+	case JRISC_op_storew:
+		size = 2;
+		store = true;
+		break;
+
+	case JRISC_op_store:
+		store = true;
+		break;
+
+	case JRISC_op_storer14n:
+	case JRISC_op_storer15n:
+		store = true;
+		/* Fall through */
+	case JRISC_op_loadr14n:
+	case JRISC_op_loadr15n:
+		offset = jriscExecUnsigned(&inst->regSrc) * 4;
+		break;
+
+	case JRISC_op_storer14r:
+	case JRISC_op_storer15r:
+		store = true;
+		/* Fall through */
+	case JRISC_op_loadr14r:
+	case JRISC_op_loadr15r:
+		indexed = true;
+		break;
+
+	default:
+		return false;
+	}
+
+	S = g->regs[inst->regSrc.val.reg];
+	D = g->regs[inst->regDst.val.reg];
+
+	switch (inst->opName) {
+	case JRISC_op_loadr14n:
+	case JRISC_op_loadr14r:
+	case JRISC_op_storer14n:
+	case JRISC_op_storer14r:
+		base = g->regs[r14];
+		break;
+
+	case JRISC_op_loadr15n:
+	case JRISC_op_loadr15r:
+	case JRISC_op_storer15n:
+	case JRISC_op_storer15r:
+		base = g->regs[r15];
+		break;
+
+	default:
+		base = S;
+		break;
+	}
+
+	for (l = 0; l < W; l++) {
+		if (!m[l]) continue;
+
+		value = D[l];
+		if (!jriscExecAccess(ex, g, l,
+							 base[l] + (indexed ? S[l] : offset),
+							 size, store, &value)) {
+			jriscExecStop(g, m, l, JRISC_execBadAddress);
+		} else if (!store) {
+			D[l] = value;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Execute one instruction in the lanes selected by <m>. Lanes that take a
+ * branch get ALL_LANES in <taken> and its destination in <dest>.
+ */
+static void
+jriscExecInstruction(const struct Exec *ex,
+					 struct ExecGroup *g,
+					 const struct JRISC_Instruction *inst,
+					 uint32_t *m,
+					 uint32_t *taken,
+					 uint32_t *dest)
+{
+	const struct JRISC_OpReg *src = &inst->regSrc;
+	uint32_t s[W], d[W], r[W], cf[W];
+	uint32_t *D = g->regs[inst->regDst.val.reg];
+	uint32_t imm = 0;
+	uint32_t t;
+	int32_t shift;
+	bool writeDst = true;
+	bool accumulate;
+	unsigned flags = FLAG_Z | FLAG_N;
+	unsigned l;
+
+	memset(taken, 0, sizeof(uint32_t) * W);
+
+	if (jriscExecMemory(ex, g, inst, m)) return;
+
+	switch (src->type) {
+	case JRISC_reg:
+	case JRISC_indirect:
+		for (l = 0; l < W; l++) s[l] = g->regs[src->val.reg][l];
+		break;
+
+	case JRISC_simmediate:
+		imm = (uint32_t)(int32_t)src->val.simmediate;
+		break;
+
+	case JRISC_uimmediate:
+		imm = jriscExecUnsigned(src);
+		break;
+
+	case JRISC_zuimmediate:
+		imm = src->val.uimmediate;
+		break;
+
+	case JRISC_shlimmediate:
+		imm = 32 - jriscExecUnsigned(src);
+		break;
+
+	default:
+		break;
+	}
+
+	switch (src->type) {
+	case JRISC_reg:
+	case JRISC_indirect:
+		break;
+
+	default:
+		for (l = 0; l < W; l++) s[l] = imm;
+		break;
+	}
+
+	for (l = 0; l < W; l++) d[l] = D[l];
+
+	switch (inst->opName) {
+	case JRISC_op_add:
+	case JRISC_op_addq:
+		for (l = 0; l < W; l++) {
+			r[l] = d[l] + s[l];
+			cf[l] = r[l] < d[l];
+		}
+		flags |= FLAG_C;
+		break;
+
+	case JRISC_op_addc:
+		for (l = 0; l < W; l++) {
+			t = d[l] + s[l];
+			r[l] = t + g->c[l];
+			cf[l] = (t < d[l]) | (r[l] < t);
+		}
+		flags |= FLAG_C;
+		break;
+
+	case JRISC_op_addqt:
+		for (l = 0; l < W; l++) r[l] = d[l] + s[l];
+		flags = 0;
+		break;
+
+	case JRISC_op_sub:
+	case JRISC_op_subq:
+	case JRISC_op_cmp:
+	case JRISC_op_cmpq:
+		for (l = 0; l < W; l++) {
+			r[l] = d[l] - s[l];
+			cf[l] = d[l] < s[l];
+		}
+		flags |= FLAG_C;
+		writeDst = (inst->opName == JRISC_op_sub) ||
+			(inst->opName == JRISC_op_subq);
+		break;
+
+	case JRISC_op_subc:
+		for (l = 0; l < W; l++) {
+			t = d[l] - s[l];
+			r[l] = t - g->c[l];
+			cf[l] = (d[l] < s[l]) | (t < g->c[l]);
+		}
+		flags |= FLAG_C;
+		break;
+
+	case JRISC_op_subqt:
+		for (l = 0; l < W; l++) r[l] = d[l] - s[l];
+		flags = 0;
+		break;
+
+	case JRISC_op_neg:
+		for (l = 0; l < W; l++) {
+			r[l] = 0 - d[l];
+			cf[l] = d[l] != 0;
+		}
+		flags |= FLAG_C;
+		break;
+
+	case JRISC_op_and:
+		for (l = 0; l < W; l++) r[l] = d[l] & s[l];
+		break;
+
+	case JRISC_op_or:
+		for (l = 0; l < W; l++) r[l] = d[l] | s[l];
+		break;
+
+	case JRISC_op_xor:
+		for (l = 0; l < W; l++) r[l] = d[l] ^ s[l];
+		break;
+
+	case JRISC_op_not:
+		for (l = 0; l < W; l++) r[l] = ~d[l];
+		break;
+
+	case JRISC_op_btst:
+		for (l = 0; l < W; l++) r[l] = d[l] & ((uint32_t)1 << imm);
+		writeDst = false;
+		flags = FLAG_Z;
+		break;
+
+	case JRISC_op_bset:
+		for (l = 0; l < W; l++) r[l] = d[l] | ((uint32_t)1 << imm);
+		break;
+
+	case JRISC_op_bclr:
+		for (l = 0; l < W; l++) r[l] = d[l] & ~((uint32_t)1 << imm);
+		break;
+
+	case JRISC_op_mult:
+		for (l = 0; l < W; l++) r[l] = (d[l] & 0xffff) * (s[l] & 0xffff);
+		break;
+
+	case JRISC_op_imult:
+	case JRISC_op_imultn:
+	case JRISC_op_imacn:
+		for (l = 0; l < W; l++) {
+			r[l] = (uint32_t)((int32_t)(int16_t)d[l] *
+							  (int32_t)(int16_t)s[l]);
+		}
+
+		if (inst->opName == JRISC_op_imult) break;
+
+		writeDst = false;
+		accumulate = (inst->opName == JRISC_op_imacn);
+		for (l = 0; l < W; l++) {
+			if (m[l]) g->acc[l] = (accumulate ? g->acc[l] : 0) + (int32_t)r[l];
+			r[l] = (uint32_t)g->acc[l];
+		}
+		break;
+
+	case JRISC_op_resmac:
+		for (l = 0; l < W; l++) r[l] = (uint32_t)g->acc[l];
+		break;
+
+	case JRISC_op_div:
+		for (l = 0; l < W; l++) r[l] = s[l] ? (d[l] / s[l]) : 0xffffffff;
+		flags = 0;
+		break;
+
+	case JRISC_op_abs:
+		for (l = 0; l < W; l++) {
+			cf[l] = d[l] >> 31;
+			r[l] = cf[l] ? (0 - d[l]) : d[l];
+		}
+		flags |= FLAG_C;
+		break;
+
+	case JRISC_op_sh:
+	case JRISC_op_sha:
+		/* Positive counts shift right, negative ones left */
+		for (l = 0; l < W; l++) {
+			shift = (int32_t)s[l];
+			if (shift >= 0) {
+				cf[l] = d[l] & 1;
+				if (shift > 31) {
+					r[l] = ((inst->opName == JRISC_op_sha) &&
+							(d[l] >> 31)) ? ALL_LANES : 0;
+				} else if (inst->opName == JRISC_op_sha) {
+					r[l] = (uint32_t)((int32_t)d[l] >> shift);
+				} else {
+					r[l] = d[l] >> shift;
+				}
+			} else {
+				cf[l] = d[l] >> 31;
+				r[l] = (shift < -31) ? 0 : (d[l] << -shift);
+			}
+		}
+		flags |= FLAG_C;
+		break;
+
+	case JRISC_op_shlq:
+		for (l = 0; l < W; l++) {
+			cf[l] = d[l] >> 31;
+			r[l] = d[l] << imm;
+		}
+		flags |= FLAG_C;
+		break;
+
+	case JRISC_op_shrq:
+		for (l = 0; l < W; l++) {
+			cf[l] = d[l] & 1;
+			r[l] = (imm < 32) ? (d[l] >> imm) : 0;
+		}
+		flags |= FLAG_C;
+		break;
+
+	case JRISC_op_sharq:
+		if (imm > 31) imm = 31;		/* Same result once all sign bits */
+		for (l = 0; l < W; l++) {
+			cf[l] = d[l] & 1;
+			r[l] = (uint32_t)((int32_t)d[l] >> imm);
+		}
+		flags |= FLAG_C;
+		break;
+
+	case JRISC_op_ror:
+	case JRISC_op_rorq:
+		for (l = 0; l < W; l++) {
+			t = s[l] % 32;
+			cf[l] = d[l] >> 31;
+			r[l] = t ? ((d[l] >> t) | (d[l] << (32 - t))) : d[l];
+		}
+		flags |= FLAG_C;
+		break;
+
+	case JRISC_op_sat8:
+	case JRISC_op_sat16:
+	case JRISC_op_sat24:
+		t = (inst->opName == JRISC_op_sat8) ? 0xff :
+			((inst->opName == JRISC_op_sat16) ? 0xffff : 0xffffff);
+		for (l = 0; l < W; l++) {
+			r[l] = (d[l] >> 31) ? 0 : ((d[l] > t) ? t : d[l]);
+		}
+		break;
+
+	case JRISC_op_sat16s:
+		for (l = 0; l < W; l++) {
+			r[l] = ((int32_t)d[l] < -32768) ? (uint32_t)-32768 :
+				(((int32_t)d[l] > 32767) ? 32767 : d[l]);
+		}
+		break;
+
+	case JRISC_op_mirror:
+		for (l = 0; l < W; l++) {
+			t = d[l];
+			t = ((t >> 1) & 0x55555555) | ((t & 0x55555555) << 1);
+			t = ((t >> 2) & 0x33333333) | ((t & 0x33333333) << 2);
+			t = ((t >> 4) & 0x0f0f0f0f) | ((t & 0x0f0f0f0f) << 4);
+			t = ((t >> 8) & 0x00ff00ff) | ((t & 0x00ff00ff) << 8);
+			r[l] = (t >> 16) | (t << 16);
+		}
+		break;
+
+	case JRISC_op_move:
+	case JRISC_op_moveq:
+		for (l = 0; l < W; l++) r[l] = s[l];
+		flags = 0;
+		break;
+
+	case JRISC_op_movei:
+		for (l = 0; l < W; l++) r[l] = inst->longImmediate;
+		flags = 0;
+		break;
+
+	case JRISC_op_movepc:
+		for (l = 0; l < W; l++) r[l] = inst->address;
+		flags = 0;
+		break;
+
+	case JRISC_op_moveta:
+		D = g->regs[32 + inst->regDst.val.reg];
+		for (l = 0; l < W; l++) r[l] = s[l];
+		flags = 0;
+		break;
+
+	case JRISC_op_movefa:
+		for (l = 0; l < W; l++) r[l] = g->regs[32 + src->val.reg][l];
+		flags = 0;
+		break;
+
+	case JRISC_op_jump:
+	case JRISC_op_jr:
+		jriscExecCondition(g, inst->regDst.val.condition, taken);
+		t = jriscInstructionBranchTarget(inst);
+		for (l = 0; l < W; l++) {
+			taken[l] &= m[l];
+			dest[l] = (inst->opName == JRISC_op_jr) ? t : s[l];
+		}
+		return;
+
+	case JRISC_op_nop:
+		return;
+
+	default:
+		for (l = 0; l < W; l++) {
+			if (m[l]) jriscExecStop(g, m, l, JRISC_execBadInstruction);
+		}
+		return;
+	}
+
+	if (writeDst) {
+		for (l = 0; l < W; l++) D[l] = BLEND(m[l], D[l], r[l]);
+	}
+
+	if (flags & FLAG_Z) {
+		for (l = 0; l < W; l++) g->z[l] = BLEND(m[l], g->z[l], r[l] == 0);
+	}
+
+	if (flags & FLAG_N) {
+		for (l = 0; l < W; l++) g->n[l] = BLEND(m[l], g->n[l], r[l] >> 31);
+	}
+
+	if (flags & FLAG_C) {
+		for (l = 0; l < W; l++) g->c[l] = BLEND(m[l], g->c[l], cf[l]);
+	}
+}
+
+/*
+ * Run the lanes of a group until all have stopped. Lanes that diverge are
+ * brought back together by always running the lowest address any of them has
+ * reached, so a lane that skips ahead waits for the others to catch up.
+ */
+static void
+jriscExecGroup(const struct Exec *ex, struct ExecGroup *g)
+{
+	const struct JRISC_Program *program = ex->program;
+	const struct JRISC_Instruction *inst;
+	uint32_t m[W], taken[W], dest[W], out[W];
+	uint32_t index;
+	uint32_t pc = 0;
+	uint32_t fall;
+	uint32_t next;
+	bool stopping;
+	bool any;
+	bool bad;
+	unsigned l;
+
+	for (;;) {
+		any = false;
+		for (l = 0; l < W; l++) {
+			if (g->live[l] && (!any || (g->pc[l] < pc))) {
+				pc = g->pc[l];
+				any = true;
+			}
+		}
+		if (!any) break;
+
+		for (l = 0; l < W; l++) {
+			m[l] = (g->live[l] && (g->pc[l] == pc)) ? ALL_LANES : 0;
+		}
+
+		index = jriscExecFind(program, pc, &bad);
+
+		/* A branch at the very end has its delay slot outside the program */
+		if (index == JRISC_PROGRAM_NO_INSTRUCTION) {
+			for (l = 0; l < W; l++) {
+				if (m[l]) jriscExecStop(g, m, l, JRISC_execDone);
+			}
+			continue;
+		}
+
+		inst = &program->instructions[index];
+
+		if (bad || (inst->opName == JRISC_invalidOpName)) {
+			for (l = 0; l < W; l++) {
+				if (m[l]) jriscExecStop(g, m, l, JRISC_execBadInstruction);
+			}
+			continue;
+		}
+
+		jriscExecInstruction(ex, g, inst, m, taken, dest);
+
+		fall = pc + jriscProgramInstructionSize(inst);
+		stopping = false;
+
+		for (l = 0; l < W; l++) {
+			next = BLEND(g->branching[l], fall, g->target[l]);
+			g->pc[l] = BLEND(m[l], g->pc[l], next);
+			g->target[l] = BLEND(m[l], g->target[l], dest[l]);
+			g->branching[l] = BLEND(m[l], g->branching[l], taken[l]);
+			g->steps[l] += m[l] & 1;
+
+			/* A jump out of the program waits for its delay slot */
+			out[l] = m[l] & ~g->branching[l] &
+				(((g->pc[l] - program->baseAddress) >= ex->programSize) ?
+				 ALL_LANES : 0);
+			stopping |= (out[l] != 0);
+		}
+
+		if (stopping) {
+			for (l = 0; l < W; l++) {
+				if (out[l]) jriscExecStop(g, m, l, JRISC_execDone);
+			}
+		}
+
+		if (ex->maxSteps) {
+			for (l = 0; l < W; l++) {
+				if (m[l] && (g->steps[l] >= ex->maxSteps)) {
+					jriscExecStop(g, m, l, JRISC_execTimeout);
+				}
+			}
+		}
+	}
+}
+
+static void
+jriscExecLoad(const struct Exec *ex, struct ExecGroup *g, size_t group)
+{
+	const struct JRISC_ExecState *st;
+	size_t first = group * W;
+	unsigned l;
+	unsigned i;
+	bool bad;
+
+	memset(g, 0, sizeof(*g));
+
+	for (l = 0; (l < W) && ((first + l) < ex->numStates); l++) {
+		st = &ex->states[first + l];
+
+		for (i = 0; i < 32; i++) {
+			g->regs[i][l] = st->regs[i];
+			g->regs[32 + i][l] = st->altRegs[i];
+		}
+		g->z[l] = st->z;
+		g->c[l] = st->c;
+		g->n[l] = st->n;
+		g->acc[l] = st->acc;
+		g->ram[l] = st->ram;
+		g->pc[l] = ex->entry;
+		g->status[l] = JRISC_execDone;
+		g->live[l] = ALL_LANES;
+
+		if (jriscExecFind(ex->program, ex->entry, &bad) ==
+			JRISC_PROGRAM_NO_INSTRUCTION) {
+			g->live[l] = 0;
+		}
+	}
+}
+
+static void
+jriscExecSave(const struct Exec *ex, const struct ExecGroup *g, size_t group)
+{
+	struct JRISC_ExecState *st;
+	size_t first = group * W;
+	unsigned l;
+	unsigned i;
+
+	for (l = 0; (l < W) && ((first + l) < ex->numStates); l++) {
+		st = &ex->states[first + l];
+
+		/* The banks are as the routine left REGPAGE */
+		for (i = 0; i < 32; i++) {
+			st->regs[i] = g->regs[i][l];
+			st->altRegs[i] = g->regs[32 + i][l];
+		}
+		st->z = g->z[l] != 0;
+		st->c = g->c[l] != 0;
+		st->n = g->n[l] != 0;
+		st->acc = g->acc[l];
+		st->pc = g->pc[l];
+		st->steps = g->steps[l];
+		st->status = g->status[l];
+	}
+}
+
+static void
+jriscExecThread(void *arg)
+{
+	struct Exec *ex = arg;
+	struct ExecGroup *g = malloc(sizeof(*g));
+	size_t group;
+
+	/* Without memory for a group, leave the work to the other threads */
+	if (!g) return;
+
+	for (;;) {
+		jriscMutexLock(ex->mutex);
+		group = ex->nextGroup++;
+		jriscMutexUnlock(ex->mutex);
+
+		if (group >= ex->numGroups) break;
+
+		jriscExecLoad(ex, g, group);
+		jriscExecGroup(ex, g);
+		jriscExecSave(ex, g, group);
+
+		jriscMutexLock(ex->mutex);
+		ex->numDone++;
+		jriscMutexUnlock(ex->mutex);
+	}
+
+	free(g);
+}
+
+enum JRISC_Error
+jriscExecRun(const struct JRISC_Program *program,
+			 uint32_t entry,
+			 uint64_t maxSteps,
+			 unsigned numThreads,
+			 struct JRISC_ExecState *states,
+			 size_t numStates)
+{
+	struct JRISC_Thread **threads;
+	struct Exec ex;
+	struct ExecGroup *g;
+	enum JRISC_Error err;
+	unsigned numStarted = 0;
+	unsigned i;
+
+	memset(&ex, 0, sizeof(ex));
+	ex.program = program;
+	ex.entry = entry;
+	ex.maxSteps = maxSteps;
+	ex.states = states;
+	ex.numStates = numStates;
+	ex.numGroups = (numStates + W - 1) / W;
+	ex.programSize = (uint32_t)(program->numWords * 2);
+
+	if (program->cpu == JRISC_dsp) {
+		ex.ramAddress = JRISC_DSP_RAM;
+		ex.ramSize = JRISC_DSP_RAM_SIZE;
+		ex.flagsAddress = JRISC_DSP_FLAGS;
+	} else {
+		ex.ramAddress = JRISC_GPU_RAM;
+		ex.ramSize = JRISC_GPU_RAM_SIZE;
+		ex.flagsAddress = JRISC_GPU_FLAGS;
+	}
+
+	if (!numThreads) numThreads = jriscThreadCpuCount();
+	if (numThreads > ex.numGroups) numThreads = (unsigned)ex.numGroups;
+
+	/* This thread is one of them */
+	if (numThreads <= 1) {
+		g = malloc(sizeof(*g));
+		if (!g) return JRISC_ERROR_outOfMemory;
+
+		for (ex.nextGroup = 0; ex.nextGroup < ex.numGroups; ex.nextGroup++) {
+			jriscExecLoad(&ex, g, ex.nextGroup);
+			jriscExecGroup(&ex, g);
+			jriscExecSave(&ex, g, ex.nextGroup);
+		}
+
+		free(g);
+		return JRISC_success;
+	}
+
+	err = jriscMutexCreate(&ex.mutex);
+	if (err != JRISC_success) return err;
+
+	threads = calloc(numThreads - 1, sizeof(*threads));
+	if (!threads) {
+		jriscMutexDestroy(ex.mutex);
+		return JRISC_ERROR_outOfMemory;
+	}
+
+	for (i = 0; i < (numThreads - 1); i++) {
+		if (jriscThreadCreate(jriscExecThread, &ex, &threads[i]) !=
+			JRISC_success) {
+			break;
+		}
+		numStarted++;
+	}
+
+	jriscExecThread(&ex);
+
+	for (i = 0; i < numStarted; i++) jriscThreadJoin(threads[i]);
+
+	free(threads);
+	jriscMutexDestroy(ex.mutex);
+
+	/* Groups are only left undone if no thread could allocate memory */
+	return (ex.numDone == ex.numGroups) ? JRISC_success :
+		JRISC_ERROR_outOfMemory;
+}
@@ -0,0 +1,76 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#ifndef JRISC_EXEC_H_
+#define JRISC_EXEC_H_
+
+#include "jrisc_base.h"
+#include "jrisc_program.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * The number of states run in lockstep by each thread. Every instruction is
+ * executed by a loop over this many lanes, which compilers turn into vector
+ * code, so it should be a multiple of the widest vector of 32-bit values the
+ * target has.
+ */
+#ifndef JRISC_EXEC_WIDTH
+#define JRISC_EXEC_WIDTH	8
+#endif
+
+enum JRISC_ExecStatus {
+	JRISC_execDone,				/* Ran off the end of the routine or left it */
+	JRISC_execTimeout,			/* Still running after the step limit */
+	JRISC_execBadAddress,		/* Load or store outside local RAM and flags */
+	JRISC_execBadInstruction,	/* Not emulated, or jumped into a movei */
+};
+
+/*
+ * One instance of a routine's state. The registers, flags, accumulator and
+ * RAM are read before running and hold the final state after. The other
+ * fields are only written.
+ */
+struct JRISC_ExecState {
+	uint32_t regs[32];			/* The current bank */
+	uint32_t altRegs[32];		/* The other bank, as moveta/movefa see it */
+	bool z, c, n;
+	int64_t acc;				/* imultn/imacn/resmac's accumulator */
+
+	/*
+	 * The CPU's local RAM, as big-endian bytes, or NULL if the routine
+	 * doesn't use it. It must be JRISC_GPU_RAM_SIZE or JRISC_DSP_RAM_SIZE
+	 * bytes, according to the program's CPU.
+	 */
+	uint8_t *ram;
+
+	uint32_t pc;				/* Where it stopped */
+	uint64_t steps;				/* Instructions executed */
+	enum JRISC_ExecStatus status;
+};
+
+/*
+ * Run <program> from <entry> once for each of <numStates> states, stopping
+ * each one when it leaves the program, or after <maxSteps> instructions if
+ * that is not 0. The states run independently but share the decoded code,
+ * and those that branch the same way are executed together. They are spread
+ * over <numThreads> threads, or one per CPU if that is 0.
+ *
+ * Loads and stores may reach local RAM and the flags register, where writing
+ * REGPAGE swaps register banks. Other addresses, and mmult, mtoi, normi,
+ * pack, unpack, loadp, storep, sat32s, addqmod and subqmod, stop the state
+ * with an error status. Division by 0 gives $ffffffff.
+ */
+extern enum JRISC_Error
+jriscExecRun(const struct JRISC_Program *program,
+			 uint32_t entry,
+			 uint64_t maxSteps,
+			 unsigned numThreads,
+			 struct JRISC_ExecState *states,
+			 size_t numStates);
+
+#endif /* JRISC_EXEC_H_ */
@@ -0,0 +1,942 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_ctx.h"
+#include "jrisc_grep.h"
+#include "jrisc_inst.h"
+#include "jrisc_inst_string.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#define MAX_MNEMONIC 16
+
+enum GrepKind {
+	KIND_ANY,			/* Patterns only: any operand at all */
+	KIND_REG,			/* rN */
+	KIND_INDIRECT,		/* (rN) */
+	KIND_INDEXED,		/* (r14+x) or (r15+x), where x is a REG or an IMM */
+	KIND_IMM,			/* #N, including movei's value */
+	KIND_COND,			/* A jump or jr condition */
+	KIND_TARGET,		/* A jr target address */
+	KIND_PC				/* movepc's source */
+};
+
+enum GrepMatchType {
+	MATCH_EXACT,
+	MATCH_ANY,
+	MATCH_CAPTURE
+};
+
+/*
+ * One operand, as jdis would print it. Instructions are reduced to a list of
+ * these to be compared with a pattern's.
+ */
+struct GrepOperand {
+	uint8_t kind;
+	uint8_t base;			/* KIND_INDEXED: 14 or 15 */
+	uint8_t innerKind;		/* KIND_INDEXED: KIND_REG, KIND_IMM or KIND_ANY */
+	uint8_t match;
+	uint8_t capture;
+	uint32_t value;
+};
+
+struct GrepElement {
+	char mnemonic[MAX_MNEMONIC];
+	bool anyInstruction;
+	bool hasCaptures;
+	unsigned numOperands;
+	struct GrepOperand operands[2];
+};
+
+struct GrepPattern {
+	char *text;
+	unsigned first;
+	unsigned length;
+	bool hasCaptures;
+	unsigned numCaptures;
+	char *captureNames[JRISC_GREP_MAX_CAPTURES];
+};
+
+struct JRISC_Grep {
+	struct GrepPattern *patterns;
+	unsigned numPatterns;
+	unsigned maxPatterns;
+
+	struct GrepElement *elements;
+	unsigned numElements;
+	unsigned maxElements;
+
+	/* The compiled NFA: bit n of each set stands for element n */
+	bool compiled;
+	unsigned numWords;
+	uint64_t *state;
+	uint64_t *starts;
+	uint64_t *finals;
+	uint64_t *mask;
+	unsigned *elementPattern;
+
+	/* For each opName, the elements whose mnemonic it matches */
+	unsigned candidateStart[JRISC_invalidOpName + 1];
+	unsigned *candidates;
+
+	/* The last instructions seen, for checking captures */
+	struct JRISC_Instruction history[JRISC_GREP_MAX_LENGTH];
+	unsigned historyCount;
+};
+
+/* Pattern parsing */
+
+static const char *
+jriscGrepSkipSpace(const char *s)
+{
+	while (isspace((unsigned char)*s)) s++;
+
+	return s;
+}
+
+static bool
+jriscGrepParseNumber(const char *s, uint32_t *valueOut)
+{
+	char *end;
+	bool negative = false;
+	unsigned long value;
+
+	if (*s == '-') {
+		negative = true;
+		s++;
+	}
+
+	if (*s == '$') {
+		value = strtoul(s + 1, &end, 16);
+		if (end == (s + 1)) return false;
+	} else {
+		value = strtoul(s, &end, 0);
+		if (end == s) return false;
+	}
+
+	if (*end) return false;
+
+	*valueOut = negative ? (uint32_t)-(long)value : (uint32_t)value;
+
+	return true;
+}
+
+static bool
+jriscGrepParseCapture(struct GrepPattern *p,
+					  const char *name,
+					  struct GrepOperand *op)
+{
+	unsigned i;
+
+	if (!*name) return false;
+	for (i = 0; name[i]; i++) {
+		if (!isalnum((unsigned char)name[i]) && (name[i] != '_')) return false;
+	}
+
+	op->match = MATCH_CAPTURE;
+
+	for (i = 0; i < p->numCaptures; i++) {
+		if (!strcmp(p->captureNames[i], name)) {
+			op->capture = (uint8_t)i;
+			return true;
+		}
+	}
+
+	if (p->numCaptures >= JRISC_GREP_MAX_CAPTURES) return false;
+
+	p->captureNames[p->numCaptures] = malloc(strlen(name) + 1);
+	if (!p->captureNames[p->numCaptures]) return false;
+	strcpy(p->captureNames[p->numCaptures], name);
+	op->capture = (uint8_t)p->numCaptures++;
+
+	return true;
+}
+
+/* A value: '*', %capture or a number */
+static bool
+jriscGrepParseValue(struct GrepPattern *p,
+					const char *s,
+					struct GrepOperand *op)
+{
+	if (!strcmp(s, "*")) {
+		op->match = MATCH_ANY;
+		return true;
+	}
+
+	if (*s == '%') return jriscGrepParseCapture(p, s + 1, op);
+
+	op->match = MATCH_EXACT;
+
+	return jriscGrepParseNumber(s, &op->value);
+}
+
+/* A register: '*', r*, %capture or rN */
+static bool
+jriscGrepParseReg(struct GrepPattern *p,
+				  const char *s,
+				  struct GrepOperand *op)
+{
+	char *end;
+	unsigned long reg;
+
+	if (!strcmp(s, "*") || !strcmp(s, "r*") || !strcmp(s, "R*")) {
+		op->match = MATCH_ANY;
+		return true;
+	}
+
+	if (*s == '%') return jriscGrepParseCapture(p, s + 1, op);
+
+	if ((*s != 'r') && (*s != 'R')) return false;
+	if (!isdigit((unsigned char)s[1])) return false;
+
+	reg = strtoul(s + 1, &end, 10);
+	if (*end || (reg > 31)) return false;
+
+	op->match = MATCH_EXACT;
+	op->value = (uint32_t)reg;
+
+	return true;
+}
+
+static bool
+jriscGrepIsReg(const char *s)
+{
+	return (((s[0] == 'r') || (s[0] == 'R')) &&
+			(isdigit((unsigned char)s[1]) || (s[1] == '*')));
+}
+
+static bool
+jriscGrepParseCondition(const char *s, uint32_t *conditionOut)
+{
+	const char *name;
+	uint32_t c;
+
+	for (c = 0; c <= JRISC_REG_MASK; c++) {
+		name = jriscConditionToString((uint8_t)c);
+		if (name && !strcasecmp(name, s)) {
+			*conditionOut = c;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static bool
+jriscGrepParseOperand(struct GrepPattern *p,
+					  char *s,
+					  struct GrepOperand *op)
+{
+	size_t length = strlen(s);
+
+	memset(op, 0, sizeof(*op));
+
+	if (!strcmp(s, "*")) {
+		op->kind = KIND_ANY;
+		op->match = MATCH_ANY;
+		return true;
+	}
+
+	if (!strcasecmp(s, "pc")) {
+		op->kind = KIND_PC;
+		op->match = MATCH_ANY;
+		return true;
+	}
+
+	if (*s == '#') {
+		op->kind = KIND_IMM;
+		return jriscGrepParseValue(p, jriscGrepSkipSpace(s + 1), op);
+	}
+
+	if ((*s == '(') && (length > 2) && (s[length - 1] == ')')) {
+		s[length - 1] = '\0';
+		s = (char *)jriscGrepSkipSpace(s + 1);
+		length = strlen(s);
+		while (length && isspace((unsigned char)s[length - 1])) {
+			s[--length] = '\0';
+		}
+
+		if (((s[0] == 'r') || (s[0] == 'R')) && (s[1] == '1') &&
+			((s[2] == '4') || (s[2] == '5')) && (s[3] == '+')) {
+			op->kind = KIND_INDEXED;
+			op->base = (s[2] == '4') ? 14 : 15;
+			s = (char *)jriscGrepSkipSpace(s + 4);
+
+			if (jriscGrepIsReg(s)) {
+				op->innerKind = KIND_REG;
+				return jriscGrepParseReg(p, s, op);
+			}
+
+			/* '*' and captures match either form */
+			op->innerKind = ((*s == '*') || (*s == '%')) ? KIND_ANY : KIND_IMM;
+			return jriscGrepParseValue(p, s, op);
+		}
+
+		op->kind = KIND_INDIRECT;
+		return jriscGrepParseReg(p, s, op);
+	}
+
+	if (jriscGrepParseCondition(s, &op->value)) {
+		op->kind = KIND_COND;
+		op->match = MATCH_EXACT;
+		return true;
+	}
+
+	if (jriscGrepIsReg(s)) {
+		op->kind = KIND_REG;
+		return jriscGrepParseReg(p, s, op);
+	}
+
+	if (*s == '%') {
+		op->kind = KIND_ANY;
+		return jriscGrepParseCapture(p, s + 1, op);
+	}
+
+	op->kind = KIND_TARGET;
+	op->match = MATCH_EXACT;
+
+	return jriscGrepParseNumber(s, &op->value);
+}
+
+static bool
+jriscGrepMnemonicExists(const char *mnemonic)
+{
+	unsigned op;
+
+	for (op = 0; op < JRISC_invalidOpName; op++) {
+		if (!strcasecmp(mnemonic, jriscOpNameToString(op))) return true;
+	}
+
+	return false;
+}
+
+/* Parse one instruction of a pattern, which is modified in place */
+static bool
+jriscGrepParseElement(struct GrepPattern *p,
+					  char *s,
+					  struct GrepElement *e)
+{
+	char *operand;
+	char *next;
+	size_t length = 0;
+	unsigned i;
+
+	memset(e, 0, sizeof(*e));
+
+	s = (char *)jriscGrepSkipSpace(s);
+	while (s[length] && !isspace((unsigned char)s[length])) length++;
+	if (!length) return false;
+
+	if ((length == 1) && (s[0] == '*')) {
+		e->anyInstruction = true;
+		return !*jriscGrepSkipSpace(s + 1);
+	}
+
+	if (length >= MAX_MNEMONIC) return false;
+	memcpy(e->mnemonic, s, length);
+	e->mnemonic[length] = '\0';
+	if (!jriscGrepMnemonicExists(e->mnemonic)) return false;
+
+	for (operand = (char *)jriscGrepSkipSpace(s + length);
+		 *operand; operand = next) {
+		if (e->numOperands >= 2) return false;
+
+		/* Operands end at a comma outside parentheses */
+		for (next = operand; *next && (*next != ','); next++) {
+			if (*next == '(') {
+				while (*next && (*next != ')')) next++;
+				if (!*next) return false;
+			}
+		}
+		if (*next) *next++ = '\0';
+
+		length = strlen(operand);
+		while (length && isspace((unsigned char)operand[length - 1])) {
+			operand[--length] = '\0';
+		}
+
+		if (!jriscGrepParseOperand(p, operand, &e->operands[e->numOperands])) {
+			return false;
+		}
+		e->numOperands++;
+		next = (char *)jriscGrepSkipSpace(next);
+	}
+
+	/* An unconditional-looking jump or jr matches any condition */
+	if ((!strcasecmp(e->mnemonic, "jump") || !strcasecmp(e->mnemonic, "jr")) &&
+		(e->numOperands == 1)) {
+		e->operands[1] = e->operands[0];
+		memset(&e->operands[0], 0, sizeof(e->operands[0]));
+		e->operands[0].kind = KIND_COND;
+		e->operands[0].match = MATCH_ANY;
+		e->numOperands = 2;
+	}
+
+	for (i = 0; i < e->numOperands; i++) {
+		if (e->operands[i].match == MATCH_CAPTURE) e->hasCaptures = true;
+	}
+
+	return true;
+}
+
+/* Instruction operands */
+
+static uint8_t
+jriscGrepBaseReg(enum JRISC_OpName opName)
+{
+	switch (opName) {
+	case JRISC_op_loadr14n:		/* Fall through */
+	case JRISC_op_loadr14r:		/* Fall through */
+	case JRISC_op_storer14n:	/* Fall through */
+	case JRISC_op_storer14r:
+		return 14;
+
+	case JRISC_op_loadr15n:		/* Fall through */
+	case JRISC_op_loadr15r:		/* Fall through */
+	case JRISC_op_storer15n:	/* Fall through */
+	case JRISC_op_storer15r:
+		return 15;
+
+	default:
+		return 0;
+	}
+}
+
+static void
+jriscGrepAddOperand(const struct JRISC_Instruction *inst,
+					const struct JRISC_OpReg *reg,
+					uint8_t base,
+					struct GrepOperand *ops,
+					unsigned *numOps)
+{
+	struct GrepOperand *op = &ops[*numOps];
+
+	memset(op, 0, sizeof(*op));
+	op->match = MATCH_EXACT;
+
+	switch (reg->type) {
+	case JRISC_reg:
+		op->kind = base ? KIND_INDEXED : KIND_REG;
+		op->innerKind = KIND_REG;
+		op->value = reg->val.reg;
+		break;
+
+	case JRISC_indirect:
+		op->kind = KIND_INDIRECT;
+		op->value = reg->val.reg;
+		break;
+
+	case JRISC_condition:
+		op->kind = KIND_COND;
+		op->value = reg->val.condition;
+		break;
+
+	case JRISC_uimmediate:
+		op->kind = base ? KIND_INDEXED : KIND_IMM;
+		op->innerKind = KIND_IMM;
+		op->value = reg->val.uimmediate ? reg->val.uimmediate : 32;
+		break;
+
+	case JRISC_zuimmediate:
+		op->kind = KIND_IMM;
+		op->value = reg->val.uimmediate;
+		break;
+
+	case JRISC_shlimmediate:
+		op->kind = KIND_IMM;
+		op->value = 32 - (reg->val.uimmediate ? reg->val.uimmediate : 32);
+		break;
+
+	case JRISC_simmediate:
+		op->kind = KIND_IMM;
+		op->value = (uint32_t)(int32_t)reg->val.simmediate;
+		break;
+
+	case JRISC_pcoffset:
+		op->kind = KIND_TARGET;
+		op->value = inst->address + (reg->val.simmediate + 1) * 2;
+		break;
+
+	default:
+		/* Flags and unused fields aren't printed */
+		return;
+	}
+
+	op->base = base;
+	(*numOps)++;
+}
+
+/* Reduce an instruction to its operands, in the order jdis prints them */
+static unsigned
+jriscGrepOperands(const struct JRISC_Instruction *inst,
+				  struct GrepOperand *ops)
+{
+	const struct JRISC_OpReg *reg1 = &inst->regSrc;
+	const struct JRISC_OpReg *reg2 = &inst->regDst;
+	uint8_t base1 = jriscGrepBaseReg(inst->opName);
+	uint8_t base2 = 0;
+	unsigned numOps = 0;
+
+	switch (inst->opName) {
+	case JRISC_op_movei:
+		memset(ops, 0, sizeof(*ops));
+		ops[0].kind = KIND_IMM;
+		ops[0].value = inst->longImmediate;
+		numOps = 1;
+		jriscGrepAddOperand(inst, &inst->regDst, 0, ops, &numOps);
+		return numOps;
+
+	case JRISC_op_movepc:
+		memset(ops, 0, sizeof(*ops));
+		ops[0].kind = KIND_PC;
+		numOps = 1;
+		jriscGrepAddOperand(inst, &inst->regDst, 0, ops, &numOps);
+		return numOps;
+
+	default:
+		break;
+	}
+
+	if (inst->swapRegs) {
+		reg1 = &inst->regDst;
+		reg2 = &inst->regSrc;
+		base2 = base1;
+		base1 = 0;
+	}
+
+	jriscGrepAddOperand(inst, reg1, base1, ops, &numOps);
+	jriscGrepAddOperand(inst, reg2, base2, ops, &numOps);
+
+	return numOps;
+}
+
+/* Matching */
+
+static bool
+jriscGrepOperandMatches(const struct GrepOperand *pat,
+						const struct GrepOperand *op,
+						uint32_t *captures,
+						unsigned *bound)
+{
+	if (pat->kind != KIND_ANY) {
+		if (pat->kind != op->kind) return false;
+
+		if (pat->kind == KIND_INDEXED) {
+			if (pat->base != op->base) return false;
+			if ((pat->innerKind != KIND_ANY) &&
+				(pat->innerKind != op->innerKind)) {
+				return false;
+			}
+		}
+	}
+
+	switch (pat->match) {
+	case MATCH_EXACT:
+		return pat->value == op->value;
+
+	case MATCH_CAPTURE:
+		/* Without a capture table, only the shape is being checked */
+		if (!captures) return true;
+
+		if (*bound & (1u << pat->capture)) {
+			return captures[pat->capture] == op->value;
+		}
+		*bound |= 1u << pat->capture;
+		captures[pat->capture] = op->value;
+		return true;
+
+	default:
+		return true;
+	}
+}
+
+static bool
+jriscGrepElementMatches(const struct GrepElement *e,
+						const struct GrepOperand *ops,
+						unsigned numOps,
+						uint32_t *captures,
+						unsigned *bound)
+{
+	unsigned i;
+
+	if (e->anyInstruction) return true;
+	if (e->numOperands != numOps) return false;
+
+	for (i = 0; i < numOps; i++) {
+		if (!jriscGrepOperandMatches(&e->operands[i], &ops[i],
+									 captures, bound)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/* Public interface */
+
+enum JRISC_Error
+jriscGrepCreate(struct JRISC_Grep **grepOut)
+{
+	struct JRISC_Grep *grep = calloc(1, sizeof(*grep));
+
+	if (!grep) return JRISC_ERROR_outOfMemory;
+
+	*grepOut = grep;
+
+	return JRISC_success;
+}
+
+static void
+jriscGrepFreeCompiled(struct JRISC_Grep *grep)
+{
+	free(grep->state);
+	free(grep->starts);
+	free(grep->finals);
+	free(grep->mask);
+	free(grep->elementPattern);
+	free(grep->candidates);
+	grep->state = grep->starts = grep->finals = grep->mask = NULL;
+	grep->elementPattern = NULL;
+	grep->candidates = NULL;
+	grep->compiled = false;
+}
+
+void
+jriscGrepDestroy(struct JRISC_Grep *grep)
+{
+	unsigned i, c;
+
+	if (!grep) return;
+
+	for (i = 0; i < grep->numPatterns; i++) {
+		free(grep->patterns[i].text);
+		for (c = 0; c < grep->patterns[i].numCaptures; c++) {
+			free(grep->patterns[i].captureNames[c]);
+		}
+	}
+
+	jriscGrepFreeCompiled(grep);
+	free(grep->patterns);
+	free(grep->elements);
+	free(grep);
+}
+
+enum JRISC_Error
+jriscGrepAddPattern(struct JRISC_Grep *grep,
+					const char *pattern,
+					unsigned *indexOut)
+{
+	struct GrepPattern p;
+	struct GrepElement elements[JRISC_GREP_MAX_LENGTH];
+	struct GrepPattern *newPatterns;
+	struct GrepElement *newElements;
+	char *copy = malloc(strlen(pattern) + 1);
+	char *s;
+	char *next;
+	unsigned c;
+
+	memset(&p, 0, sizeof(p));
+	if (!copy) return JRISC_ERROR_outOfMemory;
+	strcpy(copy, pattern);
+
+	for (s = copy; s; s = next) {
+		next = strchr(s, ';');
+		if (next) *next++ = '\0';
+
+		if ((p.length >= JRISC_GREP_MAX_LENGTH) ||
+			!jriscGrepParseElement(&p, s, &elements[p.length])) {
+			goto invalid;
+		}
+
+		if (elements[p.length].hasCaptures) p.hasCaptures = true;
+		p.length++;
+	}
+
+	if (grep->numPatterns == grep->maxPatterns) {
+		grep->maxPatterns = grep->maxPatterns ? grep->maxPatterns * 2 : 16;
+		newPatterns = realloc(grep->patterns,
+							  grep->maxPatterns * sizeof(*grep->patterns));
+		if (!newPatterns) goto oom;
+		grep->patterns = newPatterns;
+	}
+
+	while ((grep->numElements + p.length) > grep->maxElements) {
+		grep->maxElements = grep->maxElements ? grep->maxElements * 2 : 64;
+		newElements = realloc(grep->elements,
+							  grep->maxElements * sizeof(*grep->elements));
+		if (!newElements) goto oom;
+		grep->elements = newElements;
+	}
+
+	strcpy(copy, pattern);
+	p.text = copy;
+	p.first = grep->numElements;
+	memcpy(&grep->elements[grep->numElements], elements,
+		   p.length * sizeof(elements[0]));
+	grep->numElements += p.length;
+	grep->patterns[grep->numPatterns] = p;
+	if (indexOut) *indexOut = grep->numPatterns;
+	grep->numPatterns++;
+
+	jriscGrepFreeCompiled(grep);
+
+	return JRISC_success;
+
+invalid:
+	for (c = 0; c < p.numCaptures; c++) free(p.captureNames[c]);
+	free(copy);
+
+	return JRISC_ERROR_invalidValue;
+
+oom:
+	for (c = 0; c < p.numCaptures; c++) free(p.captureNames[c]);
+	free(copy);
+
+	return JRISC_ERROR_outOfMemory;
+}
+
+const char *
+jriscGrepPatternString(const struct JRISC_Grep *grep, unsigned index)
+{
+	if (index >= grep->numPatterns) return NULL;
+
+	return grep->patterns[index].text;
+}
+
+const char *
+jriscGrepCaptureName(const struct JRISC_Grep *grep,
+					 unsigned index,
+					 unsigned capture)
+{
+	if ((index >= grep->numPatterns) ||
+		(capture >= grep->patterns[index].numCaptures)) {
+		return NULL;
+	}
+
+	return grep->patterns[index].captureNames[capture];
+}
+
+static bool
+jriscGrepElementHasMnemonic(const struct GrepElement *e,
+							enum JRISC_OpName opName)
+{
+	return e->anyInstruction ||
+		!strcasecmp(e->mnemonic, jriscOpNameToString(opName));
+}
+
+static enum JRISC_Error
+jriscGrepCompile(struct JRISC_Grep *grep)
+{
+	const unsigned numWords = (grep->numElements + 63) / 64;
+	unsigned numCandidates = 0;
+	unsigned op, e, i;
+
+	jriscGrepFreeCompiled(grep);
+
+	grep->numWords = numWords;
+	grep->state = calloc(numWords + 1, sizeof(*grep->state));
+	grep->starts = calloc(numWords + 1, sizeof(*grep->starts));
+	grep->finals = calloc(numWords + 1, sizeof(*grep->finals));
+	grep->mask = calloc(numWords + 1, sizeof(*grep->mask));
+	grep->elementPattern = calloc(grep->numElements + 1,
+								  sizeof(*grep->elementPattern));
+	if (!grep->state || !grep->starts || !grep->finals || !grep->mask ||
+		!grep->elementPattern) {
+		goto oom;
+	}
+
+	for (i = 0; i < grep->numPatterns; i++) {
+		e = grep->patterns[i].first;
+		grep->starts[e / 64] |= 1ull << (e % 64);
+		e += grep->patterns[i].length - 1;
+		grep->finals[e / 64] |= 1ull << (e % 64);
+
+		for (e = 0; e < grep->patterns[i].length; e++) {
+			grep->elementPattern[grep->patterns[i].first + e] = i;
+		}
+	}
+
+	for (op = 0; op < JRISC_invalidOpName; op++) {
+		for (e = 0; e < grep->numElements; e++) {
+			if (jriscGrepElementHasMnemonic(&grep->elements[e], op)) {
+				numCandidates++;
+			}
+		}
+	}
+
+	grep->candidates = malloc((numCandidates + 1) *
+							  sizeof(*grep->candidates));
+	if (!grep->candidates) goto oom;
+
+	for (op = 0, numCandidates = 0; op < JRISC_invalidOpName; op++) {
+		grep->candidateStart[op] = numCandidates;
+		for (e = 0; e < grep->numElements; e++) {
+			if (jriscGrepElementHasMnemonic(&grep->elements[e], op)) {
+				grep->candidates[numCandidates++] = e;
+			}
+		}
+	}
+	grep->candidateStart[JRISC_invalidOpName] = numCandidates;
+
+	grep->compiled = true;
+	grep->historyCount = 0;
+
+	return JRISC_success;
+
+oom:
+	jriscGrepFreeCompiled(grep);
+
+	return JRISC_ERROR_outOfMemory;
+}
+
+void
+jriscGrepReset(struct JRISC_Grep *grep)
+{
+	if (grep->compiled) {
+		memset(grep->state, 0, grep->numWords * sizeof(*grep->state));
+	}
+	grep->historyCount = 0;
+}
+
+/* Check a whole pattern's captures against the instructions that matched it */
+static bool
+jriscGrepVerify(const struct JRISC_Grep *grep,
+				unsigned index,
+				struct JRISC_GrepMatch *match)
+{
+	const struct GrepPattern *p = &grep->patterns[index];
+	const struct JRISC_Instruction *inst;
+	struct GrepOperand ops[2];
+	unsigned numOps;
+	unsigned bound = 0;
+	unsigned i;
+
+	match->pattern = index;
+	match->length = p->length;
+	match->numCaptures = p->numCaptures;
+	inst = &grep->history[(grep->historyCount - p->length) %
+						  JRISC_GREP_MAX_LENGTH];
+	match->address = inst->address;
+
+	if (!p->hasCaptures) return true;
+
+	for (i = 0; i < p->length; i++) {
+		inst = &grep->history[(grep->historyCount - p->length + i) %
+							  JRISC_GREP_MAX_LENGTH];
+		numOps = jriscGrepOperands(inst, ops);
+		if (!jriscGrepElementMatches(&grep->elements[p->first + i],
+									 ops, numOps, match->captures, &bound)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+enum JRISC_Error
+jriscGrepFeed(struct JRISC_Grep *grep,
+			  const struct JRISC_Instruction *instruction,
+			  JRISC_GrepMatchFunc func,
+			  void *userData)
+{
+	struct GrepOperand ops[2];
+	struct JRISC_GrepMatch match;
+	const struct GrepElement *e;
+	unsigned numOps = 0;
+	bool haveOps = false;
+	uint64_t carry = 0;
+	uint64_t next;
+	uint64_t hits;
+	unsigned first, last, c, k, bit;
+	enum JRISC_Error ret;
+
+	if (!grep->compiled) {
+		ret = jriscGrepCompile(grep);
+		if (ret != JRISC_success) return ret;
+	}
+
+	if (instruction->opName >= JRISC_invalidOpName) {
+		jriscGrepReset(grep);
+		return JRISC_success;
+	}
+
+	memset(grep->mask, 0, grep->numWords * sizeof(*grep->mask));
+
+	first = grep->candidateStart[instruction->opName];
+	last = grep->candidateStart[instruction->opName + 1];
+	for (c = first; c < last; c++) {
+		e = &grep->elements[grep->candidates[c]];
+
+		if (!e->anyInstruction && !haveOps) {
+			numOps = jriscGrepOperands(instruction, ops);
+			haveOps = true;
+		}
+
+		if (jriscGrepElementMatches(e, ops, numOps, NULL, NULL)) {
+			grep->mask[grep->candidates[c] / 64] |=
+				1ull << (grep->candidates[c] % 64);
+		}
+	}
+
+	grep->history[grep->historyCount % JRISC_GREP_MAX_LENGTH] = *instruction;
+	grep->historyCount++;
+
+	/*
+	 * Advance every partial match by one instruction. A bit carried out of one
+	 * pattern's last element into the next pattern's first is harmless, as
+	 * first elements are always live anyway.
+	 */
+	for (k = 0; k < grep->numWords; k++) {
+		next = (grep->state[k] << 1) | carry | grep->starts[k];
+		carry = grep->state[k] >> 63;
+		grep->state[k] = next & grep->mask[k];
+
+		for (hits = grep->state[k] & grep->finals[k]; hits; hits &= hits - 1) {
+			for (bit = 0; !((hits >> bit) & 1); bit++);
+
+			if (jriscGrepVerify(grep, grep->elementPattern[k * 64 + bit],
+								&match)) {
+				func(userData, &match);
+			}
+		}
+	}
+
+	return JRISC_success;
+}
+
+enum JRISC_Error
+jriscGrepScan(struct JRISC_Grep *grep,
+			  struct JRISC_Context *context,
+			  uint64_t size,
+			  enum JRISC_CPU cpu,
+			  JRISC_GrepMatchFunc func,
+			  void *userData)
+{
+	const uint64_t end = context->readLocation + size;
+	struct JRISC_Instruction inst;
+	enum JRISC_Error ret;
+
+	jriscGrepReset(grep);
+
+	while (context->readLocation < end) {
+		ret = jriscInstructionRead(context, cpu, &inst);
+
+		if (ret == JRISC_ERROR_ioError) break;
+
+		if (ret != JRISC_success) {
+			jriscGrepReset(grep);
+			continue;
+		}
+
+		ret = jriscGrepFeed(grep, &inst, func, userData);
+		if (ret != JRISC_success) return ret;
+	}
+
+	return JRISC_success;
+}
@@ -0,0 +1,108 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#ifndef JRISC_GREP_H_
+#define JRISC_GREP_H_
+
+#include "jrisc_base.h"
+#include "jrisc_ctx.h"
+#include "jrisc_inst.h"
+
+#include <stdint.h>
+
+#define JRISC_GREP_MAX_LENGTH		32	/* Instructions per pattern */
+#define JRISC_GREP_MAX_CAPTURES		8	/* Distinct captures per pattern */
+
+/*
+ * Instruction sequence patterns.
+ *
+ * A pattern is a list of instructions separated by ';'. Each one is either
+ * '*', matching any instruction, or a mnemonic followed by operands written
+ * as jdis prints them, where any operand or part of one may instead be:
+ *
+ *   *        Anything of that kind: r*, #*, (*), (r14+*), or a bare * for
+ *            any operand at all
+ *   %name    A capture. Its first appearance matches anything; later ones
+ *            must match the same value.
+ *
+ * Immediates are #<value>, jr targets a bare address, and values may be
+ * decimal, $hex or 0xhex. A jump or jr written without a condition matches
+ * any condition. For example:
+ *
+ *   movei #%target, %r; jump (%r)
+ *   movei #$f02114, r*; store *, (*)
+ */
+
+struct JRISC_Grep;
+
+struct JRISC_GrepMatch {
+	unsigned pattern;			/* Index, in the order patterns were added */
+	uint32_t address;			/* Of the first instruction */
+	unsigned length;			/* In instructions */
+
+	/* Captured values, in order of each capture's first appearance */
+	unsigned numCaptures;
+	uint32_t captures[JRISC_GREP_MAX_CAPTURES];
+};
+
+typedef void (*JRISC_GrepMatchFunc)(void *userData,
+									const struct JRISC_GrepMatch *match);
+
+extern enum JRISC_Error
+jriscGrepCreate(struct JRISC_Grep **grepOut);
+
+extern void
+jriscGrepDestroy(struct JRISC_Grep *grep);
+
+/* Returns JRISC_ERROR_invalidValue if the pattern can't be parsed */
+extern enum JRISC_Error
+jriscGrepAddPattern(struct JRISC_Grep *grep,
+					const char *pattern,
+					unsigned *indexOut);
+
+extern const char *
+jriscGrepPatternString(const struct JRISC_Grep *grep, unsigned index);
+
+/* The name of capture <capture> of a pattern, without its '%' */
+extern const char *
+jriscGrepCaptureName(const struct JRISC_Grep *grep,
+					 unsigned index,
+					 unsigned capture);
+
+/*
+ * Match every pattern at once against a stream of instructions, one at a time,
+ * calling <func> for each match as its last instruction arrives.
+ *
+ * Patterns are compiled into a bit-parallel NFA: one state bit per pattern
+ * instruction, advanced for all patterns together with a shift and a mask per
+ * instruction. Captures are only checked when a whole pattern matches.
+ *
+ * An instruction with opName JRISC_invalidOpName breaks any partial matches.
+ */
+extern enum JRISC_Error
+jriscGrepFeed(struct JRISC_Grep *grep,
+			  const struct JRISC_Instruction *instruction,
+			  JRISC_GrepMatchFunc func,
+			  void *userData);
+
+/* Forget any partial matches, e.g. before starting on a new stream */
+extern void
+jriscGrepReset(struct JRISC_Grep *grep);
+
+/*
+ * Read <size> bytes from the context's current position with
+ * jriscInstructionRead, and feed every instruction to the matcher. Words that
+ * don't decode break partial matches but don't end the scan.
+ */
+extern enum JRISC_Error
+jriscGrepScan(struct JRISC_Grep *grep,
+			  struct JRISC_Context *context,
+			  uint64_t size,
+			  enum JRISC_CPU cpu,
+			  JRISC_GrepMatchFunc func,
+			  void *userData);
+
+#endif /* JRISC_GREP_H_ */
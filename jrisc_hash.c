@@ -0,0 +1,115 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_hash.h"
+
+#define PRIME64_1 0x9e3779b185ebca87ull
+#define PRIME64_2 0xc2b2ae3d27d4eb4full
+#define PRIME64_3 0x165667b19e3779f9ull
+#define PRIME64_4 0x85ebca77c2b2ae63ull
+#define PRIME64_5 0x27d4eb2f165667c5ull
+
+static inline uint64_t
+jriscRotl64(uint64_t val, unsigned bits)
+{
+	return (val << bits) | (val >> (64 - bits));
+}
+
+/* xxHash is defined over little-endian reads, whatever the host */
+static inline uint64_t
+jriscRead64(const uint8_t *p)
+{
+	return (uint64_t)p[0] | ((uint64_t)p[1] << 8) |
+		((uint64_t)p[2] << 16) | ((uint64_t)p[3] << 24) |
+		((uint64_t)p[4] << 32) | ((uint64_t)p[5] << 40) |
+		((uint64_t)p[6] << 48) | ((uint64_t)p[7] << 56);
+}
+
+static inline uint32_t
+jriscRead32(const uint8_t *p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+		((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline uint64_t
+jriscHashRound(uint64_t acc, uint64_t input)
+{
+	acc += input * PRIME64_2;
+	acc = jriscRotl64(acc, 31);
+
+	return acc * PRIME64_1;
+}
+
+static inline uint64_t
+jriscHashMergeRound(uint64_t acc, uint64_t val)
+{
+	acc ^= jriscHashRound(0, val);
+
+	return acc * PRIME64_1 + PRIME64_4;
+}
+
+uint64_t
+jriscHash64(const void *data, size_t size, uint64_t seed)
+{
+	const uint8_t *p = data;
+	const uint8_t *end = p + size;
+	uint64_t v1, v2, v3, v4;
+	uint64_t hash;
+
+	if (size >= 32) {
+		const uint8_t *limit = end - 32;
+
+		v1 = seed + PRIME64_1 + PRIME64_2;
+		v2 = seed + PRIME64_2;
+		v3 = seed;
+		v4 = seed - PRIME64_1;
+
+		do {
+			v1 = jriscHashRound(v1, jriscRead64(p)); p += 8;
+			v2 = jriscHashRound(v2, jriscRead64(p)); p += 8;
+			v3 = jriscHashRound(v3, jriscRead64(p)); p += 8;
+			v4 = jriscHashRound(v4, jriscRead64(p)); p += 8;
+		} while (p <= limit);
+
+		hash = jriscRotl64(v1, 1) + jriscRotl64(v2, 7) +
+			jriscRotl64(v3, 12) + jriscRotl64(v4, 18);
+		hash = jriscHashMergeRound(hash, v1);
+		hash = jriscHashMergeRound(hash, v2);
+		hash = jriscHashMergeRound(hash, v3);
+		hash = jriscHashMergeRound(hash, v4);
+	} else {
+		hash = seed + PRIME64_5;
+	}
+
+	hash += (uint64_t)size;
+
+	while ((p + 8) <= end) {
+		hash ^= jriscHashRound(0, jriscRead64(p));
+		hash = jriscRotl64(hash, 27) * PRIME64_1 + PRIME64_4;
+		p += 8;
+	}
+
+	if ((p + 4) <= end) {
+		hash ^= (uint64_t)jriscRead32(p) * PRIME64_1;
+		hash = jriscRotl64(hash, 23) * PRIME64_2 + PRIME64_3;
+		p += 4;
+	}
+
+	while (p < end) {
+		hash ^= (*p) * PRIME64_5;
+		hash = jriscRotl64(hash, 11) * PRIME64_1;
+		p++;
+	}
+
+	hash ^= hash >> 33;
+	hash *= PRIME64_2;
+	hash ^= hash >> 29;
+	hash *= PRIME64_3;
+	hash ^= hash >> 32;
+
+	return hash;
+}
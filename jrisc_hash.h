@@ -0,0 +1,31 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#ifndef JRISC_HASH_H_
+#define JRISC_HASH_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* The XXH64 hash function, as specified by the xxHash project */
+extern uint64_t
+jriscHash64(const void *data, size_t size, uint64_t seed);
+
+/* Mix a 64-bit value into a running hash, as XXH64 merges its lanes */
+static inline uint64_t
+jriscHashCombine(uint64_t hash, uint64_t value)
+{
+	value *= 0xc2b2ae3d27d4eb4full;
+	value = (value << 31) | (value >> 33);
+	value *= 0x9e3779b185ebca87ull;
+
+	hash ^= value;
+	hash = (hash << 27) | (hash >> 37);
+
+	return hash * 0x9e3779b185ebca87ull + 0x85ebca77c2b2ae63ull;
+}
+
+#endif /* JRISC_HASH_H_ */
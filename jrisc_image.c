@@ -0,0 +1,462 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_ctx.h"
+#include "jrisc_ctx_mem.h"
+#include "jrisc_endian.h"
+#include "jrisc_image.h"
+#include "jrisc_map.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#define AOUT_HEADER_SIZE		32
+#define COFF_HEADER_SIZE		20
+#define COFF_SECTION_SIZE		40
+#define ABS_HEADER_SIZE			28
+#define ABS_EXT_HEADER_SIZE		36
+#define ROM_HEADER_SIZE			0x2000
+#define ROM_BASE				0x800000
+
+#define COFF_MAGIC				0x0150
+#define COFF_STYP_TEXT			0x0020
+#define COFF_STYP_DATA			0x0040
+#define COFF_STYP_BSS			0x0080
+
+static enum JRISC_Error
+jriscImageAddSection(struct JRISC_Image *image,
+					 const char *name,
+					 uint32_t address,
+					 uint64_t offset,
+					 uint64_t size,
+					 uint32_t flags)
+{
+	struct JRISC_Section *sections;
+	struct JRISC_Section *s;
+
+	/* BSS sections occupy no space in the file */
+	if (!(flags & JRISC_SECTIONFLAG_BSS) &&
+		((offset > image->size) || (size > (image->size - offset)))) {
+		return JRISC_ERROR_invalidFormat;
+	}
+
+	sections = realloc(image->sections,
+					   (image->numSections + 1) * sizeof(*sections));
+	if (!sections) return JRISC_ERROR_outOfMemory;
+
+	image->sections = sections;
+	s = &sections[image->numSections++];
+
+	memset(s, 0, sizeof(*s));
+	strncpy(s->name, name, sizeof(s->name) - 1);
+	s->address = address;
+	s->offset = offset;
+	s->size = size;
+	s->flags = flags;
+
+	return JRISC_success;
+}
+
+static enum JRISC_Error
+jriscImageParseAout(struct JRISC_Image *image)
+{
+	const uint8_t *h = image->data;
+	uint32_t magic, textSize, dataSize, bssSize;
+	uint64_t symbolOffset;
+	enum JRISC_Error ret;
+
+	if (image->size < AOUT_HEADER_SIZE) return JRISC_ERROR_invalidFormat;
+
+	magic = jriscLoadBE32(&h[0]);
+	if ((magic != 0x107) && (magic != 0x108) && (magic != 0x10b)) {
+		return JRISC_ERROR_invalidFormat;
+	}
+
+	textSize = jriscLoadBE32(&h[4]);
+	dataSize = jriscLoadBE32(&h[8]);
+	bssSize = jriscLoadBE32(&h[12]);
+	image->entry = jriscLoadBE32(&h[20]);
+
+	/* Symbols follow the text and data relocations, then the strings */
+	symbolOffset = AOUT_HEADER_SIZE + (uint64_t)textSize + dataSize +
+		jriscLoadBE32(&h[24]) + jriscLoadBE32(&h[28]);
+	image->symbolSize = jriscLoadBE32(&h[16]);
+	if (image->symbolSize &&
+		((symbolOffset + image->symbolSize + 4) <= image->size)) {
+		image->symbolOffset = symbolOffset;
+		image->stringOffset = symbolOffset + image->symbolSize;
+		image->stringSize = jriscLoadBE32(&h[image->stringOffset]);
+		if (image->stringSize > (image->size - image->stringOffset)) {
+			image->stringSize = image->size - image->stringOffset;
+		}
+	} else {
+		image->symbolSize = 0;
+	}
+
+	/* BSD a.out segments are laid out contiguously starting at address 0 */
+	ret = jriscImageAddSection(image, ".text", 0,
+							   AOUT_HEADER_SIZE, textSize,
+							   JRISC_SECTIONFLAG_CODE);
+	if (ret != JRISC_success) return ret;
+
+	ret = jriscImageAddSection(image, ".data", textSize,
+							   AOUT_HEADER_SIZE + (uint64_t)textSize, dataSize,
+							   JRISC_SECTIONFLAG_DATA);
+	if (ret != JRISC_success) return ret;
+
+	return jriscImageAddSection(image, ".bss", textSize + dataSize,
+								0, bssSize, JRISC_SECTIONFLAG_BSS);
+}
+
+static enum JRISC_Error
+jriscImageParseCoff(struct JRISC_Image *image)
+{
+	const uint8_t *h = image->data;
+	const uint8_t *s;
+	uint16_t numSections, optSize, i;
+	uint32_t sFlags, flags;
+	uint64_t tableOffset;
+	uint64_t symbolOffset;
+	uint64_t symbolSize;
+	char name[9];
+	enum JRISC_Error ret;
+
+	if (image->size < COFF_HEADER_SIZE) return JRISC_ERROR_invalidFormat;
+	if (jriscLoadBE16(&h[0]) != COFF_MAGIC) return JRISC_ERROR_invalidFormat;
+
+	numSections = jriscLoadBE16(&h[2]);
+	optSize = jriscLoadBE16(&h[16]);
+
+	/*
+	 * The magic number is also a plausible JRISC instruction, so be strict
+	 * about the rest of the header before accepting the file as COFF.
+	 */
+	if ((numSections == 0) || (numSections > 32)) {
+		return JRISC_ERROR_invalidFormat;
+	}
+	if ((optSize != 0) && (optSize != 28)) return JRISC_ERROR_invalidFormat;
+
+	/* The a.out-style optional header carries the entry point */
+	if ((optSize >= 28) && (image->size >= (COFF_HEADER_SIZE + 28))) {
+		image->entry = jriscLoadBE32(&h[COFF_HEADER_SIZE + 16]);
+	}
+
+	tableOffset = COFF_HEADER_SIZE + (uint64_t)optSize;
+	if ((tableOffset + (uint64_t)numSections * COFF_SECTION_SIZE) >
+		image->size) {
+		return JRISC_ERROR_invalidFormat;
+	}
+
+	/* 18-byte symbol entries, immediately followed by the string table */
+	symbolOffset = jriscLoadBE32(&h[8]);
+	symbolSize = (uint64_t)jriscLoadBE32(&h[12]) * 18;
+	if (symbolSize && ((symbolOffset + symbolSize) <= image->size)) {
+		image->symbolOffset = symbolOffset;
+		image->symbolSize = symbolSize;
+		image->stringOffset = symbolOffset + symbolSize;
+		if ((image->stringOffset + 4) <= image->size) {
+			image->stringSize = jriscLoadBE32(&h[image->stringOffset]);
+			if (image->stringSize > (image->size - image->stringOffset)) {
+				image->stringSize = image->size - image->stringOffset;
+			}
+		}
+	}
+
+	for (i = 0; i < numSections; i++) {
+		s = &h[tableOffset + (uint64_t)i * COFF_SECTION_SIZE];
+
+		memcpy(name, s, 8);
+		name[8] = '\0';
+
+		sFlags = jriscLoadBE32(&s[36]);
+		if (sFlags & COFF_STYP_TEXT) flags = JRISC_SECTIONFLAG_CODE;
+		else if (sFlags & COFF_STYP_BSS) flags = JRISC_SECTIONFLAG_BSS;
+		else flags = JRISC_SECTIONFLAG_DATA;
+
+		ret = jriscImageAddSection(image, name,
+								   jriscLoadBE32(&s[12]),		/* s_vaddr */
+								   jriscLoadBE32(&s[20]),		/* s_scnptr */
+								   jriscLoadBE32(&s[16]),		/* s_size */
+								   flags);
+		if (ret != JRISC_success) return ret;
+	}
+
+	return JRISC_success;
+}
+
+static enum JRISC_Error
+jriscImageParseAbs(struct JRISC_Image *image)
+{
+	const uint8_t *h = image->data;
+	uint32_t textSize, dataSize, bssSize;
+	uint32_t textBase, dataBase, bssBase;
+	uint32_t symbolSize;
+	uint64_t headerSize;
+	uint16_t magic;
+	enum JRISC_Error ret;
+
+	if (image->size < ABS_HEADER_SIZE) return JRISC_ERROR_invalidFormat;
+
+	magic = jriscLoadBE16(&h[0]);
+	textSize = jriscLoadBE32(&h[2]);
+	dataSize = jriscLoadBE32(&h[6]);
+	bssSize = jriscLoadBE32(&h[10]);
+	textBase = jriscLoadBE32(&h[22]);
+
+	if (magic == 0x601a) {
+		/* Contiguous: data and BSS follow the text */
+		headerSize = ABS_HEADER_SIZE;
+		dataBase = textBase + textSize;
+		bssBase = dataBase + dataSize;
+	} else if (magic == 0x601b) {
+		/* Non-contiguous: ALN's usual output, with explicit bases */
+		if (image->size < ABS_EXT_HEADER_SIZE) return JRISC_ERROR_invalidFormat;
+		headerSize = ABS_EXT_HEADER_SIZE;
+		dataBase = jriscLoadBE32(&h[28]);
+		bssBase = jriscLoadBE32(&h[32]);
+	} else {
+		return JRISC_ERROR_invalidFormat;
+	}
+
+	image->entry = textBase;
+
+	/* 14-byte DRI symbol entries follow the data, with no string table */
+	symbolSize = jriscLoadBE32(&h[14]);
+	if (symbolSize &&
+		((headerSize + textSize + dataSize + symbolSize) <= image->size)) {
+		image->symbolOffset = headerSize + textSize + dataSize;
+		image->symbolSize = symbolSize;
+	}
+
+	ret = jriscImageAddSection(image, ".text", textBase,
+							   headerSize, textSize,
+							   JRISC_SECTIONFLAG_CODE);
+	if (ret != JRISC_success) return ret;
+
+	ret = jriscImageAddSection(image, ".data", dataBase,
+							   headerSize + textSize, dataSize,
+							   JRISC_SECTIONFLAG_DATA);
+	if (ret != JRISC_success) return ret;
+
+	return jriscImageAddSection(image, ".bss", bssBase,
+								0, bssSize, JRISC_SECTIONFLAG_BSS);
+}
+
+static bool
+jriscImageIsCartAddress(uint32_t address)
+{
+	return (address >= ROM_BASE) && (address < 0xe00000);
+}
+
+static enum JRISC_Error
+jriscImageParseRom(struct JRISC_Image *image)
+{
+	const uint8_t *h = image->data;
+	uint32_t start;
+	enum JRISC_Error ret;
+
+	if (image->size <= ROM_HEADER_SIZE) return JRISC_ERROR_invalidFormat;
+
+	/*
+	 * The boot ROM reads the cartridge bus width from 0x400, replicated in
+	 * all four bytes, then jumps to the long at 0x404. The replication makes
+	 * the width byte-order agnostic, so use the start address to tell whether
+	 * the image was dumped with its words swapped.
+	 */
+	if ((h[0x400] != h[0x401]) || (h[0x400] != h[0x402]) ||
+		(h[0x400] != h[0x403])) {
+		return JRISC_ERROR_invalidFormat;
+	}
+
+	start = jriscLoadBE32(&h[0x404]);
+	if (jriscImageIsCartAddress(start)) {
+		image->byteOrder = JRISC_bigEndian;
+	} else {
+		start = ((uint32_t)jriscLoadLE16(&h[0x404]) << 16) |
+			jriscLoadLE16(&h[0x406]);
+		if (!jriscImageIsCartAddress(start)) return JRISC_ERROR_invalidFormat;
+		image->byteOrder = JRISC_littleEndian;
+	}
+
+	image->entry = start;
+
+	ret = jriscImageAddSection(image, "header", ROM_BASE,
+							   0, ROM_HEADER_SIZE,
+							   JRISC_SECTIONFLAG_DATA);
+	if (ret != JRISC_success) return ret;
+
+	return jriscImageAddSection(image, "rom", ROM_BASE + ROM_HEADER_SIZE,
+								ROM_HEADER_SIZE,
+								image->size - ROM_HEADER_SIZE,
+								JRISC_SECTIONFLAG_CODE);
+}
+
+static enum JRISC_Error
+jriscImageParseRaw(struct JRISC_Image *image)
+{
+	return jriscImageAddSection(image, "raw", 0, 0, image->size,
+								JRISC_SECTIONFLAG_CODE);
+}
+
+static enum JRISC_Error
+jriscImageParse(struct JRISC_Image *image, enum JRISC_ImageFormat format)
+{
+	static const struct {
+		enum JRISC_ImageFormat format;
+		enum JRISC_Error (*parse)(struct JRISC_Image *image);
+	} parsers[] = {
+		{ JRISC_imageAout, jriscImageParseAout },
+		{ JRISC_imageCoff, jriscImageParseCoff },
+		{ JRISC_imageAbs, jriscImageParseAbs },
+		{ JRISC_imageRom, jriscImageParseRom },
+		{ JRISC_imageRaw, jriscImageParseRaw },
+	};
+	enum JRISC_Error ret;
+	unsigned i;
+
+	for (i = 0; i < sizeof(parsers) / sizeof(parsers[0]); i++) {
+		if ((format != JRISC_imageAuto) && (format != parsers[i].format)) {
+			continue;
+		}
+
+		ret = parsers[i].parse(image);
+
+		if (ret == JRISC_success) {
+			image->format = parsers[i].format;
+			return ret;
+		}
+
+		/* Discard anything a failed parser left behind and try the next */
+		free(image->sections);
+		image->sections = NULL;
+		image->numSections = 0;
+		image->entry = 0;
+		image->byteOrder = JRISC_bigEndian;
+		image->symbolOffset = image->symbolSize = 0;
+		image->stringOffset = image->stringSize = 0;
+
+		if (ret != JRISC_ERROR_invalidFormat) return ret;
+	}
+
+	return JRISC_ERROR_invalidFormat;
+}
+
+enum JRISC_Error
+jriscImageFromMemory(const void *data,
+					 size_t size,
+					 enum JRISC_ImageFormat format,
+					 struct JRISC_Image **imageOut)
+{
+	struct JRISC_Image *image = calloc(1, sizeof(*image));
+	enum JRISC_Error ret;
+
+	if (!image) return JRISC_ERROR_outOfMemory;
+
+	image->data = data;
+	image->size = size;
+	image->byteOrder = JRISC_bigEndian;
+
+	ret = jriscImageParse(image, format);
+	if (ret != JRISC_success) {
+		jriscImageDestroy(image);
+		return ret;
+	}
+
+	*imageOut = image;
+
+	return JRISC_success;
+}
+
+enum JRISC_Error
+jriscImageOpen(const char *fileName,
+			   enum JRISC_ImageFormat format,
+			   struct JRISC_Image **imageOut)
+{
+	struct JRISC_MappedFile *map;
+	enum JRISC_Error ret;
+
+	ret = jriscMapFile(fileName, &map);
+	if (ret != JRISC_success) return ret;
+
+	ret = jriscImageFromMemory(map->data, map->size, format, imageOut);
+	if (ret != JRISC_success) {
+		jriscUnmapFile(map);
+		return ret;
+	}
+
+	(*imageOut)->map = map;
+
+	return JRISC_success;
+}
+
+void
+jriscImageDestroy(struct JRISC_Image *image)
+{
+	if (!image) return;
+
+	jriscUnmapFile(image->map);
+	free(image->sections);
+	free(image);
+}
+
+const char *
+jriscImageFormatName(enum JRISC_ImageFormat format)
+{
+	switch (format) {
+	case JRISC_imageRaw:	return "raw";
+	case JRISC_imageAout:	return "a.out";
+	case JRISC_imageCoff:	return "coff";
+	case JRISC_imageAbs:	return "abs";
+	case JRISC_imageRom:	return "rom";
+	case JRISC_imageAuto:	return "auto";
+	default:				return "unknown";
+	}
+}
+
+const struct JRISC_Section *
+jriscImageFindSection(const struct JRISC_Image *image,
+					  const char *name)
+{
+	unsigned long index;
+	unsigned i;
+	char *end;
+
+	for (i = 0; i < image->numSections; i++) {
+		if (!strcmp(image->sections[i].name, name)) {
+			return &image->sections[i];
+		}
+	}
+
+	index = strtoul(name, &end, 0);
+	if (name[0] && !end[0] && (index < image->numSections)) {
+		return &image->sections[index];
+	}
+
+	return NULL;
+}
+
+enum JRISC_Error
+jriscImageSectionContext(const struct JRISC_Image *image,
+						 const struct JRISC_Section *section,
+						 struct JRISC_Context **contextOut)
+{
+	enum JRISC_Error ret;
+
+	if (section->flags & JRISC_SECTIONFLAG_BSS) return JRISC_ERROR_invalidValue;
+
+	ret = jriscContextFromMemory(&image->data[section->offset],
+								 (size_t)section->size,
+								 NULL, 0,
+								 section->address,
+								 contextOut);
+	if (ret != JRISC_success) return ret;
+
+	jriscContextSetByteOrder(*contextOut, image->byteOrder);
+
+	return JRISC_success;
+}
@@ -0,0 +1,100 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#ifndef JRISC_IMAGE_H_
+#define JRISC_IMAGE_H_
+
+#include "jrisc_base.h"
+#include "jrisc_ctx.h"
+#include "jrisc_map.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+enum JRISC_ImageFormat {
+	JRISC_imageRaw,			/* Headerless machine code */
+	JRISC_imageAout,		/* rmac/ALN BSD a.out object or executable */
+	JRISC_imageCoff,		/* ALN COFF executable */
+	JRISC_imageAbs,			/* DRI/Alcyon .abs executable */
+	JRISC_imageRom,			/* .j64/.rom cartridge image */
+
+	JRISC_imageAuto			/* Detect the format when opening */
+};
+
+#define JRISC_SECTIONFLAG_CODE				0x00000001
+#define JRISC_SECTIONFLAG_DATA				0x00000002
+#define JRISC_SECTIONFLAG_BSS				0x00000004
+
+struct JRISC_Section {
+	char name[16];
+	uint32_t address;
+	uint64_t offset;		/* Location in the image file */
+	uint64_t size;
+	uint32_t flags;
+};
+
+struct JRISC_Image {
+	enum JRISC_ImageFormat format;
+	enum JRISC_ByteOrder byteOrder;
+
+	const uint8_t *data;
+	uint64_t size;
+
+	uint32_t entry;
+
+	unsigned numSections;
+	struct JRISC_Section *sections;
+
+	/* Location of the symbol and string tables, if the format has them */
+	uint64_t symbolOffset;
+	uint64_t symbolSize;
+	uint64_t stringOffset;
+	uint64_t stringSize;
+
+	/* Private */
+	struct JRISC_MappedFile *map;
+};
+
+/*
+ * Memory-map a file and parse its section table. With JRISC_imageAuto, files
+ * not in a recognized container format are loaded as a single raw section at
+ * address 0.
+ */
+extern enum JRISC_Error
+jriscImageOpen(const char *fileName,
+			   enum JRISC_ImageFormat format,
+			   struct JRISC_Image **imageOut);
+
+/* As above, but the caller retains ownership of the memory */
+extern enum JRISC_Error
+jriscImageFromMemory(const void *data,
+					 size_t size,
+					 enum JRISC_ImageFormat format,
+					 struct JRISC_Image **imageOut);
+
+extern void
+jriscImageDestroy(struct JRISC_Image *image);
+
+extern const char *
+jriscImageFormatName(enum JRISC_ImageFormat format);
+
+/* Look up a section by name, or by decimal index if no name matches */
+extern const struct JRISC_Section *
+jriscImageFindSection(const struct JRISC_Image *image,
+					  const char *name);
+
+/*
+ * Create a read-only context over a section's bytes. Nothing is decoded until
+ * instructions are read from the context, and the bytes are paged in from the
+ * mapped file only as they're touched. The context must be destroyed before
+ * the image.
+ */
+extern enum JRISC_Error
+jriscImageSectionContext(const struct JRISC_Image *image,
+						 const struct JRISC_Section *section,
+						 struct JRISC_Context **contextOut);
+
+#endif /* JRISC_IMAGE_H_ */
@@ -0,0 +1,241 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_ctx.h"
+#include "jrisc_endian.h"
+#include "jrisc_index.h"
+#include "jrisc_inst.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INDEX_VERSION		1
+#define INDEX_HEADER_SIZE	24
+
+/* movei's opcode, as in jrisc_optable.h */
+#define MOVEI_OPCODE		38
+
+static const char indexMagic[8] = { 'J', 'R', 'I', 'S', 'C', 'I', 'D', 'X' };
+
+static unsigned
+jriscIndexSkip(const struct JRISC_Index *index, size_t k)
+{
+	return (index->skips[k / 4] >> ((k % 4) * 2)) & 3;
+}
+
+/*
+ * Read the instruction at the context's position, <offset> bytes into the
+ * region, and return its size, leaving the context just past it.
+ */
+static enum JRISC_Error
+jriscIndexStep(struct JRISC_Context *context,
+			   enum JRISC_CPU cpu,
+			   uint64_t offset,
+			   uint64_t size,
+			   unsigned *stepOut)
+{
+	struct JRISC_Instruction inst;
+	enum JRISC_Error err;
+	uint32_t address;
+	uint16_t word;
+
+	err = context->readWord(context, &word, &address);
+	if (err != JRISC_success) return err;
+
+	*stepOut = 2;
+
+	if (((word >> 10) == MOVEI_OPCODE) && ((offset + 6) <= (size & ~1ull)) &&
+		(jriscInstructionDecode(word, cpu, address, &inst) ==
+		 JRISC_success) &&
+		(inst.opName == JRISC_op_movei)) {
+		jriscContextSeek(context, context->readLocation + 4);
+		*stepOut = 6;
+	}
+
+	return JRISC_success;
+}
+
+enum JRISC_Error
+jriscIndexBuild(struct JRISC_Context *context,
+				uint64_t size,
+				enum JRISC_CPU cpu,
+				uint32_t interval,
+				struct JRISC_Index **indexOut)
+{
+	struct JRISC_Index *index;
+	enum JRISC_Error err;
+	uint64_t boundary = 0;
+	uint64_t checkpoint;
+	unsigned step;
+	size_t k;
+
+	if (!interval || (interval & 1)) return JRISC_ERROR_invalidValue;
+
+	index = calloc(1, sizeof(*index));
+	if (!index) return JRISC_ERROR_outOfMemory;
+
+	index->interval = interval;
+	index->size = size;
+	index->numCheckpoints = (size_t)(size ? ((size - 1) / interval + 1) : 0);
+	index->skips = calloc(index->numCheckpoints / 4 + 1, 1);
+	if (!index->skips) {
+		free(index);
+		return JRISC_ERROR_outOfMemory;
+	}
+
+	for (k = 0; k < index->numCheckpoints; k++) {
+		checkpoint = (uint64_t)k * interval;
+
+		while (boundary < checkpoint) {
+			err = jriscIndexStep(context, cpu, boundary, size, &step);
+			if (err != JRISC_success) {
+				jriscIndexDestroy(index);
+				return err;
+			}
+			boundary += step;
+		}
+
+		index->skips[k / 4] |= (uint8_t)(((boundary - checkpoint) / 2) <<
+										 ((k % 4) * 2));
+	}
+
+	*indexOut = index;
+
+	return JRISC_success;
+}
+
+void
+jriscIndexDestroy(struct JRISC_Index *index)
+{
+	if (!index) return;
+
+	free(index->skips);
+	free(index);
+}
+
+uint64_t
+jriscIndexCheckpoint(const struct JRISC_Index *index, uint64_t offset)
+{
+	size_t k;
+	uint64_t checkpoint;
+
+	if (!index->numCheckpoints) return 0;
+
+	k = (size_t)(offset / index->interval);
+	if (k >= index->numCheckpoints) k = index->numCheckpoints - 1;
+
+	/* A movei may straddle the checkpoint, putting its boundary past offset */
+	for (;;) {
+		checkpoint = (uint64_t)k * index->interval +
+			jriscIndexSkip(index, k) * 2;
+		if ((checkpoint <= offset) || !k) return checkpoint;
+		k--;
+	}
+}
+
+enum JRISC_Error
+jriscIndexSeek(const struct JRISC_Index *index,
+			   struct JRISC_Context *context,
+			   enum JRISC_CPU cpu,
+			   uint64_t offset)
+{
+	enum JRISC_Error err;
+	uint64_t boundary;
+	unsigned step;
+
+	if (offset >= (index->size & ~1ull)) return JRISC_ERROR_invalidValue;
+
+	boundary = jriscIndexCheckpoint(index, offset);
+
+	for (;;) {
+		jriscContextSeek(context, boundary);
+
+		err = jriscIndexStep(context, cpu, boundary, index->size, &step);
+		if (err != JRISC_success) return err;
+
+		if ((boundary + step) > offset) break;
+
+		boundary += step;
+	}
+
+	jriscContextSeek(context, boundary);
+
+	return JRISC_success;
+}
+
+enum JRISC_Error
+jriscIndexSave(const struct JRISC_Index *index,
+			   uint8_t **dataOut,
+			   size_t *sizeOut)
+{
+	const size_t skipsSize = (index->numCheckpoints + 3) / 4;
+	uint8_t *data = malloc(INDEX_HEADER_SIZE + skipsSize);
+
+	if (!data) return JRISC_ERROR_outOfMemory;
+
+	memcpy(data, indexMagic, sizeof(indexMagic));
+	jriscStoreLE16(&data[8], INDEX_VERSION);
+	jriscStoreLE16(&data[10], 0);
+	jriscStoreLE32(&data[12], index->interval);
+	jriscStoreLE32(&data[16], (uint32_t)index->size);
+	jriscStoreLE32(&data[20], (uint32_t)(index->size >> 32));
+	memcpy(&data[INDEX_HEADER_SIZE], index->skips, skipsSize);
+
+	*dataOut = data;
+	*sizeOut = INDEX_HEADER_SIZE + skipsSize;
+
+	return JRISC_success;
+}
+
+enum JRISC_Error
+jriscIndexLoad(const void *data,
+			   size_t size,
+			   struct JRISC_Index **indexOut)
+{
+	const uint8_t *bytes = data;
+	struct JRISC_Index *index;
+	size_t skipsSize;
+
+	if ((size < INDEX_HEADER_SIZE) ||
+		memcmp(bytes, indexMagic, sizeof(indexMagic)) ||
+		(jriscLoadLE16(&bytes[8]) != INDEX_VERSION)) {
+		return JRISC_ERROR_invalidFormat;
+	}
+
+	index = calloc(1, sizeof(*index));
+	if (!index) return JRISC_ERROR_outOfMemory;
+
+	index->interval = jriscLoadLE32(&bytes[12]);
+	index->size = jriscLoadLE32(&bytes[16]) |
+		((uint64_t)jriscLoadLE32(&bytes[20]) << 32);
+
+	if (!index->interval || (index->interval & 1)) {
+		free(index);
+		return JRISC_ERROR_invalidFormat;
+	}
+
+	index->numCheckpoints = (size_t)(index->size ?
+									 ((index->size - 1) / index->interval + 1) :
+									 0);
+	skipsSize = (index->numCheckpoints + 3) / 4;
+	if ((size - INDEX_HEADER_SIZE) != skipsSize) {
+		free(index);
+		return JRISC_ERROR_invalidFormat;
+	}
+
+	index->skips = malloc(skipsSize + 1);
+	if (!index->skips) {
+		free(index);
+		return JRISC_ERROR_outOfMemory;
+	}
+	memcpy(index->skips, &bytes[INDEX_HEADER_SIZE], skipsSize);
+
+	*indexOut = index;
+
+	return JRISC_success;
+}
@@ -0,0 +1,88 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#ifndef JRISC_INDEX_H_
+#define JRISC_INDEX_H_
+
+#include "jrisc_base.h"
+#include "jrisc_ctx.h"
+#include "jrisc_inst.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define JRISC_INDEX_DEFAULT_INTERVAL	4096
+
+/*
+ * Known instruction boundaries at regular intervals through a region of code,
+ * so decoding can start near any offset rather than at the beginning. Without
+ * one, there's no telling whether a word is an instruction or the value of a
+ * movei before it.
+ *
+ * Boundaries are those of a linear decode in which a word that doesn't decode,
+ * or a movei cut short by the end of the region, is a single-word entry, as in
+ * struct JRISC_Program. Since movei is the only instruction longer than a word,
+ * the first boundary at or after any offset is at most 4 bytes past it, so each
+ * checkpoint needs only two bits.
+ */
+struct JRISC_Index {
+	uint32_t interval;			/* Bytes between checkpoints. Even. */
+	uint64_t size;				/* Of the region, in bytes */
+
+	/*
+	 * Checkpoint k is the first boundary at or after k * interval. Its distance
+	 * past that, in words, is held in bits 2k and 2k+1 of this array.
+	 */
+	size_t numCheckpoints;
+	uint8_t *skips;
+};
+
+/*
+ * Read <size> bytes from the context's current read position and record a
+ * checkpoint every <interval> bytes. Only movei opcodes are decoded, so this
+ * costs little more than reading the words.
+ */
+extern enum JRISC_Error
+jriscIndexBuild(struct JRISC_Context *context,
+				uint64_t size,
+				enum JRISC_CPU cpu,
+				uint32_t interval,
+				struct JRISC_Index **indexOut);
+
+extern void
+jriscIndexDestroy(struct JRISC_Index *index);
+
+/* The offset of the last checkpoint at or before <offset> */
+extern uint64_t
+jriscIndexCheckpoint(const struct JRISC_Index *index, uint64_t offset);
+
+/*
+ * Move the context's read position to the start of the instruction containing
+ * <offset>, both relative to the start of the region the index was built
+ * from, which must be at location 0 of the context. At most one interval of
+ * words is read to get there.
+ */
+extern enum JRISC_Error
+jriscIndexSeek(const struct JRISC_Index *index,
+			   struct JRISC_Context *context,
+			   enum JRISC_CPU cpu,
+			   uint64_t offset);
+
+/*
+ * Flatten an index into bytes that can be stored, such as in the disassembly
+ * cache. The result is allocated with malloc.
+ */
+extern enum JRISC_Error
+jriscIndexSave(const struct JRISC_Index *index,
+			   uint8_t **dataOut,
+			   size_t *sizeOut);
+
+extern enum JRISC_Error
+jriscIndexLoad(const void *data,
+			   size_t size,
+			   struct JRISC_Index **indexOut);
+
+#endif /* JRISC_INDEX_H_ */
@@ -208,31 +208,56 @@ jriscNextInstruction(const struct JRISC_Instruction *current)
 	return ++current;
 }
 
+uint16_t
+jriscInstructionToRaw(const struct JRISC_Instruction *instruction)
+{
+	return ((uint16_t)instruction->opCode << JRISC_OPCODE_SHIFT) |
+		((uint16_t)jriscRegToRaw(&instruction->regSrc) << JRISC_REGSRC_SHIFT) |
+		(uint16_t)jriscRegToRaw(&instruction->regDst);
+}
+
 enum JRISC_Error
-jriscInstructionRead(struct JRISC_Context *context,
-					 enum JRISC_CPU cpu,
-					 struct JRISC_Instruction *instructionOut)
+jriscInstructionDecodeAs(enum JRISC_OpName opName,
+						 uint16_t raw,
+						 uint32_t address,
+						 struct JRISC_Instruction *instructionOut)
 {
-	const struct JRISC_Instruction *templates;
-	const struct JRISC_Instruction *match = NULL;
+	const struct JRISC_Instruction *match;
 	struct JRISC_Instruction out;
 	enum JRISC_Error ret;
-	uint32_t address;
-	uint16_t rawImmediate;
-	uint16_t raw;
-	uint8_t rawCode;
-	uint8_t rawSrc;
-	uint8_t rawDst;
 
-	ret = context->read(context, sizeof(raw), &raw, &address);
+	if (opName >= JRISC_invalidOpName) return JRISC_ERROR_invalidOpCode;
+
+	match = &jriscInstructionTable[opName];
+	out = *match;
+	out.address = address;
+
+	ret = jriscRegFromRaw((raw >> JRISC_REGSRC_SHIFT) & JRISC_REG_MASK,
+						  match->regSrc.type, &out.regSrc);
 	if (ret != JRISC_success) return ret;
 
-	/* XXX swap at appropriate times */
-	raw = (raw << 8) | (raw >> 8);
+	ret = jriscRegFromRaw(raw & JRISC_REG_MASK, match->regDst.type,
+						  &out.regDst);
+	if (ret != JRISC_success) return ret;
+
+	*instructionOut = out;
+
+	return ret;
+}
+
+enum JRISC_Error
+jriscInstructionDecode(uint16_t raw,
+					   enum JRISC_CPU cpu,
+					   uint32_t address,
+					   struct JRISC_Instruction *instructionOut)
+{
+	const struct JRISC_Instruction *templates;
+	const struct JRISC_Instruction *match = NULL;
+	uint8_t rawCode;
+	uint8_t rawSrc;
 
 	rawCode = raw >> JRISC_OPCODE_SHIFT;
 	rawSrc = (raw >> JRISC_REGSRC_SHIFT) & JRISC_REG_MASK;
-	rawDst = raw & JRISC_REG_MASK;
 
 	templates = jriscInstructionsFromOpCode(rawCode);
 	if (!templates) return JRISC_ERROR_invalidOpCode;
@@ -247,13 +272,25 @@ jriscInstructionRead(struct JRISC_Context *context,
 
 	if (!match) return JRISC_ERROR_invalidOpCode;
 
-	out = *match;
-	out.address = address;
+	return jriscInstructionDecodeAs(match->opName, raw, address,
+									instructionOut);
+}
 
-	ret = jriscRegFromRaw(rawSrc, match->regSrc.type, &out.regSrc);
+enum JRISC_Error
+jriscInstructionRead(struct JRISC_Context *context,
+					 enum JRISC_CPU cpu,
+					 struct JRISC_Instruction *instructionOut)
+{
+	struct JRISC_Instruction out;
+	enum JRISC_Error ret;
+	uint32_t address;
+	uint16_t rawImmediate;
+	uint16_t raw;
+
+	ret = context->readWord(context, &raw, &address);
 	if (ret != JRISC_success) return ret;
 
-	ret = jriscRegFromRaw(rawDst, match->regDst.type, &out.regDst);
+	ret = jriscInstructionDecode(raw, cpu, address, &out);
 	if (ret != JRISC_success) return ret;
 
 	/*
@@ -261,20 +298,14 @@ jriscInstructionRead(struct JRISC_Context *context,
 	 * "instruction" slots.
 	 */
 	if (out.opName == JRISC_op_movei) {
-		ret = context->read(context, sizeof(rawImmediate), &rawImmediate, NULL);
+		ret = context->readWord(context, &rawImmediate, NULL);
 		if (ret != JRISC_success) return ret;
 
-		/* XXX swap at appropriate times */
-		rawImmediate = (rawImmediate << 8) | (rawImmediate >> 8);
-
 		out.longImmediate = rawImmediate;
 
-		ret = context->read(context, sizeof(rawImmediate), &rawImmediate, NULL);
+		ret = context->readWord(context, &rawImmediate, NULL);
 		if (ret != JRISC_success) return ret;
 
-		/* XXX swap at appropriate times */
-		rawImmediate = (rawImmediate << 8) | (rawImmediate >> 8);
-
 		out.longImmediate |= (uint32_t)rawImmediate << 16;
 	}
 
@@ -100,6 +100,26 @@ jriscInstructionTable[];
 extern uint8_t
 jriscRegToRaw(const struct JRISC_OpReg *reg);
 
+extern uint16_t
+jriscInstructionToRaw(const struct JRISC_Instruction *instruction);
+
+/*
+ * Decode a single instruction word. For movei, the caller must fill in
+ * longImmediate from the two words that follow.
+ */
+extern enum JRISC_Error
+jriscInstructionDecode(uint16_t raw,
+					   enum JRISC_CPU cpu,
+					   uint32_t address,
+					   struct JRISC_Instruction *instructionOut);
+
+/* As above, but skip the opcode table search when opName is already known */
+extern enum JRISC_Error
+jriscInstructionDecodeAs(enum JRISC_OpName opName,
+						 uint16_t raw,
+						 uint32_t address,
+						 struct JRISC_Instruction *instructionOut);
+
 extern enum JRISC_Error
 jriscInstructionRead(struct JRISC_Context *context,
 					 enum JRISC_CPU cpu,
@@ -5,6 +5,7 @@
  */
 
 #include "jrisc_inst_string.h"
+#include "jrisc_sym.h"
 
 #include <stdlib.h>
 #include <stdio.h>
@@ -37,7 +38,8 @@ jriscOpNameToBaseRegString(enum JRISC_OpName opName) {
 	}
 }
 
-static const char *jriscOpNameToString(enum JRISC_OpName opName)
+const char *
+jriscOpNameToString(enum JRISC_OpName opName)
 {
 	/* Special case some outliers: */
 	switch (opName) {
@@ -61,6 +63,22 @@ static const char *jriscOpNameToString(enum JRISC_OpName opName)
 	}
 }
 
+const char *
+jriscConditionToString(uint8_t condition)
+{
+	switch (condition) {
+	case 0x0:	return "T";		/* True/Always */
+	case 0x1:	return "NE";	/* Not  Equal */
+	case 0x2:	return "EQ";	/* Equal */
+	case 0x4:	return "CC";	/* Carry Clear */
+	case 0x5:	return "HI";	/* Higher */
+	case 0x8:	return "CS";	/* Carry Set */
+	case 0x14:	return "PL";	/* Plus/Positive */
+	case 0x18:	return "MI";	/* Minus/Negative */
+	default:	return NULL;
+	}
+}
+
 /* Helper macro to build strings */
 #define ADD_STRING(...)													\
 	do {																\
@@ -71,6 +89,16 @@ static const char *jriscOpNameToString(enum JRISC_OpName opName)
 		outLength += tmpLength;											\
 	} while (0)
 
+/* Helper macro to print a symbolic address */
+#define ADD_SYMBOL(prefix, sym, offset)									\
+	do {																\
+		if (offset) {													\
+			ADD_STRING("%s%s+%" PRIu32, prefix, (sym)->name, offset);	\
+		} else {														\
+			ADD_STRING("%s%s", prefix, (sym)->name);					\
+		}																\
+	} while (0)
+
 static inline uint8_t
 jriscRegUnsignedValue(const struct JRISC_OpReg *reg)
 {
@@ -84,11 +112,15 @@ jriscRegToString(const struct JRISC_OpReg *reg,
 				 char *string,
 				 size_t *stringLengthInOut,
 				 uint32_t flags,
-				 uint32_t address)
+				 uint32_t address,
+				 const struct JRISC_SymbolTable *symbols)
 {
 	size_t stringLength = string ? *stringLengthInOut : 0;
+	const struct JRISC_Symbol *sym = NULL;
 	int outLength = 0;
 	bool visible = true;
+	uint32_t target;
+	uint32_t offset;
 
 	switch (reg->type) {
 	case JRISC_reg:
@@ -106,18 +138,12 @@ jriscRegToString(const struct JRISC_OpReg *reg,
 
 	case JRISC_condition:
 		assert(!baseIndirect);
-		switch (reg->val.condition) {
-		case 0x0:	visible = false;	/* True/Always */	break;
-		case 0x1:	ADD_STRING("NE");	/* Not  Equal */	break;
-		case 0x2:	ADD_STRING("EQ");	/* Equal */			break;
-		case 0x4:	ADD_STRING("CC");	/* Carry Clear */	break;
-		case 0x5:	ADD_STRING("HI");	/* Higher */		break;
-		case 0x8:	ADD_STRING("CS");	/* Carry Set */		break;
-		case 0x14:	ADD_STRING("PL");	/* Plus/Positive */	break;
-		case 0x18:	ADD_STRING("MI");	/* Minus/Negative */break;
-		default:
+		if (reg->val.condition == 0x0) {
+			visible = false;	/* True/Always */
+		} else if (jriscConditionToString(reg->val.condition)) {
+			ADD_STRING("%s", jriscConditionToString(reg->val.condition));
+		} else {
 			ADD_STRING("$%x", reg->val.condition);
-			break;
 		}
 		break;
 
@@ -147,8 +173,12 @@ jriscRegToString(const struct JRISC_OpReg *reg,
 
 	case JRISC_pcoffset:
 		assert(!baseIndirect);
-		if (flags & JRISC_STRINGFLAG_ADDRESS) {
-			ADD_STRING("$%x",(reg->val.simmediate + 1) * 2 + address);
+		target = (reg->val.simmediate + 1) * 2 + address;
+		if (symbols) sym = jriscSymbolTableLookup(symbols, target, &offset);
+		if (sym) {
+			ADD_SYMBOL("", sym, offset);
+		} else if (flags & JRISC_STRINGFLAG_ADDRESS) {
+			ADD_STRING("$%x", target);
 		} else {
 			ADD_STRING("*%+" PRId8, (reg->val.simmediate + 1) * 2);
 		}
@@ -173,6 +203,17 @@ jriscInstructionToString(const struct JRISC_Instruction *instruction,
 						 uint32_t flags,
 						 char *string,
 						 size_t *stringLengthInOut)
+{
+	jriscInstructionToStringSymbolic(instruction, flags, NULL,
+									 string, stringLengthInOut);
+}
+
+void
+jriscInstructionToStringSymbolic(const struct JRISC_Instruction *instruction,
+								 uint32_t flags,
+								 const struct JRISC_SymbolTable *symbols,
+								 char *string,
+								 size_t *stringLengthInOut)
 {
 	const char *reg1BaseIndirect =
 		jriscOpNameToBaseRegString(instruction->opName);
@@ -182,9 +223,11 @@ jriscInstructionToString(const struct JRISC_Instruction *instruction,
 	const char *opIndent = flags ? "" : "\t";
 	const char *opNameFmt = "%s%-8s";
 	size_t stringLength = string ? *stringLengthInOut : 0;
+	const struct JRISC_Symbol *sym = NULL;
 	size_t localLength;
 	int outLength = 0;
 	bool regVisible = true;
+	uint32_t offset;
 
 	if (instruction->swapRegs) {
 		reg1 = &instruction->regDst;
@@ -199,11 +242,7 @@ jriscInstructionToString(const struct JRISC_Instruction *instruction,
 	}
 
 	if (flags & JRISC_STRINGFLAG_MACHINE_CODE) {
-		uint16_t machineCode =
-			((uint16_t)instruction->opCode << JRISC_OPCODE_SHIFT) |
-			((uint16_t)jriscRegToRaw(&instruction->regSrc) <<
-			 JRISC_REGSRC_SHIFT) |
-			(uint16_t)jriscRegToRaw(&instruction->regDst);
+		uint16_t machineCode = jriscInstructionToRaw(instruction);
 
 		ADD_STRING("%s%02x%02x", opIndent,
 				   machineCode >> 8, (machineCode & 0xff));
@@ -231,7 +270,20 @@ jriscInstructionToString(const struct JRISC_Instruction *instruction,
 	ADD_STRING(opNameFmt, opIndent, jriscOpNameToString(instruction->opName));
 
 	if (instruction->opName == JRISC_op_movei) {
-		ADD_STRING("#$%x", instruction->longImmediate);
+		if (symbols) {
+			sym = jriscSymbolTableLookup(symbols, instruction->longImmediate,
+										 &offset);
+		}
+		/*
+		 * Unlike a jump target, a movei value may just be a number, so only
+		 * name it if it hits a symbol exactly or falls inside a known size.
+		 */
+		if (sym && offset && !sym->size) sym = NULL;
+		if (sym) {
+			ADD_SYMBOL("#", sym, offset);
+		} else {
+			ADD_STRING("#$%x", instruction->longImmediate);
+		}
 	} else if (instruction->opName == JRISC_op_movepc) {
 		ADD_STRING("pc");
 	} else {
@@ -241,7 +293,8 @@ jriscInstructionToString(const struct JRISC_Instruction *instruction,
 									  string,
 									  &localLength,
 									  flags,
-									  instruction->address);
+									  instruction->address,
+									  symbols);
 		localLength -= 1 /* For '\0' */;
 		string += localLength;
 		outLength += localLength;
@@ -257,7 +310,8 @@ jriscInstructionToString(const struct JRISC_Instruction *instruction,
 					 string,
 					 &localLength,
 					 flags,
-					 instruction->address);
+					 instruction->address,
+					 symbols);
 	localLength -= 1 /* For '\0' */;
 	string += localLength;
 	outLength += localLength;
@@ -271,11 +325,30 @@ enum JRISC_Error
 jriscInstructionPrint(const struct JRISC_Instruction *instruction,
 					  uint32_t flags)
 {
-	static char tempBuf[32];
+	return jriscInstructionPrintSymbolic(instruction, flags, NULL);
+}
+
+enum JRISC_Error
+jriscInstructionPrintSymbolic(const struct JRISC_Instruction *instruction,
+							  uint32_t flags,
+							  const struct JRISC_SymbolTable *symbols)
+{
+	return jriscInstructionFilePrintSymbolic(instruction, flags, symbols,
+											 stdout);
+}
+
+enum JRISC_Error
+jriscInstructionFilePrintSymbolic(const struct JRISC_Instruction *instruction,
+								  uint32_t flags,
+								  const struct JRISC_SymbolTable *symbols,
+								  FILE *fp)
+{
+	static char tempBuf[128];
 	char *outBuf = NULL;
 	size_t length = sizeof(tempBuf);
 
-	jriscInstructionToString(instruction, flags, tempBuf, &length);
+	jriscInstructionToStringSymbolic(instruction, flags, symbols,
+									 tempBuf, &length);
 
 	if (length > sizeof(tempBuf)) {
 		/*
@@ -287,12 +360,13 @@ jriscInstructionPrint(const struct JRISC_Instruction *instruction,
 			return JRISC_ERROR_outOfMemory;
 		}
 
-		jriscInstructionToString(instruction, flags, outBuf, &length);
+		jriscInstructionToStringSymbolic(instruction, flags, symbols,
+										 outBuf, &length);
 	} else {
 		outBuf = &tempBuf[0];
 	}
 
-	printf("%s\n", outBuf);
+	fprintf(fp, "%s\n", outBuf);
 
 	if (outBuf != &tempBuf[0]) {
 		free(outBuf);
@@ -9,12 +9,25 @@
 
 #include "jrisc_base.h"
 #include "jrisc_inst.h"
+#include "jrisc_sym.h"
 
 #include <stddef.h>
+#include <stdio.h>
 
 #define JRISC_STRINGFLAG_ADDRESS				0x000000001
 #define JRISC_STRINGFLAG_MACHINE_CODE			0x000000002
 
+/*
+ * The assembler mnemonic of an operation. Some are shared: the indexed load
+ * and store forms are all "load" and "store", and movepc is "move".
+ */
+extern const char *
+jriscOpNameToString(enum JRISC_OpName opName);
+
+/* Returns NULL for condition codes with no assembler mnemonic */
+extern const char *
+jriscConditionToString(uint8_t condition);
+
 extern void
 jriscInstructionToString(const struct JRISC_Instruction *instruction,
 						 uint32_t flags,
@@ -25,4 +38,26 @@ extern enum JRISC_Error
 jriscInstructionPrint(const struct JRISC_Instruction *instruction,
 					  uint32_t flags);
 
+/*
+ * As above, but print branch targets and movei values that fall within a
+ * symbol as <symbol>[+<offset>]. The table must be finalized.
+ */
+extern void
+jriscInstructionToStringSymbolic(const struct JRISC_Instruction *instruction,
+								 uint32_t flags,
+								 const struct JRISC_SymbolTable *symbols,
+								 char *string,
+								 size_t *stringLengthInOut);
+
+extern enum JRISC_Error
+jriscInstructionPrintSymbolic(const struct JRISC_Instruction *instruction,
+							  uint32_t flags,
+							  const struct JRISC_SymbolTable *symbols);
+
+extern enum JRISC_Error
+jriscInstructionFilePrintSymbolic(const struct JRISC_Instruction *instruction,
+								  uint32_t flags,
+								  const struct JRISC_SymbolTable *symbols,
+								  FILE *fp);
+
 #endif /* JRISC_INST_STRING_H_ */
@@ -0,0 +1,400 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_ctx.h"
+#include "jrisc_inst.h"
+#include "jrisc_inst_string.h"
+#include "jrisc_listing.h"
+#include "jrisc_sym.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define BITMAP_WORDS(bits) (((bits) + 31) / 32)
+#define BITMAP_SET(map, bit) ((map)[(bit) / 32] |= 1u << ((bit) % 32))
+#define BITMAP_TEST(map, bit) (((map)[(bit) / 32] >> ((bit) % 32)) & 1)
+
+struct Listing {
+	struct JRISC_Context *context;
+	uint64_t startLocation;
+	uint64_t size;
+	uint64_t numWords;
+	uint32_t base;
+	enum JRISC_CPU cpu;
+
+	/* One bit per 16-bit word of the image */
+	uint32_t *targets;
+	uint32_t *boundaries;
+
+	/* Every jr target and movei value seen, for finding used symbols */
+	uint32_t *references;
+	size_t numReferences;
+	size_t maxReferences;
+};
+
+static bool
+jriscListingWordIndex(const struct Listing *l,
+					  uint32_t address,
+					  uint64_t *indexOut)
+{
+	uint64_t offset = (uint64_t)address - l->base;
+
+	if ((address < l->base) || (offset >= (l->numWords * 2)) || (offset & 1)) {
+		return false;
+	}
+
+	*indexOut = offset / 2;
+
+	return true;
+}
+
+/*
+ * Decode the next item in the image: Either an instruction that will re-encode
+ * to exactly the same words, or a single data word.
+ */
+static enum JRISC_Error
+jriscListingNext(struct Listing *l,
+				 uint64_t wordIndex,
+				 struct JRISC_Instruction *inst,
+				 uint16_t *raw,
+				 unsigned *numWords)
+{
+	struct JRISC_Context *ctx = l->context;
+	uint32_t address;
+	uint16_t immediate;
+	enum JRISC_Error ret;
+
+	*numWords = 1;
+
+	ret = ctx->readWord(ctx, raw, &address);
+	if (ret != JRISC_success) return ret;
+
+	inst->opName = JRISC_invalidOpName;
+
+	if (jriscInstructionDecode(*raw, l->cpu, address, inst) != JRISC_success) {
+		goto data;
+	}
+
+	/* Encodings with ignored bits set can't be reproduced from mnemonics */
+	if (jriscInstructionToRaw(inst) != *raw) goto data;
+
+	if ((inst->regDst.type == JRISC_condition) &&
+		!jriscConditionToString(inst->regDst.val.condition)) {
+		goto data;
+	}
+
+	if (inst->opName == JRISC_op_movei) {
+		if ((l->numWords - wordIndex) < 3) goto data;
+
+		ret = ctx->readWord(ctx, &immediate, NULL);
+		if (ret != JRISC_success) return ret;
+		inst->longImmediate = immediate;
+
+		ret = ctx->readWord(ctx, &immediate, NULL);
+		if (ret != JRISC_success) return ret;
+		inst->longImmediate |= (uint32_t)immediate << 16;
+
+		*numWords = 3;
+	}
+
+	return JRISC_success;
+
+data:
+	inst->opName = JRISC_invalidOpName;
+
+	return JRISC_success;
+}
+
+static bool
+jriscListingOperand(const struct JRISC_Instruction *inst, uint32_t *valueOut)
+{
+	if (inst->opName == JRISC_op_jr) {
+		*valueOut = inst->address + (inst->regSrc.val.simmediate + 1) * 2;
+		return true;
+	}
+
+	if (inst->opName == JRISC_op_movei) {
+		*valueOut = inst->longImmediate;
+		return true;
+	}
+
+	return false;
+}
+
+static enum JRISC_Error
+jriscListingAddReference(struct Listing *l, uint32_t value)
+{
+	uint32_t *references;
+	size_t maxReferences;
+
+	if (l->numReferences == l->maxReferences) {
+		maxReferences = l->maxReferences ? l->maxReferences * 2 : 1024;
+		references = realloc(l->references,
+							 maxReferences * sizeof(*references));
+		if (!references) return JRISC_ERROR_outOfMemory;
+		l->references = references;
+		l->maxReferences = maxReferences;
+	}
+
+	l->references[l->numReferences++] = value;
+
+	return JRISC_success;
+}
+
+static enum JRISC_Error
+jriscListingFindTargets(struct Listing *l)
+{
+	struct JRISC_Instruction inst;
+	uint64_t w;
+	uint64_t target;
+	uint32_t value;
+	uint16_t raw;
+	unsigned numWords;
+	enum JRISC_Error ret;
+
+	for (w = 0; w < l->numWords; w += numWords) {
+		ret = jriscListingNext(l, w, &inst, &raw, &numWords);
+		if (ret != JRISC_success) return ret;
+
+		BITMAP_SET(l->boundaries, w);
+
+		if (!jriscListingOperand(&inst, &value)) continue;
+
+		ret = jriscListingAddReference(l, value);
+		if (ret != JRISC_success) return ret;
+
+		if (jriscListingWordIndex(l, value, &target)) {
+			BITMAP_SET(l->targets, target);
+		}
+	}
+
+	return JRISC_success;
+}
+
+/*
+ * A symbol with no size covers everything up to the next one, however far
+ * away. Keep those inside the image from reaching past its end, and only let
+ * those outside it, such as hardware register equates, match exactly.
+ */
+static enum JRISC_Error
+jriscListingAddSymbol(const struct Listing *l,
+					  struct JRISC_SymbolTable *labels,
+					  const struct JRISC_Symbol *sym)
+{
+	uint64_t offset = (uint64_t)sym->address - l->base;
+	uint32_t size = sym->size;
+
+	if (!size) {
+		if ((sym->address < l->base) || (offset >= l->size)) size = 1;
+		else size = (uint32_t)(l->size - offset);
+	}
+
+	return jriscSymbolTableAdd(labels, sym->name, sym->address, size);
+}
+
+/*
+ * Merge the caller's symbols with a generated label for each target that
+ * starts an instruction. Both inputs are already in address order, so this is
+ * a linear merge and the final sort is skipped.
+ */
+static enum JRISC_Error
+jriscListingBuildLabels(struct Listing *l,
+						const struct JRISC_SymbolTable *symbols,
+						struct JRISC_SymbolTable *labels)
+{
+	char name[16];
+	unsigned s = 0;
+	uint64_t w;
+	uint32_t address;
+	enum JRISC_Error ret;
+	const unsigned numSymbols = symbols ? symbols->count : 0;
+
+	for (w = 0; w < l->numWords; w++) {
+		if (!BITMAP_TEST(l->targets, w) || !BITMAP_TEST(l->boundaries, w)) {
+			continue;
+		}
+
+		address = l->base + (uint32_t)(w * 2);
+
+		for (; (s < numSymbols) && (symbols->symbols[s].address <= address);
+			 s++) {
+			ret = jriscListingAddSymbol(l, labels, &symbols->symbols[s]);
+			if (ret != JRISC_success) return ret;
+		}
+
+		/* Existing symbols win, via de-duplication in the symbol table */
+		snprintf(name, sizeof(name), "L%06x", address);
+		ret = jriscSymbolTableAdd(labels, name, address, 0);
+		if (ret != JRISC_success) return ret;
+	}
+
+	for (; s < numSymbols; s++) {
+		ret = jriscListingAddSymbol(l, labels, &symbols->symbols[s]);
+		if (ret != JRISC_success) return ret;
+	}
+
+	return jriscSymbolTableFinalize(labels);
+}
+
+static bool
+jriscListingIsPlaced(const struct Listing *l, const struct JRISC_Symbol *sym)
+{
+	uint64_t w;
+
+	return jriscListingWordIndex(l, sym->address, &w) &&
+		BITMAP_TEST(l->boundaries, w);
+}
+
+/* Define any referenced symbols that won't appear as a label */
+static enum JRISC_Error
+jriscListingWriteEquates(struct Listing *l,
+						 const struct JRISC_SymbolTable *labels,
+						 FILE *fp)
+{
+	const struct JRISC_Symbol *sym;
+	uint32_t *used;
+	size_t i;
+	unsigned index;
+	bool any = false;
+
+	used = calloc(BITMAP_WORDS(labels->count) + 1, sizeof(*used));
+	if (!used) return JRISC_ERROR_outOfMemory;
+
+	for (i = 0; i < l->numReferences; i++) {
+		sym = jriscSymbolTableLookup(labels, l->references[i], NULL);
+		if (sym && !jriscListingIsPlaced(l, sym)) {
+			BITMAP_SET(used, (unsigned)(sym - labels->symbols));
+		}
+	}
+
+	for (index = 0; index < labels->count; index++) {
+		if (!BITMAP_TEST(used, index)) continue;
+		fprintf(fp, "%s\tequ\t$%x\n", labels->symbols[index].name,
+				labels->symbols[index].address);
+		any = true;
+	}
+
+	if (any) fprintf(fp, "\n");
+
+	free(used);
+
+	return JRISC_success;
+}
+
+static enum JRISC_Error
+jriscListingWriteCode(struct Listing *l,
+					  const struct JRISC_SymbolTable *labels,
+					  FILE *fp)
+{
+	struct JRISC_Instruction inst;
+	char buf[256];
+	char *line;
+	size_t length;
+	unsigned s = 0;
+	uint64_t w;
+	uint32_t address;
+	uint16_t raw;
+	unsigned numWords;
+	enum JRISC_Error ret;
+
+	for (w = 0; w < l->numWords; w += numWords) {
+		address = l->base + (uint32_t)(w * 2);
+
+		while ((s < labels->count) &&
+			   (labels->symbols[s].address < address)) {
+			s++;
+		}
+		if ((s < labels->count) && (labels->symbols[s].address == address)) {
+			fprintf(fp, "%s:\n", labels->symbols[s].name);
+		}
+
+		ret = jriscListingNext(l, w, &inst, &raw, &numWords);
+		if (ret != JRISC_success) return ret;
+
+		if (inst.opName == JRISC_invalidOpName) {
+			fprintf(fp, "\tdc.w    $%04x\n", raw);
+			continue;
+		}
+
+		length = sizeof(buf);
+		jriscInstructionToStringSymbolic(&inst, 0, labels, buf, &length);
+
+		if (length > sizeof(buf)) {
+			line = malloc(length);
+			if (!line) return JRISC_ERROR_outOfMemory;
+			jriscInstructionToStringSymbolic(&inst, 0, labels, line, &length);
+			fprintf(fp, "%s\n", line);
+			free(line);
+		} else {
+			fprintf(fp, "%s\n", buf);
+		}
+	}
+
+	return JRISC_success;
+}
+
+enum JRISC_Error
+jriscListingWrite(struct JRISC_Context *context,
+				  uint64_t size,
+				  enum JRISC_CPU cpu,
+				  const struct JRISC_SymbolTable *symbols,
+				  FILE *fp)
+{
+	struct Listing l;
+	struct JRISC_SymbolTable *labels = NULL;
+	uint8_t oddByte;
+	enum JRISC_Error ret;
+
+	memset(&l, 0, sizeof(l));
+	l.context = context;
+	l.startLocation = context->readLocation;
+	l.base = context->readAddress;
+	l.size = size;
+	l.numWords = size / 2;
+	l.cpu = cpu;
+
+	l.targets = calloc(BITMAP_WORDS(l.numWords) + 1, sizeof(uint32_t));
+	l.boundaries = calloc(BITMAP_WORDS(l.numWords) + 1, sizeof(uint32_t));
+	if (!l.targets || !l.boundaries) {
+		ret = JRISC_ERROR_outOfMemory;
+		goto done;
+	}
+
+	ret = jriscListingFindTargets(&l);
+	if (ret != JRISC_success) goto done;
+
+	ret = jriscSymbolTableCreate(&labels);
+	if (ret != JRISC_success) goto done;
+
+	ret = jriscListingBuildLabels(&l, symbols, labels);
+	if (ret != JRISC_success) goto done;
+
+	fprintf(fp, "\t%s\n", (cpu == JRISC_dsp) ? ".dsp" : ".gpu");
+	fprintf(fp, "\t.org\t$%x\n\n", l.base);
+
+	ret = jriscListingWriteEquates(&l, labels, fp);
+	if (ret != JRISC_success) goto done;
+
+	jriscContextSeek(context, l.startLocation);
+
+	ret = jriscListingWriteCode(&l, labels, fp);
+	if (ret != JRISC_success) goto done;
+
+	if (size & 1) {
+		ret = context->read(context, 1, &oddByte, NULL);
+		if (ret != JRISC_success) goto done;
+		fprintf(fp, "\tdc.b    $%02x\n", oddByte);
+	}
+
+done:
+	jriscSymbolTableDestroy(labels);
+	free(l.references);
+	free(l.boundaries);
+	free(l.targets);
+
+	return ret;
+}
@@ -0,0 +1,39 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#ifndef JRISC_LISTING_H_
+#define JRISC_LISTING_H_
+
+#include "jrisc_base.h"
+#include "jrisc_ctx.h"
+#include "jrisc_inst.h"
+#include "jrisc_sym.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Write a labeled listing of <size> bytes of code, starting at the context's
+ * current read position, that rmac will assemble back into identical bytes.
+ *
+ * The first pass records every jr target and every movei value that lands on
+ * an instruction in the image in a bitmap. The second generates a label at
+ * each, prints branch and movei operands symbolically, and falls back to dc.w
+ * for any word that doesn't decode to an instruction which would re-encode
+ * identically. Both passes are linear in the size of the image.
+ *
+ * Symbols from the optional table are used in preference to generated
+ * labels. Any referenced symbols that can't be placed as labels are defined
+ * with equ.
+ */
+extern enum JRISC_Error
+jriscListingWrite(struct JRISC_Context *context,
+				  uint64_t size,
+				  enum JRISC_CPU cpu,
+				  const struct JRISC_SymbolTable *symbols,
+				  FILE *fp);
+
+#endif /* JRISC_LISTING_H_ */
@@ -0,0 +1,216 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_cfg.h"
+#include "jrisc_live.h"
+#include "jrisc_program.h"
+#include "jrisc_regs.h"
+
+#include <stdlib.h>
+
+/* Step backward over one instruction */
+static inline JRISC_RegMask
+jriscLiveTransfer(const struct JRISC_Instruction *instruction,
+				  JRISC_RegMask live)
+{
+	JRISC_RegMask reads;
+	JRISC_RegMask writes;
+
+	jriscInstructionRegMasks(instruction, &reads, &writes);
+
+	return (live & ~(writes & ~JRISC_REGMASK_PARTIAL)) | reads;
+}
+
+enum JRISC_Error
+jriscLivenessCompute(const struct JRISC_Program *program,
+					 struct JRISC_Liveness **liveOut)
+{
+	struct JRISC_Liveness *live;
+	const struct JRISC_Cfg *cfg;
+	const struct JRISC_Block *block;
+	JRISC_RegMask *use = NULL;
+	JRISC_RegMask *kill = NULL;
+	uint32_t *predStart = NULL;
+	uint32_t *predFill = NULL;
+	uint32_t *preds = NULL;
+	uint32_t *stack = NULL;
+	uint8_t *queued = NULL;
+	JRISC_RegMask reads, writes, in, out;
+	size_t numBlocks, numStack;
+	size_t b, e, i;
+	uint32_t s;
+	enum JRISC_Error ret = JRISC_ERROR_outOfMemory;
+
+	live = calloc(1, sizeof(*live));
+	if (!live) return JRISC_ERROR_outOfMemory;
+
+	live->program = program;
+	if (jriscCfgBuild(program, &live->cfg) != JRISC_success) goto done;
+	cfg = live->cfg;
+	numBlocks = cfg->numBlocks;
+
+	live->liveIn = calloc(numBlocks + 1, sizeof(*live->liveIn));
+	live->liveOut = calloc(numBlocks + 1, sizeof(*live->liveOut));
+	use = calloc(numBlocks + 1, sizeof(*use));
+	kill = calloc(numBlocks + 1, sizeof(*kill));
+	predStart = calloc(numBlocks + 1, sizeof(*predStart));
+	predFill = calloc(numBlocks + 1, sizeof(*predFill));
+	preds = malloc((cfg->numEdges + 1) * sizeof(*preds));
+	stack = malloc((numBlocks + 1) * sizeof(*stack));
+	queued = malloc(numBlocks + 1);
+	if (!live->liveIn || !live->liveOut || !use || !kill || !predStart ||
+		!predFill || !preds || !stack || !queued) {
+		goto done;
+	}
+
+	/* Summarize each block, and count its predecessors */
+	for (b = 0; b < numBlocks; b++) {
+		block = &cfg->blocks[b];
+
+		for (i = block->first + block->count; i-- > block->first;) {
+			jriscInstructionRegMasks(&program->instructions[i],
+									 &reads, &writes);
+			writes &= ~JRISC_REGMASK_PARTIAL;
+			use[b] = (use[b] & ~writes) | reads;
+			kill[b] |= writes;
+		}
+
+		for (e = 0; e < block->numSuccessors; e++) {
+			predFill[cfg->edges[block->firstSuccessor + e]]++;
+		}
+	}
+
+	for (b = 0, s = 0; b < numBlocks; b++) {
+		predStart[b] = s;
+		s += predFill[b];
+		predFill[b] = predStart[b];
+	}
+	predStart[numBlocks] = s;
+
+	for (b = 0; b < numBlocks; b++) {
+		block = &cfg->blocks[b];
+
+		for (e = 0; e < block->numSuccessors; e++) {
+			s = cfg->edges[block->firstSuccessor + e];
+			preds[predFill[s]++] = (uint32_t)b;
+		}
+	}
+
+	/* Start from the end, so most blocks see their successors' sets first */
+	for (b = 0; b < numBlocks; b++) {
+		stack[b] = (uint32_t)b;
+		queued[b] = 1;
+	}
+	numStack = numBlocks;
+
+	while (numStack) {
+		b = stack[--numStack];
+		queued[b] = 0;
+		block = &cfg->blocks[b];
+
+		out = (block->flags & JRISC_BLOCKFLAG_UNKNOWN_EXIT) ?
+			JRISC_REGMASK_ALL : 0;
+		for (e = 0; e < block->numSuccessors; e++) {
+			out |= live->liveIn[cfg->edges[block->firstSuccessor + e]];
+		}
+		live->liveOut[b] = out;
+
+		in = use[b] | (out & ~kill[b]);
+		if (in == live->liveIn[b]) continue;
+		live->liveIn[b] = in;
+
+		for (i = predStart[b]; i < predStart[b + 1]; i++) {
+			if (!queued[preds[i]]) {
+				queued[preds[i]] = 1;
+				stack[numStack++] = preds[i];
+			}
+		}
+	}
+
+	ret = JRISC_success;
+
+done:
+	free(queued);
+	free(stack);
+	free(preds);
+	free(predFill);
+	free(predStart);
+	free(kill);
+	free(use);
+
+	if (ret != JRISC_success) {
+		jriscLivenessDestroy(live);
+	} else {
+		*liveOut = live;
+	}
+
+	return ret;
+}
+
+void
+jriscLivenessDestroy(struct JRISC_Liveness *live)
+{
+	if (!live) return;
+
+	jriscCfgDestroy(live->cfg);
+	free(live->liveIn);
+	free(live->liveOut);
+	free(live);
+}
+
+void
+jriscLivenessAtIndex(const struct JRISC_Liveness *live,
+					 size_t index,
+					 JRISC_RegMask *liveInOut,
+					 JRISC_RegMask *liveOutOut)
+{
+	const uint32_t b = jriscCfgFindBlock(live->cfg, index);
+	const struct JRISC_Block *block = &live->cfg->blocks[b];
+	JRISC_RegMask mask = live->liveOut[b];
+	size_t i;
+
+	for (i = block->first + block->count - 1; i > index; i--) {
+		mask = jriscLiveTransfer(&live->program->instructions[i], mask);
+	}
+
+	if (liveOutOut) *liveOutOut = mask;
+	if (liveInOut) {
+		*liveInOut = jriscLiveTransfer(&live->program->instructions[index],
+									   mask);
+	}
+}
+
+void
+jriscLivenessBlock(const struct JRISC_Liveness *live,
+				   size_t blockIndex,
+				   JRISC_RegMask *liveOuts)
+{
+	const struct JRISC_Block *block = &live->cfg->blocks[blockIndex];
+	JRISC_RegMask mask = live->liveOut[blockIndex];
+	size_t i;
+
+	for (i = block->count; i-- > 0;) {
+		liveOuts[i] = mask;
+		mask = jriscLiveTransfer(&live->program->instructions[block->first + i],
+								 mask);
+	}
+}
+
+enum JRISC_Error
+jriscLivenessAt(const struct JRISC_Liveness *live,
+				uint32_t address,
+				JRISC_RegMask *liveInOut,
+				JRISC_RegMask *liveOutOut)
+{
+	const uint32_t index = jriscProgramFind(live->program, address);
+
+	if (index == JRISC_PROGRAM_NO_INSTRUCTION) return JRISC_ERROR_notFound;
+
+	jriscLivenessAtIndex(live, index, liveInOut, liveOutOut);
+
+	return JRISC_success;
+}
@@ -0,0 +1,71 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#ifndef JRISC_LIVE_H_
+#define JRISC_LIVE_H_
+
+#include "jrisc_base.h"
+#include "jrisc_cfg.h"
+#include "jrisc_program.h"
+#include "jrisc_regs.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Which registers, flags, etc. may still be read before they are next
+ * written, at the start and end of every basic block.
+ *
+ * Everything is assumed live wherever control leaves for somewhere unknown,
+ * such as a jump (rN). Bits in JRISC_REGMASK_PARTIAL are never killed.
+ */
+struct JRISC_Liveness {
+	const struct JRISC_Program *program;
+	struct JRISC_Cfg *cfg;
+
+	/* Indexed by block */
+	JRISC_RegMask *liveIn;
+	JRISC_RegMask *liveOut;
+};
+
+/*
+ * Build the program's control flow graph and solve liveness over it with a
+ * backward worklist. Each block's sets only grow, so each block is revisited
+ * at most once per bit, and the whole pass is linear in the program's size.
+ *
+ * <program> must outlive the result.
+ */
+extern enum JRISC_Error
+jriscLivenessCompute(const struct JRISC_Program *program,
+					 struct JRISC_Liveness **liveOut);
+
+extern void
+jriscLivenessDestroy(struct JRISC_Liveness *live);
+
+/* What is live just before and just after instruction <index> runs */
+extern void
+jriscLivenessAtIndex(const struct JRISC_Liveness *live,
+					 size_t index,
+					 JRISC_RegMask *liveInOut,
+					 JRISC_RegMask *liveOutOut);
+
+/*
+ * What is live just after each instruction of block <blockIndex>, in one
+ * pass. <liveOuts> must have room for the block's count.
+ */
+extern void
+jriscLivenessBlock(const struct JRISC_Liveness *live,
+				   size_t blockIndex,
+				   JRISC_RegMask *liveOuts);
+
+/* As above, by address. Returns JRISC_ERROR_notFound outside the program. */
+extern enum JRISC_Error
+jriscLivenessAt(const struct JRISC_Liveness *live,
+				uint32_t address,
+				JRISC_RegMask *liveInOut,
+				JRISC_RegMask *liveOutOut);
+
+#endif /* JRISC_LIVE_H_ */
@@ -0,0 +1,211 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_ctx_compressed.h"
+#include "jrisc_map.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+static enum JRISC_Error
+jriscReadWholeFile(const char *fileName, struct JRISC_MappedFile *map)
+{
+	FILE *fp = fopen(fileName, "rb");
+	uint8_t *buf = NULL;
+	uint8_t *newBuf;
+	size_t capacity = 0;
+	size_t size = 0;
+	size_t got;
+
+	if (!fp) return JRISC_ERROR_ioError;
+
+	do {
+		if (size == capacity) {
+			capacity = capacity ? capacity * 2 : 64 * 1024;
+			newBuf = realloc(buf, capacity);
+			if (!newBuf) {
+				free(buf);
+				fclose(fp);
+				return JRISC_ERROR_outOfMemory;
+			}
+			buf = newBuf;
+		}
+
+		got = fread(&buf[size], 1, capacity - size, fp);
+		size += got;
+	} while (got);
+
+	if (ferror(fp)) {
+		free(buf);
+		fclose(fp);
+		return JRISC_ERROR_ioError;
+	}
+
+	fclose(fp);
+
+	map->data = buf;
+	map->size = size;
+	map->mapped = false;
+
+	return JRISC_success;
+}
+
+#if defined(_WIN32)
+static bool
+jriscMapFileOS(const char *fileName, struct JRISC_MappedFile *map)
+{
+	HANDLE file;
+	HANDLE mapping;
+	LARGE_INTEGER size;
+	void *data;
+
+	file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, NULL,
+					   OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) return false;
+
+	if (!GetFileSizeEx(file, &size) || (size.QuadPart == 0) ||
+		((uint64_t)size.QuadPart > SIZE_MAX)) {
+		CloseHandle(file);
+		return false;
+	}
+
+	mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(file);
+	if (!mapping) return false;
+
+	data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	if (!data) return false;
+
+	map->data = data;
+	map->size = (size_t)size.QuadPart;
+	map->mapped = true;
+
+	return true;
+}
+
+static void
+jriscUnmapFileOS(struct JRISC_MappedFile *map)
+{
+	UnmapViewOfFile((void *)map->data);
+}
+#else
+static bool
+jriscMapFileOS(const char *fileName, struct JRISC_MappedFile *map)
+{
+	struct stat st;
+	void *data;
+	int fd = open(fileName, O_RDONLY);
+
+	if (fd < 0) return false;
+
+	if (fstat(fd, &st) || !S_ISREG(st.st_mode) || (st.st_size == 0) ||
+		((uint64_t)st.st_size > SIZE_MAX)) {
+		close(fd);
+		return false;
+	}
+
+	data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) return false;
+
+	map->data = data;
+	map->size = (size_t)st.st_size;
+	map->mapped = true;
+
+	return true;
+}
+
+static void
+jriscUnmapFileOS(struct JRISC_MappedFile *map)
+{
+	munmap((void *)map->data, map->size);
+}
+#endif
+
+/* Replace a gzip or xz compressed file's data with what it decompresses to */
+static enum JRISC_Error
+jriscDecompressMappedFile(struct JRISC_MappedFile *map)
+{
+	enum JRISC_Compression compression;
+	uint8_t *data;
+	size_t size;
+	enum JRISC_Error ret;
+
+	compression = jriscCompressionDetect(map->data, map->size);
+	if (!jriscCompressionSupported(compression)) return JRISC_success;
+
+	ret = jriscDecompress(map->data, map->size, compression,
+						  JRISC_DECOMPRESS_MAX_SIZE, &data, &size);
+
+	/* Just happened to look like it was compressed */
+	if (ret == JRISC_ERROR_invalidFormat) return JRISC_success;
+	if (ret != JRISC_success) return ret;
+
+	if (map->mapped) {
+		jriscUnmapFileOS(map);
+	} else {
+		free((void *)map->data);
+	}
+
+	map->data = data;
+	map->size = size;
+	map->mapped = false;
+
+	return JRISC_success;
+}
+
+enum JRISC_Error
+jriscMapFile(const char *fileName,
+			 struct JRISC_MappedFile **mapOut)
+{
+	struct JRISC_MappedFile *map = calloc(1, sizeof(*map));
+	enum JRISC_Error ret;
+
+	if (!map) return JRISC_ERROR_outOfMemory;
+
+	if (!jriscMapFileOS(fileName, map)) {
+		ret = jriscReadWholeFile(fileName, map);
+		if (ret != JRISC_success) {
+			free(map);
+			return ret;
+		}
+	}
+
+	ret = jriscDecompressMappedFile(map);
+	if (ret != JRISC_success) {
+		jriscUnmapFile(map);
+		return ret;
+	}
+
+	*mapOut = map;
+
+	return JRISC_success;
+}
+
+void
+jriscUnmapFile(struct JRISC_MappedFile *map)
+{
+	if (!map) return;
+
+	if (map->mapped) {
+		jriscUnmapFileOS(map);
+	} else {
+		free((void *)map->data);
+	}
+
+	free(map);
+}
@@ -0,0 +1,37 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#ifndef JRISC_MAP_H_
+#define JRISC_MAP_H_
+
+#include "jrisc_base.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+struct JRISC_MappedFile {
+	const uint8_t *data;
+	size_t size;
+
+	/* Private */
+	bool mapped;
+};
+
+/*
+ * Map a whole file read-only. Files that can't be memory-mapped, such as pipes,
+ * are read into an allocated buffer instead, so callers needn't care which
+ * method was used. A gzip or xz compressed file is recognized by its magic
+ * number and decompressed, if the library was built with zlib or liblzma.
+ */
+extern enum JRISC_Error
+jriscMapFile(const char *fileName,
+			 struct JRISC_MappedFile **mapOut);
+
+extern void
+jriscUnmapFile(struct JRISC_MappedFile *map);
+
+#endif /* JRISC_MAP_H_ */
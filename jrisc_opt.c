@@ -0,0 +1,847 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_cfg.h"
+#include "jrisc_const.h"
+#include "jrisc_inst.h"
+#include "jrisc_live.h"
+#include "jrisc_opt.h"
+#include "jrisc_program.h"
+#include "jrisc_regs.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+enum OptAction {
+	ACTION_KEEP,
+	ACTION_DELETE,
+	ACTION_MOVEQ,			/* Re-encode a movei as a moveq */
+	ACTION_SWAP				/* Move after the branch that follows it */
+};
+
+/* Rough cycles before a result can be used without a stall */
+#define OPT_LOAD_LATENCY	3
+#define OPT_DIV_LATENCY		16
+
+/* The most instructions scheduled at once, as dependencies are quadratic */
+#define OPT_SCHEDULE_WINDOW	64
+
+/* An instruction in the window being scheduled */
+struct OptNode {
+	uint32_t index;
+	JRISC_RegMask reads;
+	JRISC_RegMask writes;
+	JRISC_RegMask deadWrites;	/* Flags overwritten before they are read */
+	unsigned latency;
+	unsigned height;			/* Longest path of latencies to the end */
+	unsigned numPreds;			/* Not yet scheduled */
+	unsigned earliest;			/* Cycle its operands are ready */
+	bool scheduled;
+};
+
+struct OptScheduler {
+	const struct JRISC_Program *program;
+	const struct JRISC_Liveness *live;
+	const struct JRISC_ConstProp *constProp;
+	const uint8_t *targets;
+	uint32_t rules;
+	uint8_t *actions;
+	uint32_t *schedule;			/* The new order of the instructions */
+	JRISC_RegMask *liveOuts;	/* By instruction, in the current block */
+	struct JRISC_OptReport *report;
+	size_t stallsSaved;
+
+	struct OptNode nodes[OPT_SCHEDULE_WINDOW];
+
+	/* The latency of each dependency from an earlier node to a later one */
+	uint8_t edges[OPT_SCHEDULE_WINDOW][OPT_SCHEDULE_WINDOW];
+};
+
+static const char *jriscOptRuleNames[] = {
+	"moveq",
+	"move",
+	"dead",
+	"delay",
+	"sched",
+};
+
+const char *
+jriscOptRuleName(enum JRISC_OptRule rule)
+{
+	if (rule >= JRISC_optNumRules) return NULL;
+
+	return jriscOptRuleNames[rule];
+}
+
+static bool
+jriscOptIsInstructionStart(const struct JRISC_Program *program,
+						   uint32_t address,
+						   uint32_t *indexOut)
+{
+	const uint32_t index = jriscProgramFind(program, address);
+
+	if ((index == JRISC_PROGRAM_NO_INSTRUCTION) ||
+		(program->instructions[index].address != address)) {
+		return false;
+	}
+
+	*indexOut = index;
+
+	return true;
+}
+
+/* Mark every instruction something else can jump to or point at */
+static void
+jriscOptMarkTargets(const struct JRISC_Program *program, uint8_t *targets)
+{
+	const struct JRISC_Instruction *inst;
+	uint32_t index;
+	size_t i;
+
+	for (i = 0; i < program->numInstructions; i++) {
+		inst = &program->instructions[i];
+
+		if ((inst->opName == JRISC_op_jr) &&
+			jriscOptIsInstructionStart(program,
+									   jriscInstructionBranchTarget(inst),
+									   &index)) {
+			targets[index] = 1;
+		} else if ((inst->opName == JRISC_op_movei) &&
+				   jriscOptIsInstructionStart(program, inst->longImmediate,
+											  &index)) {
+			targets[index] = 1;
+		}
+	}
+}
+
+/* Whether deleting an instruction can only matter through what it writes */
+static bool
+jriscOptIsPure(const struct JRISC_Instruction *instruction,
+			   JRISC_RegMask reads,
+			   JRISC_RegMask writes)
+{
+	switch (instruction->opName) {
+	case JRISC_op_div:			/* Also writes the remainder register */
+	case JRISC_op_jump:
+	case JRISC_op_jr:
+	case JRISC_invalidOpName:
+		return false;
+
+	default:
+		break;
+	}
+
+	return writes && !(writes & JRISC_REGMASK_PARTIAL) &&
+		!(reads & JRISC_REGMASK_MEMORY);
+}
+
+static void
+jriscOptChoose(const struct JRISC_Program *program,
+			   const struct JRISC_Liveness *live,
+			   const uint8_t *targets,
+			   uint32_t rules,
+			   uint8_t *actions,
+			   struct JRISC_OptReport *report)
+{
+	const struct JRISC_Instruction *insts = program->instructions;
+	const size_t n = program->numInstructions;
+	const struct JRISC_Instruction *inst;
+	JRISC_RegMask reads, writes, branchReads, liveOut;
+	bool inDelaySlot;
+	size_t i, k;
+
+	for (i = 0; i < n; i++) {
+		inst = &insts[i];
+		inDelaySlot = i && jriscInstructionIsBranch(&insts[i - 1]);
+
+		if (inst->opName == JRISC_invalidOpName) continue;
+
+		jriscInstructionRegMasks(inst, &reads, &writes);
+
+		if ((rules & JRISC_OPT_RULE(JRISC_optSelfMove)) && !inDelaySlot &&
+			(inst->opName == JRISC_op_move) &&
+			(inst->regSrc.val.reg == inst->regDst.val.reg)) {
+			actions[i] = ACTION_DELETE;
+			report->applied[JRISC_optSelfMove]++;
+			continue;
+		}
+
+		if ((rules & JRISC_OPT_RULE(JRISC_optDeadCode)) && !inDelaySlot &&
+			jriscOptIsPure(inst, reads, writes)) {
+			jriscLivenessAtIndex(live, i, NULL, &liveOut);
+			if (!(writes & liveOut)) {
+				actions[i] = ACTION_DELETE;
+				report->applied[JRISC_optDeadCode]++;
+				continue;
+			}
+		}
+
+		if ((rules & JRISC_OPT_RULE(JRISC_optMoveiToMoveq)) &&
+			(inst->opName == JRISC_op_movei) &&
+			(inst->longImmediate <= JRISC_REG_MASK) &&
+			!jriscProgramContains(program, inst->longImmediate)) {
+			actions[i] = ACTION_MOVEQ;
+			report->applied[JRISC_optMoveiToMoveq]++;
+		}
+	}
+
+	/* The scheduler fills delay slots itself */
+	if (!(rules & JRISC_OPT_RULE(JRISC_optFillDelaySlot)) ||
+		(rules & JRISC_OPT_RULE(JRISC_optSchedule))) {
+		return;
+	}
+
+	/*
+	 * Hoist the instruction before a branch into its empty delay slot. Neither
+	 * may be a jump target, or code entering between them would change, and
+	 * the instruction mustn't change anything the branch tests.
+	 */
+	for (i = 1; (i + 1) < n; i++) {
+		inst = &insts[i];
+
+		if (!jriscInstructionIsBranch(inst) ||
+			(insts[i + 1].opName != JRISC_op_nop) ||
+			(actions[i + 1] != ACTION_KEEP) ||
+			(actions[i - 1] != ACTION_KEEP) ||
+			targets[i] || targets[i - 1] ||
+			((i >= 2) && jriscInstructionIsBranch(&insts[i - 2]))) {
+			continue;
+		}
+
+		switch (insts[i - 1].opName) {
+		case JRISC_op_jump:			/* Fall through */
+		case JRISC_op_jr:			/* Fall through */
+		case JRISC_op_movei:		/* Fall through */
+		case JRISC_op_nop:			/* Fall through */
+		case JRISC_invalidOpName:
+			continue;
+
+		default:
+			break;
+		}
+
+		jriscInstructionRegMasks(inst, &branchReads, &writes);
+		jriscInstructionRegMasks(&insts[i - 1], &reads, &writes);
+		if (writes & branchReads) continue;
+
+		/* A deleted target's label moves on to the instruction after it */
+		for (k = i - 1; (k > 0) && (actions[k - 1] == ACTION_DELETE) &&
+			 !targets[k - 1]; k--) {
+		}
+		if ((k > 0) && (actions[k - 1] == ACTION_DELETE)) continue;
+
+		actions[i - 1] = ACTION_SWAP;
+		actions[i + 1] = ACTION_DELETE;
+		report->applied[JRISC_optFillDelaySlot]++;
+		i++;
+	}
+}
+
+/*
+ * Rough cycles from issuing an instruction until its result can be used
+ * without a stall. Loads from local RAM take a couple of ticks more than the
+ * ALU, and longer from main memory; div takes 16.
+ */
+static unsigned
+jriscOptLatency(const struct JRISC_Instruction *inst)
+{
+	switch (inst->opName) {
+	case JRISC_op_loadb:		/* Fall through */
+	case JRISC_op_loadw:		/* Fall through */
+	case JRISC_op_load:			/* Fall through */
+	case JRISC_op_loadp:		/* Fall through */
+	case JRISC_op_loadr14n:		/* Fall through */
+	case JRISC_op_loadr14r:		/* Fall through */
+	case JRISC_op_loadr15n:		/* Fall through */
+	case JRISC_op_loadr15r:
+		return OPT_LOAD_LATENCY;
+
+	case JRISC_op_div:
+		return OPT_DIV_LATENCY;
+
+	default:
+		return 1;
+	}
+}
+
+/*
+ * Whether a store might be to the flags register, switching register banks
+ * under every instruction around it. Only a long store can reach it.
+ */
+static bool
+jriscOptIsBarrier(const struct JRISC_Program *program,
+				  const struct JRISC_ConstProp *constProp,
+				  size_t index)
+{
+	uint32_t address;
+
+	switch (program->instructions[index].opName) {
+	case JRISC_op_store:		/* Fall through */
+	case JRISC_op_storer14n:	/* Fall through */
+	case JRISC_op_storer14r:	/* Fall through */
+	case JRISC_op_storer15n:	/* Fall through */
+	case JRISC_op_storer15r:
+		break;
+
+	default:
+		return false;
+	}
+
+	return !jriscConstPropAddress(constProp, index, &address) ||
+		(address == ((program->cpu == JRISC_dsp) ? JRISC_DSP_FLAGS :
+					 JRISC_GPU_FLAGS));
+}
+
+static void
+jriscOptNodeInit(struct OptScheduler *s, struct OptNode *node, uint32_t index)
+{
+	const struct JRISC_Instruction *inst = &s->program->instructions[index];
+	const JRISC_RegMask liveOut = s->liveOuts[index];
+
+	memset(node, 0, sizeof(*node));
+	node->index = index;
+	node->latency = jriscOptLatency(inst);
+
+	if (jriscOptIsBarrier(s->program, s->constProp, index)) {
+		node->reads = node->writes = JRISC_REGMASK_ALL;
+		return;
+	}
+
+	jriscInstructionRegMasks(inst, &node->reads, &node->writes);
+
+	/* The remainder is read back through memory */
+	if (inst->opName == JRISC_op_div) node->writes |= JRISC_REGMASK_MEMORY;
+
+	/*
+	 * Flags overwritten before anything reads them only need to stay out of
+	 * the stretches where someone else's flags are live, so they don't order
+	 * instructions that all throw their flags away.
+	 */
+	node->deadWrites = node->writes & JRISC_REGMASK_FLAGS & ~liveOut;
+	node->writes &= ~node->deadWrites;
+}
+
+/* Fill in the latency of every edge between the first <n> nodes */
+static void
+jriscOptBuildEdges(struct OptScheduler *s, unsigned n)
+{
+	const struct OptNode *a, *b;
+	unsigned i, j;
+
+	memset(s->edges, 0, sizeof(s->edges));
+
+	for (i = 0; i < n; i++) {
+		a = &s->nodes[i];
+
+		for (j = i + 1; j < n; j++) {
+			b = &s->nodes[j];
+
+			if (a->writes & b->reads) {
+				s->edges[i][j] = (uint8_t)a->latency;
+			} else if ((a->reads & (b->writes | b->deadWrites)) ||
+					   (a->writes & (b->writes | b->deadWrites)) ||
+					   (a->deadWrites & (b->reads | b->writes))) {
+				s->edges[i][j] = 1;
+			}
+		}
+	}
+}
+
+/* The stall cycles of running nodes in <order> */
+static unsigned
+jriscOptStalls(const struct OptScheduler *s, const uint8_t *order, unsigned n)
+{
+	unsigned start[OPT_SCHEDULE_WINDOW];
+	unsigned stalls = 0;
+	unsigned t = 0;
+	unsigned i, k, ready;
+
+	for (k = 0; k < n; k++) {
+		ready = t;
+		for (i = 0; i < k; i++) {
+			if (s->edges[order[i]][order[k]] &&
+				((start[i] + s->edges[order[i]][order[k]]) > ready)) {
+				ready = start[i] + s->edges[order[i]][order[k]];
+			}
+		}
+
+		stalls += ready - t;
+		start[k] = ready;
+		t = ready + 1;
+	}
+
+	return stalls;
+}
+
+/* The longest path of latencies from each node to the end of the window */
+static void
+jriscOptHeights(struct OptScheduler *s, unsigned n)
+{
+	struct OptNode *node;
+	unsigned i, j;
+
+	for (i = n; i-- > 0;) {
+		node = &s->nodes[i];
+		node->height = node->latency;
+
+		for (j = i + 1; j < n; j++) {
+			if (s->edges[i][j] &&
+				((s->edges[i][j] + s->nodes[j].height) > node->height)) {
+				node->height = s->edges[i][j] + s->nodes[j].height;
+			}
+		}
+	}
+}
+
+/*
+ * Order the first <n> nodes, less any marked as scheduled already, into
+ * <order>. At each cycle the node whose operands are ready soonest goes next,
+ * breaking ties by the longest path of latencies still to follow it, then by
+ * the original order.
+ */
+static unsigned
+jriscOptListSchedule(struct OptScheduler *s, unsigned n, uint8_t *order)
+{
+	struct OptNode *node;
+	unsigned count = 0;
+	unsigned t = 0;
+	unsigned i, j, best, when, bestWhen = 0;
+
+	for (i = 0; i < n; i++) {
+		node = &s->nodes[i];
+		node->earliest = 0;
+		node->numPreds = 0;
+
+		for (j = 0; j < i; j++) {
+			if (s->edges[j][i] && !s->nodes[j].scheduled) node->numPreds++;
+		}
+	}
+
+	for (;;) {
+		best = n;
+		for (i = 0; i < n; i++) {
+			node = &s->nodes[i];
+			if (node->scheduled || node->numPreds) continue;
+
+			when = (node->earliest > t) ? node->earliest : t;
+			if ((best == n) || (when < bestWhen) ||
+				((when == bestWhen) &&
+				 (node->height > s->nodes[best].height))) {
+				best = i;
+				bestWhen = when;
+			}
+		}
+		if (best == n) break;
+
+		s->nodes[best].scheduled = true;
+		order[count++] = (uint8_t)best;
+		t = bestWhen + 1;
+
+		for (j = best + 1; j < n; j++) {
+			if (!s->edges[best][j]) continue;
+
+			s->nodes[j].numPreds--;
+			if ((bestWhen + s->edges[best][j]) > s->nodes[j].earliest) {
+				s->nodes[j].earliest = bestWhen + s->edges[best][j];
+			}
+		}
+	}
+
+	return count;
+}
+
+/*
+ * Whether node <x> of a block ending at <branch> can move into the branch's
+ * empty delay slot: nothing after it in the block reads or writes what it
+ * does, except flags it throws away that are dead after the slot too, and
+ * it is neither a target nor something that can't sit in a delay slot.
+ */
+static bool
+jriscOptCanFillSlot(const struct OptScheduler *s,
+					unsigned x,
+					unsigned branch,
+					JRISC_RegMask slotLiveOut)
+{
+	const struct OptNode *a = &s->nodes[x];
+	const struct OptNode *b;
+	unsigned j;
+
+	if (s->targets[a->index] || (a->deadWrites & slotLiveOut)) return false;
+
+	switch (s->program->instructions[a->index].opName) {
+	case JRISC_op_movei:
+		if (s->actions[a->index] == ACTION_MOVEQ) break;
+		/* Fall through */
+	case JRISC_op_jump:			/* Fall through */
+	case JRISC_op_jr:			/* Fall through */
+	case JRISC_op_nop:			/* Fall through */
+	case JRISC_invalidOpName:
+		return false;
+
+	default:
+		break;
+	}
+
+	for (j = x + 1; j <= branch; j++) {
+		b = &s->nodes[j];
+
+		if ((a->writes & (b->reads | b->writes | b->deadWrites)) ||
+			(a->reads & (b->writes | b->deadWrites))) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Reorder instructions [first, last] of a block. If <branch> isn't
+ * JRISC_PROGRAM_NO_INSTRUCTION, it is the block's jump or jr, which must stay
+ * at the end followed by <slot>, and <last> is the slot.
+ */
+static void
+jriscOptScheduleWindow(struct OptScheduler *s,
+					   uint32_t first,
+					   uint32_t last,
+					   uint32_t branch)
+{
+	const struct JRISC_Instruction *insts = s->program->instructions;
+	uint8_t before[OPT_SCHEDULE_WINDOW] = { 0 };
+	uint8_t after[OPT_SCHEDULE_WINDOW] = { 0 };
+	unsigned n = 0;
+	unsigned numBody, numAfter;
+	unsigned b = 0;
+	unsigned pinned;
+	unsigned fill;
+	unsigned i, stallsBefore, stallsAfter;
+	uint32_t slot = JRISC_PROGRAM_NO_INSTRUCTION;	/* An empty one */
+	uint32_t k, pos;
+
+	for (k = first; k <= last; k++) {
+		if (s->actions[k] == ACTION_DELETE) continue;
+
+		if (k == branch) {
+			b = n;
+		} else if ((branch != JRISC_PROGRAM_NO_INSTRUCTION) && (k > branch) &&
+				   (insts[k].opName == JRISC_op_nop)) {
+			slot = k;
+			continue;
+		}
+
+		jriscOptNodeInit(s, &s->nodes[n++], k);
+	}
+
+	numBody = (branch == JRISC_PROGRAM_NO_INSTRUCTION) ? n : b;
+	if (!numBody) return;
+
+	jriscOptBuildEdges(s, n);
+
+	/*
+	 * An entry point in the middle of a block must stay at its start. If it
+	 * was deleted, its label goes to the next survivor, which stays instead.
+	 */
+	pinned = s->targets[first] ? 1 : 0;
+	if (pinned) {
+		for (i = 1; i < n; i++) {
+			if (!s->edges[0][i]) s->edges[0][i] = 1;
+		}
+	}
+
+	for (i = 0; i < n; i++) before[i] = (uint8_t)i;
+	stallsBefore = jriscOptStalls(s, before, n);
+
+	/* The branch and any slot stay where they are */
+	for (i = numBody; i < n; i++) s->nodes[i].scheduled = true;
+
+	jriscOptHeights(s, n);
+
+	/* Find the least urgent instruction that can go in an empty slot */
+	fill = n;
+	if ((slot != JRISC_PROGRAM_NO_INSTRUCTION) && !s->targets[slot] &&
+		(s->rules & JRISC_OPT_RULE(JRISC_optFillDelaySlot))) {
+		for (i = pinned; i < numBody; i++) {
+			if (jriscOptCanFillSlot(s, i, b, s->liveOuts[slot]) &&
+				((fill == n) ||
+				 (s->nodes[i].height <= s->nodes[fill].height))) {
+				fill = i;
+			}
+		}
+		if (fill < n) s->nodes[fill].scheduled = true;
+	}
+
+	numAfter = jriscOptListSchedule(s, n, after);
+	for (i = numBody; i < n; i++) after[numAfter++] = (uint8_t)i;
+	if (fill < n) after[numAfter++] = (uint8_t)fill;
+
+	stallsAfter = jriscOptStalls(s, after, numAfter);
+
+	/* Unless it saves something, keep everything else in its place */
+	if (stallsAfter >= stallsBefore) {
+		if (fill == n) return;
+
+		for (i = 0, numAfter = 0; i < n; i++) {
+			if (i != fill) after[numAfter++] = (uint8_t)i;
+		}
+		after[numAfter++] = (uint8_t)fill;
+		stallsAfter = jriscOptStalls(s, after, numAfter);
+	}
+
+	if (fill < n) {
+		s->actions[slot] = ACTION_DELETE;
+		s->report->applied[JRISC_optFillDelaySlot]++;
+	}
+
+	if (stallsAfter < stallsBefore) {
+		s->report->applied[JRISC_optSchedule]++;
+		s->stallsSaved += stallsBefore - stallsAfter;
+	}
+
+	pos = first;
+	for (i = 0; i < numAfter; i++) {
+		s->schedule[pos++] = s->nodes[after[i]].index;
+	}
+	if ((fill == n) && (slot != JRISC_PROGRAM_NO_INSTRUCTION)) {
+		s->schedule[pos++] = slot;
+	}
+	for (k = first; k <= last; k++) {
+		if (s->actions[k] == ACTION_DELETE) s->schedule[pos++] = k;
+	}
+}
+
+/*
+ * Schedule every basic block, in windows of at most OPT_SCHEDULE_WINDOW
+ * instructions that don't span a jr or movei target. A block's branch and
+ * delay slot go in its last window.
+ */
+static void
+jriscOptSchedule(struct OptScheduler *s)
+{
+	const struct JRISC_Cfg *cfg = s->live->cfg;
+	const struct JRISC_Block *block;
+	uint32_t first, end, bodyEnd, k;
+	uint32_t branch;
+	size_t b;
+
+	for (b = 0; b < cfg->numBlocks; b++) {
+		block = &cfg->blocks[b];
+		first = block->first;
+		end = first + block->count;
+
+		jriscLivenessBlock(s->live, b, &s->liveOuts[first]);
+
+		branch = JRISC_PROGRAM_NO_INSTRUCTION;
+		if ((block->count >= 2) &&
+			jriscInstructionIsBranch(&s->program->instructions[end - 2])) {
+			branch = end - 2;
+		} else if (jriscInstructionIsBranch(
+					   &s->program->instructions[end - 1])) {
+			branch = end - 1;
+		}
+
+		/* A branch in a delay slot is left alone */
+		if ((branch != JRISC_PROGRAM_NO_INSTRUCTION) && (branch > first) &&
+			jriscInstructionIsBranch(&s->program->instructions[branch - 1])) {
+			continue;
+		}
+
+		bodyEnd = (branch == JRISC_PROGRAM_NO_INSTRUCTION) ? end : branch;
+
+		while (first < bodyEnd) {
+			for (k = first + 1; (k < bodyEnd) && !s->targets[k] &&
+				 ((k - first) < (OPT_SCHEDULE_WINDOW - 2)); k++) {
+			}
+
+			if ((k == bodyEnd) && (branch != JRISC_PROGRAM_NO_INSTRUCTION) &&
+				!s->targets[branch]) {
+				jriscOptScheduleWindow(s, first, end - 1, branch);
+			} else {
+				jriscOptScheduleWindow(s, first, k - 1,
+									   JRISC_PROGRAM_NO_INSTRUCTION);
+			}
+
+			first = k;
+		}
+	}
+}
+
+enum JRISC_Error
+jriscOptimize(const struct JRISC_Program *program,
+			  uint32_t rules,
+			  struct JRISC_Program **optimizedOut,
+			  struct JRISC_OptReport *report)
+{
+	const struct JRISC_Instruction *insts = program->instructions;
+	const size_t n = program->numInstructions;
+	struct JRISC_Liveness *live = NULL;
+	struct JRISC_ConstProp *constProp = NULL;
+	struct OptScheduler *scheduler = NULL;
+	struct JRISC_OptReport localReport;
+	struct JRISC_Instruction inst;
+	uint8_t *targets = NULL;
+	uint8_t *actions = NULL;
+	uint32_t *schedule = NULL;		/* Old indices, reordered within blocks */
+	uint32_t *order = NULL;			/* New position -> old index */
+	uint32_t *newIndex = NULL;		/* Old index -> new position */
+	uint32_t *newAddress = NULL;	/* By new position, plus the end */
+	uint16_t *words = NULL;
+	size_t numOrder = 0;
+	size_t numWords = 0;
+	size_t i, k;
+	uint32_t address, target, old;
+	int32_t offset;
+	bool usesPc = false;
+	enum JRISC_Error ret = JRISC_ERROR_outOfMemory;
+
+	if (!report) report = &localReport;
+	memset(report, 0, sizeof(*report));
+	report->bytesBefore = report->bytesAfter = program->numWords * 2;
+
+	for (i = 0; i < n; i++) {
+		if (insts[i].opName == JRISC_op_movepc) usesPc = true;
+	}
+
+	targets = calloc(n + 1, 1);
+	actions = calloc(n + 1, 1);
+	schedule = malloc((n + 1) * sizeof(*schedule));
+	order = malloc((n + 1) * sizeof(*order));
+	newIndex = malloc((n + 1) * sizeof(*newIndex));
+	newAddress = malloc((n + 1) * sizeof(*newAddress));
+	words = malloc((program->numWords + 1) * sizeof(*words));
+	if (!targets || !actions || !schedule || !order || !newIndex ||
+		!newAddress || !words) {
+		goto done;
+	}
+
+	for (i = 0; i < n; i++) schedule[i] = (uint32_t)i;
+
+	if (!usesPc) {
+		ret = jriscLivenessCompute(program, &live);
+		if (ret != JRISC_success) goto done;
+		ret = JRISC_ERROR_outOfMemory;
+
+		jriscOptMarkTargets(program, targets);
+		jriscOptChoose(program, live, targets, rules, actions, report);
+	}
+
+	if (!usesPc && (rules & JRISC_OPT_RULE(JRISC_optSchedule))) {
+		ret = jriscConstPropCompute(program, &constProp);
+		if (ret != JRISC_success) goto done;
+		ret = JRISC_ERROR_outOfMemory;
+
+		scheduler = calloc(1, sizeof(*scheduler));
+		if (!scheduler) goto done;
+
+		scheduler->liveOuts = malloc((n + 1) * sizeof(JRISC_RegMask));
+		if (!scheduler->liveOuts) goto done;
+
+		scheduler->program = program;
+		scheduler->live = live;
+		scheduler->constProp = constProp;
+		scheduler->targets = targets;
+		scheduler->rules = rules;
+		scheduler->actions = actions;
+		scheduler->schedule = schedule;
+		scheduler->report = report;
+		jriscOptSchedule(scheduler);
+	}
+
+	/* Lay out the new program */
+	for (i = 0; i < n; i++) {
+		old = schedule[i];
+
+		if (actions[old] == ACTION_SWAP) {
+			order[numOrder++] = old + 1;
+			order[numOrder++] = old;
+			i++;
+		} else if (actions[old] != ACTION_DELETE) {
+			order[numOrder++] = old;
+		}
+	}
+
+	for (i = 0; i < n; i++) newIndex[i] = (uint32_t)numOrder;
+	for (k = 0, address = program->baseAddress; k < numOrder; k++) {
+		newIndex[order[k]] = (uint32_t)k;
+		newAddress[k] = address;
+		address += (actions[order[k]] == ACTION_MOVEQ) ? 2 :
+			jriscProgramInstructionSize(&insts[order[k]]);
+	}
+	newAddress[numOrder] = address;
+
+	/* Anything that pointed at a deleted instruction gets the next one */
+	for (i = n; i-- > 0;) {
+		if ((newIndex[i] == numOrder) && ((i + 1) < n)) {
+			newIndex[i] = newIndex[i + 1];
+		}
+	}
+
+	/* Re-encode, with every code address mapped to its new location */
+	for (k = 0; k < numOrder; k++) {
+		old = order[k];
+		inst = insts[old];
+
+		if (inst.opName == JRISC_invalidOpName) {
+			words[numWords++] = jriscProgramRaw(program, old);
+			continue;
+		}
+
+		if (actions[old] == ACTION_MOVEQ) {
+			words[numWords++] = (uint16_t)
+				((jriscInstructionTable[JRISC_op_moveq].opCode <<
+				  JRISC_OPCODE_SHIFT) |
+				 (inst.longImmediate << JRISC_REGSRC_SHIFT) |
+				 inst.regDst.val.reg);
+			continue;
+		}
+
+		if (inst.opName == JRISC_op_jr) {
+			target = jriscInstructionBranchTarget(&inst);
+			if (jriscOptIsInstructionStart(program, target, &old)) {
+				target = newAddress[newIndex[old]];
+			}
+
+			offset = ((int32_t)(target - newAddress[k]) - 2) / 2;
+			if ((offset < -16) || (offset > 15)) {
+				ret = JRISC_ERROR_invalidValue;
+				goto done;
+			}
+			inst.regSrc.val.simmediate = (int8_t)offset;
+		} else if ((inst.opName == JRISC_op_movei) &&
+				   jriscOptIsInstructionStart(program, inst.longImmediate,
+											  &old)) {
+			inst.longImmediate = newAddress[newIndex[old]];
+		}
+
+		words[numWords++] = jriscInstructionToRaw(&inst);
+		if (inst.opName == JRISC_op_movei) {
+			words[numWords++] = jriscInstructionLongImmediateLow(&inst);
+			words[numWords++] = jriscInstructionLongImmediateHigh(&inst);
+		}
+	}
+
+	ret = jriscProgramFromWords(words, numWords, program->baseAddress,
+								program->cpu, optimizedOut);
+	if (ret != JRISC_success) goto done;
+
+	report->bytesAfter = numWords * 2;
+	report->cyclesSaved = program->numWords - numWords;
+	if (scheduler) report->cyclesSaved += scheduler->stallsSaved;
+
+done:
+	if (scheduler) free(scheduler->liveOuts);
+	free(scheduler);
+	jriscConstPropDestroy(constProp);
+	jriscLivenessDestroy(live);
+	free(words);
+	free(newAddress);
+	free(newIndex);
+	free(order);
+	free(schedule);
+	free(actions);
+	free(targets);
+
+	return ret;
+}
@@ -0,0 +1,65 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#ifndef JRISC_OPT_H_
+#define JRISC_OPT_H_
+
+#include "jrisc_base.h"
+#include "jrisc_program.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+enum JRISC_OptRule {
+	JRISC_optMoveiToMoveq,		/* movei #0-31, rN -> moveq */
+	JRISC_optSelfMove,			/* Delete move rN, rN */
+	JRISC_optDeadCode,			/* Delete instructions whose results die */
+	JRISC_optFillDelaySlot,		/* X; jr/jump; nop -> jr/jump; X */
+	JRISC_optSchedule,			/* Reorder blocks to avoid stalls */
+	JRISC_optNumRules
+};
+
+#define JRISC_OPT_RULE(rule)	(1u << (rule))
+#define JRISC_OPT_ALL_RULES		((1u << JRISC_optNumRules) - 1)
+
+struct JRISC_OptReport {
+	size_t applied[JRISC_optNumRules];
+	size_t bytesBefore;
+	size_t bytesAfter;
+
+	/*
+	 * An estimate: one cycle for each instruction word no longer executed,
+	 * plus the load and div stalls the scheduler avoids within blocks
+	 */
+	size_t cyclesSaved;
+};
+
+/*
+ * Apply the selected peephole rules to a program, each guarded by register
+ * liveness, and return the re-encoded result. jr offsets, and movei values
+ * that hold the address of an instruction in the program, are adjusted for
+ * any code that moved.
+ *
+ * With JRISC_optSchedule, each basic block is reordered by a list scheduler,
+ * which also does the work of JRISC_optFillDelaySlot if that is selected,
+ * filling a delay slot with any instruction in the block that can move there
+ * rather than only the one before the branch.
+ *
+ * Code that computes addresses some other way can't be adjusted, so a program
+ * that uses movepc is returned unchanged. Returns JRISC_ERROR_invalidValue if
+ * a jr out of the program would end up out of range.
+ */
+extern enum JRISC_Error
+jriscOptimize(const struct JRISC_Program *program,
+			  uint32_t rules,
+			  struct JRISC_Program **optimizedOut,
+			  struct JRISC_OptReport *report);
+
+/* A short name for a rule, e.g. "moveq" */
+extern const char *
+jriscOptRuleName(enum JRISC_OptRule rule);
+
+#endif /* JRISC_OPT_H_ */
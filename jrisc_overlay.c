@@ -0,0 +1,743 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_bus.h"
+#include "jrisc_cfg.h"
+#include "jrisc_const.h"
+#include "jrisc_diff.h"
+#include "jrisc_inst.h"
+#include "jrisc_overlay.h"
+#include "jrisc_program.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Where an overlay goes in local RAM, once placed */
+struct OverlaySlot {
+	uint32_t address;
+	uint32_t size;
+	bool placed;
+	bool fits;
+};
+
+struct OverlayPlanner {
+	struct JRISC_Overlay *overlays;
+	size_t numOverlays;
+	struct OverlaySlot *slots;
+	uint8_t *resident;
+};
+
+static uint32_t
+jriscOverlayAlignUp(uint32_t value)
+{
+	return (value + JRISC_OVERLAY_ALIGN - 1) & ~(JRISC_OVERLAY_ALIGN - 1);
+}
+
+static bool
+jriscOverlayOverlaps(uint32_t startA, uint32_t endA,
+					 uint32_t startB, uint32_t endB)
+{
+	return (startA < endB) && (startB < endA) &&
+		(startA < endA) && (startB < endB);
+}
+
+/* The bytes a load or store moves */
+static unsigned
+jriscOverlayAccessSize(const struct JRISC_Instruction *inst)
+{
+	switch (inst->opName) {
+	case JRISC_op_loadb:		/* Fall through */
+	case JRISC_op_storeb:
+		return 1;
+
+	case JRISC_op_loadw:		/* Fall through */
+	case JRISC_op_storew:
+		return 2;
+
+	case JRISC_op_loadp:		/* Fall through */
+	case JRISC_op_storep:
+		return 8;
+
+	default:
+		return 4;
+	}
+}
+
+/* Mark the instructions reachable from the entry point */
+static enum JRISC_Error
+jriscOverlayReach(const struct JRISC_Overlay *overlay,
+				  const struct JRISC_Cfg *cfg,
+				  uint8_t *reached)
+{
+	const struct JRISC_Program *program = overlay->program;
+	const struct JRISC_Block *block;
+	uint8_t *visited = NULL;
+	uint32_t *stack = NULL;
+	size_t numStack = 0;
+	size_t e, i;
+	uint32_t b, index;
+	enum JRISC_Error ret = JRISC_ERROR_outOfMemory;
+
+	index = jriscProgramFind(program, overlay->entry);
+	if (index == JRISC_PROGRAM_NO_INSTRUCTION) return JRISC_ERROR_invalidValue;
+
+	visited = calloc(cfg->numBlocks, 1);
+	stack = malloc(cfg->numBlocks * sizeof(*stack));
+	if (!visited || !stack) goto done;
+
+	b = jriscCfgFindBlock(cfg, index);
+	visited[b] = 1;
+	stack[numStack++] = b;
+
+	while (numStack) {
+		block = &cfg->blocks[stack[--numStack]];
+
+		for (i = block->first; i < block->first + block->count; i++) {
+			reached[i] = 1;
+
+			/* A call returns to the block after the one it is made from */
+			if ((program->instructions[i].opName == JRISC_op_movepc) &&
+				(block + 1 < cfg->blocks + cfg->numBlocks) &&
+				!visited[block - cfg->blocks + 1]) {
+				b = (uint32_t)(block - cfg->blocks + 1);
+				visited[b] = 1;
+				stack[numStack++] = b;
+			}
+		}
+
+		for (e = 0; e < block->numSuccessors; e++) {
+			b = cfg->edges[block->firstSuccessor + e];
+			if (visited[b]) continue;
+			visited[b] = 1;
+			stack[numStack++] = b;
+		}
+	}
+
+	ret = JRISC_success;
+
+done:
+	free(stack);
+	free(visited);
+
+	return ret;
+}
+
+/*
+ * Count the overlay's reachable code, the data in its image that the code
+ * refers to, and the local RAM outside the image it uses.
+ */
+static enum JRISC_Error
+jriscOverlayMeasure(struct JRISC_Overlay *overlay, uint8_t *reached)
+{
+	const struct JRISC_Program *program = overlay->program;
+	const uint32_t imageStart = program->baseAddress;
+	const uint32_t imageEnd = imageStart + (uint32_t)program->numWords * 2;
+	const struct JRISC_Instruction *inst;
+	struct JRISC_ConstProp *constProp = NULL;
+	uint8_t *referenced = NULL;
+	uint32_t addresses[2];
+	unsigned numAddresses, k;
+	uint32_t address, index, size;
+	size_t i, run;
+	bool used;
+	enum JRISC_Error ret;
+
+	ret = jriscConstPropCompute(program, &constProp);
+	if (ret != JRISC_success) goto done;
+
+	ret = jriscOverlayReach(overlay, constProp->cfg, reached);
+	if (ret != JRISC_success) goto done;
+
+	ret = JRISC_ERROR_outOfMemory;
+	referenced = calloc(program->numInstructions + 1, 1);
+	if (!referenced) goto done;
+
+	overlay->codeBytes = 0;
+	overlay->dataBytes = 0;
+	overlay->workStart = overlay->workEnd = 0;
+
+	for (i = 0; i < program->numInstructions; i++) {
+		if (!reached[i]) continue;
+
+		inst = &program->instructions[i];
+		overlay->codeBytes += jriscProgramInstructionSize(inst);
+
+		numAddresses = 0;
+		if (inst->opName == JRISC_op_movei) {
+			addresses[numAddresses++] = inst->longImmediate;
+		}
+		if ((inst->opName != JRISC_op_jump) &&
+			jriscConstPropAddress(constProp, i, &address)) {
+			addresses[numAddresses++] = address;
+
+			/* Local RAM outside the image is work RAM */
+			size = jriscOverlayAccessSize(inst);
+			if ((jriscBusRegion(program->cpu, address) == JRISC_busLocal) &&
+				((address < imageStart) || (address >= imageEnd))) {
+				if (overlay->workStart == overlay->workEnd) {
+					overlay->workStart = address;
+					overlay->workEnd = address + size;
+				} else if (address < overlay->workStart) {
+					overlay->workStart = address;
+				} else if (address + size > overlay->workEnd) {
+					overlay->workEnd = address + size;
+				}
+			}
+		}
+
+		for (k = 0; k < numAddresses; k++) {
+			index = jriscProgramFind(program, addresses[k]);
+			if ((index != JRISC_PROGRAM_NO_INSTRUCTION) && !reached[index]) {
+				referenced[index] = 1;
+			}
+		}
+	}
+
+	/* Each run of the image outside reachable code is data if it is used */
+	for (i = 0; i < program->numInstructions; i = run) {
+		if (reached[i]) {
+			run = i + 1;
+			continue;
+		}
+
+		size = 0;
+		used = false;
+		for (run = i; (run < program->numInstructions) && !reached[run];
+			 run++) {
+			size += jriscProgramInstructionSize(&program->instructions[run]);
+			if (referenced[run]) used = true;
+		}
+
+		if (used) overlay->dataBytes += size;
+	}
+
+	ret = JRISC_success;
+
+done:
+	free(referenced);
+	if (constProp) jriscConstPropDestroy(constProp);
+
+	return ret;
+}
+
+static uint32_t
+jriscOverlayFind(uint32_t *parents, uint32_t node)
+{
+	uint32_t root = node;
+	uint32_t next;
+
+	while (parents[root] != root) root = parents[root];
+
+	while (parents[node] != root) {
+		next = parents[node];
+		parents[node] = root;
+		node = next;
+	}
+
+	return root;
+}
+
+/*
+ * Mark a run of identical code found in overlays i and j, starting at
+ * instructions <oldIndex> and <newIndex>, and merge each pair of its
+ * instructions into the same class.
+ */
+static void
+jriscOverlayShareRun(struct JRISC_OverlayPlan *plan,
+					 const size_t *firstNodes,
+					 uint32_t *parents,
+					 uint8_t *shared,
+					 size_t i, size_t j,
+					 size_t oldIndex, size_t newIndex,
+					 size_t count, uint32_t bytes)
+{
+	const size_t n = plan->numOverlays;
+	uint32_t a, b;
+	size_t k;
+
+	if (bytes < JRISC_OVERLAY_MIN_SHARED) return;
+
+	for (k = 0; k < count; k++) {
+		a = (uint32_t)(firstNodes[i] + oldIndex + k);
+		b = (uint32_t)(firstNodes[j] + newIndex + k);
+		shared[a] = shared[b] = 1;
+		a = jriscOverlayFind(parents, a);
+		b = jriscOverlayFind(parents, b);
+		if (a != b) parents[b] = a;
+	}
+
+	plan->sharedBytes[i * n + j] += bytes;
+	plan->sharedBytes[j * n + i] += bytes;
+}
+
+/*
+ * Find reachable code common to each pair of overlays, then count each
+ * overlay's shared code, and all of it with each class of identical
+ * instructions counted once.
+ */
+static enum JRISC_Error
+jriscOverlayShare(struct JRISC_OverlayPlan *plan,
+				  struct JRISC_Overlay *overlays,
+				  uint8_t **reached)
+{
+	const size_t n = plan->numOverlays;
+	const struct JRISC_Program *oldProgram, *newProgram;
+	const struct JRISC_DiffHunk *hunk;
+	struct JRISC_Diff *diff = NULL;
+	size_t *firstNodes = NULL;
+	uint32_t *parents = NULL;
+	uint8_t *shared = NULL;
+	size_t numNodes = 0;
+	size_t i, j, h, k, start;
+	uint32_t node, bytes;
+	enum JRISC_Error ret = JRISC_ERROR_outOfMemory;
+
+	firstNodes = malloc(n * sizeof(*firstNodes));
+	if (!firstNodes) goto done;
+
+	for (i = 0; i < n; i++) {
+		firstNodes[i] = numNodes;
+		numNodes += overlays[i].program->numInstructions;
+	}
+
+	parents = malloc((numNodes + 1) * sizeof(*parents));
+	shared = calloc(numNodes + 1, 1);
+	if (!parents || !shared) goto done;
+
+	for (node = 0; node < numNodes; node++) parents[node] = node;
+
+	for (i = 0; i < n; i++) {
+		oldProgram = overlays[i].program;
+
+		for (j = i + 1; j < n; j++) {
+			newProgram = overlays[j].program;
+
+			ret = jriscDiffPrograms(oldProgram, newProgram, &diff);
+			if (ret != JRISC_success) goto done;
+
+			/* Split equal hunks into runs reachable in both */
+			for (h = 0; h < diff->numHunks; h++) {
+				hunk = &diff->hunks[h];
+				if (hunk->kind != JRISC_diffEqual) continue;
+
+				bytes = 0;
+				for (k = 0, start = 0; k <= hunk->oldCount; k++) {
+					if ((k < hunk->oldCount) &&
+						reached[i][hunk->oldIndex + k] &&
+						reached[j][hunk->newIndex + k]) {
+						bytes += jriscProgramInstructionSize(
+							&oldProgram->instructions[hunk->oldIndex + k]);
+						continue;
+					}
+
+					jriscOverlayShareRun(plan, firstNodes, parents, shared,
+										 i, j,
+										 hunk->oldIndex + start,
+										 hunk->newIndex + start,
+										 k - start, bytes);
+					bytes = 0;
+					start = k + 1;
+				}
+			}
+
+			jriscDiffDestroy(diff);
+			diff = NULL;
+		}
+	}
+
+	plan->commonBytes = 0;
+	for (i = 0; i < n; i++) {
+		oldProgram = overlays[i].program;
+		overlays[i].sharedBytes = 0;
+
+		for (k = 0; k < oldProgram->numInstructions; k++) {
+			node = (uint32_t)(firstNodes[i] + k);
+			if (!shared[node]) continue;
+
+			bytes = jriscProgramInstructionSize(&oldProgram->instructions[k]);
+			overlays[i].sharedBytes += bytes;
+			if (jriscOverlayFind(parents, node) == node) {
+				plan->commonBytes += bytes;
+			}
+		}
+	}
+
+	ret = JRISC_success;
+
+done:
+	if (diff) jriscDiffDestroy(diff);
+	free(shared);
+	free(parents);
+	free(firstNodes);
+
+	return ret;
+}
+
+/*
+ * Run two frames with the placed overlays and return the bytes uploaded in
+ * the second, when only what the others clobbered each frame is reloaded.
+ * If <switchBytes> isn't NULL, the bytes uploaded for each overlay are
+ * stored in it.
+ */
+static uint32_t
+jriscOverlaySimulate(const struct OverlayPlanner *planner,
+					 uint32_t *switchBytes)
+{
+	const struct JRISC_Overlay *overlay;
+	const struct OverlaySlot *slot, *other;
+	uint32_t total = 0;
+	size_t pass, k, m;
+
+	memset(planner->resident, 0, planner->numOverlays);
+
+	for (pass = 0; pass < 2; pass++) {
+		for (k = 0; k < planner->numOverlays; k++) {
+			overlay = &planner->overlays[k];
+			slot = &planner->slots[k];
+			if (!slot->placed) continue;
+
+			if (!planner->resident[k]) {
+				if (pass) total += slot->size;
+				if (pass && switchBytes) switchBytes[k] = slot->size;
+				planner->resident[k] = 1;
+			} else if (pass && switchBytes) {
+				switchBytes[k] = 0;
+			}
+
+			for (m = 0; m < planner->numOverlays; m++) {
+				other = &planner->slots[m];
+				if ((m == k) || !other->placed) continue;
+
+				if (jriscOverlayOverlaps(slot->address,
+										 slot->address + slot->size,
+										 other->address,
+										 other->address + other->size) ||
+					jriscOverlayOverlaps(overlay->workStart,
+										 overlay->workEnd,
+										 other->address,
+										 other->address + other->size)) {
+					planner->resident[m] = 0;
+				}
+			}
+		}
+	}
+
+	return total;
+}
+
+/*
+ * Place overlay <k> where it is clobbered least, trying the edges of the
+ * area, of everything already placed and of work RAM. If there's nowhere in
+ * [areaStart, areaEnd) clear of its own work RAM, it is left at <areaStart>
+ * and marked as not fitting.
+ */
+static void
+jriscOverlayPlace(struct OverlayPlanner *planner,
+				  size_t k,
+				  uint32_t areaStart,
+				  uint32_t areaEnd)
+{
+	const struct JRISC_Overlay *overlay = &planner->overlays[k];
+	struct OverlaySlot *slot = &planner->slots[k];
+	const struct OverlaySlot *other;
+	const struct JRISC_Overlay *otherOverlay;
+	const uint32_t size = slot->size;
+	uint32_t candidates[5];
+	uint32_t bestAddress = areaStart;
+	uint32_t bestCost = 0;
+	uint32_t address, cost;
+	unsigned numCandidates, c;
+	size_t m;
+	bool found = false;
+
+	slot->placed = true;
+
+	for (m = 0; m <= planner->numOverlays; m++) {
+		numCandidates = 0;
+		if (m == planner->numOverlays) {
+			candidates[numCandidates++] = areaStart;
+			candidates[numCandidates++] = areaEnd - size;
+		} else {
+			other = &planner->slots[m];
+			otherOverlay = &planner->overlays[m];
+
+			if (other->placed && (m != k)) {
+				candidates[numCandidates++] = other->address + other->size;
+				candidates[numCandidates++] = other->address - size;
+			}
+			if (otherOverlay->workStart != otherOverlay->workEnd) {
+				candidates[numCandidates++] = otherOverlay->workEnd;
+				candidates[numCandidates++] = otherOverlay->workStart - size;
+			}
+		}
+
+		for (c = 0; c < numCandidates; c++) {
+			/* Candidates below an edge round down, the rest round up */
+			address = (c & 1) ? candidates[c] & ~(JRISC_OVERLAY_ALIGN - 1) :
+				jriscOverlayAlignUp(candidates[c]);
+
+			if ((address < areaStart) || (address > areaEnd) ||
+				(size > areaEnd - address) ||
+				jriscOverlayOverlaps(address, address + size,
+									 overlay->workStart, overlay->workEnd)) {
+				continue;
+			}
+
+			slot->address = address;
+			cost = jriscOverlaySimulate(planner, NULL);
+			if (!found || (cost < bestCost) ||
+				((cost == bestCost) && (address < bestAddress))) {
+				bestCost = cost;
+				bestAddress = address;
+				found = true;
+			}
+		}
+	}
+
+	slot->address = bestAddress;
+	slot->fits = found;
+}
+
+/*
+ * Lay out every overlay, largest first, after the common code if <useCommon>.
+ * Returns the bytes uploaded per frame and sets <fitsOut>.
+ */
+static uint32_t
+jriscOverlayLayout(struct OverlayPlanner *planner,
+				   const struct JRISC_OverlayPlan *plan,
+				   bool useCommon,
+				   bool *fitsOut)
+{
+	const size_t n = planner->numOverlays;
+	const uint32_t areaStart = plan->ramStart +
+		(useCommon ? jriscOverlayAlignUp(plan->commonBytes) : 0);
+	const struct JRISC_Overlay *overlay;
+	struct OverlaySlot *slot;
+	size_t k, m, largest;
+	bool fits = true;
+
+	for (k = 0; k < n; k++) {
+		overlay = &planner->overlays[k];
+		slot = &planner->slots[k];
+		slot->size = overlay->codeBytes + overlay->dataBytes -
+			(useCommon ? overlay->sharedBytes : 0);
+		slot->placed = false;
+	}
+
+	for (k = 0; k < n; k++) {
+		largest = n;
+		for (m = 0; m < n; m++) {
+			if (planner->slots[m].placed) continue;
+			if ((largest == n) ||
+				(planner->slots[m].size > planner->slots[largest].size)) {
+				largest = m;
+			}
+		}
+
+		jriscOverlayPlace(planner, largest, areaStart, plan->ramEnd);
+		if (!planner->slots[largest].fits) fits = false;
+	}
+
+	*fitsOut = fits;
+
+	return jriscOverlaySimulate(planner, NULL);
+}
+
+/* Whether any overlay's work RAM would clobber the common code */
+static bool
+jriscOverlayCommonClobbered(const struct JRISC_Overlay *overlays,
+							const struct JRISC_OverlayPlan *plan)
+{
+	const uint32_t commonEnd = plan->ramStart +
+		jriscOverlayAlignUp(plan->commonBytes);
+	size_t k;
+
+	for (k = 0; k < plan->numOverlays; k++) {
+		if (jriscOverlayOverlaps(overlays[k].workStart, overlays[k].workEnd,
+								 plan->ramStart, commonEnd)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+enum JRISC_Error
+jriscOverlayPlan(struct JRISC_Overlay *overlays,
+				 size_t numOverlays,
+				 struct JRISC_OverlayPlan **planOut)
+{
+	struct JRISC_OverlayPlan *plan = NULL;
+	struct OverlayPlanner planner;
+	uint8_t **reached = NULL;
+	uint32_t *switchBytes = NULL;
+	const struct JRISC_Program *program;
+	enum JRISC_CPU cpu;
+	uint32_t withoutCommon, withCommon;
+	size_t k;
+	bool fitsWithout, fitsWith = false;
+	enum JRISC_Error ret = JRISC_ERROR_invalidValue;
+
+	memset(&planner, 0, sizeof(planner));
+
+	if (!numOverlays) goto done;
+
+	cpu = overlays[0].program->cpu;
+	for (k = 1; k < numOverlays; k++) {
+		if (overlays[k].program->cpu != cpu) goto done;
+	}
+
+	ret = JRISC_ERROR_outOfMemory;
+	plan = calloc(1, sizeof(*plan));
+	reached = calloc(numOverlays, sizeof(*reached));
+	switchBytes = calloc(numOverlays, sizeof(*switchBytes));
+	planner.slots = calloc(numOverlays, sizeof(*planner.slots));
+	planner.resident = calloc(numOverlays, 1);
+	if (!plan || !reached || !switchBytes || !planner.slots ||
+		!planner.resident) {
+		goto done;
+	}
+
+	plan->numOverlays = numOverlays;
+	plan->ramStart = (cpu == JRISC_dsp) ? JRISC_DSP_RAM : JRISC_GPU_RAM;
+	plan->ramEnd = plan->ramStart +
+		((cpu == JRISC_dsp) ? JRISC_DSP_RAM_SIZE : JRISC_GPU_RAM_SIZE);
+	plan->sharedBytes = calloc(numOverlays * numOverlays,
+							   sizeof(*plan->sharedBytes));
+	if (!plan->sharedBytes) goto done;
+
+	for (k = 0; k < numOverlays; k++) {
+		reached[k] = calloc(overlays[k].program->numInstructions + 1, 1);
+		if (!reached[k]) goto done;
+
+		ret = jriscOverlayMeasure(&overlays[k], reached[k]);
+		if (ret != JRISC_success) goto done;
+	}
+
+	ret = jriscOverlayShare(plan, overlays, reached);
+	if (ret != JRISC_success) goto done;
+
+	planner.overlays = overlays;
+	planner.numOverlays = numOverlays;
+
+	/* As linked: whole images, where they are linked */
+	for (k = 0; k < numOverlays; k++) {
+		program = overlays[k].program;
+		planner.slots[k].address = program->baseAddress;
+		planner.slots[k].size = (uint32_t)program->numWords * 2;
+		planner.slots[k].placed = true;
+	}
+	plan->linkedFrameBytes = jriscOverlaySimulate(&planner, switchBytes);
+	for (k = 0; k < numOverlays; k++) {
+		overlays[k].linkedSwitchBytes = switchBytes[k];
+	}
+
+	/* Try with and without common code, preferring whatever fits */
+	withoutCommon = jriscOverlayLayout(&planner, plan, false, &fitsWithout);
+	if (plan->commonBytes && !jriscOverlayCommonClobbered(overlays, plan)) {
+		withCommon = jriscOverlayLayout(&planner, plan, true, &fitsWith);
+		plan->useCommon = (fitsWith && !fitsWithout) ||
+			((fitsWith == fitsWithout) && (withCommon < withoutCommon));
+	}
+
+	if (!plan->useCommon) {
+		jriscOverlayLayout(&planner, plan, false, &fitsWithout);
+	}
+
+	plan->fits = plan->useCommon ? fitsWith : fitsWithout;
+	plan->frameBytes = jriscOverlaySimulate(&planner, switchBytes);
+
+	for (k = 0; k < numOverlays; k++) {
+		overlays[k].loadAddress = planner.slots[k].address;
+		overlays[k].uploadBytes = planner.slots[k].size;
+		overlays[k].switchBytes = switchBytes[k];
+		overlays[k].fits = planner.slots[k].fits;
+	}
+
+	*planOut = plan;
+	plan = NULL;
+	ret = JRISC_success;
+
+done:
+	if (reached) {
+		for (k = 0; k < numOverlays; k++) free(reached[k]);
+	}
+	free(reached);
+	free(switchBytes);
+	free(planner.slots);
+	free(planner.resident);
+	if (plan) jriscOverlayPlanDestroy(plan);
+
+	return ret;
+}
+
+void
+jriscOverlayPlanDestroy(struct JRISC_OverlayPlan *plan)
+{
+	free(plan->sharedBytes);
+	free(plan);
+}
+
+enum JRISC_Error
+jriscOverlayPlanWrite(const struct JRISC_Overlay *overlays,
+					  const struct JRISC_OverlayPlan *plan,
+					  FILE *fp)
+{
+	const size_t n = plan->numOverlays;
+	const struct JRISC_Overlay *overlay;
+	size_t i, j;
+	bool any = false;
+
+	fprintf(fp, "%-16s %8s %6s %6s %6s %6s  %s\n", "Overlay", "Entry",
+			"Image", "Code", "Data", "Shared", "Work RAM");
+	for (i = 0; i < n; i++) {
+		overlay = &overlays[i];
+		fprintf(fp, "%-16s  $%06x %6zu %6u %6u %6u  ", overlay->name,
+				overlay->entry, overlay->program->numWords * 2,
+				overlay->codeBytes, overlay->dataBytes, overlay->sharedBytes);
+		if (overlay->workStart != overlay->workEnd) {
+			fprintf(fp, "$%x-$%x\n", overlay->workStart,
+					overlay->workEnd - 1);
+		} else {
+			fprintf(fp, "-\n");
+		}
+	}
+
+	fprintf(fp, "\nShared code:\n");
+	for (i = 0; i < n; i++) {
+		for (j = i + 1; j < n; j++) {
+			if (!plan->sharedBytes[i * n + j]) continue;
+			fprintf(fp, "  %s, %s: %u bytes\n", overlays[i].name,
+					overlays[j].name, plan->sharedBytes[i * n + j]);
+			any = true;
+		}
+	}
+	if (!any) fprintf(fp, "  None\n");
+
+	fprintf(fp, "\nLocal RAM $%x-$%x, ", plan->ramStart, plan->ramEnd - 1);
+	if (plan->useCommon) {
+		fprintf(fp, "%u bytes of common code resident at $%x\n",
+				plan->commonBytes, plan->ramStart);
+	} else {
+		fprintf(fp, "no common code\n");
+	}
+
+	fprintf(fp, "%-16s %8s %6s %9s %9s\n", "Overlay", "Load at", "Upload",
+			"Per frame", "As linked");
+	for (i = 0; i < n; i++) {
+		overlay = &overlays[i];
+		fprintf(fp, "%-16s  $%06x %6u %9u %9u%s\n", overlay->name,
+				overlay->loadAddress, overlay->uploadBytes,
+				overlay->switchBytes, overlay->linkedSwitchBytes,
+				overlay->fits ? "" : "  doesn't fit");
+	}
+
+	fprintf(fp, "\nUploaded per frame: %u bytes, %u as linked\n",
+			plan->frameBytes, plan->linkedFrameBytes);
+
+	return ferror(fp) ? JRISC_ERROR_ioError : JRISC_success;
+}
@@ -0,0 +1,132 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#ifndef JRISC_OVERLAY_H_
+#define JRISC_OVERLAY_H_
+
+#include "jrisc_base.h"
+#include "jrisc_program.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+/* Load addresses are phrase aligned, for the blitter */
+#define JRISC_OVERLAY_ALIGN			8
+
+/* Shorter runs of identical code aren't worth moving into common code */
+#define JRISC_OVERLAY_MIN_SHARED	16
+
+/*
+ * One of several programs uploaded in turn to the same CPU's local RAM, e.g.
+ * once each per frame.
+ */
+struct JRISC_Overlay {
+	/* Set by the caller */
+	const char *name;
+	const struct JRISC_Program *program;
+	uint32_t entry;
+
+	/* The code reachable from the entry point, in bytes */
+	uint32_t codeBytes;
+
+	/*
+	 * The rest of the image that reachable code loads from, stores to or
+	 * takes the address of, counting each run between reachable code whole
+	 */
+	uint32_t dataBytes;
+
+	/*
+	 * Local RAM outside the image that it loads from or stores to, as
+	 * [workStart, workEnd), or empty if they are equal
+	 */
+	uint32_t workStart;
+	uint32_t workEnd;
+
+	/* Reachable code identical to code in another overlay */
+	uint32_t sharedBytes;
+
+	/* Where the plan puts it and how much of it is uploaded */
+	uint32_t loadAddress;
+	uint32_t uploadBytes;
+
+	/* Uploaded each frame when switching to it from the overlay before it */
+	uint32_t switchBytes;
+
+	/* The same, with the whole image uploaded to the address it is linked at */
+	uint32_t linkedSwitchBytes;
+
+	/* False if no place in local RAM could hold it clear of its work RAM */
+	bool fits;
+};
+
+struct JRISC_OverlayPlan {
+	size_t numOverlays;
+
+	/* The CPU's local RAM, [ramStart, ramEnd) */
+	uint32_t ramStart;
+	uint32_t ramEnd;
+
+	/*
+	 * Indexed by [i * numOverlays + j]: bytes of overlay i's reachable code
+	 * in runs of at least JRISC_OVERLAY_MIN_SHARED bytes identical to code in
+	 * overlay j
+	 */
+	uint32_t *sharedBytes;
+
+	/* All shared code, each run counted once */
+	uint32_t commonBytes;
+
+	/*
+	 * If set, the shared code is uploaded once to the start of local RAM and
+	 * stays there, and the overlays are placed after it
+	 */
+	bool useCommon;
+
+	/* Uploaded each frame by the plan, and with the images as linked */
+	uint32_t frameBytes;
+	uint32_t linkedFrameBytes;
+
+	/* False if any overlay doesn't fit */
+	bool fits;
+};
+
+/*
+ * Measure each overlay's footprint, find the code they share, and plan where
+ * to load each so that as little as possible is uploaded per frame, taking a
+ * frame to run the overlays once each in array order.
+ *
+ * Code is reachable from the entry point through the control flow graph,
+ * including jump (rN) targets that constant propagation finds. A move pc
+ * marks a subroutine call, so the block after the one holding it is reachable
+ * too, as the place the subroutine returns to.
+ *
+ * Code is shared if jriscDiffPrograms aligns it, so jr offsets and movei
+ * addresses only need to lead to the same place. The plan assumes each
+ * overlay is relinked to hold only its footprint at the address chosen, less
+ * the shared code when that is made common, and then picks places for the
+ * largest overlays first, keeping each one where it is clobbered least by the
+ * others' code and work RAM.
+ *
+ * All overlays must be for the same CPU. Returns JRISC_ERROR_invalidValue if
+ * they aren't, or an entry point isn't in its program.
+ */
+extern enum JRISC_Error
+jriscOverlayPlan(struct JRISC_Overlay *overlays,
+				 size_t numOverlays,
+				 struct JRISC_OverlayPlan **planOut);
+
+extern void
+jriscOverlayPlanDestroy(struct JRISC_OverlayPlan *plan);
+
+/* Print each overlay's footprint, the code they share, and the plan */
+extern enum JRISC_Error
+jriscOverlayPlanWrite(const struct JRISC_Overlay *overlays,
+					  const struct JRISC_OverlayPlan *plan,
+					  FILE *fp);
+
+#endif /* JRISC_OVERLAY_H_ */
@@ -0,0 +1,236 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_pipe.h"
+#include "jrisc_ring.h"
+#include "jrisc_thread.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#define PIPE_BATCH_WORDS	4096
+#define PIPE_NUM_BATCHES	8
+
+struct PipeWords {
+	uint16_t words[PIPE_BATCH_WORDS];
+	size_t numWords;
+	uint32_t address;
+	bool last;
+};
+
+struct PipeInstructions {
+	struct JRISC_Instruction instructions[PIPE_BATCH_WORDS];
+	size_t count;
+	bool last;
+};
+
+struct Pipe {
+	struct JRISC_Context *context;
+	uint64_t size;
+	enum JRISC_CPU cpu;
+
+	/* Reader to decoder, and back again */
+	struct JRISC_Ring *fullWords;
+	struct JRISC_Ring *freeWords;
+
+	/* Decoder to the calling thread, and back again */
+	struct JRISC_Ring *fullInstructions;
+	struct JRISC_Ring *freeInstructions;
+
+	/* Set by the decoder when it has seen the end of the code */
+	volatile size_t stopReading;
+
+	/* Set by the calling thread when it stops taking instructions */
+	volatile size_t cancel;
+};
+
+/*
+ * Wait for an item, or for <stop> to be set. Each stage only waits on rings
+ * that a stage still running will fill, so this can't deadlock. The ring
+ * capacity matches the number of batches, so pushing never has to wait.
+ */
+static void *
+pipePop(struct JRISC_Ring *ring, const volatile size_t *stop1,
+		const volatile size_t *stop2)
+{
+	void *item;
+
+	while (!jriscRingPop(ring, &item)) {
+		if ((stop1 && jriscAtomicLoad(stop1)) ||
+			(stop2 && jriscAtomicLoad(stop2))) {
+			return NULL;
+		}
+		jriscThreadYield();
+	}
+
+	return item;
+}
+
+static void
+pipeReader(void *arg)
+{
+	struct Pipe *pipe = arg;
+	struct JRISC_Context *ctx = pipe->context;
+	uint64_t remaining = pipe->size / 2;
+	struct PipeWords *batch;
+
+	do {
+		batch = pipePop(pipe->freeWords, &pipe->stopReading, &pipe->cancel);
+		if (!batch) return;
+
+		batch->numWords = (remaining < PIPE_BATCH_WORDS) ?
+			(size_t)remaining : PIPE_BATCH_WORDS;
+		batch->address = ctx->readAddress;
+
+		/* A failed read ends the code, as it would for jriscInstructionRead */
+		if (ctx->readWords(ctx, batch->words, batch->numWords, NULL) !=
+			JRISC_success) {
+			batch->numWords = 0;
+		}
+
+		remaining = batch->numWords ? (remaining - batch->numWords) : 0;
+		batch->last = !remaining;
+
+		jriscRingPush(pipe->fullWords, batch);
+	} while (remaining);
+}
+
+static void
+pipeDecoder(void *arg)
+{
+	struct Pipe *pipe = arg;
+	struct PipeWords *in;
+	struct PipeInstructions *out;
+	struct JRISC_Instruction inst;
+	unsigned immediateWords = 0;
+	bool last = false;
+	size_t w;
+
+	out = pipePop(pipe->freeInstructions, &pipe->cancel, NULL);
+	if (!out) return;
+	out->count = 0;
+
+	while (!last) {
+		in = pipePop(pipe->fullWords, &pipe->cancel, NULL);
+		if (!in) return;
+
+		for (w = 0; !last && (w < in->numWords); w++) {
+			if (immediateWords) {
+				/* movei's value follows it, low word first */
+				if (immediateWords == 2) {
+					inst.longImmediate = in->words[w];
+				} else {
+					inst.longImmediate |= (uint32_t)in->words[w] << 16;
+				}
+				if (--immediateWords) continue;
+			} else if (jriscInstructionDecode(in->words[w], pipe->cpu,
+											  in->address + w * 2, &inst) !=
+					   JRISC_success) {
+				last = true;
+				break;
+			} else if (inst.opName == JRISC_op_movei) {
+				immediateWords = 2;
+				continue;
+			}
+
+			out->instructions[out->count++] = inst;
+			if (out->count == PIPE_BATCH_WORDS) {
+				out->last = false;
+				jriscRingPush(pipe->fullInstructions, out);
+
+				out = pipePop(pipe->freeInstructions, &pipe->cancel, NULL);
+				if (!out) return;
+				out->count = 0;
+			}
+		}
+
+		last = last || in->last;
+		jriscRingPush(pipe->freeWords, in);
+	}
+
+	/* The reader may still be waiting for a batch to fill */
+	jriscAtomicStore(&pipe->stopReading, 1);
+
+	out->last = true;
+	jriscRingPush(pipe->fullInstructions, out);
+}
+
+enum JRISC_Error
+jriscPipeDecode(struct JRISC_Context *context,
+				uint64_t size,
+				enum JRISC_CPU cpu,
+				JRISC_PipeFunc func,
+				void *arg)
+{
+	struct Pipe pipe = { 0 };
+	struct PipeWords *words = NULL;
+	struct PipeInstructions *instructions = NULL;
+	struct PipeInstructions *batch;
+	struct JRISC_Thread *reader = NULL;
+	struct JRISC_Thread *decoder = NULL;
+	enum JRISC_Error err = JRISC_ERROR_outOfMemory;
+	bool last = false;
+	size_t b, i;
+
+	pipe.context = context;
+	pipe.size = size;
+	pipe.cpu = cpu;
+
+	words = malloc(PIPE_NUM_BATCHES * sizeof(*words));
+	instructions = malloc(PIPE_NUM_BATCHES * sizeof(*instructions));
+	if (!words || !instructions ||
+		(jriscRingCreate(PIPE_NUM_BATCHES, &pipe.fullWords) != JRISC_success) ||
+		(jriscRingCreate(PIPE_NUM_BATCHES, &pipe.freeWords) != JRISC_success) ||
+		(jriscRingCreate(PIPE_NUM_BATCHES, &pipe.fullInstructions) !=
+		 JRISC_success) ||
+		(jriscRingCreate(PIPE_NUM_BATCHES, &pipe.freeInstructions) !=
+		 JRISC_success)) {
+		goto done;
+	}
+
+	for (b = 0; b < PIPE_NUM_BATCHES; b++) {
+		jriscRingPush(pipe.freeWords, &words[b]);
+		jriscRingPush(pipe.freeInstructions, &instructions[b]);
+	}
+
+	if (jriscThreadCreate(pipeReader, &pipe, &reader) != JRISC_success) {
+		goto done;
+	}
+	if (jriscThreadCreate(pipeDecoder, &pipe, &decoder) != JRISC_success) {
+		jriscAtomicStore(&pipe.cancel, 1);
+		goto done;
+	}
+
+	err = JRISC_success;
+	while (!last) {
+		batch = pipePop(pipe.fullInstructions, NULL, NULL);
+
+		for (i = 0; (err == JRISC_success) && (i < batch->count); i++) {
+			err = func(&batch->instructions[i], arg);
+		}
+
+		if (err != JRISC_success) {
+			jriscAtomicStore(&pipe.cancel, 1);
+			break;
+		}
+
+		last = batch->last;
+		jriscRingPush(pipe.freeInstructions, batch);
+	}
+
+done:
+	jriscThreadJoin(decoder);
+	jriscThreadJoin(reader);
+	jriscRingDestroy(pipe.freeInstructions);
+	jriscRingDestroy(pipe.fullInstructions);
+	jriscRingDestroy(pipe.freeWords);
+	jriscRingDestroy(pipe.fullWords);
+	free(instructions);
+	free(words);
+
+	return err;
+}
@@ -0,0 +1,42 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#ifndef JRISC_PIPE_H_
+#define JRISC_PIPE_H_
+
+#include "jrisc_base.h"
+#include "jrisc_ctx.h"
+#include "jrisc_inst.h"
+
+#include <stdint.h>
+
+typedef enum JRISC_Error (*JRISC_PipeFunc)(
+	const struct JRISC_Instruction *instruction,
+	void *arg);
+
+/*
+ * Decode <size> bytes from the context's read position, and call <func> on
+ * the calling thread for each instruction, in order. This sees the same
+ * instructions as calling jriscInstructionRead until it fails: decoding stops
+ * at the first word that isn't an instruction, or a movei cut short.
+ *
+ * Reading and decoding are done on two other threads, each a stage ahead of
+ * the next. Batches of words and of decoded instructions are passed between
+ * them through lock-free single-producer, single-consumer rings, and handed
+ * back through another ring each to be reused, so nothing is allocated once
+ * the pipeline is running.
+ *
+ * If <func> returns an error, the pipeline is shut down and the error is
+ * returned. Nothing else may use the context until this returns.
+ */
+extern enum JRISC_Error
+jriscPipeDecode(struct JRISC_Context *context,
+				uint64_t size,
+				enum JRISC_CPU cpu,
+				JRISC_PipeFunc func,
+				void *arg);
+
+#endif /* JRISC_PIPE_H_ */
@@ -0,0 +1,240 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_ctx.h"
+#include "jrisc_image.h"
+#include "jrisc_inst.h"
+#include "jrisc_program.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static enum JRISC_Error
+jriscProgramBuild(struct JRISC_Program *p)
+{
+	struct JRISC_Instruction *inst;
+	size_t w;
+	size_t n = 0;
+
+	/* Upper bound: one entry per word */
+	p->instructions = malloc((p->numWords ? p->numWords : 1) *
+							 sizeof(*p->instructions));
+	p->wordToInstruction = malloc((p->numWords ? p->numWords : 1) *
+								  sizeof(*p->wordToInstruction));
+	if (!p->instructions || !p->wordToInstruction) {
+		return JRISC_ERROR_outOfMemory;
+	}
+
+	for (w = 0; w < p->numWords; n++) {
+		inst = &p->instructions[n];
+
+		p->wordToInstruction[w] = (uint32_t)n;
+
+		if (jriscInstructionDecode(p->words[w], p->cpu,
+								   p->baseAddress + (uint32_t)(w * 2),
+								   inst) != JRISC_success) {
+			goto invalid;
+		}
+
+		if (inst->opName == JRISC_op_movei) {
+			if ((w + 2) >= p->numWords) goto invalid;
+
+			inst->longImmediate = p->words[w + 1] |
+				((uint32_t)p->words[w + 2] << 16);
+			p->wordToInstruction[w + 1] = (uint32_t)n;
+			p->wordToInstruction[w + 2] = (uint32_t)n;
+			w += 3;
+			continue;
+		}
+
+		w++;
+		continue;
+
+invalid:
+		memset(inst, 0, sizeof(*inst));
+		inst->opName = JRISC_invalidOpName;
+		inst->cpu = p->cpu;
+		inst->address = p->baseAddress + (uint32_t)(w * 2);
+		w++;
+	}
+
+	p->numInstructions = n;
+
+	return JRISC_success;
+}
+
+enum JRISC_Error
+jriscProgramFromWords(const uint16_t *words,
+					  size_t numWords,
+					  uint32_t baseAddress,
+					  enum JRISC_CPU cpu,
+					  struct JRISC_Program **programOut)
+{
+	struct JRISC_Program *p = calloc(1, sizeof(*p));
+	enum JRISC_Error ret;
+
+	if (!p) return JRISC_ERROR_outOfMemory;
+
+	p->words = malloc((numWords ? numWords : 1) * sizeof(*p->words));
+	if (!p->words) {
+		free(p);
+		return JRISC_ERROR_outOfMemory;
+	}
+
+	if (numWords) memcpy(p->words, words, numWords * sizeof(*words));
+	p->numWords = numWords;
+	p->baseAddress = baseAddress;
+	p->cpu = cpu;
+
+	ret = jriscProgramBuild(p);
+	if (ret != JRISC_success) {
+		jriscProgramDestroy(p);
+		return ret;
+	}
+
+	*programOut = p;
+
+	return JRISC_success;
+}
+
+enum JRISC_Error
+jriscProgramDecode(struct JRISC_Context *context,
+				   uint64_t size,
+				   enum JRISC_CPU cpu,
+				   struct JRISC_Program **programOut)
+{
+	struct JRISC_Program *p = calloc(1, sizeof(*p));
+	enum JRISC_Error ret;
+
+	if (!p) return JRISC_ERROR_outOfMemory;
+
+	p->numWords = (size_t)(size / 2);
+	p->baseAddress = context->readAddress;
+	p->cpu = cpu;
+	p->words = malloc((p->numWords ? p->numWords : 1) * sizeof(*p->words));
+	if (!p->words) {
+		ret = JRISC_ERROR_outOfMemory;
+		goto fail;
+	}
+
+	/* One bulk read rather than a call per word */
+	ret = context->readWords(context, p->words, p->numWords, NULL);
+	if (ret != JRISC_success) goto fail;
+
+	ret = jriscProgramBuild(p);
+	if (ret != JRISC_success) goto fail;
+
+	*programOut = p;
+
+	return JRISC_success;
+
+fail:
+	jriscProgramDestroy(p);
+
+	return ret;
+}
+
+enum JRISC_Error
+jriscProgramFromSection(const struct JRISC_Image *image,
+						const struct JRISC_Section *section,
+						enum JRISC_CPU cpu,
+						struct JRISC_Program **programOut)
+{
+	struct JRISC_Context *ctx;
+	enum JRISC_Error ret;
+
+	ret = jriscImageSectionContext(image, section, &ctx);
+	if (ret != JRISC_success) return ret;
+
+	ret = jriscProgramDecode(ctx, section->size, cpu, programOut);
+	jriscContextDestroy(ctx);
+
+	return ret;
+}
+
+void
+jriscProgramDestroy(struct JRISC_Program *program)
+{
+	if (!program) return;
+
+	free(program->instructions);
+	free(program->wordToInstruction);
+	free(program->words);
+	free(program);
+}
+
+enum JRISC_Error
+jriscProgramWrite(const struct JRISC_Program *program,
+				  struct JRISC_Context *context)
+{
+	enum JRISC_Error ret;
+	size_t w;
+
+	for (w = 0; w < program->numWords; w++) {
+		ret = context->writeWord(context, program->words[w], NULL);
+		if (ret != JRISC_success) return ret;
+	}
+
+	return JRISC_success;
+}
+
+bool
+jriscProgramContains(const struct JRISC_Program *program, uint32_t address)
+{
+	return (address >= program->baseAddress) &&
+		(((uint64_t)address - program->baseAddress) < (program->numWords * 2));
+}
+
+uint32_t
+jriscProgramFind(const struct JRISC_Program *program, uint32_t address)
+{
+	if (!jriscProgramContains(program, address)) {
+		return JRISC_PROGRAM_NO_INSTRUCTION;
+	}
+
+	return program->wordToInstruction[(address - program->baseAddress) / 2];
+}
+
+unsigned
+jriscProgramInstructionSize(const struct JRISC_Instruction *instruction)
+{
+	return (instruction->opName == JRISC_op_movei) ? 6 : 2;
+}
+
+uint16_t
+jriscProgramRaw(const struct JRISC_Program *program, size_t index)
+{
+	return program->words[(program->instructions[index].address -
+						   program->baseAddress) / 2];
+}
+
+unsigned
+jriscProgramDecodeAt(const struct JRISC_Program *program,
+					 size_t w,
+					 struct JRISC_Instruction *instructionOut)
+{
+	if (jriscInstructionDecode(program->words[w], program->cpu,
+							   program->baseAddress + (uint32_t)(w * 2),
+							   instructionOut) != JRISC_success) {
+		return 0;
+	}
+
+	if (instructionOut->opName != JRISC_op_movei) return 1;
+	if ((w + 2) >= program->numWords) return 0;
+
+	instructionOut->longImmediate = program->words[w + 1] |
+		((uint32_t)program->words[w + 2] << 16);
+
+	return 3;
+}
+
+uint32_t
+jriscInstructionBranchTarget(const struct JRISC_Instruction *instruction)
+{
+	return instruction->address + 2 +
+		((int32_t)instruction->regSrc.val.simmediate * 2);
+}
@@ -0,0 +1,105 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#ifndef JRISC_PROGRAM_H_
+#define JRISC_PROGRAM_H_
+
+#include "jrisc_base.h"
+#include "jrisc_ctx.h"
+#include "jrisc_image.h"
+#include "jrisc_inst.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define JRISC_PROGRAM_NO_INSTRUCTION ((uint32_t)-1)
+
+/*
+ * A region of code decoded once, linearly, into an array that analyses can
+ * walk and index freely.
+ *
+ * Every word of the region belongs to exactly one entry. Words that don't
+ * decode, and a movei cut short by the end of the region, become single-word
+ * entries with opName JRISC_invalidOpName. Their raw value is in words[].
+ */
+struct JRISC_Program {
+	struct JRISC_Instruction *instructions;
+	size_t numInstructions;
+
+	/* The region's words, in host order, and the entry each one belongs to */
+	uint16_t *words;
+	uint32_t *wordToInstruction;
+	size_t numWords;
+
+	uint32_t baseAddress;
+	enum JRISC_CPU cpu;
+};
+
+/* Decode <size> bytes from the context's current read position */
+extern enum JRISC_Error
+jriscProgramDecode(struct JRISC_Context *context,
+				   uint64_t size,
+				   enum JRISC_CPU cpu,
+				   struct JRISC_Program **programOut);
+
+/* As above, from words already in host order. The words are copied. */
+extern enum JRISC_Error
+jriscProgramFromWords(const uint16_t *words,
+					  size_t numWords,
+					  uint32_t baseAddress,
+					  enum JRISC_CPU cpu,
+					  struct JRISC_Program **programOut);
+
+/* Decode a whole section of an image, in the image's byte order */
+extern enum JRISC_Error
+jriscProgramFromSection(const struct JRISC_Image *image,
+						const struct JRISC_Section *section,
+						enum JRISC_CPU cpu,
+						struct JRISC_Program **programOut);
+
+extern void
+jriscProgramDestroy(struct JRISC_Program *program);
+
+/* Write all of the program's words at the context's write position */
+extern enum JRISC_Error
+jriscProgramWrite(const struct JRISC_Program *program,
+				  struct JRISC_Context *context);
+
+/*
+ * Return the index of the entry containing <address>, which need not be the
+ * address of its first word, or JRISC_PROGRAM_NO_INSTRUCTION if the address
+ * is outside the program.
+ */
+extern uint32_t
+jriscProgramFind(const struct JRISC_Program *program, uint32_t address);
+
+extern bool
+jriscProgramContains(const struct JRISC_Program *program, uint32_t address);
+
+/* The size in bytes of an entry: 6 for movei, 2 for anything else */
+extern unsigned
+jriscProgramInstructionSize(const struct JRISC_Instruction *instruction);
+
+/* The first word of entry <index> */
+extern uint16_t
+jriscProgramRaw(const struct JRISC_Program *program, size_t index);
+
+/*
+ * Decode the instruction starting at word <w>, which needn't start one of the
+ * program's entries. Returns the number of words it takes, or 0 if it doesn't
+ * decode or is a movei cut short by the end of the program.
+ */
+extern unsigned
+jriscProgramDecodeAt(const struct JRISC_Program *program,
+					 size_t w,
+					 struct JRISC_Instruction *instructionOut);
+
+/* The address a jr branches to */
+extern uint32_t
+jriscInstructionBranchTarget(const struct JRISC_Instruction *instruction);
+
+#endif /* JRISC_PROGRAM_H_ */
@@ -0,0 +1,848 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_cfg.h"
+#include "jrisc_inst.h"
+#include "jrisc_program.h"
+#include "jrisc_recomp.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+/* The flags an instruction sets from its result */
+#define RECOMP_FLAG_Z	0x1
+#define RECOMP_FLAG_N	0x2
+
+struct Recomp {
+	const struct JRISC_Program *program;
+	FILE *fp;
+
+	uint32_t programSize;		/* In bytes */
+	uint32_t ramAddress;
+	uint32_t ramSize;
+	uint32_t flagsAddress;
+	const char *cpuName;		/* In the accessors' names */
+};
+
+static bool
+jriscRecompIsIdentifier(const char *name)
+{
+	const char *s;
+
+	if (!name[0] || ((name[0] >= '0') && (name[0] <= '9'))) return false;
+
+	for (s = name; *s; s++) {
+		if (!(((*s >= 'a') && (*s <= 'z')) || ((*s >= 'A') && (*s <= 'Z')) ||
+			  ((*s >= '0') && (*s <= '9')) || (*s == '_'))) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/* The index of the instruction starting at <address>, if one does */
+static uint32_t
+jriscRecompFind(const struct Recomp *rc, uint32_t address)
+{
+	const uint32_t index = jriscProgramFind(rc->program, address);
+
+	if ((index == JRISC_PROGRAM_NO_INSTRUCTION) ||
+		(rc->program->instructions[index].address != address)) {
+		return JRISC_PROGRAM_NO_INSTRUCTION;
+	}
+
+	return index;
+}
+
+/* The value of an immediate operand, as jriscExecRun reads it */
+static uint32_t
+jriscRecompImmediate(const struct JRISC_OpReg *reg)
+{
+	const uint32_t uimmediate = reg->val.uimmediate ? reg->val.uimmediate : 32;
+
+	switch (reg->type) {
+	case JRISC_simmediate:
+		return (uint32_t)(int32_t)reg->val.simmediate;
+
+	case JRISC_uimmediate:
+		return uimmediate;
+
+	case JRISC_zuimmediate:
+		return reg->val.uimmediate;
+
+	case JRISC_shlimmediate:
+		return 32 - uimmediate;
+
+	default:
+		return 0;
+	}
+}
+
+static void
+jriscRecompStop(const struct Recomp *rc,
+				uint32_t address,
+				const char *status)
+{
+	fprintf(rc->fp, "\tdest = 0x%xu;\n", address);
+	fprintf(rc->fp, "\tstatus = %s;\n", status);
+	fprintf(rc->fp, "\tgoto leave;\n");
+}
+
+/*
+ * Loads and stores. <resume> is where to go on after a store to the flags
+ * register. Returns false if the instruction isn't one.
+ */
+static bool
+jriscRecompMemory(const struct Recomp *rc,
+				  const struct JRISC_Instruction *inst,
+				  const char *resume)
+{
+	FILE *fp = rc->fp;
+	const unsigned src = inst->regSrc.val.reg;
+	const unsigned dst = inst->regDst.val.reg;
+	char address[32];
+	unsigned size = 4;
+	bool store = false;
+
+	switch (inst->opName) {
+	case JRISC_op_storeb:
+		store = true;
+		/* Fall through */
+	case JRISC_op_loadb:
+		size = 1;
+		sprintf(address, "r%u", src);
+		break;
+
+	case JRISC_op_storew:
+		store = true;
+		/* Fall through */
+	case JRISC_op_loadw:
+		size = 2;
+		sprintf(address, "r%u", src);
+		break;
+
+	case JRISC_op_store:
+		store = true;
+		/* Fall through */
+	case JRISC_op_load:
+		sprintf(address, "r%u", src);
+		break;
+
+	case JRISC_op_storer14n:
+		store = true;
+		/* Fall through */
+	case JRISC_op_loadr14n:
+		sprintf(address, "r14 + 0x%xu",
+				jriscRecompImmediate(&inst->regSrc) * 4);
+		break;
+
+	case JRISC_op_storer15n:
+		store = true;
+		/* Fall through */
+	case JRISC_op_loadr15n:
+		sprintf(address, "r15 + 0x%xu",
+				jriscRecompImmediate(&inst->regSrc) * 4);
+		break;
+
+	case JRISC_op_storer14r:
+		store = true;
+		/* Fall through */
+	case JRISC_op_loadr14r:
+		sprintf(address, "r14 + r%u", src);
+		break;
+
+	case JRISC_op_storer15r:
+		store = true;
+		/* Fall through */
+	case JRISC_op_loadr15r:
+		sprintf(address, "r15 + r%u", src);
+		break;
+
+	default:
+		return false;
+	}
+
+	if (store) {
+		fprintf(fp, "\tswitch (jriscRecomp%sStore(st, %s, %u, r%u)) {\n",
+				rc->cpuName, address, size, dst);
+		fprintf(fp, "\tcase 0:\n");
+		fprintf(fp, "\t\tbreak;\n");
+		fprintf(fp, "\tcase 2:\n");
+		fprintf(fp, "\t\tvalue = r%u;\n", dst);
+		fprintf(fp, "\t\tsteps++;\n");
+		fprintf(fp, "\t\tdest = %s;\n", resume);
+		fprintf(fp, "\t\tgoto setflags;\n");
+	} else {
+		fprintf(fp, "\tswitch (jriscRecomp%sLoad(st, %s, %u, &value)) {\n",
+				rc->cpuName, address, size);
+		fprintf(fp, "\tcase 0:\n");
+		fprintf(fp, "\t\tr%u = value;\n", dst);
+		fprintf(fp, "\t\tbreak;\n");
+		fprintf(fp, "\tcase 2:\n");
+		fprintf(fp, "\t\tr%u = z | (c << 1) | (n << 2) | "
+				"(st->regpage << 14);\n", dst);
+		fprintf(fp, "\t\tbreak;\n");
+	}
+	fprintf(fp, "\tdefault:\n");
+	fprintf(fp, "\t\tdest = 0x%xu;\n", inst->address);
+	fprintf(fp, "\t\tstatus = JRISC_recompBadAddress;\n");
+	fprintf(fp, "\t\tgoto leave;\n");
+	fprintf(fp, "\t}\n");
+	fprintf(fp, "\tsteps++;\n");
+
+	return true;
+}
+
+/*
+ * Any instruction but a branch, computing its result into t first, as
+ * jriscExecRun does. <resume> is where to go on after a store to the flags
+ * register.
+ */
+static void
+jriscRecompBody(const struct Recomp *rc,
+				const struct JRISC_Instruction *inst,
+				const char *resume)
+{
+	FILE *fp = rc->fp;
+	const uint32_t imm = jriscRecompImmediate(&inst->regSrc);
+	const unsigned dst = inst->regDst.val.reg;
+	unsigned flags = RECOMP_FLAG_Z | RECOMP_FLAG_N;
+	bool writeDst = true;
+	char s[16];
+	char d[8];
+
+	if (jriscRecompMemory(rc, inst, resume)) return;
+
+	if ((inst->regSrc.type == JRISC_reg) ||
+		(inst->regSrc.type == JRISC_indirect)) {
+		sprintf(s, "r%u", inst->regSrc.val.reg);
+	} else {
+		sprintf(s, "0x%xu", imm);
+	}
+	sprintf(d, "r%u", dst);
+
+	switch (inst->opName) {
+	case JRISC_op_add:
+	case JRISC_op_addq:
+		fprintf(fp, "\tt = %s + %s;\n", d, s);
+		fprintf(fp, "\tc = t < %s;\n", d);
+		break;
+
+	case JRISC_op_addc:
+		fprintf(fp, "\tu = %s + %s;\n", d, s);
+		fprintf(fp, "\tt = u + c;\n");
+		fprintf(fp, "\tc = (u < %s) | (t < u);\n", d);
+		break;
+
+	case JRISC_op_addqt:
+		fprintf(fp, "\tt = %s + %s;\n", d, s);
+		flags = 0;
+		break;
+
+	case JRISC_op_sub:
+	case JRISC_op_subq:
+	case JRISC_op_cmp:
+	case JRISC_op_cmpq:
+		fprintf(fp, "\tt = %s - %s;\n", d, s);
+		if (!strcmp(s, "0x0u")) {
+			/* cmpq #0 can't borrow, and compilers warn of the comparison */
+			fprintf(fp, "\tc = 0;\n");
+		} else {
+			fprintf(fp, "\tc = %s < %s;\n", d, s);
+		}
+		writeDst = (inst->opName == JRISC_op_sub) ||
+			(inst->opName == JRISC_op_subq);
+		break;
+
+	case JRISC_op_subc:
+		fprintf(fp, "\tu = %s - %s;\n", d, s);
+		fprintf(fp, "\tt = u - c;\n");
+		fprintf(fp, "\tc = (%s < %s) | (u < c);\n", d, s);
+		break;
+
+	case JRISC_op_subqt:
+		fprintf(fp, "\tt = %s - %s;\n", d, s);
+		flags = 0;
+		break;
+
+	case JRISC_op_neg:
+		fprintf(fp, "\tt = 0 - %s;\n", d);
+		fprintf(fp, "\tc = %s != 0;\n", d);
+		break;
+
+	case JRISC_op_and:
+		fprintf(fp, "\tt = %s & %s;\n", d, s);
+		break;
+
+	case JRISC_op_or:
+		fprintf(fp, "\tt = %s | %s;\n", d, s);
+		break;
+
+	case JRISC_op_xor:
+		fprintf(fp, "\tt = %s ^ %s;\n", d, s);
+		break;
+
+	case JRISC_op_not:
+		fprintf(fp, "\tt = ~%s;\n", d);
+		break;
+
+	case JRISC_op_btst:
+		fprintf(fp, "\tt = %s & 0x%xu;\n", d, (uint32_t)1 << imm);
+		writeDst = false;
+		flags = RECOMP_FLAG_Z;
+		break;
+
+	case JRISC_op_bset:
+		fprintf(fp, "\tt = %s | 0x%xu;\n", d, (uint32_t)1 << imm);
+		break;
+
+	case JRISC_op_bclr:
+		fprintf(fp, "\tt = %s & 0x%xu;\n", d, ~((uint32_t)1 << imm));
+		break;
+
+	case JRISC_op_mult:
+		fprintf(fp, "\tt = (%s & 0xffffu) * (%s & 0xffffu);\n", d, s);
+		break;
+
+	case JRISC_op_imult:
+		fprintf(fp, "\tt = (uint32_t)((int32_t)(int16_t)%s * "
+				"(int32_t)(int16_t)%s);\n", d, s);
+		break;
+
+	case JRISC_op_imultn:
+	case JRISC_op_imacn:
+		fprintf(fp, "\tacc = %s(int32_t)(uint32_t)((int32_t)(int16_t)%s * "
+				"(int32_t)(int16_t)%s);\n",
+				(inst->opName == JRISC_op_imacn) ? "acc + " : "", d, s);
+		fprintf(fp, "\tt = (uint32_t)acc;\n");
+		writeDst = false;
+		break;
+
+	case JRISC_op_resmac:
+		fprintf(fp, "\tt = (uint32_t)acc;\n");
+		break;
+
+	case JRISC_op_div:
+		fprintf(fp, "\tt = %s ? (%s / %s) : 0xffffffffu;\n", s, d, s);
+		flags = 0;
+		break;
+
+	case JRISC_op_abs:
+		fprintf(fp, "\tc = %s >> 31;\n", d);
+		fprintf(fp, "\tt = c ? (0 - %s) : %s;\n", d, d);
+		break;
+
+	case JRISC_op_sh:
+	case JRISC_op_sha:
+		/* Positive counts shift right, negative ones left */
+		fprintf(fp, "\tshift = (int32_t)%s;\n", s);
+		fprintf(fp, "\tif (shift >= 0) {\n");
+		fprintf(fp, "\t\tc = %s & 1;\n", d);
+		if (inst->opName == JRISC_op_sha) {
+			fprintf(fp, "\t\tt = (uint32_t)((int32_t)%s >> "
+					"((shift > 31) ? 31 : shift));\n", d);
+		} else {
+			fprintf(fp, "\t\tt = (shift > 31) ? 0 : (%s >> shift);\n", d);
+		}
+		fprintf(fp, "\t} else {\n");
+		fprintf(fp, "\t\tc = %s >> 31;\n", d);
+		fprintf(fp, "\t\tt = (shift < -31) ? 0 : (%s << -shift);\n", d);
+		fprintf(fp, "\t}\n");
+		break;
+
+	case JRISC_op_shlq:
+		fprintf(fp, "\tc = %s >> 31;\n", d);
+		fprintf(fp, "\tt = %s << %u;\n", d, imm);
+		break;
+
+	case JRISC_op_shrq:
+		fprintf(fp, "\tc = %s & 1;\n", d);
+		if (imm < 32) {
+			fprintf(fp, "\tt = %s >> %u;\n", d, imm);
+		} else {
+			fprintf(fp, "\tt = 0;\n");
+		}
+		break;
+
+	case JRISC_op_sharq:
+		/* Same result once all sign bits */
+		fprintf(fp, "\tc = %s & 1;\n", d);
+		fprintf(fp, "\tt = (uint32_t)((int32_t)%s >> %u);\n", d,
+				(imm > 31) ? 31 : imm);
+		break;
+
+	case JRISC_op_ror:
+	case JRISC_op_rorq:
+		fprintf(fp, "\tu = %s %% 32;\n", s);
+		fprintf(fp, "\tc = %s >> 31;\n", d);
+		fprintf(fp, "\tt = u ? ((%s >> u) | (%s << (32 - u))) : %s;\n",
+				d, d, d);
+		break;
+
+	case JRISC_op_sat8:
+	case JRISC_op_sat16:
+	case JRISC_op_sat24:
+		fprintf(fp, "\tt = (%s >> 31) ? 0 : ((%s > 0x%xu) ? 0x%xu : %s);\n",
+				d, d,
+				(inst->opName == JRISC_op_sat8) ? 0xff :
+				((inst->opName == JRISC_op_sat16) ? 0xffff : 0xffffff),
+				(inst->opName == JRISC_op_sat8) ? 0xff :
+				((inst->opName == JRISC_op_sat16) ? 0xffff : 0xffffff),
+				d);
+		break;
+
+	case JRISC_op_sat16s:
+		fprintf(fp, "\tt = ((int32_t)%s < -32768) ? (uint32_t)-32768 :\n", d);
+		fprintf(fp, "\t\t(((int32_t)%s > 32767) ? 32767 : %s);\n", d, d);
+		break;
+
+	case JRISC_op_mirror:
+		fprintf(fp, "\tt = %s;\n", d);
+		fprintf(fp, "\tt = ((t >> 1) & 0x55555555u) | "
+				"((t & 0x55555555u) << 1);\n");
+		fprintf(fp, "\tt = ((t >> 2) & 0x33333333u) | "
+				"((t & 0x33333333u) << 2);\n");
+		fprintf(fp, "\tt = ((t >> 4) & 0x0f0f0f0fu) | "
+				"((t & 0x0f0f0f0fu) << 4);\n");
+		fprintf(fp, "\tt = ((t >> 8) & 0x00ff00ffu) | "
+				"((t & 0x00ff00ffu) << 8);\n");
+		fprintf(fp, "\tt = (t >> 16) | (t << 16);\n");
+		break;
+
+	case JRISC_op_move:
+	case JRISC_op_moveq:
+		fprintf(fp, "\tt = %s;\n", s);
+		flags = 0;
+		break;
+
+	case JRISC_op_movei:
+		fprintf(fp, "\tt = 0x%xu;\n", inst->longImmediate);
+		flags = 0;
+		break;
+
+	case JRISC_op_movepc:
+		fprintf(fp, "\tt = 0x%xu;\n", inst->address);
+		flags = 0;
+		break;
+
+	case JRISC_op_moveta:
+		fprintf(fp, "\tst->altRegs[%u] = %s;\n", dst, s);
+		writeDst = false;
+		flags = 0;
+		break;
+
+	case JRISC_op_movefa:
+		fprintf(fp, "\tt = st->altRegs[%u];\n", inst->regSrc.val.reg);
+		flags = 0;
+		break;
+
+	case JRISC_op_nop:
+		writeDst = false;
+		flags = 0;
+		break;
+
+	default:
+		jriscRecompStop(rc, inst->address, "JRISC_recompBadInstruction");
+		return;
+	}
+
+	if (writeDst) fprintf(fp, "\t%s = t;\n", d);
+	if (flags & RECOMP_FLAG_Z) fprintf(fp, "\tz = t == 0;\n");
+	if (flags & RECOMP_FLAG_N) fprintf(fp, "\tn = t >> 31;\n");
+	fprintf(fp, "\tsteps++;\n");
+}
+
+/* The C for whether a jump or jr condition holds */
+static void
+jriscRecompCondition(uint8_t cond, char *out)
+{
+	const char *f = (cond & 0x10) ? "n" : "c";
+	const char *terms[4];
+	unsigned numTerms = 0;
+	unsigned i;
+
+	if (cond & 0x1) terms[numTerms++] = "z";
+	if (cond & 0x2) terms[numTerms++] = "!z";
+	if (cond & 0x4) terms[numTerms++] = f;
+	if (cond & 0x8) terms[numTerms++] = (cond & 0x10) ? "!n" : "!c";
+
+	if (!numTerms) {
+		strcpy(out, "1");
+		return;
+	}
+
+	strcpy(out, "!(");
+	for (i = 0; i < numTerms; i++) {
+		if (i) strcat(out, " || ");
+		strcat(out, terms[i]);
+	}
+	strcat(out, ")");
+}
+
+/* Go on at <address>, known at compile time, counting it as a branch */
+static void
+jriscRecompGoto(const struct Recomp *rc, uint32_t address, const char *indent)
+{
+	FILE *fp = rc->fp;
+
+	if (jriscRecompFind(rc, address) == JRISC_PROGRAM_NO_INSTRUCTION) {
+		fprintf(fp, "%sdest = 0x%xu;\n", indent, address);
+		fprintf(fp, "%sgoto dispatch;\n", indent);
+		return;
+	}
+
+	fprintf(fp, "%sif (maxSteps && (steps >= maxSteps)) {\n", indent);
+	fprintf(fp, "%s\tdest = 0x%xu;\n", indent, address);
+	fprintf(fp, "%s\tstatus = JRISC_recompTimeout;\n", indent);
+	fprintf(fp, "%s\tgoto leave;\n", indent);
+	fprintf(fp, "%s}\n", indent);
+	fprintf(fp, "%sgoto L_%x;\n", indent, address);
+}
+
+/* A jump or jr at instruction <index>, with its delay slot */
+static void
+jriscRecompBranch(const struct Recomp *rc, size_t index)
+{
+	const struct JRISC_Program *program = rc->program;
+	const struct JRISC_Instruction *inst = &program->instructions[index];
+	const struct JRISC_Instruction *slot;
+	FILE *fp = rc->fp;
+	const uint32_t slotAddress = inst->address + 2;
+	uint32_t after;
+	char cond[32];
+	char resume[40];
+
+	jriscRecompCondition(inst->regDst.val.condition, cond);
+	fprintf(fp, "\ttaken = %s;\n", cond);
+	if (inst->opName == JRISC_op_jr) {
+		fprintf(fp, "\ttarget = 0x%xu;\n",
+				jriscInstructionBranchTarget(inst));
+	} else {
+		fprintf(fp, "\ttarget = r%u;\n", inst->regSrc.val.reg);
+	}
+	fprintf(fp, "\tsteps++;\n");
+
+	/* A branch at the very end has its delay slot outside the program */
+	if ((index + 1) >= program->numInstructions) {
+		fprintf(fp, "\tdest = 0x%xu;\n", slotAddress);
+		fprintf(fp, "\tgoto leave;\n");
+		return;
+	}
+
+	slot = &program->instructions[index + 1];
+	if ((slot->opName == JRISC_invalidOpName) ||
+		jriscInstructionIsBranch(slot)) {
+		jriscRecompStop(rc, slotAddress, "JRISC_recompBadInstruction");
+		return;
+	}
+
+	after = slotAddress + jriscProgramInstructionSize(slot);
+	sprintf(resume, "taken ? target : 0x%xu", after);
+	jriscRecompBody(rc, slot, resume);
+
+	fprintf(fp, "\tif (taken) {\n");
+	if (inst->opName == JRISC_op_jr) {
+		jriscRecompGoto(rc, jriscInstructionBranchTarget(inst), "\t\t");
+	} else {
+		fprintf(fp, "\t\tdest = target;\n");
+		fprintf(fp, "\t\tgoto dispatch;\n");
+	}
+	fprintf(fp, "\t}\n");
+
+	if ((after - program->baseAddress) < rc->programSize) {
+		fprintf(fp, "\tgoto L_%x;\n", after);
+	} else {
+		fprintf(fp, "\tdest = 0x%xu;\n", after);
+		fprintf(fp, "\tgoto leave;\n");
+	}
+}
+
+static void
+jriscRecompDeclarations(const struct Recomp *rc, const char *name)
+{
+	FILE *fp = rc->fp;
+
+	fprintf(fp, "#include <stdint.h>\n");
+	fprintf(fp, "\n");
+	fprintf(fp, "#ifndef JRISC_RECOMP_STATE_\n");
+	fprintf(fp, "#define JRISC_RECOMP_STATE_\n");
+	fprintf(fp, "\n");
+	fprintf(fp, "enum JRISC_RecompStatus {\n");
+	fprintf(fp, "\tJRISC_recompDone,\t\t\t/* Ran off the end of the code or "
+			"left it */\n");
+	fprintf(fp, "\tJRISC_recompTimeout,\t\t/* Still running after maxSteps "
+			"*/\n");
+	fprintf(fp, "\tJRISC_recompBadAddress,\t\t/* Load or store outside local "
+			"RAM and flags */\n");
+	fprintf(fp, "\tJRISC_recompBadInstruction\t/* Not supported, or jumped "
+			"into a movei */\n");
+	fprintf(fp, "};\n");
+	fprintf(fp, "\n");
+	fprintf(fp, "/*\n");
+	fprintf(fp, " * A routine's state. Everything but the status is read on "
+			"entry, and all of\n");
+	fprintf(fp, " * it is written on return.\n");
+	fprintf(fp, " */\n");
+	fprintf(fp, "struct JRISC_RecompState {\n");
+	fprintf(fp, "\tuint32_t regs[32];\t\t\t/* The current bank */\n");
+	fprintf(fp, "\tuint32_t altRegs[32];\t\t/* The other bank */\n");
+	fprintf(fp, "\tuint32_t z, c, n;\t\t\t/* The flags, 0 or 1 */\n");
+	fprintf(fp, "\tuint32_t regpage;\t\t\t/* REGPAGE, 0 or 1 */\n");
+	fprintf(fp, "\tint64_t acc;\t\t\t\t/* imultn/imacn/resmac's accumulator "
+			"*/\n");
+	fprintf(fp, "\tuint8_t *ram;\t\t\t\t/* Local RAM as big-endian bytes, or "
+			"NULL */\n");
+	fprintf(fp, "\tuint32_t pc;\t\t\t\t/* Where to start, then where it "
+			"stopped */\n");
+	fprintf(fp, "\tuint64_t steps;\t\t\t\t/* Instructions executed */\n");
+	fprintf(fp, "\tuint64_t maxSteps;\t\t\t/* Stop once past this many, if "
+			"not 0 */\n");
+	fprintf(fp, "\tenum JRISC_RecompStatus status;\n");
+	fprintf(fp, "};\n");
+	fprintf(fp, "\n");
+	fprintf(fp, "#endif /* JRISC_RECOMP_STATE_ */\n");
+	fprintf(fp, "\n");
+	fprintf(fp, "/*\n");
+	fprintf(fp, " * $%06x-$%06x, for the %s. ram must be %u bytes, from "
+			"$%06x.\n",
+			rc->program->baseAddress,
+			rc->program->baseAddress + rc->programSize - 1,
+			(rc->program->cpu == JRISC_dsp) ? "DSP" : "GPU",
+			rc->ramSize, rc->ramAddress);
+	fprintf(fp, " */\n");
+	fprintf(fp, "extern void\n");
+	fprintf(fp, "%s(struct JRISC_RecompState *st);\n", name);
+}
+
+/*
+ * Local RAM and the flags register. 1 if outside them, 2 for the flags. They
+ * are guarded so routines for the same CPU can share a file.
+ */
+static void
+jriscRecompAccessors(const struct Recomp *rc)
+{
+	FILE *fp = rc->fp;
+
+	fprintf(fp, "#ifndef JRISC_RECOMP_%s_ACCESS_\n",
+			(rc->program->cpu == JRISC_dsp) ? "DSP" : "GPU");
+	fprintf(fp, "#define JRISC_RECOMP_%s_ACCESS_\n",
+			(rc->program->cpu == JRISC_dsp) ? "DSP" : "GPU");
+	fprintf(fp, "\n");
+	fprintf(fp, "static inline int\n");
+	fprintf(fp, "jriscRecomp%sLoad(const struct JRISC_RecompState *st, "
+			"uint32_t address,\n",
+			rc->cpuName);
+	fprintf(fp, "\t\t\t\t   unsigned size, uint32_t *value)\n");
+	fprintf(fp, "{\n");
+	fprintf(fp, "\tconst uint8_t *p;\n");
+	fprintf(fp, "\tuint32_t offset;\n");
+	fprintf(fp, "\n");
+	fprintf(fp, "\taddress &= ~(uint32_t)(size - 1);\n");
+	fprintf(fp, "\tif ((size == 4) && (address == 0x%xu)) return 2;\n",
+			rc->flagsAddress);
+	fprintf(fp, "\n");
+	fprintf(fp, "\toffset = address - 0x%xu;\n", rc->ramAddress);
+	fprintf(fp, "\tif (!st->ram || (address < 0x%xu) || (offset >= 0x%xu)) "
+			"return 1;\n",
+			rc->ramAddress, rc->ramSize);
+	fprintf(fp, "\n");
+	fprintf(fp, "\tp = st->ram + offset;\n");
+	fprintf(fp, "\t*value = 0;\n");
+	fprintf(fp, "\twhile (size--) *value = (*value << 8) | *p++;\n");
+	fprintf(fp, "\n");
+	fprintf(fp, "\treturn 0;\n");
+	fprintf(fp, "}\n");
+	fprintf(fp, "\n");
+	fprintf(fp, "static inline int\n");
+	fprintf(fp, "jriscRecomp%sStore(struct JRISC_RecompState *st, uint32_t "
+			"address,\n",
+			rc->cpuName);
+	fprintf(fp, "\t\t\t\t\tunsigned size, uint32_t value)\n");
+	fprintf(fp, "{\n");
+	fprintf(fp, "\tuint8_t *p;\n");
+	fprintf(fp, "\tuint32_t offset;\n");
+	fprintf(fp, "\n");
+	fprintf(fp, "\taddress &= ~(uint32_t)(size - 1);\n");
+	fprintf(fp, "\tif ((size == 4) && (address == 0x%xu)) return 2;\n",
+			rc->flagsAddress);
+	fprintf(fp, "\n");
+	fprintf(fp, "\toffset = address - 0x%xu;\n", rc->ramAddress);
+	fprintf(fp, "\tif (!st->ram || (address < 0x%xu) || (offset >= 0x%xu)) "
+			"return 1;\n",
+			rc->ramAddress, rc->ramSize);
+	fprintf(fp, "\n");
+	fprintf(fp, "\tp = st->ram + offset;\n");
+	fprintf(fp, "\twhile (size--) *p++ = (uint8_t)(value >> (size * 8));\n");
+	fprintf(fp, "\n");
+	fprintf(fp, "\treturn 0;\n");
+	fprintf(fp, "}\n");
+	fprintf(fp, "\n");
+	fprintf(fp, "#endif\n");
+}
+
+static void
+jriscRecompFunction(const struct Recomp *rc, const char *name)
+{
+	const struct JRISC_Program *program = rc->program;
+	const struct JRISC_Instruction *inst;
+	FILE *fp = rc->fp;
+	bool stores = false;
+	char resume[16];
+	size_t i;
+	unsigned r;
+
+	for (i = 0; i < program->numInstructions; i++) {
+		switch (program->instructions[i].opName) {
+		case JRISC_op_storeb:
+		case JRISC_op_storew:
+		case JRISC_op_store:
+		case JRISC_op_storer14n:
+		case JRISC_op_storer15n:
+		case JRISC_op_storer14r:
+		case JRISC_op_storer15r:
+			stores = true;
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	fprintf(fp, "void\n");
+	fprintf(fp, "%s(struct JRISC_RecompState *st)\n", name);
+	fprintf(fp, "{\n");
+	for (r = 0; r < 32; r++) {
+		fprintf(fp, "\tuint32_t r%u = st->regs[%u];\n", r, r);
+	}
+	fprintf(fp, "\tuint32_t z = st->z, c = st->c, n = st->n;\n");
+	fprintf(fp, "\tint64_t acc = st->acc;\n");
+	fprintf(fp, "\tuint64_t steps = st->steps;\n");
+	fprintf(fp, "\tconst uint64_t maxSteps = st->maxSteps;\n");
+	fprintf(fp, "\tenum JRISC_RecompStatus status = JRISC_recompDone;\n");
+	fprintf(fp, "\tuint32_t dest = st->pc;\n");
+	fprintf(fp, "\tuint32_t t = 0, u = 0, value = 0, target = 0;\n");
+	fprintf(fp, "\tint32_t shift = 0;\n");
+	fprintf(fp, "\tint taken = 0;\n");
+	fprintf(fp, "\n");
+	fprintf(fp, "\t(void)t; (void)u; (void)value; (void)target; (void)shift; "
+			"(void)taken;\n");
+	fprintf(fp, "\n");
+
+	/*
+	 * Computed jumps, and the entry point, go by address. Leaving the program
+	 * counts before running out of steps, as in jriscExecRun.
+	 */
+	fprintf(fp, "\tgoto dispatch;\n");
+	fprintf(fp, "\n");
+	fprintf(fp, "dispatch:\n");
+	fprintf(fp, "\tif ((dest - 0x%xu) >= 0x%xu) goto leave;\n",
+			program->baseAddress, rc->programSize);
+	fprintf(fp, "\tif (maxSteps && (steps >= maxSteps)) {\n");
+	fprintf(fp, "\t\tstatus = JRISC_recompTimeout;\n");
+	fprintf(fp, "\t\tgoto leave;\n");
+	fprintf(fp, "\t}\n");
+	fprintf(fp, "\tswitch (dest) {\n");
+	for (i = 0; i < program->numInstructions; i++) {
+		inst = &program->instructions[i];
+		fprintf(fp, "\tcase 0x%xu: goto L_%x;\n", inst->address,
+				inst->address);
+	}
+	fprintf(fp, "\tdefault: break;\n");
+	fprintf(fp, "\t}\n");
+	fprintf(fp, "\tstatus = JRISC_recompBadInstruction;\n");
+	fprintf(fp, "\tgoto leave;\n");
+
+	for (i = 0; i < program->numInstructions; i++) {
+		inst = &program->instructions[i];
+		fprintf(fp, "\n");
+		fprintf(fp, "L_%x:\n", inst->address);
+
+		if (inst->opName == JRISC_invalidOpName) {
+			jriscRecompStop(rc, inst->address, "JRISC_recompBadInstruction");
+		} else if (jriscInstructionIsBranch(inst)) {
+			jriscRecompBranch(rc, i);
+		} else {
+			sprintf(resume, "0x%xu",
+					inst->address + jriscProgramInstructionSize(inst));
+			jriscRecompBody(rc, inst, resume);
+		}
+	}
+
+	/* Running off the end leaves the program */
+	fprintf(fp, "\tdest = 0x%xu;\n", program->baseAddress + rc->programSize);
+	fprintf(fp, "\tgoto leave;\n");
+
+	if (stores) {
+		fprintf(fp, "\n");
+		fprintf(fp, "setflags:\n");
+		fprintf(fp, "\tz = value & 1;\n");
+		fprintf(fp, "\tc = (value >> 1) & 1;\n");
+		fprintf(fp, "\tn = (value >> 2) & 1;\n");
+		fprintf(fp, "\tif (((value >> 14) & 1) != st->regpage) {\n");
+		for (r = 0; r < 32; r++) {
+			fprintf(fp, "\t\tt = r%u; r%u = st->altRegs[%u]; "
+					"st->altRegs[%u] = t;\n", r, r, r, r);
+		}
+		fprintf(fp, "\t\tst->regpage ^= 1;\n");
+		fprintf(fp, "\t}\n");
+		fprintf(fp, "\tgoto dispatch;\n");
+	}
+
+	fprintf(fp, "\n");
+	fprintf(fp, "leave:\n");
+	for (r = 0; r < 32; r++) fprintf(fp, "\tst->regs[%u] = r%u;\n", r, r);
+	fprintf(fp, "\tst->z = z;\n");
+	fprintf(fp, "\tst->c = c;\n");
+	fprintf(fp, "\tst->n = n;\n");
+	fprintf(fp, "\tst->acc = acc;\n");
+	fprintf(fp, "\tst->pc = dest;\n");
+	fprintf(fp, "\tst->steps = steps;\n");
+	fprintf(fp, "\tst->status = status;\n");
+	fprintf(fp, "}\n");
+}
+
+enum JRISC_Error
+jriscRecompWrite(const struct JRISC_Program *program,
+				 const char *name,
+				 bool header,
+				 FILE *fp)
+{
+	struct Recomp rc;
+
+	if (!jriscRecompIsIdentifier(name)) return JRISC_ERROR_invalidValue;
+
+	memset(&rc, 0, sizeof(rc));
+	rc.program = program;
+	rc.fp = fp;
+	rc.programSize = (uint32_t)(program->numWords * 2);
+
+	if (program->cpu == JRISC_dsp) {
+		rc.ramAddress = JRISC_DSP_RAM;
+		rc.ramSize = JRISC_DSP_RAM_SIZE;
+		rc.flagsAddress = JRISC_DSP_FLAGS;
+		rc.cpuName = "Dsp";
+	} else {
+		rc.ramAddress = JRISC_GPU_RAM;
+		rc.ramSize = JRISC_GPU_RAM_SIZE;
+		rc.flagsAddress = JRISC_GPU_FLAGS;
+		rc.cpuName = "Gpu";
+	}
+
+	fprintf(fp, "/* Recompiled from Jaguar RISC code by jrecomp */\n");
+	fprintf(fp, "\n");
+	jriscRecompDeclarations(&rc, name);
+
+	if (!header) {
+		fprintf(fp, "\n");
+		jriscRecompAccessors(&rc);
+		fprintf(fp, "\n");
+		jriscRecompFunction(&rc, name);
+	}
+
+	return ferror(fp) ? JRISC_ERROR_ioError : JRISC_success;
+}
@@ -0,0 +1,54 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#ifndef JRISC_RECOMP_H_
+#define JRISC_RECOMP_H_
+
+#include "jrisc_base.h"
+#include "jrisc_program.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+
+/*
+ * Translate a program into a C function that runs it natively, as
+ *
+ *   void <name>(struct JRISC_RecompState *st);
+ *
+ * The generated file needs only a C99 compiler and the standard headers. It
+ * defines the state struct, which mirrors struct JRISC_ExecState and is
+ * documented in the output, and the function, which starts at st->pc and
+ * returns with st->status, st->pc and the rest of the state set as
+ * jriscExecRun leaves them.
+ *
+ * Every instruction becomes a labeled block of C, and the registers, flags
+ * and accumulator live in locals for the compiler to keep in host registers.
+ * jr targets and fall-through are plain gotos. Each branch's delay slot is
+ * compiled again after it, so the slot runs before the branch is taken. A
+ * jump (rN), or a jr to an address that isn't known to start an instruction,
+ * goes through a switch over every instruction's address, which is also how
+ * the function starts at st->pc. Addresses the switch doesn't know stop the
+ * function, as if it left the program, so the caller can go on interpreting
+ * from st->pc. Loads and stores reach local RAM, as big-endian bytes, and
+ * the flags register; a store that changes REGPAGE swaps the locals with
+ * st->altRegs.
+ *
+ * The instructions jriscExecRun doesn't emulate, and a branch in a delay
+ * slot, stop with JRISC_recompBadInstruction. st->maxSteps, if it isn't 0,
+ * is only checked when a branch is taken, so a routine may run a little past
+ * it before stopping.
+ *
+ * With <header> set, only the declarations are written, for other files to
+ * call the function by. Returns JRISC_ERROR_invalidValue if <name> isn't a C
+ * identifier.
+ */
+extern enum JRISC_Error
+jriscRecompWrite(const struct JRISC_Program *program,
+				 const char *name,
+				 bool header,
+				 FILE *fp);
+
+#endif /* JRISC_RECOMP_H_ */
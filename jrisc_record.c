@@ -0,0 +1,261 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_endian.h"
+#include "jrisc_inst.h"
+#include "jrisc_program.h"
+#include "jrisc_record.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static const char recordMagic[8] = { 'J', 'R', 'I', 'S', 'C', 'R', 'E', 'C' };
+
+/* As in jrisc_stats.c, the optable's own names, which are all distinct */
+static const char *jriscRecordOpNames[] = {
+#define JRISC_OP(opName, opNum, regSrcType, regDstType, swapRegs, cpus) #opName,
+#include "jrisc_optable.h"
+#undef JRISC_OP
+};
+
+static const char *jriscRecordRegTypeNames[] = {
+	"reg",
+	"indirect",
+	"condition",
+	"simmediate",
+	"uimmediate",
+	"zuimmediate",
+	"shlimmediate",
+	"pcoffset",
+	"flag",
+	"unused",
+};
+
+static int32_t
+jriscRecordOperandValue(const struct JRISC_Instruction *instruction,
+						const struct JRISC_OpReg *reg)
+{
+	const uint8_t u = reg->val.uimmediate ? reg->val.uimmediate : 32;
+
+	switch (reg->type) {
+	case JRISC_reg:
+	case JRISC_indirect:
+		return reg->val.reg;
+
+	case JRISC_condition:
+		return reg->val.condition;
+
+	case JRISC_simmediate:
+		return reg->val.simmediate;
+
+	case JRISC_uimmediate:
+		return u;
+
+	case JRISC_zuimmediate:
+		return reg->val.uimmediate;
+
+	case JRISC_shlimmediate:
+		return 32 - u;
+
+	case JRISC_pcoffset:
+		return (int32_t)jriscInstructionBranchTarget(instruction);
+
+	case JRISC_flag:
+		return reg->val.flag;
+
+	default:
+		return 0;
+	}
+}
+
+void
+jriscRecordFromInstruction(const struct JRISC_Instruction *instruction,
+						   struct JRISC_Record *recordOut)
+{
+	memset(recordOut, 0, sizeof(*recordOut));
+
+	recordOut->address = instruction->address;
+	recordOut->opName = (uint8_t)instruction->opName;
+	recordOut->srcType = (uint8_t)instruction->regSrc.type;
+	recordOut->dstType = (uint8_t)instruction->regDst.type;
+	recordOut->srcValue = jriscRecordOperandValue(instruction,
+												  &instruction->regSrc);
+	recordOut->dstValue = jriscRecordOperandValue(instruction,
+												  &instruction->regDst);
+	recordOut->words[0] = jriscInstructionToRaw(instruction);
+	recordOut->numWords = 1;
+
+	if (instruction->opName == JRISC_op_movei) {
+		recordOut->longImmediate = instruction->longImmediate;
+		recordOut->words[1] = jriscInstructionLongImmediateLow(instruction);
+		recordOut->words[2] = jriscInstructionLongImmediateHigh(instruction);
+		recordOut->numWords = 3;
+	}
+}
+
+void
+jriscRecordEncode(const struct JRISC_Record *record,
+				  uint8_t bytesOut[JRISC_RECORD_SIZE])
+{
+	jriscStoreLE32(&bytesOut[0], record->address);
+	jriscStoreLE32(&bytesOut[4], record->longImmediate);
+	jriscStoreLE16(&bytesOut[8], record->words[0]);
+	jriscStoreLE16(&bytesOut[10], record->words[1]);
+	jriscStoreLE16(&bytesOut[12], record->words[2]);
+	bytesOut[14] = record->numWords;
+	bytesOut[15] = record->opName;
+	bytesOut[16] = record->srcType;
+	bytesOut[17] = record->dstType;
+	jriscStoreLE16(&bytesOut[18], 0);
+	jriscStoreLE32(&bytesOut[20], (uint32_t)record->srcValue);
+	jriscStoreLE32(&bytesOut[24], (uint32_t)record->dstValue);
+}
+
+void
+jriscRecordDecode(const uint8_t bytes[JRISC_RECORD_SIZE],
+				  struct JRISC_Record *recordOut)
+{
+	recordOut->address = jriscLoadLE32(&bytes[0]);
+	recordOut->longImmediate = jriscLoadLE32(&bytes[4]);
+	recordOut->words[0] = jriscLoadLE16(&bytes[8]);
+	recordOut->words[1] = jriscLoadLE16(&bytes[10]);
+	recordOut->words[2] = jriscLoadLE16(&bytes[12]);
+	recordOut->numWords = bytes[14];
+	recordOut->opName = bytes[15];
+	recordOut->srcType = bytes[16];
+	recordOut->dstType = bytes[17];
+	recordOut->srcValue = (int32_t)jriscLoadLE32(&bytes[20]);
+	recordOut->dstValue = (int32_t)jriscLoadLE32(&bytes[24]);
+}
+
+enum JRISC_Error
+jriscRecordWriteHeader(FILE *fp, enum JRISC_CPU cpu)
+{
+	uint8_t header[JRISC_RECORD_HEADER_SIZE];
+
+	memset(header, 0, sizeof(header));
+	memcpy(header, recordMagic, sizeof(recordMagic));
+	jriscStoreLE16(&header[8], JRISC_RECORD_VERSION);
+	jriscStoreLE16(&header[10], JRISC_RECORD_SIZE);
+	header[12] = (uint8_t)cpu;
+
+	if (fwrite(header, sizeof(header), 1, fp) != 1) return JRISC_ERROR_ioError;
+
+	return JRISC_success;
+}
+
+enum JRISC_Error
+jriscRecordReadHeader(const void *data, size_t size, enum JRISC_CPU *cpuOut)
+{
+	const uint8_t *header = data;
+
+	if ((size < JRISC_RECORD_HEADER_SIZE) ||
+		memcmp(header, recordMagic, sizeof(recordMagic)) ||
+		(jriscLoadLE16(&header[8]) != JRISC_RECORD_VERSION) ||
+		(jriscLoadLE16(&header[10]) != JRISC_RECORD_SIZE)) {
+		return JRISC_ERROR_invalidFormat;
+	}
+
+	if (cpuOut) *cpuOut = (enum JRISC_CPU)header[12];
+
+	return JRISC_success;
+}
+
+enum JRISC_Error
+jriscRecordWriterCreate(FILE *fp,
+						enum JRISC_RecordFormat format,
+						struct JRISC_RecordWriter **writerOut)
+{
+	struct JRISC_RecordWriter *writer = malloc(sizeof(*writer));
+
+	if (!writer) return JRISC_ERROR_outOfMemory;
+
+	writer->fp = fp;
+	writer->format = format;
+	writer->used = 0;
+	writer->error = JRISC_success;
+
+	*writerOut = writer;
+
+	return JRISC_success;
+}
+
+static size_t
+jriscRecordFormatJson(const struct JRISC_Record *record, char *out)
+{
+	char *p = out;
+	unsigned w;
+
+	p += sprintf(p, "{\"address\":%u,\"words\":[", (unsigned)record->address);
+	for (w = 0; w < record->numWords; w++) {
+		p += sprintf(p, "%s%u", w ? "," : "", (unsigned)record->words[w]);
+	}
+	p += sprintf(p, "],\"numWords\":%u,\"opName\":\"%s\","
+				 "\"src\":{\"type\":\"%s\",\"value\":%d},"
+				 "\"dst\":{\"type\":\"%s\",\"value\":%d},"
+				 "\"longImmediate\":%u}\n",
+				 (unsigned)record->numWords,
+				 jriscRecordOpNames[record->opName],
+				 jriscRecordRegTypeNames[record->srcType],
+				 (int)record->srcValue,
+				 jriscRecordRegTypeNames[record->dstType],
+				 (int)record->dstValue,
+				 (unsigned)record->longImmediate);
+
+	return p - out;
+}
+
+/* Longer than any record in either format */
+#define RECORD_MAX_LENGTH	256
+
+enum JRISC_Error
+jriscRecordWriterAdd(struct JRISC_RecordWriter *writer,
+					 const struct JRISC_Instruction *instruction)
+{
+	struct JRISC_Record record;
+
+	if (writer->error != JRISC_success) return writer->error;
+
+	if ((sizeof(writer->buffer) - writer->used) < RECORD_MAX_LENGTH) {
+		if (jriscRecordWriterFlush(writer) != JRISC_success) {
+			return writer->error;
+		}
+	}
+
+	jriscRecordFromInstruction(instruction, &record);
+
+	if (writer->format == JRISC_recordBinary) {
+		jriscRecordEncode(&record, (uint8_t *)&writer->buffer[writer->used]);
+		writer->used += JRISC_RECORD_SIZE;
+	} else {
+		writer->used += jriscRecordFormatJson(&record,
+											  &writer->buffer[writer->used]);
+	}
+
+	return JRISC_success;
+}
+
+enum JRISC_Error
+jriscRecordWriterFlush(struct JRISC_RecordWriter *writer)
+{
+	if (writer->error != JRISC_success) return writer->error;
+
+	if (writer->used &&
+		(fwrite(writer->buffer, 1, writer->used, writer->fp) !=
+		 writer->used)) {
+		writer->error = JRISC_ERROR_ioError;
+	}
+	writer->used = 0;
+
+	return writer->error;
+}
+
+void
+jriscRecordWriterDestroy(struct JRISC_RecordWriter *writer)
+{
+	free(writer);
+}
@@ -0,0 +1,129 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#ifndef JRISC_RECORD_H_
+#define JRISC_RECORD_H_
+
+#include "jrisc_base.h"
+#include "jrisc_inst.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/*
+ * Machine-readable disassembly, for tools that would otherwise have to parse
+ * jdis's text.
+ *
+ * The binary format is a 16-byte header followed by fixed-size records, all
+ * little-endian, so it can be mapped and indexed directly:
+ *
+ *   Header:  0  char[8]  "JRISCREC"
+ *            8  uint16   Version, JRISC_RECORD_VERSION
+ *           10  uint16   Record size, JRISC_RECORD_SIZE
+ *           12  uint8    CPU, as enum JRISC_CPU
+ *           13  uint8[3] Reserved, zero
+ *
+ *   Record:  0  uint32   Address
+ *            4  uint32   longImmediate (movei only, otherwise zero)
+ *            8  uint16[3] Raw words, numWords of them, then zero
+ *           14  uint8    numWords
+ *           15  uint8    opName, as enum JRISC_OpName
+ *           16  uint8    Source operand type, as enum JRISC_RegType
+ *           17  uint8    Destination operand type
+ *           18  uint16   Reserved, zero
+ *           20  int32    Source operand value
+ *           24  int32    Destination operand value
+ *
+ * Operand values are register numbers for registers and indirect registers,
+ * the condition code bits for conditions, the immediate's actual value (so
+ * 1-32 for addq, and the shift count for shlq), and the target address for jr.
+ *
+ * The version changes whenever the layout or the enum numbering does.
+ *
+ * The JSON Lines format holds one object per instruction with the same
+ * fields, with opName and operand types as their enum names, e.g.:
+ *
+ *   {"address":15740928,"words":[38914,12314,240],"numWords":3,
+ *    "opName":"movei","src":{"type":"unused","value":0},
+ *    "dst":{"type":"reg","value":2},"longImmediate":15740954}
+ *
+ * but all on one line.
+ */
+#define JRISC_RECORD_VERSION		1
+#define JRISC_RECORD_HEADER_SIZE	16
+#define JRISC_RECORD_SIZE			28
+
+enum JRISC_RecordFormat {
+	JRISC_recordBinary,
+	JRISC_recordJson
+};
+
+struct JRISC_Record {
+	uint32_t address;
+	uint32_t longImmediate;
+	uint16_t words[3];
+	uint8_t numWords;
+	uint8_t opName;
+	uint8_t srcType;
+	uint8_t dstType;
+	int32_t srcValue;
+	int32_t dstValue;
+};
+
+/* Collects records and writes them to a file in large blocks */
+struct JRISC_RecordWriter {
+	FILE *fp;
+	enum JRISC_RecordFormat format;
+	size_t used;
+	enum JRISC_Error error;
+	char buffer[64 * 1024];
+};
+
+extern void
+jriscRecordFromInstruction(const struct JRISC_Instruction *instruction,
+						   struct JRISC_Record *recordOut);
+
+extern void
+jriscRecordEncode(const struct JRISC_Record *record,
+				  uint8_t bytesOut[JRISC_RECORD_SIZE]);
+
+extern void
+jriscRecordDecode(const uint8_t bytes[JRISC_RECORD_SIZE],
+				  struct JRISC_Record *recordOut);
+
+/* Write the binary format's header. JSON Lines has none. */
+extern enum JRISC_Error
+jriscRecordWriteHeader(FILE *fp, enum JRISC_CPU cpu);
+
+/*
+ * Check the header at the start of <data>. Returns JRISC_ERROR_invalidFormat
+ * if it is missing, or is from a different version of the format.
+ */
+extern enum JRISC_Error
+jriscRecordReadHeader(const void *data, size_t size, enum JRISC_CPU *cpuOut);
+
+extern enum JRISC_Error
+jriscRecordWriterCreate(FILE *fp,
+						enum JRISC_RecordFormat format,
+						struct JRISC_RecordWriter **writerOut);
+
+/*
+ * Errors writing to the file are remembered, and returned by this and every
+ * later call.
+ */
+extern enum JRISC_Error
+jriscRecordWriterAdd(struct JRISC_RecordWriter *writer,
+					 const struct JRISC_Instruction *instruction);
+
+extern enum JRISC_Error
+jriscRecordWriterFlush(struct JRISC_RecordWriter *writer);
+
+/* Does not flush */
+extern void
+jriscRecordWriterDestroy(struct JRISC_RecordWriter *writer);
+
+#endif /* JRISC_RECORD_H_ */
@@ -0,0 +1,232 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_inst.h"
+#include "jrisc_regs.h"
+
+#include <stdio.h>
+
+static JRISC_RegMask
+jriscOpRegMask(const struct JRISC_OpReg *reg)
+{
+	switch (reg->type) {
+	case JRISC_reg:			/* Fall through */
+	case JRISC_indirect:
+		return JRISC_REGMASK_REG(reg->val.reg);
+
+	default:
+		return 0;
+	}
+}
+
+JRISC_RegMask
+jriscConditionRegMask(uint8_t condition)
+{
+	JRISC_RegMask mask = 0;
+
+	/* Bits 0 and 1 test Z, and bits 2 and 3 test C, or N if bit 4 is set */
+	if (condition & 0x3) mask |= JRISC_REGMASK_Z;
+	if (condition & 0xc) {
+		mask |= (condition & 0x10) ? JRISC_REGMASK_N : JRISC_REGMASK_C;
+	}
+
+	return mask;
+}
+
+void
+jriscInstructionRegMasks(const struct JRISC_Instruction *instruction,
+						 JRISC_RegMask *readsOut,
+						 JRISC_RegMask *writesOut)
+{
+	const JRISC_RegMask src = jriscOpRegMask(&instruction->regSrc);
+	const JRISC_RegMask dst = jriscOpRegMask(&instruction->regDst);
+	JRISC_RegMask reads = 0;
+	JRISC_RegMask writes = 0;
+
+	switch (instruction->opName) {
+	case JRISC_op_addc:			/* Fall through */
+	case JRISC_op_subc:
+		reads = src | dst | JRISC_REGMASK_C;
+		writes = dst | JRISC_REGMASK_FLAGS;
+		break;
+
+	case JRISC_op_addqt:		/* Fall through */
+	case JRISC_op_subqt:		/* Fall through */
+	case JRISC_op_pack:			/* Fall through */
+	case JRISC_op_unpack:
+		reads = dst;
+		writes = dst;
+		break;
+
+	case JRISC_op_btst:
+		reads = dst;
+		writes = JRISC_REGMASK_Z;
+		break;
+
+	case JRISC_op_cmp:			/* Fall through */
+	case JRISC_op_cmpq:
+		reads = src | dst;
+		writes = JRISC_REGMASK_FLAGS;
+		break;
+
+	case JRISC_op_imultn:
+		reads = src | dst;
+		writes = JRISC_REGMASK_ACC | JRISC_REGMASK_FLAGS;
+		break;
+
+	case JRISC_op_imacn:
+		reads = src | dst | JRISC_REGMASK_ACC;
+		writes = JRISC_REGMASK_ACC | JRISC_REGMASK_FLAGS;
+		break;
+
+	case JRISC_op_resmac:
+		reads = JRISC_REGMASK_ACC;
+		writes = dst | JRISC_REGMASK_FLAGS;
+		break;
+
+	case JRISC_op_div:
+		reads = src | dst;
+		writes = dst;
+		break;
+
+	case JRISC_op_mtoi:			/* Fall through */
+	case JRISC_op_normi:
+		reads = src;
+		writes = dst | JRISC_REGMASK_FLAGS;
+		break;
+
+	case JRISC_op_mmult:
+		/* The matrix is in the other bank, the vector in memory */
+		reads = src | JRISC_REGMASK_ALT | JRISC_REGMASK_MEMORY;
+		writes = dst | JRISC_REGMASK_FLAGS;
+		break;
+
+	case JRISC_op_move:
+		reads = src;
+		writes = dst;
+		break;
+
+	case JRISC_op_moveq:		/* Fall through */
+	case JRISC_op_movei:		/* Fall through */
+	case JRISC_op_movepc:
+		writes = dst;
+		break;
+
+	case JRISC_op_moveta:
+		reads = src;
+		writes = JRISC_REGMASK_ALT;
+		break;
+
+	case JRISC_op_movefa:
+		reads = JRISC_REGMASK_ALT;
+		writes = dst;
+		break;
+
+	case JRISC_op_loadb:		/* Fall through */
+	case JRISC_op_loadw:		/* Fall through */
+	case JRISC_op_load:			/* Fall through */
+	case JRISC_op_loadp:
+		reads = src | JRISC_REGMASK_MEMORY;
+		writes = dst;
+		break;
+
+	case JRISC_op_loadr14n:		/* Fall through */
+	case JRISC_op_loadr14r:
+		reads = src | JRISC_REGMASK_REG(r14) | JRISC_REGMASK_MEMORY;
+		writes = dst;
+		break;
+
+	case JRISC_op_loadr15n:		/* Fall through */
+	case JRISC_op_loadr15r:
+		reads = src | JRISC_REGMASK_REG(r15) | JRISC_REGMASK_MEMORY;
+		writes = dst;
+		break;
+
+	case JRISC_op_storeb:		/* Fall through */
+	case JRISC_op_storew:		/* Fall through */
+	case JRISC_op_store:		/* Fall through */
+	case JRISC_op_storep:
+		reads = src | dst;
+		writes = JRISC_REGMASK_MEMORY;
+		break;
+
+	case JRISC_op_storer14n:	/* Fall through */
+	case JRISC_op_storer14r:
+		reads = src | dst | JRISC_REGMASK_REG(r14);
+		writes = JRISC_REGMASK_MEMORY;
+		break;
+
+	case JRISC_op_storer15n:	/* Fall through */
+	case JRISC_op_storer15r:
+		reads = src | dst | JRISC_REGMASK_REG(r15);
+		writes = JRISC_REGMASK_MEMORY;
+		break;
+
+	case JRISC_op_jump:
+		reads = src | jriscConditionRegMask(instruction->regDst.val.condition);
+		break;
+
+	case JRISC_op_jr:
+		reads = jriscConditionRegMask(instruction->regDst.val.condition);
+		break;
+
+	case JRISC_op_nop:
+		break;
+
+	case JRISC_invalidOpName:
+		/* Nothing is known about an undecodable word */
+		reads = JRISC_REGMASK_ALL;
+		writes = 0;
+		break;
+
+	default:
+		/* ALU operations: immediate sources have no mask bits */
+		reads = src | dst;
+		writes = dst | JRISC_REGMASK_FLAGS;
+		break;
+	}
+
+	*readsOut = reads;
+	*writesOut = writes;
+}
+
+void
+jriscRegMaskToString(JRISC_RegMask mask,
+					 char *string,
+					 size_t *stringLengthInOut)
+{
+	static const char *otherNames[] = { "Z", "C", "N", "ACC", "ALT", "MEM" };
+	size_t stringLength = string ? *stringLengthInOut : 0;
+	size_t outLength = 0;
+	const char *sep = "";
+	unsigned bit;
+	int length;
+
+	if (stringLength) string[0] = '\0';
+
+	for (bit = 0; bit < 38; bit++) {
+		if (!(mask & ((JRISC_RegMask)1 << bit))) continue;
+
+		if (bit < 32) {
+			length = snprintf(string, stringLength, "%sr%u", sep, bit);
+		} else {
+			length = snprintf(string, stringLength, "%s%s", sep,
+							  otherNames[bit - 32]);
+		}
+
+		if (string && ((size_t)length < stringLength)) {
+			string += length;
+			stringLength -= length;
+		} else {
+			stringLength = 0;
+		}
+		outLength += length;
+		sep = " ";
+	}
+
+	*stringLengthInOut = outLength + 1 /* For '\0' */;
+}
@@ -0,0 +1,65 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#ifndef JRISC_REGS_H_
+#define JRISC_REGS_H_
+
+#include "jrisc_base.h"
+#include "jrisc_inst.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * A set of registers and other machine state, as a bitmask. Bits 0-31 are
+ * r0-r31 of the current bank. The rest stand for state no operand names.
+ */
+typedef uint64_t JRISC_RegMask;
+
+#define JRISC_REGMASK_REG(reg)	((JRISC_RegMask)1 << (reg))
+#define JRISC_REGMASK_REGS		((JRISC_RegMask)0xffffffff)
+#define JRISC_REGMASK_Z			((JRISC_RegMask)1 << 32)	/* Zero flag */
+#define JRISC_REGMASK_C			((JRISC_RegMask)1 << 33)	/* Carry flag */
+#define JRISC_REGMASK_N			((JRISC_RegMask)1 << 34)	/* Neg. flag */
+#define JRISC_REGMASK_ACC		((JRISC_RegMask)1 << 35)	/* MAC result */
+#define JRISC_REGMASK_ALT		((JRISC_RegMask)1 << 36)	/* Other bank */
+#define JRISC_REGMASK_MEMORY	((JRISC_RegMask)1 << 37)	/* Incl. I/O */
+
+#define JRISC_REGMASK_FLAGS \
+	(JRISC_REGMASK_Z | JRISC_REGMASK_C | JRISC_REGMASK_N)
+#define JRISC_REGMASK_ALL		(((JRISC_RegMask)1 << 38) - 1)
+
+/*
+ * The alternate bank and memory are each many locations behind a single bit,
+ * so writing them never makes an earlier write dead.
+ */
+#define JRISC_REGMASK_PARTIAL	(JRISC_REGMASK_ALT | JRISC_REGMASK_MEMORY)
+
+/*
+ * What an instruction reads and writes, including the implicit r14/r15 of
+ * indexed loads and stores, the flags, and the MAC accumulator. A jump or jr
+ * reads only the flags its condition tests.
+ */
+extern void
+jriscInstructionRegMasks(const struct JRISC_Instruction *instruction,
+						 JRISC_RegMask *readsOut,
+						 JRISC_RegMask *writesOut);
+
+/* The flags a jump or jr condition code tests */
+extern JRISC_RegMask
+jriscConditionRegMask(uint8_t condition);
+
+/*
+ * Format a mask as a space-separated list, e.g. "r1 r14 Z C". Works like
+ * jriscInstructionToString: returns the length needed, including the '\0',
+ * in *stringLengthInOut.
+ */
+extern void
+jriscRegMaskToString(JRISC_RegMask mask,
+					 char *string,
+					 size_t *stringLengthInOut);
+
+#endif /* JRISC_REGS_H_ */
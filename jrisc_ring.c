@@ -0,0 +1,87 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_ring.h"
+#include "jrisc_thread.h"
+
+#include <stdlib.h>
+
+#define CACHE_LINE_SIZE 64
+
+/*
+ * head and tail count every push and pop, and are only reduced to a slot
+ * index when used, so the ring is full when they differ by its capacity.
+ * Each is written by one side and read by the other, so they are kept on
+ * separate cache lines.
+ */
+struct JRISC_Ring {
+	void **slots;
+	size_t mask;
+
+	char pad0[CACHE_LINE_SIZE];
+	volatile size_t head;		/* Written by the producer */
+	char pad1[CACHE_LINE_SIZE - sizeof(size_t)];
+	volatile size_t tail;		/* Written by the consumer */
+	char pad2[CACHE_LINE_SIZE - sizeof(size_t)];
+};
+
+enum JRISC_Error
+jriscRingCreate(size_t capacity, struct JRISC_Ring **ringOut)
+{
+	struct JRISC_Ring *ring = calloc(1, sizeof(*ring));
+	size_t size = 1;
+
+	if (!ring) return JRISC_ERROR_outOfMemory;
+
+	while (size < capacity) size *= 2;
+
+	ring->slots = malloc(size * sizeof(*ring->slots));
+	if (!ring->slots) {
+		free(ring);
+		return JRISC_ERROR_outOfMemory;
+	}
+	ring->mask = size - 1;
+
+	*ringOut = ring;
+
+	return JRISC_success;
+}
+
+void
+jriscRingDestroy(struct JRISC_Ring *ring)
+{
+	if (!ring) return;
+
+	free(ring->slots);
+	free(ring);
+}
+
+bool
+jriscRingPush(struct JRISC_Ring *ring, void *item)
+{
+	const size_t head = ring->head;
+
+	if ((head - jriscAtomicLoad(&ring->tail)) > ring->mask) return false;
+
+	ring->slots[head & ring->mask] = item;
+	jriscAtomicStore(&ring->head, head + 1);
+
+	return true;
+}
+
+bool
+jriscRingPop(struct JRISC_Ring *ring, void **itemOut)
+{
+	const size_t tail = ring->tail;
+
+	if (jriscAtomicLoad(&ring->head) == tail) return false;
+
+	*itemOut = ring->slots[tail & ring->mask];
+	jriscAtomicStore(&ring->tail, tail + 1);
+
+	return true;
+}
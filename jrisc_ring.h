@@ -0,0 +1,37 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#ifndef JRISC_RING_H_
+#define JRISC_RING_H_
+
+#include "jrisc_base.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * A fixed-size queue of pointers between exactly one producer thread and one
+ * consumer thread. Neither side takes a lock: each only writes its own index,
+ * and reads the other's with jriscAtomicLoad.
+ */
+struct JRISC_Ring;
+
+/* <capacity> is rounded up to a power of two */
+extern enum JRISC_Error
+jriscRingCreate(size_t capacity, struct JRISC_Ring **ringOut);
+
+extern void
+jriscRingDestroy(struct JRISC_Ring *ring);
+
+/* Producer only. Returns false if the ring is full. */
+extern bool
+jriscRingPush(struct JRISC_Ring *ring, void *item);
+
+/* Consumer only. Returns false if the ring is empty. */
+extern bool
+jriscRingPop(struct JRISC_Ring *ring, void **itemOut);
+
+#endif /* JRISC_RING_H_ */
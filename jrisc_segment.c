@@ -0,0 +1,219 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_cfg.h"
+#include "jrisc_inst.h"
+#include "jrisc_program.h"
+#include "jrisc_regs.h"
+#include "jrisc_segment.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* What is known about each word */
+#define SEGMENT_CODE_START	0x01	/* A reached instruction starts here */
+#define SEGMENT_CODE		0x02	/* Part of an instruction taken as code */
+#define SEGMENT_DATA_START	0x04	/* A load or store's address */
+
+struct Segmenter {
+	const struct JRISC_Program *program;
+	uint8_t *state;
+
+	/* Words still to walk from. Each reached instruction adds at most one. */
+	uint32_t *stack;
+	size_t numStack;
+};
+
+static bool
+jriscSegmentWordIndex(const struct JRISC_Program *program,
+					  uint32_t address,
+					  uint32_t *wordOut)
+{
+	const uint32_t offset = address - program->baseAddress;
+
+	if ((address < program->baseAddress) || (offset & 1) ||
+		((offset / 2) >= program->numWords)) {
+		return false;
+	}
+
+	*wordOut = offset / 2;
+
+	return true;
+}
+
+/* Follow the code from word <w> until it ends or joins code already seen */
+static void
+jriscSegmentWalk(struct Segmenter *s, size_t w)
+{
+	const struct JRISC_Program *program = s->program;
+	struct JRISC_Instruction inst;
+	JRISC_RegMask reads, writes;
+	uint32_t values[32];
+	uint32_t known = 0;			/* Registers a movei set, by bit */
+	uint32_t target;
+	unsigned size, i, reg;
+	bool delaySlot = false;		/* Of an unconditional branch */
+
+	while ((w < program->numWords) &&
+		   !(s->state[w] & SEGMENT_CODE_START)) {
+		size = jriscProgramDecodeAt(program, w, &inst);
+		if (!size) return;
+
+		s->state[w] |= SEGMENT_CODE_START;
+		for (i = 0; i < size; i++) s->state[w + i] |= SEGMENT_CODE;
+
+		reg = inst.regSrc.val.reg;
+		if (inst.opName == JRISC_op_jr) {
+			if (jriscSegmentWordIndex(program,
+									  jriscInstructionBranchTarget(&inst),
+									  &target)) {
+				s->stack[s->numStack++] = target;
+			}
+		} else if (inst.regSrc.type != JRISC_indirect) {
+			/* Nothing to follow */
+		} else if (!((known >> reg) & 1) ||
+				   !jriscSegmentWordIndex(program, values[reg], &target)) {
+			/* Where it goes isn't known, or is outside the program */
+		} else if (inst.opName == JRISC_op_jump) {
+			s->stack[s->numStack++] = target;
+		} else {
+			s->state[target] |= SEGMENT_DATA_START;
+		}
+
+		if (delaySlot) return;
+		delaySlot = jriscInstructionIsBranch(&inst) &&
+			!inst.regDst.val.condition;
+
+		jriscInstructionRegMasks(&inst, &reads, &writes);
+		known &= ~(uint32_t)(writes & JRISC_REGMASK_REGS);
+		if (inst.opName == JRISC_op_movei) {
+			known |= 1u << inst.regDst.val.reg;
+			values[inst.regDst.val.reg] = inst.longImmediate;
+		}
+
+		w += size;
+	}
+}
+
+/*
+ * Whether unreached words [first, end) look like code, decoding them from
+ * <first>. A movei running past <end> counts as a word that doesn't decode.
+ */
+static bool
+jriscSegmentLooksLikeCode(const struct JRISC_Program *program,
+						  size_t first,
+						  size_t end)
+{
+	struct JRISC_Instruction inst;
+	size_t invalid = 0;
+	size_t w;
+	unsigned size;
+
+	for (w = first; w < end; w += size) {
+		size = jriscProgramDecodeAt(program, w, &inst);
+		if (!size || ((w + size) > end)) {
+			invalid++;
+			size = 1;
+		}
+	}
+
+	return (invalid * JRISC_SEGMENT_INVALID_DENSITY) < (end - first);
+}
+
+enum JRISC_Error
+jriscSegmentProgram(const struct JRISC_Program *program,
+					const uint32_t *entries,
+					size_t numEntries,
+					struct JRISC_SegmentMap **mapOut)
+{
+	const size_t n = program->numWords;
+	struct JRISC_SegmentMap *map;
+	struct JRISC_Segment *segment;
+	struct Segmenter s;
+	uint32_t entry;
+	size_t w, end, k;
+	bool code;
+	enum JRISC_Error ret = JRISC_ERROR_outOfMemory;
+
+	memset(&s, 0, sizeof(s));
+	s.program = program;
+
+	map = calloc(1, sizeof(*map));
+	s.state = calloc(n + 1, sizeof(*s.state));
+	s.stack = malloc((n + numEntries + 1) * sizeof(*s.stack));
+	if (!map || !s.state || !s.stack) goto done;
+
+	map->program = program;
+
+	for (k = 0; k < numEntries; k++) {
+		if (jriscSegmentWordIndex(program, entries[k], &entry)) {
+			s.stack[s.numStack++] = entry;
+		}
+	}
+	if (!numEntries && n) s.stack[s.numStack++] = 0;
+
+	while (s.numStack) jriscSegmentWalk(&s, s.stack[--s.numStack]);
+
+	/* Sort out what wasn't reached, a run at a time */
+	for (w = 0; w < n; w = end) {
+		if (s.state[w] & SEGMENT_CODE) {
+			end = w + 1;
+			continue;
+		}
+
+		for (end = w + 1; (end < n) &&
+			 !(s.state[end] & (SEGMENT_CODE | SEGMENT_DATA_START)); end++) {
+		}
+
+		if (!(s.state[w] & SEGMENT_DATA_START) &&
+			jriscSegmentLooksLikeCode(program, w, end)) {
+			for (k = w; k < end; k++) s.state[k] |= SEGMENT_CODE;
+		}
+	}
+
+	/* One segment per change between code and data */
+	map->segments = malloc((n ? n : 1) * sizeof(*map->segments));
+	if (!map->segments) goto done;
+
+	for (w = 0; w < n; w++) {
+		code = (s.state[w] & SEGMENT_CODE) != 0;
+		segment = map->numSegments ?
+			&map->segments[map->numSegments - 1] : NULL;
+
+		if (segment && (segment->code == code)) {
+			segment->numWords++;
+		} else {
+			segment = &map->segments[map->numSegments++];
+			segment->firstWord = (uint32_t)w;
+			segment->numWords = 1;
+			segment->code = code;
+		}
+	}
+
+	ret = JRISC_success;
+
+done:
+	free(s.stack);
+	free(s.state);
+
+	if (ret == JRISC_success) {
+		*mapOut = map;
+	} else {
+		jriscSegmentMapDestroy(map);
+	}
+
+	return ret;
+}
+
+void
+jriscSegmentMapDestroy(struct JRISC_SegmentMap *map)
+{
+	if (!map) return;
+
+	free(map->segments);
+	free(map);
+}
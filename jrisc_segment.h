@@ -0,0 +1,66 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#ifndef JRISC_SEGMENT_H_
+#define JRISC_SEGMENT_H_
+
+#include "jrisc_base.h"
+#include "jrisc_program.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/*
+ * An unreached run is taken as data if at least 1 in this many of its words
+ * don't decode
+ */
+#define JRISC_SEGMENT_INVALID_DENSITY	8
+
+/* A run of a program's words, all code or all data */
+struct JRISC_Segment {
+	uint32_t firstWord;		/* Index into the program's words */
+	uint32_t numWords;
+	bool code;
+};
+
+struct JRISC_SegmentMap {
+	const struct JRISC_Program *program;
+
+	/* In order, covering every word of the program */
+	struct JRISC_Segment *segments;
+	size_t numSegments;
+};
+
+/*
+ * Split a program into code and data, in time linear in its size.
+ *
+ * Code is whatever can be reached from the entry points by falling through and
+ * following jr, and jump (rN) where a movei just before set rN. Each path ends
+ * after the delay slot of an unconditional branch, or at a word that doesn't
+ * decode. Along the way, a load or store through a register a movei pointed
+ * into the program marks where data starts.
+ *
+ * The unreached words left over are split where data starts, and each run is
+ * data if it starts there, or if enough of its words don't decode, as it
+ * would be decoded from its start. Otherwise it is taken as code that is only
+ * reached in ways that couldn't be followed, such as through a table.
+ *
+ * Words are decoded from the program's words, so code need not line up with
+ * the program's own linear decoding. Entry points outside the program are
+ * ignored; with none, the first word is the only entry point.
+ * <program> must outlive the result.
+ */
+extern enum JRISC_Error
+jriscSegmentProgram(const struct JRISC_Program *program,
+					const uint32_t *entries,
+					size_t numEntries,
+					struct JRISC_SegmentMap **mapOut);
+
+extern void
+jriscSegmentMapDestroy(struct JRISC_SegmentMap *map);
+
+#endif /* JRISC_SEGMENT_H_ */
@@ -0,0 +1,708 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_image.h"
+#include "jrisc_inst.h"
+#include "jrisc_inst_string.h"
+#include "jrisc_program.h"
+#include "jrisc_server.h"
+#include "jrisc_sym.h"
+#include "jrisc_thread.h"
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#endif
+
+#define MAX_FIELDS			4
+
+/* A decoded image, shared by every request that names its file */
+struct ServerImage {
+	char *path;
+	int64_t mtime;
+	uint64_t fileSize;
+
+	unsigned numSections;
+	struct JRISC_Section *sections;
+
+	/* Indexed by section. NULL for sections that aren't code. */
+	struct JRISC_Program **programs;
+	struct JRISC_SymbolTable *symbols;
+
+	/* Guarded by the server's lock */
+	unsigned refs;
+	uint64_t lastUsed;
+	bool detached;				/* No longer in the list; freed when unused */
+	struct ServerImage *next;
+};
+
+struct JRISC_Server {
+	struct JRISC_ServerOptions options;
+
+	struct JRISC_Mutex *lock;
+	struct ServerImage *images;
+	unsigned numImages;
+	uint64_t clock;
+
+	uint64_t requests;
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t errors;
+};
+
+struct Response {
+	char *data;
+	size_t used;
+	size_t capacity;
+	bool failed;
+};
+
+static bool
+responseReserve(struct Response *response, size_t length)
+{
+	size_t capacity = response->capacity ? response->capacity : 256;
+	char *data;
+
+	if (response->failed) return false;
+	if ((response->capacity - response->used) >= length) return true;
+
+	while ((capacity - response->used) < length) capacity *= 2;
+
+	data = realloc(response->data, capacity);
+	if (!data) {
+		response->failed = true;
+		return false;
+	}
+
+	response->data = data;
+	response->capacity = capacity;
+
+	return true;
+}
+
+static void
+responsePrintf(struct Response *response, const char *fmt, ...)
+{
+	va_list args;
+	int length;
+
+	va_start(args, fmt);
+	length = vsnprintf(NULL, 0, fmt, args);
+	va_end(args);
+
+	/* vsnprintf always wants room for the NUL, even though it isn't kept */
+	if ((length < 0) || !responseReserve(response, (size_t)length + 1)) {
+		response->failed = true;
+		return;
+	}
+
+	va_start(args, fmt);
+	vsnprintf(&response->data[response->used], (size_t)length + 1, fmt, args);
+	va_end(args);
+
+	response->used += length;
+}
+
+static void
+responseInstruction(struct Response *response,
+					const struct ServerImage *serverImage,
+					const struct JRISC_Program *program,
+					size_t index)
+{
+	const struct JRISC_Instruction *inst = &program->instructions[index];
+	size_t length;
+
+	if (inst->opName == JRISC_invalidOpName) {
+		responsePrintf(response, "%08x: dc.w    $%04x\n", inst->address,
+					   jriscProgramRaw(program, index));
+		return;
+	}
+
+	/* Long symbol names may need a second try with more room */
+	length = 128;
+	do {
+		if (!responseReserve(response, length + 1)) return;
+
+		length = response->capacity - response->used;
+		jriscInstructionToStringSymbolic(inst, JRISC_STRINGFLAG_ADDRESS,
+										 serverImage->symbols,
+										 &response->data[response->used],
+										 &length);
+	} while (length > (response->capacity - response->used));
+
+	response->used += length - 1;
+	responsePrintf(response, "\n");
+}
+
+static bool
+fileIdentity(const char *path, int64_t *mtimeOut, uint64_t *sizeOut)
+{
+#if defined(_WIN32)
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+
+	if (!GetFileAttributesExA(path, GetFileExInfoStandard, &attributes)) {
+		return false;
+	}
+
+	*mtimeOut = ((int64_t)attributes.ftLastWriteTime.dwHighDateTime << 32) |
+		attributes.ftLastWriteTime.dwLowDateTime;
+	*sizeOut = ((uint64_t)attributes.nFileSizeHigh << 32) |
+		attributes.nFileSizeLow;
+#else
+	struct stat st;
+
+	if (stat(path, &st) || !S_ISREG(st.st_mode)) return false;
+
+	/* Nanoseconds, so a file rebuilt within the second is still noticed */
+#if defined(__APPLE__)
+	*mtimeOut = (int64_t)st.st_mtimespec.tv_sec * 1000000000 +
+		st.st_mtimespec.tv_nsec;
+#else
+	*mtimeOut = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+	*sizeOut = st.st_size;
+#endif
+
+	return true;
+}
+
+static void
+serverImageFree(struct ServerImage *serverImage)
+{
+	unsigned i;
+
+	if (serverImage->programs) {
+		for (i = 0; i < serverImage->numSections; i++) {
+			jriscProgramDestroy(serverImage->programs[i]);
+		}
+	}
+
+	jriscSymbolTableDestroy(serverImage->symbols);
+	free(serverImage->programs);
+	free(serverImage->sections);
+	free(serverImage->path);
+	free(serverImage);
+}
+
+/*
+ * Decode every code section of a file and load its symbols. Only the results
+ * are kept; the file itself is unmapped before returning.
+ */
+static enum JRISC_Error
+serverImageLoad(const struct JRISC_ServerOptions *options,
+				const char *path,
+				int64_t mtime,
+				uint64_t fileSize,
+				struct ServerImage **serverImageOut)
+{
+	struct ServerImage *serverImage = calloc(1, sizeof(*serverImage));
+	struct JRISC_Image *image = NULL;
+	struct JRISC_Section *section;
+	enum JRISC_Error err;
+	unsigned i;
+
+	if (!serverImage) return JRISC_ERROR_outOfMemory;
+
+	serverImage->mtime = mtime;
+	serverImage->fileSize = fileSize;
+	serverImage->path = malloc(strlen(path) + 1);
+	if (!serverImage->path) {
+		err = JRISC_ERROR_outOfMemory;
+		goto fail;
+	}
+	strcpy(serverImage->path, path);
+
+	err = jriscImageOpen(path, options->format, &image);
+	if (err != JRISC_success) goto fail;
+
+	if (options->littleEndian) image->byteOrder = JRISC_littleEndian;
+
+	serverImage->numSections = image->numSections;
+	serverImage->sections = calloc(image->numSections + 1,
+								   sizeof(*serverImage->sections));
+	serverImage->programs = calloc(image->numSections + 1,
+								   sizeof(*serverImage->programs));
+	if (!serverImage->sections || !serverImage->programs) {
+		err = JRISC_ERROR_outOfMemory;
+		goto fail;
+	}
+
+	for (i = 0; i < image->numSections; i++) {
+		section = &serverImage->sections[i];
+		*section = image->sections[i];
+
+		if (image->format == JRISC_imageRaw) {
+			if (options->baseSpecified) {
+				section->address = options->baseAddress;
+			} else {
+				section->address = (options->cpu == JRISC_gpu) ?
+					JRISC_GPU_RAM : JRISC_DSP_RAM;
+			}
+		}
+
+		if (!(section->flags & JRISC_SECTIONFLAG_CODE)) continue;
+
+		err = jriscProgramFromSection(image, section, options->cpu,
+									  &serverImage->programs[i]);
+		if (err != JRISC_success) goto fail;
+	}
+
+	err = jriscSymbolTableCreate(&serverImage->symbols);
+	if (err == JRISC_success) {
+		err = jriscSymbolTableLoadImage(serverImage->symbols, image);
+	}
+	if (err == JRISC_success) {
+		err = jriscSymbolTableFinalize(serverImage->symbols);
+	}
+	if (err != JRISC_success) goto fail;
+
+	jriscImageDestroy(image);
+
+	*serverImageOut = serverImage;
+
+	return JRISC_success;
+
+fail:
+	if (image) jriscImageDestroy(image);
+	serverImageFree(serverImage);
+
+	return err;
+}
+
+/* Drop the least recently used images nothing is using, down to the limit */
+static void
+serverEvict(struct JRISC_Server *server)
+{
+	struct ServerImage **link;
+	struct ServerImage **oldest;
+	struct ServerImage *victim;
+
+	while (server->numImages > server->options.maxImages) {
+		oldest = NULL;
+		for (link = &server->images; *link; link = &(*link)->next) {
+			if (!(*link)->refs &&
+				(!oldest || ((*link)->lastUsed < (*oldest)->lastUsed))) {
+				oldest = link;
+			}
+		}
+
+		if (!oldest) return;
+
+		victim = *oldest;
+		*oldest = victim->next;
+		serverImageFree(victim);
+		server->numImages--;
+	}
+}
+
+/* Remove an image from the list, freeing it now if nothing is using it */
+static void
+serverUnlink(struct JRISC_Server *server, struct ServerImage **link)
+{
+	struct ServerImage *serverImage = *link;
+
+	*link = serverImage->next;
+	server->numImages--;
+
+	if (serverImage->refs) {
+		serverImage->detached = true;
+	} else {
+		serverImageFree(serverImage);
+	}
+}
+
+static void
+serverRelease(struct JRISC_Server *server, struct ServerImage *serverImage)
+{
+	jriscMutexLock(server->lock);
+
+	if (!--serverImage->refs && serverImage->detached) {
+		serverImageFree(serverImage);
+	}
+
+	jriscMutexUnlock(server->lock);
+}
+
+/*
+ * Find the decoded image of a file, decoding it if it isn't resident or has
+ * changed. The lock is not held while decoding, so requests for other images
+ * carry on meanwhile. If two threads decode the same file at once, the first
+ * to finish wins and the other's work is thrown away.
+ */
+static enum JRISC_Error
+serverAcquire(struct JRISC_Server *server,
+			  const char *path,
+			  struct ServerImage **serverImageOut)
+{
+	struct ServerImage *loaded = NULL;
+	struct ServerImage **link;
+	enum JRISC_Error err;
+	uint64_t fileSize;
+	int64_t mtime;
+	bool retried = false;
+
+	if (!fileIdentity(path, &mtime, &fileSize)) return JRISC_ERROR_ioError;
+
+	jriscMutexLock(server->lock);
+
+	for (;;) {
+		for (link = &server->images; *link; link = &(*link)->next) {
+			if (!strcmp((*link)->path, path)) break;
+		}
+
+		if (*link && ((*link)->mtime == mtime) &&
+			((*link)->fileSize == fileSize)) {
+			(*link)->refs++;
+			(*link)->lastUsed = ++server->clock;
+			if (!retried) server->hits++;
+			*serverImageOut = *link;
+			jriscMutexUnlock(server->lock);
+
+			if (loaded) serverImageFree(loaded);
+
+			return JRISC_success;
+		}
+
+		if (*link) serverUnlink(server, link);
+
+		if (loaded) break;
+
+		server->misses++;
+		jriscMutexUnlock(server->lock);
+
+		err = serverImageLoad(&server->options, path, mtime, fileSize,
+							  &loaded);
+		if (err != JRISC_success) return err;
+
+		jriscMutexLock(server->lock);
+		retried = true;
+	}
+
+	loaded->refs = 1;
+	loaded->lastUsed = ++server->clock;
+	loaded->next = server->images;
+	server->images = loaded;
+	server->numImages++;
+	serverEvict(server);
+
+	jriscMutexUnlock(server->lock);
+
+	*serverImageOut = loaded;
+
+	return JRISC_success;
+}
+
+static bool
+parseAddress(const char *field, uint32_t *addressOut)
+{
+	unsigned long value;
+	char *end;
+
+	errno = 0;
+	value = strtoul(field, &end, 0);
+	if ((errno != 0) || !field[0] || end[0] || (value > 0xffffffffUL)) {
+		return false;
+	}
+
+	*addressOut = (uint32_t)value;
+
+	return true;
+}
+
+/* The code section containing an address, or -1 if none does */
+static int
+findSection(const struct ServerImage *serverImage, uint32_t address)
+{
+	unsigned i;
+
+	for (i = 0; i < serverImage->numSections; i++) {
+		if (serverImage->programs[i] &&
+			jriscProgramContains(serverImage->programs[i], address)) {
+			return (int)i;
+		}
+	}
+
+	return -1;
+}
+
+static const char *
+errorMessage(enum JRISC_Error err)
+{
+	switch (err) {
+	case JRISC_ERROR_outOfMemory:
+		return "out of memory";
+
+	case JRISC_ERROR_ioError:
+		return "could not read file";
+
+	case JRISC_ERROR_invalidFormat:
+		return "unrecognized file format";
+
+	default:
+		return "could not decode file";
+	}
+}
+
+static void
+handleDisassemble(struct JRISC_Server *server,
+				  char *fields[],
+				  unsigned numFields,
+				  struct Response *response)
+{
+	struct ServerImage *serverImage;
+	const struct JRISC_Program *program;
+	const struct JRISC_Symbol *sym;
+	enum JRISC_Error err;
+	uint32_t start;
+	uint32_t end;
+	uint32_t offset;
+	size_t i;
+	int s;
+
+	if ((numFields != 4) || !parseAddress(fields[2], &start) ||
+		!parseAddress(fields[3], &end) || (end < start)) {
+		responsePrintf(response, "error\tusage: disassemble <file> <start> "
+					   "<end>\n");
+		return;
+	}
+
+	if ((end - start) > JRISC_SERVER_MAX_RANGE) {
+		responsePrintf(response, "error\trange is larger than %u bytes\n",
+					   JRISC_SERVER_MAX_RANGE);
+		return;
+	}
+
+	err = serverAcquire(server, fields[1], &serverImage);
+	if (err != JRISC_success) {
+		responsePrintf(response, "error\t%s\n", errorMessage(err));
+		return;
+	}
+
+	s = findSection(serverImage, start);
+	if (s < 0) {
+		responsePrintf(response, "error\tno code at $%x\n", start);
+		serverRelease(server, serverImage);
+		return;
+	}
+
+	program = serverImage->programs[s];
+	responsePrintf(response, "ok\n");
+
+	for (i = jriscProgramFind(program, start);
+		 (i < program->numInstructions) &&
+			 (program->instructions[i].address < end);
+		 i++) {
+		sym = jriscSymbolTableLookup(serverImage->symbols,
+									 program->instructions[i].address,
+									 &offset);
+		if (sym && !offset) responsePrintf(response, "%s:\n", sym->name);
+
+		responseInstruction(response, serverImage, program, i);
+	}
+
+	serverRelease(server, serverImage);
+}
+
+static void
+handleLookup(struct JRISC_Server *server,
+			 char *fields[],
+			 unsigned numFields,
+			 struct Response *response)
+{
+	struct ServerImage *serverImage;
+	const struct JRISC_Program *program;
+	const struct JRISC_Symbol *sym;
+	enum JRISC_Error err;
+	uint32_t address;
+	uint32_t offset;
+	size_t i;
+	int s;
+
+	if ((numFields != 3) || !parseAddress(fields[2], &address)) {
+		responsePrintf(response, "error\tusage: lookup <file> <address>\n");
+		return;
+	}
+
+	err = serverAcquire(server, fields[1], &serverImage);
+	if (err != JRISC_success) {
+		responsePrintf(response, "error\t%s\n", errorMessage(err));
+		return;
+	}
+
+	s = findSection(serverImage, address);
+	if (s < 0) {
+		responsePrintf(response, "error\tno code at $%x\n", address);
+		serverRelease(server, serverImage);
+		return;
+	}
+
+	program = serverImage->programs[s];
+	i = jriscProgramFind(program, address);
+
+	responsePrintf(response, "ok\n");
+	responsePrintf(response, "section\t%s\n", serverImage->sections[s].name);
+	responsePrintf(response, "index\t%zu\n", i);
+
+	sym = jriscSymbolTableLookup(serverImage->symbols, address, &offset);
+	if (sym) responsePrintf(response, "symbol\t%s+%u\n", sym->name, offset);
+
+	responsePrintf(response, "instruction\t");
+	responseInstruction(response, serverImage, program, i);
+
+	serverRelease(server, serverImage);
+}
+
+static void
+handleStats(struct JRISC_Server *server,
+			unsigned numFields,
+			struct Response *response)
+{
+	const struct ServerImage *serverImage;
+	size_t numInstructions;
+	unsigned i;
+
+	if (numFields != 1) {
+		responsePrintf(response, "error\tusage: stats\n");
+		return;
+	}
+
+	jriscMutexLock(server->lock);
+
+	responsePrintf(response, "ok\n");
+	responsePrintf(response, "images\t%u\n", server->numImages);
+	responsePrintf(response, "requests\t%llu\n",
+				   (unsigned long long)server->requests);
+	responsePrintf(response, "hits\t%llu\n", (unsigned long long)server->hits);
+	responsePrintf(response, "misses\t%llu\n",
+				   (unsigned long long)server->misses);
+	responsePrintf(response, "errors\t%llu\n",
+				   (unsigned long long)server->errors);
+
+	for (serverImage = server->images; serverImage;
+		 serverImage = serverImage->next) {
+		numInstructions = 0;
+		for (i = 0; i < serverImage->numSections; i++) {
+			if (serverImage->programs[i]) {
+				numInstructions += serverImage->programs[i]->numInstructions;
+			}
+		}
+
+		responsePrintf(response, "image\t%s\t%zu\n", serverImage->path,
+					   numInstructions);
+	}
+
+	jriscMutexUnlock(server->lock);
+}
+
+enum JRISC_Error
+jriscServerCreate(const struct JRISC_ServerOptions *options,
+				  struct JRISC_Server **serverOut)
+{
+	struct JRISC_Server *server = calloc(1, sizeof(*server));
+	enum JRISC_Error err;
+
+	if (!server) return JRISC_ERROR_outOfMemory;
+
+	server->options = *options;
+	if (!server->options.maxImages) server->options.maxImages = 1;
+
+	err = jriscMutexCreate(&server->lock);
+	if (err != JRISC_success) {
+		free(server);
+		return err;
+	}
+
+	*serverOut = server;
+
+	return JRISC_success;
+}
+
+void
+jriscServerDestroy(struct JRISC_Server *server)
+{
+	struct ServerImage *next;
+
+	if (!server) return;
+
+	while (server->images) {
+		next = server->images->next;
+		serverImageFree(server->images);
+		server->images = next;
+	}
+
+	jriscMutexDestroy(server->lock);
+	free(server);
+}
+
+enum JRISC_Error
+jriscServerHandle(struct JRISC_Server *server,
+				  const char *request,
+				  size_t requestSize,
+				  char **responseOut,
+				  size_t *responseSizeOut)
+{
+	struct Response response;
+	char *fields[MAX_FIELDS + 1];
+	char *copy;
+	char *p;
+	unsigned numFields = 0;
+
+	memset(&response, 0, sizeof(response));
+
+	/* Split a NUL-terminated copy of the request in place */
+	copy = malloc(requestSize + 1);
+	if (!copy) return JRISC_ERROR_outOfMemory;
+	memcpy(copy, request, requestSize);
+	copy[requestSize] = '\0';
+
+	for (p = copy; numFields <= MAX_FIELDS; p++) {
+		fields[numFields++] = p;
+		p = strchr(p, '\t');
+		if (!p) break;
+		*p = '\0';
+	}
+
+	if (memchr(request, '\0', requestSize)) {
+		responsePrintf(&response, "error\trequest contains a NUL\n");
+	} else if (!strcmp(fields[0], "disassemble")) {
+		handleDisassemble(server, fields, numFields, &response);
+	} else if (!strcmp(fields[0], "lookup")) {
+		handleLookup(server, fields, numFields, &response);
+	} else if (!strcmp(fields[0], "stats")) {
+		handleStats(server, numFields, &response);
+	} else {
+		responsePrintf(&response, "error\tunknown command\n");
+	}
+
+	free(copy);
+
+	jriscMutexLock(server->lock);
+	server->requests++;
+	if (response.failed ||
+		((response.used >= 5) && !memcmp(response.data, "error", 5))) {
+		server->errors++;
+	}
+	jriscMutexUnlock(server->lock);
+
+	if (response.failed) {
+		free(response.data);
+		return JRISC_ERROR_outOfMemory;
+	}
+
+	*responseOut = response.data;
+	*responseSizeOut = response.used;
+
+	return JRISC_success;
+}
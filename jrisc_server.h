@@ -0,0 +1,79 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#ifndef JRISC_SERVER_H_
+#define JRISC_SERVER_H_
+
+#include "jrisc_base.h"
+#include "jrisc_image.h"
+#include "jrisc_inst.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/*
+ * Requests and responses travel as frames: a 32-bit little-endian payload
+ * length followed by that many bytes. Payloads are text.
+ *
+ * A request is a command and its arguments, separated by tabs:
+ *
+ *   disassemble <file> <start address> <end address>
+ *   lookup <file> <address>
+ *   stats
+ *
+ * A response starts with "ok" or "error", then a tab and a message for errors,
+ * then a newline. The rest of an ok response depends on the command.
+ */
+#define JRISC_SERVER_FRAME_HEADER_SIZE	4
+#define JRISC_SERVER_MAX_REQUEST		4096
+
+/* The most code a single disassemble request may cover, in bytes */
+#define JRISC_SERVER_MAX_RANGE			(256 * 1024)
+
+struct JRISC_ServerOptions {
+	enum JRISC_CPU cpu;
+	enum JRISC_ImageFormat format;
+	bool littleEndian;
+
+	/* The load address of raw images, if not the CPU's local RAM */
+	bool baseSpecified;
+	uint32_t baseAddress;
+
+	/* How many decoded images to keep resident */
+	unsigned maxImages;
+};
+
+struct JRISC_Server;
+
+extern enum JRISC_Error
+jriscServerCreate(const struct JRISC_ServerOptions *options,
+				  struct JRISC_Server **serverOut);
+
+extern void
+jriscServerDestroy(struct JRISC_Server *server);
+
+/*
+ * Answer one request payload. Any number of threads may call this at once.
+ *
+ * Images are decoded in full the first time they are named, and kept until
+ * the least recently used ones are evicted to stay within maxImages. A file
+ * whose size or modification time has changed since it was decoded is
+ * decoded again.
+ *
+ * Problems with the request itself, such as an unreadable file, are reported
+ * in the response. An error is returned only when no response could be built,
+ * in which case *responseOut is not set. Otherwise the response is allocated
+ * with malloc and is not NUL-terminated.
+ */
+extern enum JRISC_Error
+jriscServerHandle(struct JRISC_Server *server,
+				  const char *request,
+				  size_t requestSize,
+				  char **responseOut,
+				  size_t *responseSizeOut);
+
+#endif /* JRISC_SERVER_H_ */
@@ -0,0 +1,244 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_inst.h"
+#include "jrisc_stats.h"
+
+#include <stddef.h>
+#include <string.h>
+#include <inttypes.h>
+
+/*
+ * Use the optable's own names rather than jriscOpNameToString's, which folds
+ * the indexed loads and stores together.
+ */
+static const char *jriscStatsOpNames[] = {
+#define JRISC_OP(opName, opNum, regSrcType, regDstType, swapRegs, cpus) #opName,
+#include "jrisc_optable.h"
+#undef JRISC_OP
+};
+
+static const char *jriscStatsRegTypeNames[] = {
+	"reg",
+	"indirect",
+	"condition",
+	"simmediate",
+	"uimmediate",
+	"zuimmediate",
+	"shlimmediate",
+	"pcoffset",
+	"flag",
+};
+
+static const char *jriscStatsFieldNames[] = {
+	"src",
+	"dst",
+};
+
+void
+jriscStatsInit(struct JRISC_Stats *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+	stats->previous = JRISC_invalidOpName;
+}
+
+void
+jriscStatsMerge(struct JRISC_Stats *dst, const struct JRISC_Stats *src)
+{
+	/* Every counter is a uint64_t, and previous isn't a counter */
+	const size_t numCounters = offsetof(struct JRISC_Stats, previous) /
+		sizeof(uint64_t);
+	const uint64_t *in = (const uint64_t *)src;
+	uint64_t *out = (uint64_t *)dst;
+	size_t i;
+
+	for (i = 0; i < numCounters; i++) out[i] += in[i];
+}
+
+uint64_t
+jriscStatsCpuCount(const struct JRISC_Stats *stats, enum JRISC_CPU cpu)
+{
+	uint64_t count = 0;
+	unsigned op;
+
+	for (op = 0; op < JRISC_invalidOpName; op++) {
+		if (jriscInstructionTable[op].cpu == cpu) count += stats->opNames[op];
+	}
+
+	return count;
+}
+
+enum JRISC_Error
+jriscStatsCollect(struct JRISC_Stats *stats,
+				  struct JRISC_Context *context,
+				  uint64_t size,
+				  enum JRISC_CPU cpu)
+{
+	const uint64_t end = context->readLocation + size;
+	struct JRISC_Instruction inst;
+	enum JRISC_Error ret;
+
+	jriscStatsBreak(stats);
+
+	while (context->readLocation < end) {
+		ret = jriscInstructionRead(context, cpu, &inst);
+
+		if (ret == JRISC_success) {
+			jriscStatsAdd(stats, &inst);
+		} else if (ret == JRISC_ERROR_ioError) {
+			break;
+		} else {
+			jriscStatsAddInvalid(stats);
+		}
+	}
+
+	jriscStatsBreak(stats);
+
+	return JRISC_success;
+}
+
+static void
+jriscStatsWriteCsv(const struct JRISC_Stats *stats, FILE *fp)
+{
+	unsigned f, t, v, a, b;
+
+	fprintf(fp, "category,key,value,count\n");
+	fprintf(fp, "total,instructions,,%" PRIu64 "\n", stats->instructions);
+	fprintf(fp, "total,invalid,,%" PRIu64 "\n", stats->invalidWords);
+	fprintf(fp, "cpu,gpu,,%" PRIu64 "\n",
+			jriscStatsCpuCount(stats, JRISC_gpu));
+	fprintf(fp, "cpu,dsp,,%" PRIu64 "\n",
+			jriscStatsCpuCount(stats, JRISC_dsp));
+
+	for (a = 0; a < JRISC_invalidOpName; a++) {
+		if (!stats->opNames[a]) continue;
+		fprintf(fp, "opname,%s,,%" PRIu64 "\n", jriscStatsOpNames[a],
+				stats->opNames[a]);
+	}
+
+	for (f = 0; f < JRISC_statsNumFields; f++) {
+		for (t = 0; t < JRISC_unused; t++) {
+			for (v = 0; v < JRISC_STATS_FIELD_VALUES; v++) {
+				if (!stats->fields[f][t][v]) continue;
+				fprintf(fp, "%s,%s,%u,%" PRIu64 "\n", jriscStatsFieldNames[f],
+						jriscStatsRegTypeNames[t], v, stats->fields[f][t][v]);
+			}
+		}
+	}
+
+	for (v = 0; v < JRISC_STATS_MOVEI_PAGES; v++) {
+		if (!stats->moveiPages[v]) continue;
+		fprintf(fp, "moveipage,$%02x,,%" PRIu64 "\n", v,
+				stats->moveiPages[v]);
+	}
+	if (stats->moveiPages[v]) {
+		fprintf(fp, "moveipage,wide,,%" PRIu64 "\n", stats->moveiPages[v]);
+	}
+
+	for (a = 0; a < JRISC_invalidOpName; a++) {
+		for (b = 0; b < JRISC_invalidOpName; b++) {
+			if (!stats->bigrams[a][b]) continue;
+			fprintf(fp, "bigram,%s,%s,%" PRIu64 "\n", jriscStatsOpNames[a],
+					jriscStatsOpNames[b], stats->bigrams[a][b]);
+		}
+	}
+}
+
+static void
+jriscStatsWriteJson(const struct JRISC_Stats *stats, FILE *fp)
+{
+	const char *sep;
+	const char *innerSep;
+	unsigned f, t, v, a, b;
+
+	fprintf(fp, "{\n");
+	fprintf(fp, "  \"instructions\": %" PRIu64 ",\n", stats->instructions);
+	fprintf(fp, "  \"invalid\": %" PRIu64 ",\n", stats->invalidWords);
+	fprintf(fp, "  \"cpu\": {\"gpu\": %" PRIu64 ", \"dsp\": %" PRIu64 "},\n",
+			jriscStatsCpuCount(stats, JRISC_gpu),
+			jriscStatsCpuCount(stats, JRISC_dsp));
+
+	fprintf(fp, "  \"opname\": {");
+	for (a = 0, sep = ""; a < JRISC_invalidOpName; a++) {
+		if (!stats->opNames[a]) continue;
+		fprintf(fp, "%s\n    \"%s\": %" PRIu64, sep, jriscStatsOpNames[a],
+				stats->opNames[a]);
+		sep = ",";
+	}
+	fprintf(fp, "\n  },\n");
+
+	for (f = 0; f < JRISC_statsNumFields; f++) {
+		fprintf(fp, "  \"%s\": {", jriscStatsFieldNames[f]);
+		for (t = 0, sep = ""; t < JRISC_unused; t++) {
+			for (v = 0, innerSep = NULL; v < JRISC_STATS_FIELD_VALUES; v++) {
+				if (!stats->fields[f][t][v]) continue;
+				if (!innerSep) {
+					fprintf(fp, "%s\n    \"%s\": {", sep,
+							jriscStatsRegTypeNames[t]);
+					innerSep = "";
+					sep = ",";
+				}
+				fprintf(fp, "%s\"%u\": %" PRIu64, innerSep, v,
+						stats->fields[f][t][v]);
+				innerSep = ", ";
+			}
+			if (innerSep) fprintf(fp, "}");
+		}
+		fprintf(fp, "\n  },\n");
+	}
+
+	fprintf(fp, "  \"moveipage\": {");
+	for (v = 0, sep = ""; v < JRISC_STATS_MOVEI_PAGES; v++) {
+		if (!stats->moveiPages[v]) continue;
+		fprintf(fp, "%s\n    \"$%02x\": %" PRIu64, sep, v,
+				stats->moveiPages[v]);
+		sep = ",";
+	}
+	if (stats->moveiPages[v]) {
+		fprintf(fp, "%s\n    \"wide\": %" PRIu64, sep, stats->moveiPages[v]);
+	}
+	fprintf(fp, "\n  },\n");
+
+	fprintf(fp, "  \"bigram\": {");
+	for (a = 0, sep = ""; a < JRISC_invalidOpName; a++) {
+		for (b = 0, innerSep = NULL; b < JRISC_invalidOpName; b++) {
+			if (!stats->bigrams[a][b]) continue;
+			if (!innerSep) {
+				fprintf(fp, "%s\n    \"%s\": {", sep, jriscStatsOpNames[a]);
+				innerSep = "";
+				sep = ",";
+			}
+			fprintf(fp, "%s\"%s\": %" PRIu64, innerSep, jriscStatsOpNames[b],
+					stats->bigrams[a][b]);
+			innerSep = ", ";
+		}
+		if (innerSep) fprintf(fp, "}");
+	}
+	fprintf(fp, "\n  }\n");
+	fprintf(fp, "}\n");
+}
+
+enum JRISC_Error
+jriscStatsWrite(const struct JRISC_Stats *stats,
+				enum JRISC_StatsFormat format,
+				FILE *fp)
+{
+	switch (format) {
+	case JRISC_statsCsv:
+		jriscStatsWriteCsv(stats, fp);
+		break;
+
+	case JRISC_statsJson:
+		jriscStatsWriteJson(stats, fp);
+		break;
+
+	default:
+		return JRISC_ERROR_invalidValue;
+	}
+
+	return ferror(fp) ? JRISC_ERROR_ioError : JRISC_success;
+}
@@ -0,0 +1,141 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#ifndef JRISC_STATS_H_
+#define JRISC_STATS_H_
+
+#include "jrisc_base.h"
+#include "jrisc_ctx.h"
+#include "jrisc_inst.h"
+#include "jrisc_regtype.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define JRISC_STATS_FIELD_VALUES	32	/* Values of a 5-bit field */
+#define JRISC_STATS_MOVEI_PAGES		256	/* 64KB pages of 24-bit space */
+
+enum JRISC_StatsField {
+	JRISC_statsSrc,
+	JRISC_statsDst,
+	JRISC_statsNumFields
+};
+
+/*
+ * Opcode and operand histograms. Every counter is indexed directly by
+ * something already in a decoded instruction, so counting is a handful of
+ * increments. Counters from separate threads or files combine with
+ * jriscStatsMerge.
+ */
+struct JRISC_Stats {
+	uint64_t instructions;
+	uint64_t invalidWords;
+
+	uint64_t opNames[JRISC_invalidOpName];
+
+	/* Raw field values, e.g. 0 for an addq of 32, by field and field type */
+	uint64_t fields[JRISC_statsNumFields][JRISC_unused]
+		[JRISC_STATS_FIELD_VALUES];
+
+	/*
+	 * movei values that fit in 24 bits, i.e. could be addresses, by their
+	 * top byte: $f0 for hardware registers and local RAM. Wider values are
+	 * counted in the last entry.
+	 */
+	uint64_t moveiPages[JRISC_STATS_MOVEI_PAGES + 1];
+
+	/* Adjacent pairs of instructions: bigrams[first][second] */
+	uint64_t bigrams[JRISC_invalidOpName][JRISC_invalidOpName];
+
+	/* Private: the previous instruction's opName, for bigrams */
+	enum JRISC_OpName previous;
+};
+
+enum JRISC_StatsFormat {
+	JRISC_statsCsv,
+	JRISC_statsJson
+};
+
+extern void
+jriscStatsInit(struct JRISC_Stats *stats);
+
+/* Count one decoded instruction */
+static inline void
+jriscStatsAdd(struct JRISC_Stats *stats,
+			  const struct JRISC_Instruction *instruction)
+{
+	const enum JRISC_OpName opName = instruction->opName;
+	const enum JRISC_RegType srcType = instruction->regSrc.type;
+	const enum JRISC_RegType dstType = instruction->regDst.type;
+
+	stats->instructions++;
+	stats->opNames[opName]++;
+
+	if (srcType < JRISC_unused) {
+		stats->fields[JRISC_statsSrc][srcType]
+			[jriscRegToRaw(&instruction->regSrc)]++;
+	}
+	if (dstType < JRISC_unused) {
+		stats->fields[JRISC_statsDst][dstType]
+			[jriscRegToRaw(&instruction->regDst)]++;
+	}
+
+	if (opName == JRISC_op_movei) {
+		if (instruction->longImmediate >> 24) {
+			stats->moveiPages[JRISC_STATS_MOVEI_PAGES]++;
+		} else {
+			stats->moveiPages[instruction->longImmediate >> 16]++;
+		}
+	}
+
+	if (stats->previous != JRISC_invalidOpName) {
+		stats->bigrams[stats->previous][opName]++;
+	}
+	stats->previous = opName;
+}
+
+/* Count a word that didn't decode. It also breaks the chain of bigrams. */
+static inline void
+jriscStatsAddInvalid(struct JRISC_Stats *stats)
+{
+	stats->invalidWords++;
+	stats->previous = JRISC_invalidOpName;
+}
+
+/* Start a new, unrelated stream of instructions, e.g. another section */
+static inline void
+jriscStatsBreak(struct JRISC_Stats *stats)
+{
+	stats->previous = JRISC_invalidOpName;
+}
+
+/* Add all of <src>'s counters to <dst>'s */
+extern void
+jriscStatsMerge(struct JRISC_Stats *dst, const struct JRISC_Stats *src);
+
+/* The number of instructions counted that only exist on the given CPU */
+extern uint64_t
+jriscStatsCpuCount(const struct JRISC_Stats *stats, enum JRISC_CPU cpu);
+
+/* Decode and count <size> bytes from the context's current position */
+extern enum JRISC_Error
+jriscStatsCollect(struct JRISC_Stats *stats,
+				  struct JRISC_Context *context,
+				  uint64_t size,
+				  enum JRISC_CPU cpu);
+
+/*
+ * Write every non-zero counter. CSV output has one
+ * "category,key,value,count" row per counter, e.g. "opname,addq,,12" or
+ * "bigram,movei,jump,3". JSON output is a single object with the same
+ * categories as members.
+ */
+extern enum JRISC_Error
+jriscStatsWrite(const struct JRISC_Stats *stats,
+				enum JRISC_StatsFormat format,
+				FILE *fp);
+
+#endif /* JRISC_STATS_H_ */
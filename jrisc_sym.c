@@ -0,0 +1,517 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_endian.h"
+#include "jrisc_image.h"
+#include "jrisc_sym.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#define STRING_BLOCK_SIZE		(64 * 1024)
+
+#define AOUT_NLIST_SIZE			12
+#define AOUT_N_STAB				0xe0
+#define AOUT_N_TYPE				0x1e
+
+#define COFF_SYMBOL_SIZE		18
+#define COFF_C_EXT				2
+#define COFF_C_STAT				3
+#define COFF_C_LABEL			6
+
+#define DRI_SYMBOL_SIZE			14
+#define DRI_DEFINED				0x8000
+#define DRI_EQUATED				0x4000
+#define DRI_LONGNAME			0x0048
+
+#if defined(__GNUC__) || defined(__clang__)
+#define JRISC_PREFETCH(addr) __builtin_prefetch(addr)
+#else
+#define JRISC_PREFETCH(addr) ((void)0)
+#endif
+
+/* Number of trailing one bits in val, plus one */
+static inline unsigned
+jriscTrailingOnesPlusOne(uint32_t val)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_ctz(~val) + 1;
+#elif defined(_MSC_VER)
+	unsigned long index;
+
+	_BitScanForward(&index, ~val);
+
+	return index + 1;
+#else
+	unsigned count = 1;
+
+	while (val & 1) {
+		val >>= 1;
+		count++;
+	}
+
+	return count;
+#endif
+}
+
+enum JRISC_Error
+jriscSymbolTableCreate(struct JRISC_SymbolTable **tableOut)
+{
+	struct JRISC_SymbolTable *table = calloc(1, sizeof(*table));
+
+	if (!table) return JRISC_ERROR_outOfMemory;
+
+	*tableOut = table;
+
+	return JRISC_success;
+}
+
+void
+jriscSymbolTableDestroy(struct JRISC_SymbolTable *table)
+{
+	unsigned i;
+
+	if (!table) return;
+
+	for (i = 0; i < table->numStringBlocks; i++) free(table->stringBlocks[i]);
+
+	free(table->stringBlocks);
+	free(table->symbols);
+	free(table->tree);
+	free(table->treeIndex);
+	free(table);
+}
+
+/*
+ * Names are packed into large blocks rather than allocated one at a time, so
+ * loading 100K+ symbols doesn't mean 100K+ mallocs.
+ */
+static const char *
+jriscSymbolTableCopyName(struct JRISC_SymbolTable *table,
+						 const char *name,
+						 size_t length)
+{
+	char **blocks;
+	char *block;
+	char *copy;
+	size_t blockSize = STRING_BLOCK_SIZE;
+
+	if (!table->numStringBlocks ||
+		((table->stringBlockUsed + length + 1) > STRING_BLOCK_SIZE)) {
+		if ((length + 1) > blockSize) blockSize = length + 1;
+
+		blocks = realloc(table->stringBlocks,
+						 (table->numStringBlocks + 1) * sizeof(*blocks));
+		if (!blocks) return NULL;
+		table->stringBlocks = blocks;
+
+		block = malloc(blockSize);
+		if (!block) return NULL;
+
+		table->stringBlocks[table->numStringBlocks++] = block;
+		table->stringBlockUsed = 0;
+	}
+
+	copy = &table->stringBlocks[table->numStringBlocks - 1]
+		[table->stringBlockUsed];
+	memcpy(copy, name, length);
+	copy[length] = '\0';
+	table->stringBlockUsed += length + 1;
+
+	return copy;
+}
+
+static enum JRISC_Error
+jriscSymbolTableAddLength(struct JRISC_SymbolTable *table,
+						  const char *name,
+						  size_t length,
+						  uint32_t address,
+						  uint32_t size)
+{
+	struct JRISC_Symbol *symbols;
+	struct JRISC_Symbol *sym;
+	unsigned capacity;
+
+	if (!length) return JRISC_success;
+
+	if (table->count == table->capacity) {
+		capacity = table->capacity ? table->capacity * 2 : 256;
+		symbols = realloc(table->symbols, capacity * sizeof(*symbols));
+		if (!symbols) return JRISC_ERROR_outOfMemory;
+		table->symbols = symbols;
+		table->capacity = capacity;
+	}
+
+	sym = &table->symbols[table->count];
+	sym->name = jriscSymbolTableCopyName(table, name, length);
+	if (!sym->name) return JRISC_ERROR_outOfMemory;
+	sym->address = address;
+	sym->size = size;
+
+	table->count++;
+	table->finalized = false;
+
+	return JRISC_success;
+}
+
+enum JRISC_Error
+jriscSymbolTableAdd(struct JRISC_SymbolTable *table,
+					const char *name,
+					uint32_t address,
+					uint32_t size)
+{
+	return jriscSymbolTableAddLength(table, name, strlen(name), address, size);
+}
+
+static enum JRISC_Error
+jriscSymbolTableLoadAout(struct JRISC_SymbolTable *table,
+						 const struct JRISC_Image *image)
+{
+	const uint8_t *syms = &image->data[image->symbolOffset];
+	const char *strings = (const char *)&image->data[image->stringOffset];
+	const uint8_t *s;
+	uint64_t i;
+	uint32_t strx;
+	uint8_t type;
+	enum JRISC_Error ret;
+
+	for (i = 0; (i + AOUT_NLIST_SIZE) <= image->symbolSize;
+		 i += AOUT_NLIST_SIZE) {
+		s = &syms[i];
+		strx = jriscLoadBE32(&s[0]);
+		type = s[4];
+
+		/* Skip debugger entries and undefined externals */
+		if (type & AOUT_N_STAB) continue;
+		if (!(type & AOUT_N_TYPE)) continue;
+		if ((strx < 4) || (strx >= image->stringSize)) continue;
+
+		ret = jriscSymbolTableAddLength(table, &strings[strx],
+										strnlen(&strings[strx],
+												image->stringSize - strx),
+										jriscLoadBE32(&s[8]), 0);
+		if (ret != JRISC_success) return ret;
+	}
+
+	return JRISC_success;
+}
+
+static enum JRISC_Error
+jriscSymbolTableLoadCoff(struct JRISC_SymbolTable *table,
+						 const struct JRISC_Image *image)
+{
+	const uint8_t *syms = &image->data[image->symbolOffset];
+	const char *strings = (const char *)&image->data[image->stringOffset];
+	const uint8_t *s;
+	const char *name;
+	size_t length;
+	uint64_t i;
+	uint32_t strx;
+	int16_t section;
+	uint8_t storage;
+	uint8_t numAux;
+	enum JRISC_Error ret;
+
+	for (i = 0; (i + COFF_SYMBOL_SIZE) <= image->symbolSize;
+		 i += COFF_SYMBOL_SIZE * (1 + numAux)) {
+		s = &syms[i];
+		section = (int16_t)jriscLoadBE16(&s[12]);
+		storage = s[16];
+		numAux = s[17];
+
+		if (section == 0) continue;
+		if ((storage != COFF_C_EXT) && (storage != COFF_C_STAT) &&
+			(storage != COFF_C_LABEL)) continue;
+
+		/* Section symbols are statics carrying an auxiliary entry */
+		if ((storage == COFF_C_STAT) && numAux) continue;
+
+		if (jriscLoadBE32(&s[0]) == 0) {
+			strx = jriscLoadBE32(&s[4]);
+			if ((strx < 4) || (strx >= image->stringSize)) continue;
+			name = &strings[strx];
+			length = strnlen(name, image->stringSize - strx);
+		} else {
+			name = (const char *)s;
+			length = strnlen(name, 8);
+		}
+
+		ret = jriscSymbolTableAddLength(table, name, length,
+										jriscLoadBE32(&s[8]), 0);
+		if (ret != JRISC_success) return ret;
+	}
+
+	return JRISC_success;
+}
+
+static enum JRISC_Error
+jriscSymbolTableLoadDri(struct JRISC_SymbolTable *table,
+						const struct JRISC_Image *image)
+{
+	const uint8_t *syms = &image->data[image->symbolOffset];
+	const uint8_t *s;
+	char name[8 + DRI_SYMBOL_SIZE + 1];
+	size_t length;
+	uint64_t i;
+	uint16_t type;
+	enum JRISC_Error ret;
+
+	for (i = 0; (i + DRI_SYMBOL_SIZE) <= image->symbolSize;
+		 i += DRI_SYMBOL_SIZE) {
+		s = &syms[i];
+		type = jriscLoadBE16(&s[8]);
+
+		memcpy(name, s, 8);
+		length = strnlen(name, 8);
+
+		/* Extended (GST) names continue into the whole next entry */
+		if (((type & DRI_LONGNAME) == DRI_LONGNAME) &&
+			((i + 2 * DRI_SYMBOL_SIZE) <= image->symbolSize)) {
+			i += DRI_SYMBOL_SIZE;
+			if (length == 8) {
+				memcpy(&name[8], &syms[i], DRI_SYMBOL_SIZE);
+				length += strnlen(&name[8], DRI_SYMBOL_SIZE);
+			}
+		}
+
+		if (!(type & (DRI_DEFINED | DRI_EQUATED))) continue;
+
+		ret = jriscSymbolTableAddLength(table, name, length,
+										jriscLoadBE32(&s[10]), 0);
+		if (ret != JRISC_success) return ret;
+	}
+
+	return JRISC_success;
+}
+
+enum JRISC_Error
+jriscSymbolTableLoadImage(struct JRISC_SymbolTable *table,
+						  const struct JRISC_Image *image)
+{
+	if (!image->symbolSize) return JRISC_success;
+
+	switch (image->format) {
+	case JRISC_imageAout:
+		return jriscSymbolTableLoadAout(table, image);
+
+	case JRISC_imageCoff:
+		return jriscSymbolTableLoadCoff(table, image);
+
+	case JRISC_imageAbs:
+		return jriscSymbolTableLoadDri(table, image);
+
+	default:
+		return JRISC_success;
+	}
+}
+
+static bool
+jriscParseMapAddress(const char *token, uint32_t *addressOut)
+{
+	char *end;
+
+	if (token[0] == '$') token++;
+	else if ((token[0] == '0') && ((token[1] == 'x') || (token[1] == 'X'))) {
+		token += 2;
+	}
+
+	if (!isxdigit((unsigned char)token[0])) return false;
+
+	*addressOut = strtoul(token, &end, 16);
+
+	return !end[0];
+}
+
+enum JRISC_Error
+jriscSymbolTableLoadMap(struct JRISC_SymbolTable *table,
+						const char *fileName)
+{
+	FILE *fp = fopen(fileName, "r");
+	char line[1024];
+	char *tokens[3];
+	char *save;
+	const char *name;
+	unsigned numTokens;
+	uint32_t address;
+	uint32_t size;
+	enum JRISC_Error ret = JRISC_success;
+
+	if (!fp) return JRISC_ERROR_ioError;
+
+	while (fgets(line, sizeof(line), fp)) {
+		if ((line[0] == '#') || (line[0] == ';')) continue;
+
+		numTokens = 0;
+		for (save = strtok(line, " \t\r\n"); save && (numTokens < 3);
+			 save = strtok(NULL, " \t\r\n")) {
+			tokens[numTokens++] = save;
+		}
+
+		if (numTokens < 2) continue;
+
+		/* Symbol names can't start with a digit, so try the address first */
+		if (isdigit((unsigned char)tokens[0][0]) || (tokens[0][0] == '$')) {
+			if (!jriscParseMapAddress(tokens[0], &address)) continue;
+			name = tokens[1];
+		} else {
+			if (!jriscParseMapAddress(tokens[1], &address)) continue;
+			name = tokens[0];
+		}
+
+		size = 0;
+		if (numTokens > 2) jriscParseMapAddress(tokens[2], &size);
+
+		ret = jriscSymbolTableAdd(table, name, address, size);
+		if (ret != JRISC_success) break;
+	}
+
+	fclose(fp);
+
+	return ret;
+}
+
+struct SortKey {
+	uint32_t address;
+	unsigned index;
+};
+
+static int
+jriscCompareSortKeys(const void *a, const void *b)
+{
+	const struct SortKey *keyA = a;
+	const struct SortKey *keyB = b;
+
+	if (keyA->address != keyB->address) {
+		return (keyA->address < keyB->address) ? -1 : 1;
+	}
+
+	/* Keep the first-added name for a given address */
+	return (keyA->index < keyB->index) ? -1 : (keyA->index > keyB->index);
+}
+
+static unsigned
+jriscSymbolTableBuildTree(struct JRISC_SymbolTable *table,
+						  unsigned sortedIndex,
+						  unsigned k)
+{
+	if (k <= table->count) {
+		sortedIndex = jriscSymbolTableBuildTree(table, sortedIndex, 2 * k);
+		table->tree[k] = table->symbols[sortedIndex].address;
+		table->treeIndex[k] = sortedIndex++;
+		sortedIndex = jriscSymbolTableBuildTree(table, sortedIndex, 2 * k + 1);
+	}
+
+	return sortedIndex;
+}
+
+enum JRISC_Error
+jriscSymbolTableFinalize(struct JRISC_SymbolTable *table)
+{
+	struct JRISC_Symbol *sorted;
+	struct SortKey *keys;
+	bool inOrder = true;
+	unsigned i;
+	unsigned out;
+
+	if (table->finalized) return JRISC_success;
+
+	/* qsort isn't stable, so sort on (address, insertion order) keys */
+	keys = malloc((table->count + 1) * sizeof(*keys));
+	sorted = malloc((table->capacity + 1) * sizeof(*sorted));
+	if (!keys || !sorted) {
+		free(keys);
+		free(sorted);
+		return JRISC_ERROR_outOfMemory;
+	}
+
+	for (i = 0; i < table->count; i++) {
+		keys[i].address = table->symbols[i].address;
+		keys[i].index = i;
+		if (i && (keys[i].address < keys[i - 1].address)) inOrder = false;
+	}
+
+	/* Tables built in address order, like generated labels, skip the sort */
+	if (!inOrder) {
+		qsort(keys, table->count, sizeof(keys[0]), jriscCompareSortKeys);
+	}
+
+	for (i = 0, out = 0; i < table->count; i++) {
+		const struct JRISC_Symbol *sym = &table->symbols[keys[i].index];
+
+		if (out && (sorted[out - 1].address == sym->address)) {
+			if (!sorted[out - 1].size) sorted[out - 1].size = sym->size;
+			continue;
+		}
+
+		sorted[out++] = *sym;
+	}
+
+	free(keys);
+	free(table->symbols);
+	table->symbols = sorted;
+	table->count = out;
+
+	free(table->tree);
+	free(table->treeIndex);
+	table->tree = malloc((table->count + 1) * sizeof(*table->tree));
+	table->treeIndex = malloc((table->count + 1) * sizeof(*table->treeIndex));
+	if (!table->tree || !table->treeIndex) {
+		free(table->tree);
+		free(table->treeIndex);
+		table->tree = table->treeIndex = NULL;
+		return JRISC_ERROR_outOfMemory;
+	}
+
+	jriscSymbolTableBuildTree(table, 0, 1);
+	table->finalized = true;
+
+	return JRISC_success;
+}
+
+const struct JRISC_Symbol *
+jriscSymbolTableLookup(const struct JRISC_SymbolTable *table,
+					   uint32_t address,
+					   uint32_t *offsetOut)
+{
+	const struct JRISC_Symbol *sym;
+	const unsigned count = table->count;
+	unsigned next;
+	uint32_t offset;
+	uint32_t k = 1;
+
+	if (!table->finalized || !count) return NULL;
+
+	/* Branch-free descent, then recover the first node above address */
+	while (k <= count) {
+		JRISC_PREFETCH(&table->tree[k * 16]);
+		k = 2 * k + (table->tree[k] <= address);
+	}
+	k >>= jriscTrailingOnesPlusOne(k);
+
+	next = k ? table->treeIndex[k] : count;
+	if (!next) return NULL;
+
+	sym = &table->symbols[next - 1];
+	offset = address - sym->address;
+
+	if (sym->size) {
+		if (offset >= sym->size) return NULL;
+	} else if ((next == count) && offset) {
+		/* Nothing bounds the last symbol, so only match it exactly */
+		return NULL;
+	}
+
+	if (offsetOut) *offsetOut = offset;
+
+	return sym;
+}
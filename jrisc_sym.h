@@ -0,0 +1,84 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#ifndef JRISC_SYM_H_
+#define JRISC_SYM_H_
+
+#include "jrisc_base.h"
+#include "jrisc_image.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+struct JRISC_Symbol {
+	uint32_t address;
+	uint32_t size;			/* 0 if unknown */
+	const char *name;
+};
+
+struct JRISC_SymbolTable {
+	/* Sorted by address once finalized, with at most one name per address */
+	struct JRISC_Symbol *symbols;
+	unsigned count;
+
+	/* Private */
+	unsigned capacity;
+	char **stringBlocks;
+	unsigned numStringBlocks;
+	size_t stringBlockUsed;
+
+	/*
+	 * The addresses again, in Eytzinger (implicit BFS tree) order, 1-based,
+	 * with each slot's position in the sorted array alongside. Lookups walk
+	 * this top-down, touching one cache line per few levels.
+	 */
+	uint32_t *tree;
+	uint32_t *treeIndex;
+	bool finalized;
+};
+
+extern enum JRISC_Error
+jriscSymbolTableCreate(struct JRISC_SymbolTable **tableOut);
+
+extern void
+jriscSymbolTableDestroy(struct JRISC_SymbolTable *table);
+
+/* The name is copied. Adding symbols un-finalizes the table. */
+extern enum JRISC_Error
+jriscSymbolTableAdd(struct JRISC_SymbolTable *table,
+					const char *name,
+					uint32_t address,
+					uint32_t size);
+
+/* Load the a.out, COFF, or DRI symbol table of an image, if it has one */
+extern enum JRISC_Error
+jriscSymbolTableLoadImage(struct JRISC_SymbolTable *table,
+						  const struct JRISC_Image *image);
+
+/*
+ * Load a text map file. Each line holds an address and a name, in either
+ * order, optionally followed by a size. Blank lines and lines starting with
+ * '#' or ';' are ignored.
+ */
+extern enum JRISC_Error
+jriscSymbolTableLoadMap(struct JRISC_SymbolTable *table,
+						const char *fileName);
+
+/* Sort, drop duplicate addresses, and build the lookup tree */
+extern enum JRISC_Error
+jriscSymbolTableFinalize(struct JRISC_SymbolTable *table);
+
+/*
+ * Find the symbol covering an address: the nearest one at or below it, if the
+ * address is within its size, or before the next symbol when the size is
+ * unknown. The table must be finalized.
+ */
+extern const struct JRISC_Symbol *
+jriscSymbolTableLookup(const struct JRISC_SymbolTable *table,
+					   uint32_t address,
+					   uint32_t *offsetOut);
+
+#endif /* JRISC_SYM_H_ */
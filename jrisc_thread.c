@@ -0,0 +1,256 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_thread.h"
+
+#include <stdlib.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+struct JRISC_Thread {
+	JRISC_ThreadFunc func;
+	void *arg;
+
+#if defined(_WIN32)
+	HANDLE handle;
+#else
+	pthread_t handle;
+#endif
+};
+
+struct JRISC_Mutex {
+#if defined(_WIN32)
+	CRITICAL_SECTION lock;
+#else
+	pthread_mutex_t lock;
+#endif
+};
+
+struct JRISC_Cond {
+#if defined(_WIN32)
+	CONDITION_VARIABLE cond;
+#else
+	pthread_cond_t cond;
+#endif
+};
+
+#if defined(_WIN32)
+static DWORD WINAPI
+jriscThreadStart(LPVOID param)
+{
+	struct JRISC_Thread *thread = param;
+
+	thread->func(thread->arg);
+
+	return 0;
+}
+#else
+static void *
+jriscThreadStart(void *param)
+{
+	struct JRISC_Thread *thread = param;
+
+	thread->func(thread->arg);
+
+	return NULL;
+}
+#endif
+
+enum JRISC_Error
+jriscThreadCreate(JRISC_ThreadFunc func,
+				  void *arg,
+				  struct JRISC_Thread **threadOut)
+{
+	struct JRISC_Thread *thread = malloc(sizeof(*thread));
+
+	if (!thread) return JRISC_ERROR_outOfMemory;
+
+	thread->func = func;
+	thread->arg = arg;
+
+#if defined(_WIN32)
+	thread->handle = CreateThread(NULL, 0, jriscThreadStart, thread, 0, NULL);
+	if (!thread->handle) {
+		free(thread);
+		return JRISC_ERROR_outOfMemory;
+	}
+#else
+	if (pthread_create(&thread->handle, NULL, jriscThreadStart, thread)) {
+		free(thread);
+		return JRISC_ERROR_outOfMemory;
+	}
+#endif
+
+	*threadOut = thread;
+
+	return JRISC_success;
+}
+
+void
+jriscThreadJoin(struct JRISC_Thread *thread)
+{
+	if (!thread) return;
+
+#if defined(_WIN32)
+	WaitForSingleObject(thread->handle, INFINITE);
+	CloseHandle(thread->handle);
+#else
+	pthread_join(thread->handle, NULL);
+#endif
+
+	free(thread);
+}
+
+void
+jriscThreadYield(void)
+{
+#if defined(_WIN32)
+	SwitchToThread();
+#else
+	sched_yield();
+#endif
+}
+
+unsigned
+jriscThreadCpuCount(void)
+{
+#if defined(_WIN32)
+	SYSTEM_INFO info;
+
+	GetSystemInfo(&info);
+
+	return info.dwNumberOfProcessors ? info.dwNumberOfProcessors : 1;
+#else
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return (count > 0) ? (unsigned)count : 1;
+#endif
+}
+
+enum JRISC_Error
+jriscMutexCreate(struct JRISC_Mutex **mutexOut)
+{
+	struct JRISC_Mutex *mutex = malloc(sizeof(*mutex));
+
+	if (!mutex) return JRISC_ERROR_outOfMemory;
+
+#if defined(_WIN32)
+	InitializeCriticalSection(&mutex->lock);
+#else
+	if (pthread_mutex_init(&mutex->lock, NULL)) {
+		free(mutex);
+		return JRISC_ERROR_outOfMemory;
+	}
+#endif
+
+	*mutexOut = mutex;
+
+	return JRISC_success;
+}
+
+void
+jriscMutexDestroy(struct JRISC_Mutex *mutex)
+{
+	if (!mutex) return;
+
+#if defined(_WIN32)
+	DeleteCriticalSection(&mutex->lock);
+#else
+	pthread_mutex_destroy(&mutex->lock);
+#endif
+
+	free(mutex);
+}
+
+void
+jriscMutexLock(struct JRISC_Mutex *mutex)
+{
+#if defined(_WIN32)
+	EnterCriticalSection(&mutex->lock);
+#else
+	pthread_mutex_lock(&mutex->lock);
+#endif
+}
+
+void
+jriscMutexUnlock(struct JRISC_Mutex *mutex)
+{
+#if defined(_WIN32)
+	LeaveCriticalSection(&mutex->lock);
+#else
+	pthread_mutex_unlock(&mutex->lock);
+#endif
+}
+
+enum JRISC_Error
+jriscCondCreate(struct JRISC_Cond **condOut)
+{
+	struct JRISC_Cond *cond = malloc(sizeof(*cond));
+
+	if (!cond) return JRISC_ERROR_outOfMemory;
+
+#if defined(_WIN32)
+	InitializeConditionVariable(&cond->cond);
+#else
+	if (pthread_cond_init(&cond->cond, NULL)) {
+		free(cond);
+		return JRISC_ERROR_outOfMemory;
+	}
+#endif
+
+	*condOut = cond;
+
+	return JRISC_success;
+}
+
+void
+jriscCondDestroy(struct JRISC_Cond *cond)
+{
+	if (!cond) return;
+
+#if !defined(_WIN32)
+	pthread_cond_destroy(&cond->cond);
+#endif
+
+	free(cond);
+}
+
+void
+jriscCondWait(struct JRISC_Cond *cond, struct JRISC_Mutex *mutex)
+{
+#if defined(_WIN32)
+	SleepConditionVariableCS(&cond->cond, &mutex->lock, INFINITE);
+#else
+	pthread_cond_wait(&cond->cond, &mutex->lock);
+#endif
+}
+
+void
+jriscCondSignal(struct JRISC_Cond *cond)
+{
+#if defined(_WIN32)
+	WakeConditionVariable(&cond->cond);
+#else
+	pthread_cond_signal(&cond->cond);
+#endif
+}
+
+void
+jriscCondBroadcast(struct JRISC_Cond *cond)
+{
+#if defined(_WIN32)
+	WakeAllConditionVariable(&cond->cond);
+#else
+	pthread_cond_broadcast(&cond->cond);
+#endif
+}
@@ -0,0 +1,107 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#ifndef JRISC_THREAD_H_
+#define JRISC_THREAD_H_
+
+#include "jrisc_base.h"
+
+#include <stddef.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/* Minimal portable threads: POSIX threads, or Win32 threads on Windows */
+struct JRISC_Thread;
+struct JRISC_Mutex;
+struct JRISC_Cond;
+
+typedef void (*JRISC_ThreadFunc)(void *arg);
+
+extern enum JRISC_Error
+jriscThreadCreate(JRISC_ThreadFunc func,
+				  void *arg,
+				  struct JRISC_Thread **threadOut);
+
+/* Wait for the thread to return, then free it */
+extern void
+jriscThreadJoin(struct JRISC_Thread *thread);
+
+/* Give up the rest of this thread's time slice */
+extern void
+jriscThreadYield(void);
+
+/* The number of CPUs available, or 1 if that can't be determined */
+extern unsigned
+jriscThreadCpuCount(void);
+
+extern enum JRISC_Error
+jriscMutexCreate(struct JRISC_Mutex **mutexOut);
+
+extern void
+jriscMutexDestroy(struct JRISC_Mutex *mutex);
+
+extern void
+jriscMutexLock(struct JRISC_Mutex *mutex);
+
+extern void
+jriscMutexUnlock(struct JRISC_Mutex *mutex);
+
+extern enum JRISC_Error
+jriscCondCreate(struct JRISC_Cond **condOut);
+
+extern void
+jriscCondDestroy(struct JRISC_Cond *cond);
+
+/*
+ * Unlock the mutex, which must be held, sleep until the condition is signaled,
+ * then lock it again. As with pthreads, wakeups may be spurious, so callers
+ * must recheck what they are waiting for.
+ */
+extern void
+jriscCondWait(struct JRISC_Cond *cond, struct JRISC_Mutex *mutex);
+
+/* Wake one waiting thread */
+extern void
+jriscCondSignal(struct JRISC_Cond *cond);
+
+/* Wake every waiting thread */
+extern void
+jriscCondBroadcast(struct JRISC_Cond *cond);
+
+/*
+ * A load that no later memory access can be moved ahead of, and a store that
+ * no earlier one can be moved after, for handing data between threads without
+ * a lock. The MSVC versions rely on x86/x64's own ordering, which is the only
+ * kind of target the Visual Studio projects build for.
+ */
+static inline size_t
+jriscAtomicLoad(const volatile size_t *p)
+{
+#if defined(_MSC_VER)
+	size_t value = *p;
+
+	_ReadWriteBarrier();
+
+	return value;
+#else
+	return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+#endif
+}
+
+static inline void
+jriscAtomicStore(volatile size_t *p, size_t value)
+{
+#if defined(_MSC_VER)
+	_ReadWriteBarrier();
+	*p = value;
+#else
+	__atomic_store_n(p, value, __ATOMIC_RELEASE);
+#endif
+}
+
+#endif /* JRISC_THREAD_H_ */
@@ -0,0 +1,57 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_bank.h"
+#include "jrisc_program.h"
+#include "testprogram.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static const uint16_t code[] = {
+	OP(35, 10, 2),					/* moveq	#10, r2 */
+	OP(35, 0, 3),					/* moveq	#0, r3 */
+	OP(36, 3, 5),					/* moveta	r3, r5 */
+	OP(37, 5, 4),					/* loop:	movefa	r5, r4 */
+	OP(2, 1, 4),					/* addq	#1, r4 */
+	OP(36, 4, 5),					/* moveta	r4, r5 */
+	OP(37, 6, 7),					/* movefa	r6, r7 */
+	OP(0, 7, 3),					/* add	r7, r3 */
+	OP(6, 1, 2),					/* subq	#1, r2 */
+	OP(53, -7, 0x1),				/* jr	NE, loop */
+	OP(57, 0, 0),					/* nop */
+	OP(36, 3, 8),					/* moveta	r3, r8 */
+	OP(38, 0, 10), 0x2100, 0x00f0,	/* movei	#$f02100, r10 */
+	OP(37, 9, 11),					/* again:	movefa	r9, r11 */
+	OP(47, 10, 11),					/* store	r11, (r10) */
+	OP(53, -3, 0),					/* jr	again */
+	OP(57, 0, 0),					/* nop */
+};
+
+int
+main(int argc, char *argv[])
+{
+	struct JRISC_Program *program;
+	struct JRISC_BankMap *map;
+
+	program = decode(code, sizeof(code) / sizeof(code[0]));
+
+	if (jriscBankMapCompute(program, &map) != JRISC_success) {
+		printf("Failed to analyze banks\n");
+		return 1;
+	}
+
+	if (jriscBankMapWrite(map, stdout) != JRISC_success) {
+		printf("Failed to write report\n");
+		return 1;
+	}
+
+	jriscBankMapDestroy(map);
+	jriscProgramDestroy(program);
+
+	return 0;
+}
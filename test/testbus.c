@@ -0,0 +1,87 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_bus.h"
+#include "jrisc_inst.h"
+#include "jrisc_inst_string.h"
+#include "jrisc_program.h"
+#include "testprogram.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Copy a buffer from DRAM into local RAM, among other things */
+static const uint16_t code[] = {
+	OP(38, 0, 14), 0x3100, 0x00f0,	/* movei	#$f03100, r14 */
+	OP(43, 1, 1),					/* load	(r14+1), r1 */
+	OP(38, 0, 2), 0x0000, 0x00f0,	/* movei	#$f00000, r2 */
+	OP(46, 2, 1),					/* storew	r1, (r2) */
+	OP(38, 0, 3), 0x0000, 0x0010,	/* movei	#$100000, r3 */
+	OP(38, 0, 4), 0x3200, 0x00f0,	/* movei	#$f03200, r4 */
+	OP(35, 16, 5),					/* moveq	#16, r5 */
+	OP(41, 3, 6),					/* loop:	load	(r3), r6 */
+	OP(47, 4, 6),					/* store	r6, (r4) */
+	OP(2, 4, 3),					/* addq	#4, r3 */
+	OP(2, 4, 4),					/* addq	#4, r4 */
+	OP(6, 1, 5),					/* subq	#1, r5 */
+	OP(53, -6, 0x1),				/* jr	NE, loop */
+	OP(57, 0, 0),					/* nop */
+	OP(41, 7, 8),					/* load	(r7), r8 */
+	OP(60, 5, 8),					/* store	r8, (r14+r5) */
+	OP(38, 0, 9), 0x0000, 0x0080,	/* movei	#$800000, r9 */
+	OP(42, 9, 10),					/* loadp	(r9), r10 */
+};
+
+int
+main(int argc, char *argv[])
+{
+	static const uint32_t addresses[] = {
+		JRISC_GPU_RAM, JRISC_DSP_RAM + JRISC_DSP_RAM_SIZE - 4, JRISC_GPU_FLAGS,
+		JRISC_DSP_RAM, 0x4000, 0x800000, 0xffffff, 0x1f03000,
+	};
+	struct JRISC_Program *program;
+	struct JRISC_BusMap *map;
+	const struct JRISC_BusAccess *access;
+	char text[64];
+	size_t i, length;
+
+	for (i = 0; i < sizeof(addresses) / sizeof(addresses[0]); i++) {
+		printf("$%x: GPU %s, DSP %s\n", addresses[i],
+			   jriscBusRegionName(jriscBusRegion(JRISC_gpu, addresses[i])),
+			   jriscBusRegionName(jriscBusRegion(JRISC_dsp, addresses[i])));
+	}
+	printf("\n");
+
+	program = decode(code, sizeof(code) / sizeof(code[0]));
+
+	if (jriscBusMapCompute(program, &map) != JRISC_success) {
+		printf("Failed to classify accesses\n");
+		return 1;
+	}
+
+	for (i = 0; i < map->numAccesses; i++) {
+		access = &map->accesses[i];
+		length = sizeof(text);
+		jriscInstructionToString(&program->instructions[access->index],
+								 JRISC_STRINGFLAG_ADDRESS, text, &length);
+		printf("%-32s %s %s", text, access->store ? "store" : "load ",
+			   jriscBusRegionName(access->region));
+		if (access->addressKnown) printf(" $%x", access->address);
+		printf("\n");
+	}
+	printf("\n");
+
+	if (jriscBusMapWrite(map, 0, NULL, stdout) != JRISC_success) {
+		printf("Failed to write report\n");
+		return 1;
+	}
+
+	jriscBusMapDestroy(map);
+	jriscProgramDestroy(program);
+
+	return 0;
+}
@@ -0,0 +1,234 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_cache.h"
+#include "jrisc_ctx.h"
+#include "jrisc_ctx_mem.h"
+#include "jrisc_inst.h"
+#include "jrisc_inst_string.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/types.h>
+#include <utime.h>
+
+#define CACHE_DIR		"testcache.dir"
+#define MAX_RECORDS		16
+
+/* The header's size and where numRecords and textSize sit in it */
+#define HEADER_SIZE		40
+#define NUM_RECORDS_AT	24
+#define TEXT_SIZE_AT	32
+
+static const uint8_t code[] = {
+	0x98, 0x1f, 0x05, 0xbc, 0x00, 0x00,	/* movei #$5bc, r31 */
+	0xbf, 0xe0,							/* store r0, (r31) */
+	0x08, 0x9f,							/* addq #4, r31 */
+	0xa7, 0xe0,							/* load (r31), r0 */
+	0xd7, 0xc0,							/* jr $f0300a */
+	0xe4, 0x00							/* nop */
+};
+
+static const char text[] = "Some disassembly\n";
+
+static char *
+entryPath(uint64_t key)
+{
+	static char path[64];
+
+	snprintf(path, sizeof(path), "%s/%016llx.jrc", CACHE_DIR,
+			 (unsigned long long)key);
+
+	return path;
+}
+
+/* Read an entry's file, change it, and write it back */
+static void
+damage(uint64_t key, long cut, uint64_t numRecords, uint64_t textSize)
+{
+	uint8_t buf[1024];
+	size_t size;
+	FILE *fp = fopen(entryPath(key), "rb");
+
+	if (!fp) {
+		printf("Failed to read entry\n");
+		exit(1);
+	}
+	size = fread(buf, 1, sizeof(buf), fp);
+	fclose(fp);
+
+	if (numRecords) memcpy(&buf[NUM_RECORDS_AT], &numRecords, 8);
+	if (textSize) memcpy(&buf[TEXT_SIZE_AT], &textSize, 8);
+
+	fp = fopen(entryPath(key), "wb");
+	if (!fp || (fwrite(buf, 1, size - cut, fp) != size - cut) || fclose(fp)) {
+		printf("Failed to write entry\n");
+		exit(1);
+	}
+}
+
+static void
+lookup(struct JRISC_Cache *cache, const char *name, uint64_t key)
+{
+	struct JRISC_CacheEntry *entry;
+	enum JRISC_Error err = jriscCacheLookup(cache, key, &entry);
+
+	if (err != JRISC_success) {
+		printf("%s: miss (%d)\n", name, err);
+		return;
+	}
+
+	printf("%s: hit, %llu records, %llu bytes of text\n", name,
+		   (unsigned long long)entry->numRecords,
+		   (unsigned long long)entry->textSize);
+	jriscCacheEntryRelease(entry);
+}
+
+static void
+store(struct JRISC_Cache *cache, uint64_t key)
+{
+	if (jriscCacheStore(cache, key, NULL, 0, text, strlen(text)) !=
+		JRISC_success) {
+		printf("Failed to store %llu\n", (unsigned long long)key);
+		exit(1);
+	}
+
+	printf("stored %llu: cache size %llu\n", (unsigned long long)key,
+		   (unsigned long long)cache->size);
+}
+
+/* Set when an entry was last used, in seconds before now */
+static void
+age(uint64_t key, time_t secondsAgo)
+{
+	struct utimbuf times;
+
+	times.actime = times.modtime = time(NULL) - secondsAgo;
+	utime(entryPath(key), &times);
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct JRISC_CacheRecord records[MAX_RECORDS];
+	struct JRISC_Instruction inst;
+	struct JRISC_CacheEntry *entry;
+	struct JRISC_Context *ctx;
+	struct JRISC_Cache *cache;
+	uint64_t numRecords = 0;
+	uint64_t fileSize;
+	uint64_t key;
+	uint64_t i;
+
+	key = jriscCacheKey(code, sizeof(code), 0, 0xf03000, JRISC_gpu, 0, 0);
+	printf("key: same %d, offset %d, address %d, cpu %d, flags %d, salt %d\n",
+		   key == jriscCacheKey(code, sizeof(code), 0, 0xf03000, JRISC_gpu,
+								0, 0),
+		   key == jriscCacheKey(code, sizeof(code), 2, 0xf03000, JRISC_gpu,
+								0, 0),
+		   key == jriscCacheKey(code, sizeof(code), 0, 0xf1b000, JRISC_gpu,
+								0, 0),
+		   key == jriscCacheKey(code, sizeof(code), 0, 0xf03000, JRISC_dsp,
+								0, 0),
+		   key == jriscCacheKey(code, sizeof(code), 0, 0xf03000, JRISC_gpu,
+								1, 0),
+		   key == jriscCacheKey(code, sizeof(code), 0, 0xf03000, JRISC_gpu,
+								0, 1));
+
+	/* Start from an empty cache, however the last run ended */
+	if ((jriscCacheOpen(CACHE_DIR, 0, &cache) != JRISC_success)) {
+		printf("Failed to open cache\n");
+		return 1;
+	}
+	jriscCacheClose(cache);
+	jriscCacheOpen(CACHE_DIR, 1024 * 1024, &cache);
+	printf("open: cache size %llu\n", (unsigned long long)cache->size);
+
+	lookup(cache, "empty", key);
+
+	if (jriscContextFromMemory(code, sizeof(code), NULL, 0, 0xf03000, &ctx) !=
+		JRISC_success) {
+		printf("Failed to create context\n");
+		return 1;
+	}
+	while ((numRecords < MAX_RECORDS) &&
+		   (jriscInstructionRead(ctx, JRISC_gpu, &inst) == JRISC_success)) {
+		jriscCacheRecordFromInstruction(&inst, &records[numRecords++]);
+	}
+	jriscContextDestroy(ctx);
+
+	if (jriscCacheStore(cache, key, records, numRecords, text, strlen(text)) !=
+		JRISC_success) {
+		printf("Failed to store\n");
+		return 1;
+	}
+	printf("stored: cache size %llu\n", (unsigned long long)cache->size);
+
+	if (jriscCacheLookup(cache, key, &entry) != JRISC_success) {
+		printf("Failed to look up\n");
+		return 1;
+	}
+	printf("text matches: %d\n", (entry->textSize == strlen(text)) &&
+		   !memcmp(entry->text, text, strlen(text)));
+	for (i = 0; i < entry->numRecords; i++) {
+		jriscCacheRecordToInstruction(&entry->records[i], &inst);
+		jriscInstructionPrint(&inst, JRISC_STRINGFLAG_ADDRESS);
+	}
+	jriscCacheEntryRelease(entry);
+
+	/* Damaged entries are misses, to be replaced by the next store */
+	damage(key, 1, 0, 0);
+	lookup(cache, "truncated", key);
+	jriscCacheStore(cache, key, records, numRecords, text, strlen(text));
+	lookup(cache, "replaced", key);
+
+	/* As many records as the file could hold, and a size that wraps */
+	fileSize = HEADER_SIZE + numRecords * sizeof(records[0]) + strlen(text);
+	damage(key, 0, fileSize / sizeof(records[0]),
+		   fileSize - HEADER_SIZE -
+		   (fileSize / sizeof(records[0])) * sizeof(records[0]));
+	lookup(cache, "wrapped", key);
+
+	damage(key, (long)fileSize - 8, 0, 0);
+	lookup(cache, "short header", key);
+	jriscCacheClose(cache);
+
+	/* Room for two text-only entries, counting from an empty cache */
+	jriscCacheOpen(CACHE_DIR, 0, &cache);
+	jriscCacheClose(cache);
+	jriscCacheOpen(CACHE_DIR, 2 * (HEADER_SIZE + strlen(text)), &cache);
+
+	store(cache, 1);
+	store(cache, 2);
+
+	/* 1 was used more recently, so 2 goes, though 1 would win a tie */
+	age(1, 10);
+	age(2, 20);
+	store(cache, 3);
+	lookup(cache, "1", 1);
+	lookup(cache, "2", 2);
+	lookup(cache, "3", 3);
+	jriscCacheClose(cache);
+
+	/* Reopening with a smaller budget trims to fit and rescans the size */
+	age(1, 10);
+	age(3, 20);
+	jriscCacheOpen(CACHE_DIR, HEADER_SIZE + strlen(text), &cache);
+	printf("reopen: cache size %llu\n", (unsigned long long)cache->size);
+	lookup(cache, "1", 1);
+	lookup(cache, "3", 3);
+	jriscCacheClose(cache);
+
+	jriscCacheOpen(CACHE_DIR, 0, &cache);
+	printf("emptied: cache size %llu\n", (unsigned long long)cache->size);
+	jriscCacheClose(cache);
+	remove(CACHE_DIR);
+
+	return 0;
+}
@@ -0,0 +1,129 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_classify.h"
+#include "testprogram.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static const uint16_t gpuCode[] = {
+	OP(38, 0, 0), 0x3000, 0x00f0,	/* movei	#$f03000, r0 */
+	OP(42, 2, 1),					/* loadp	(r2), r1 */
+	OP(32, 0, 1),					/* sat8	r1 */
+	OP(62, 0, 3),					/* sat24	r3 */
+	OP(63, 0, 1),					/* pack	r1 */
+	OP(0, 1, 2),					/* add	r1, r2 */
+	OP(48, 2, 1),					/* storep	r1, (r2) */
+	OP(53, -8, 0),					/* jr	loop */
+	OP(57, 0, 0),					/* nop */
+};
+
+static const uint16_t dspCode[] = {
+	OP(38, 0, 14), 0xb000, 0x00f1,	/* movei	#$f1b000, r14 */
+	OP(38, 0, 15), 0xa100, 0x00f1,	/* movei	#$f1a100, r15 */
+	OP(63, 4, 3),					/* addqmod	#4, r3 */
+	OP(32, 2, 4),					/* subqmod	#2, r4 */
+	OP(41, 14, 5),					/* load	(r14), r5 */
+	OP(33, 0, 5),					/* sat16s	r5 */
+	OP(47, 15, 5),					/* store	r5, (r15) */
+	OP(53, -8, 0),					/* jr	loop */
+	OP(57, 0, 0),					/* nop */
+};
+
+/* Nothing here that only one CPU has */
+static const uint16_t commonCode[] = {
+	OP(35, 4, 1),					/* moveq	#4, r1 */
+	OP(41, 2, 3),					/* load	(r2), r3 */
+	OP(0, 1, 3),					/* add	r1, r3 */
+	OP(47, 2, 3),					/* store	r3, (r2) */
+	OP(6, 1, 4),					/* subq	#1, r4 */
+	OP(53, -6, 0x1),				/* jr	NE, loop */
+	OP(57, 0, 0),					/* nop */
+};
+
+static void
+toBytes(const uint16_t *words, size_t numWords, bool littleEndian,
+		uint8_t *bytes)
+{
+	size_t i;
+
+	for (i = 0; i < numWords; i++) {
+		bytes[i * 2 + (littleEndian ? 1 : 0)] = words[i] >> 8;
+		bytes[i * 2 + (littleEndian ? 0 : 1)] = words[i] & 0xff;
+	}
+}
+
+static void
+printGuess(const char *name, const struct JRISC_CpuGuess *guess)
+{
+	printf("%s: %s, GPU %u%%, DSP %u%%\n", name,
+		   (guess->cpu == JRISC_gpu) ? "GPU" :
+		   (guess->cpu == JRISC_dsp) ? "DSP" : "unknown",
+		   guess->gpuConfidence, guess->dspConfidence);
+	printf("  %llu words, invalid %llu/%llu, only %llu/%llu, "
+		   "addresses %llu/%llu\n",
+		   (unsigned long long)guess->words,
+		   (unsigned long long)guess->gpuInvalid,
+		   (unsigned long long)guess->dspInvalid,
+		   (unsigned long long)guess->gpuOnly,
+		   (unsigned long long)guess->dspOnly,
+		   (unsigned long long)guess->gpuAddresses,
+		   (unsigned long long)guess->dspAddresses);
+}
+
+static void
+testCode(const char *name, const uint16_t *words, size_t numWords,
+		 bool littleEndian)
+{
+	uint8_t bytes[64];
+	struct JRISC_CpuGuess guess;
+
+	toBytes(words, numWords, littleEndian, bytes);
+
+	memset(&guess, 0, sizeof(guess));
+	jriscCpuGuessScan(&guess, bytes, numWords * 2,
+					  littleEndian ? JRISC_littleEndian : JRISC_bigEndian);
+	printGuess(name, &guess);
+}
+
+int
+main(int argc, char *argv[])
+{
+	uint8_t noise[4096];
+	uint32_t seed = 1;
+	uint8_t bytes[64];
+	struct JRISC_CpuGuess guess;
+	size_t i;
+
+	testCode("GPU", gpuCode, sizeof(gpuCode) / sizeof(gpuCode[0]), false);
+	testCode("GPU, little-endian", gpuCode,
+			 sizeof(gpuCode) / sizeof(gpuCode[0]), true);
+	testCode("DSP", dspCode, sizeof(dspCode) / sizeof(dspCode[0]), false);
+	testCode("Common", commonCode,
+			 sizeof(commonCode) / sizeof(commonCode[0]), false);
+
+	/* Sections of one file add up */
+	memset(&guess, 0, sizeof(guess));
+	toBytes(commonCode, sizeof(commonCode) / sizeof(commonCode[0]), false,
+			bytes);
+	jriscCpuGuessScan(&guess, bytes, sizeof(commonCode), JRISC_bigEndian);
+	toBytes(dspCode, sizeof(dspCode) / sizeof(dspCode[0]), false, bytes);
+	jriscCpuGuessScan(&guess, bytes, sizeof(dspCode), JRISC_bigEndian);
+	printGuess("Common then DSP", &guess);
+
+	for (i = 0; i < sizeof(noise); i++) {
+		seed = seed * 1103515245 + 12345;
+		noise[i] = (uint8_t)(seed >> 16);
+	}
+
+	memset(&guess, 0, sizeof(guess));
+	jriscCpuGuessScan(&guess, noise, sizeof(noise), JRISC_bigEndian);
+	printGuess("Noise", &guess);
+
+	return 0;
+}
@@ -0,0 +1,228 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_ctx.h"
+#include "jrisc_ctx_compressed.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * DATA_SIZE bytes of PATTERN(i), compressed with gzip as two members of 8K
+ * each, and with xz as one stream. Expects a build with zlib and liblzma.
+ */
+#define DATA_SIZE	16384
+#define PATTERN(i)	(uint8_t)((((i) >> 8) + ((i) & 0xff) * 3) & 0xff)
+
+/* Small enough that the test slides and restarts the window */
+#define WINDOW_SIZE	1024
+
+static const uint8_t gzipData[] = {
+	0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x63, 0x60,
+	0x66, 0xe3, 0xe4, 0xe1, 0x17, 0x12, 0x95, 0x90, 0x96, 0x53, 0x54, 0x51,
+	0xd7, 0xd2, 0x35, 0x30, 0x36, 0xb3, 0xb4, 0xb1, 0x77, 0x72, 0xf5, 0xf0,
+	0xf6, 0x0b, 0x0c, 0x09, 0x8f, 0x8a, 0x4d, 0x48, 0x4e, 0xcb, 0xcc, 0xc9,
+	0x2f, 0x2a, 0xad, 0xa8, 0xae, 0x6b, 0x6c, 0x69, 0xef, 0xea, 0x9d, 0x30,
+	0x79, 0xda, 0xcc, 0x39, 0xf3, 0x17, 0x2d, 0x5d, 0xb1, 0x7a, 0xdd, 0xc6,
+	0x2d, 0xdb, 0x77, 0xed, 0x3d, 0x70, 0xf8, 0xd8, 0xc9, 0x33, 0xe7, 0x2f,
+	0x5d, 0xbd, 0x71, 0xfb, 0xde, 0xc3, 0x27, 0xcf, 0x5f, 0xbd, 0xfd, 0xf0,
+	0xf9, 0xdb, 0xcf, 0x3f, 0xff, 0x99, 0x58, 0x39, 0xb8, 0xf9, 0x04, 0x45,
+	0xc4, 0xa5, 0x64, 0x15, 0x94, 0xd5, 0x34, 0x75, 0xf4, 0x8d, 0x4c, 0x2d,
+	0xac, 0xed, 0x1c, 0x5d, 0xdc, 0xbd, 0x7c, 0x03, 0x82, 0xc3, 0x22, 0x63,
+	0xe2, 0x93, 0x52, 0x33, 0xb2, 0xf3, 0x0a, 0x4b, 0xca, 0xab, 0x6a, 0x1b,
+	0x9a, 0xdb, 0x3a, 0x7b, 0xfa, 0x27, 0x4d, 0x9d, 0x31, 0x7b, 0xde, 0xc2,
+	0x25, 0xcb, 0x57, 0xad, 0xdd, 0xb0, 0x79, 0xdb, 0xce, 0x3d, 0xfb, 0x0f,
+	0x1d, 0x3d, 0x71, 0xfa, 0xdc, 0xc5, 0x2b, 0xd7, 0x6f, 0xdd, 0x7d, 0xf0,
+	0xf8, 0xd9, 0xcb, 0x37, 0xef, 0x3f, 0x7d, 0xfd, 0xf1, 0xfb, 0x1f, 0x23,
+	0x0b, 0x3b, 0x17, 0xaf, 0x80, 0xb0, 0x98, 0xa4, 0x8c, 0xbc, 0x92, 0xaa,
+	0x86, 0xb6, 0x9e, 0xa1, 0x89, 0xb9, 0x95, 0xad, 0x83, 0xb3, 0x9b, 0xa7,
+	0x8f, 0x7f, 0x50, 0x68, 0x44, 0x74, 0x5c, 0x62, 0x4a, 0x7a, 0x56, 0x6e,
+	0x41, 0x71, 0x59, 0x65, 0x4d, 0x7d, 0x53, 0x6b, 0x47, 0x77, 0xdf, 0xc4,
+	0x29, 0xd3, 0x67, 0xcd, 0x5d, 0xb0, 0x78, 0xd9, 0xca, 0x35, 0xeb, 0x37,
+	0x6d, 0xdd, 0xb1, 0x7b, 0xdf, 0xc1, 0x23, 0xc7, 0x4f, 0x9d, 0xbd, 0x70,
+	0xf9, 0xda, 0xcd, 0x3b, 0xf7, 0x1f, 0x3d, 0x7d, 0xf1, 0xfa, 0xdd, 0xc7,
+	0x2f, 0xdf, 0x7f, 0xfd, 0xa5, 0x89, 0xa1, 0x0c, 0x43, 0x27, 0x50, 0x87,
+	0x4e, 0x4c, 0xd1, 0x26, 0x50, 0x47, 0x78, 0xf2, 0x67, 0x18, 0xe1, 0xc9,
+	0x9f, 0x71, 0x84, 0x27, 0x7f, 0xa6, 0x11, 0x9e, 0xfc, 0x99, 0x47, 0x78,
+	0xf2, 0x67, 0x19, 0xe1, 0xc9, 0x9f, 0x75, 0x84, 0x27, 0x7f, 0xb6, 0x11,
+	0x9e, 0xfc, 0xd9, 0x47, 0x78, 0xf2, 0xe7, 0x18, 0xe1, 0xc9, 0x9f, 0x73,
+	0x84, 0x27, 0x7f, 0xae, 0x11, 0x9e, 0xfc, 0xb9, 0x47, 0x78, 0xf2, 0xe7,
+	0x19, 0xe1, 0xc9, 0x9f, 0x77, 0x84, 0x27, 0x7f, 0xbe, 0x11, 0x9e, 0xfc,
+	0xf9, 0x47, 0x78, 0xf2, 0x17, 0x18, 0xe1, 0xc9, 0x5f, 0x70, 0x84, 0x27,
+	0x7f, 0xa1, 0x11, 0x9e, 0xfc, 0x85, 0x47, 0x78, 0xf2, 0x17, 0x19, 0xe1,
+	0xc9, 0x5f, 0x74, 0x84, 0x27, 0x7f, 0xb1, 0x11, 0x9e, 0xfc, 0xc5, 0x47,
+	0x78, 0xf2, 0x97, 0x18, 0xe1, 0xc9, 0x5f, 0x72, 0x84, 0x27, 0x7f, 0xa9,
+	0x11, 0x9e, 0xfc, 0xa5, 0x47, 0x78, 0xf2, 0x97, 0x01, 0x00, 0xa6, 0xa9,
+	0x22, 0x4b, 0x00, 0x20, 0x00, 0x00, 0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x02, 0x03, 0x53, 0x50, 0x56, 0xd3, 0xd4, 0xd1, 0x37, 0x32,
+	0xb5, 0xb0, 0xb6, 0x73, 0x74, 0x71, 0xf7, 0xf2, 0x0d, 0x08, 0x0e, 0x8b,
+	0x8c, 0x89, 0x4f, 0x4a, 0xcd, 0xc8, 0xce, 0x2b, 0x2c, 0x29, 0xaf, 0xaa,
+	0x6d, 0x68, 0x6e, 0xeb, 0xec, 0xe9, 0x9f, 0x34, 0x75, 0xc6, 0xec, 0x79,
+	0x0b, 0x97, 0x2c, 0x5f, 0xb5, 0x76, 0xc3, 0xe6, 0x6d, 0x3b, 0xf7, 0xec,
+	0x3f, 0x74, 0xf4, 0xc4, 0xe9, 0x73, 0x17, 0xaf, 0x5c, 0xbf, 0x75, 0xf7,
+	0xc1, 0xe3, 0x67, 0x2f, 0xdf, 0xbc, 0xff, 0xf4, 0xf5, 0xc7, 0xef, 0x7f,
+	0x8c, 0x2c, 0xec, 0x5c, 0xbc, 0x02, 0xc2, 0x62, 0x92, 0x32, 0xf2, 0x4a,
+	0xaa, 0x1a, 0xda, 0x7a, 0x86, 0x26, 0xe6, 0x56, 0xb6, 0x0e, 0xce, 0x6e,
+	0x9e, 0x3e, 0xfe, 0x41, 0xa1, 0x11, 0xd1, 0x71, 0x89, 0x29, 0xe9, 0x59,
+	0xb9, 0x05, 0xc5, 0x65, 0x95, 0x35, 0xf5, 0x4d, 0xad, 0x1d, 0xdd, 0x7d,
+	0x13, 0xa7, 0x4c, 0x9f, 0x35, 0x77, 0xc1, 0xe2, 0x65, 0x2b, 0xd7, 0xac,
+	0xdf, 0xb4, 0x75, 0xc7, 0xee, 0x7d, 0x07, 0x8f, 0x1c, 0x3f, 0x75, 0xf6,
+	0xc2, 0xe5, 0x6b, 0x37, 0xef, 0xdc, 0x7f, 0xf4, 0xf4, 0xc5, 0xeb, 0x77,
+	0x1f, 0xbf, 0x7c, 0xff, 0xf5, 0x97, 0x81, 0x99, 0x8d, 0x93, 0x87, 0x5f,
+	0x48, 0x54, 0x42, 0x5a, 0x4e, 0x51, 0x45, 0x5d, 0x4b, 0xd7, 0xc0, 0xd8,
+	0xcc, 0xd2, 0xc6, 0xde, 0xc9, 0xd5, 0xc3, 0xdb, 0x2f, 0x30, 0x24, 0x3c,
+	0x2a, 0x36, 0x21, 0x39, 0x2d, 0x33, 0x27, 0xbf, 0xa8, 0xb4, 0xa2, 0xba,
+	0xae, 0xb1, 0xa5, 0xbd, 0xab, 0x77, 0xc2, 0xe4, 0x69, 0x33, 0xe7, 0xcc,
+	0x5f, 0xb4, 0x74, 0xc5, 0xea, 0x75, 0x1b, 0xb7, 0x6c, 0xdf, 0xb5, 0xf7,
+	0xc0, 0xe1, 0x63, 0x27, 0xcf, 0x9c, 0xbf, 0x74, 0xf5, 0xc6, 0xed, 0x7b,
+	0x0f, 0x9f, 0x3c, 0x7f, 0xf5, 0xf6, 0xc3, 0xe7, 0x6f, 0x3f, 0xff, 0xfc,
+	0x67, 0x62, 0xe5, 0xe0, 0xe6, 0x13, 0x14, 0x11, 0x97, 0x92, 0xa5, 0x89,
+	0xa1, 0x0a, 0x43, 0x27, 0x50, 0x87, 0x4e, 0x4c, 0xd1, 0x26, 0x50, 0x47,
+	0x78, 0xf2, 0x57, 0x18, 0xe1, 0xc9, 0x5f, 0x71, 0x84, 0x27, 0x7f, 0xa5,
+	0x11, 0x9e, 0xfc, 0x95, 0x47, 0x78, 0xf2, 0x57, 0x19, 0xe1, 0xc9, 0x5f,
+	0x75, 0x84, 0x27, 0x7f, 0xb5, 0x11, 0x9e, 0xfc, 0xd5, 0x47, 0x78, 0xf2,
+	0xd7, 0x18, 0xe1, 0xc9, 0x5f, 0x73, 0x84, 0x27, 0x7f, 0xad, 0x11, 0x9e,
+	0xfc, 0xb5, 0x47, 0x78, 0xf2, 0xd7, 0x19, 0xe1, 0xc9, 0x5f, 0x77, 0x84,
+	0x27, 0x7f, 0xbd, 0x11, 0x9e, 0xfc, 0xf5, 0x47, 0x78, 0xf2, 0x37, 0x18,
+	0xe1, 0xc9, 0xdf, 0x70, 0x84, 0x27, 0x7f, 0xa3, 0x11, 0x9e, 0xfc, 0x8d,
+	0x47, 0x78, 0xf2, 0x37, 0x19, 0xe1, 0xc9, 0xdf, 0x74, 0x84, 0x27, 0x7f,
+	0xb3, 0x11, 0x9e, 0xfc, 0xcd, 0x47, 0x78, 0xf2, 0xb7, 0x18, 0xe1, 0xc9,
+	0xdf, 0x72, 0x84, 0x27, 0x7f, 0xab, 0x11, 0x9e, 0xfc, 0xad, 0x47, 0x78,
+	0xf2, 0xb7, 0x01, 0x00, 0x6f, 0x13, 0x90, 0x17, 0x00, 0x20, 0x00, 0x00
+};
+
+static const uint8_t xzData[] = {
+	0xfd, 0x37, 0x7a, 0x58, 0x5a, 0x00, 0x00, 0x04, 0xe6, 0xd6, 0xb4, 0x46,
+	0x02, 0x00, 0x21, 0x01, 0x16, 0x00, 0x00, 0x00, 0x74, 0x2f, 0xe5, 0xa3,
+	0xe0, 0x3f, 0xff, 0x01, 0x47, 0x5d, 0x00, 0x00, 0x00, 0xea, 0x84, 0xe2,
+	0x03, 0xfb, 0x1b, 0xb2, 0x46, 0x31, 0xbd, 0x11, 0xdc, 0xe4, 0xc9, 0xb6,
+	0x71, 0x8a, 0xd1, 0x2b, 0x1a, 0x45, 0x77, 0x9a, 0x8f, 0xef, 0xe2, 0x64,
+	0x9c, 0x90, 0xf3, 0x83, 0xfd, 0x65, 0xcb, 0xaa, 0x2a, 0x17, 0x17, 0x5c,
+	0x8b, 0x71, 0x38, 0xb1, 0x17, 0x4e, 0x80, 0xe9, 0xcd, 0xf5, 0x68, 0x64,
+	0x6b, 0x7d, 0x03, 0x1f, 0x0e, 0xbc, 0x64, 0x5c, 0x1b, 0x00, 0x63, 0x75,
+	0x48, 0x16, 0x04, 0x22, 0x69, 0x47, 0x03, 0xd0, 0x9a, 0x17, 0x75, 0xba,
+	0xe9, 0xb4, 0x46, 0xb3, 0x1b, 0xa9, 0x2d, 0xde, 0x73, 0xa1, 0x8f, 0x73,
+	0x44, 0x31, 0xdf, 0xd9, 0x74, 0xaf, 0xb6, 0x51, 0xa2, 0x54, 0xda, 0x1c,
+	0x5f, 0xb8, 0x90, 0x95, 0x9a, 0xd6, 0x17, 0x26, 0x04, 0xfc, 0x2c, 0x24,
+	0x75, 0x2d, 0xf6, 0x21, 0x23, 0x22, 0x3f, 0x15, 0xd6, 0x04, 0xa0, 0x9f,
+	0x69, 0x40, 0x97, 0xe1, 0x96, 0x85, 0x13, 0xc9, 0x3f, 0x4b, 0x60, 0xe9,
+	0x29, 0x41, 0xed, 0x3c, 0x0c, 0x48, 0x60, 0x10, 0x95, 0xbb, 0x61, 0x81,
+	0x05, 0xb1, 0xa5, 0xd8, 0xf3, 0x0a, 0x4e, 0x7b, 0x32, 0x8b, 0xac, 0x47,
+	0xac, 0x19, 0x10, 0xcd, 0x5b, 0x6a, 0x96, 0xb7, 0x05, 0x91, 0xa6, 0x78,
+	0x03, 0xd2, 0xd7, 0x31, 0x59, 0x5b, 0xba, 0xbf, 0x87, 0xf8, 0x1e, 0x98,
+	0xef, 0xf7, 0x19, 0xb9, 0x08, 0xaa, 0xc9, 0x98, 0xb8, 0x5e, 0x18, 0x19,
+	0x7b, 0x64, 0x84, 0x70, 0x82, 0x4a, 0x0a, 0xe9, 0xe9, 0x08, 0x60, 0x0a,
+	0x13, 0xc4, 0xa1, 0xc5, 0xda, 0x04, 0x79, 0x1d, 0x29, 0x5a, 0x05, 0x75,
+	0xb3, 0x0c, 0x25, 0x2a, 0xf8, 0xc2, 0xd3, 0x06, 0x7b, 0x71, 0x02, 0xd0,
+	0x8b, 0x57, 0x35, 0xaf, 0x36, 0xe6, 0x5d, 0x46, 0xfe, 0xb9, 0xdb, 0x7f,
+	0xe9, 0x3c, 0xa5, 0x28, 0xa1, 0x54, 0x70, 0xb8, 0x96, 0xaf, 0x75, 0xab,
+	0x8a, 0x9f, 0x32, 0xf7, 0xb6, 0xb8, 0x4d, 0x52, 0x6c, 0x65, 0x70, 0xba,
+	0x57, 0x0f, 0x13, 0x4f, 0xf3, 0x23, 0xa4, 0x8f, 0x7c, 0xf3, 0x89, 0xad,
+	0xe6, 0x1d, 0x8d, 0xba, 0xe5, 0xe9, 0x64, 0xfb, 0xcf, 0x6a, 0xf6, 0x6c,
+	0x70, 0x9e, 0xd9, 0x06, 0x9f, 0x1f, 0x93, 0x5b, 0x2d, 0x26, 0x0d, 0x3e,
+	0xd2, 0xd7, 0x81, 0xf8, 0xb3, 0x1a, 0xee, 0x74, 0xb7, 0xef, 0x88, 0x6e,
+	0xa0, 0x70, 0x0b, 0xb6, 0x21, 0x58, 0xf4, 0x74, 0x29, 0xa8, 0x00, 0x00,
+	0x6a, 0x22, 0x99, 0x78, 0xa9, 0x9c, 0x76, 0x26, 0x00, 0x01, 0xe3, 0x02,
+	0x80, 0x80, 0x01, 0x00, 0x6b, 0x72, 0x32, 0x3c, 0xb1, 0xc4, 0x67, 0xfb,
+	0x02, 0x00, 0x00, 0x00, 0x00, 0x04, 0x59, 0x5a
+};
+
+/* Read through the context, checking every byte read against the pattern */
+static enum JRISC_Error
+readAt(struct JRISC_Context *ctx, uint64_t location, uint64_t size)
+{
+	uint8_t buf[WINDOW_SIZE];
+	uint32_t address;
+	uint64_t i;
+	enum JRISC_Error ret;
+
+	jriscContextSeek(ctx, location);
+	ret = ctx->read(ctx, size, buf, &address);
+	if (ret != JRISC_success) return ret;
+
+	for (i = 0; i < size; i++) {
+		if (buf[i] != PATTERN(location + i)) {
+			printf("  Mismatch at %llu\n", (unsigned long long)(location + i));
+			return JRISC_ERROR_invalidValue;
+		}
+	}
+
+	return JRISC_success;
+}
+
+static void
+testStream(const uint8_t *data, size_t size)
+{
+	enum JRISC_Compression compression = jriscCompressionDetect(data, size);
+	struct JRISC_Context *ctx;
+	uint8_t *out;
+	size_t outSize, i;
+	uint64_t location;
+	enum JRISC_Error ret = JRISC_success;
+	FILE *fp;
+
+	printf("%s:\n", jriscCompressionName(compression));
+
+	fp = tmpfile();
+	if (!fp || (fwrite(data, 1, size, fp) != size) || fseek(fp, 0, SEEK_SET)) {
+		printf("  Failed to write temporary file\n");
+		exit(1);
+	}
+
+	if (jriscContextFromCompressedFile(fp, compression, WINDOW_SIZE,
+									   0x4000, &ctx) != JRISC_success) {
+		printf("  Failed to create context\n");
+		exit(1);
+	}
+
+	/* Forward, crossing the gzip members */
+	for (location = 0; (location < DATA_SIZE) && (ret == JRISC_success);
+		 location += 100) {
+		ret = readAt(ctx, location, (DATA_SIZE - location < 100) ?
+					 DATA_SIZE - location : 100);
+	}
+	printf("  Sequential: %d\n", ret);
+
+	printf("  Short seek back: %d\n", readAt(ctx, DATA_SIZE - 300, 200));
+	printf("  Long seek back: %d\n", readAt(ctx, 1000, 16));
+	printf("  Skip ahead: %d\n", readAt(ctx, 12000, 512));
+	printf("  Past the end: %d\n", readAt(ctx, DATA_SIZE - 8, 16));
+	printf("  Too big: %d\n", readAt(ctx, 0, WINDOW_SIZE));
+
+	jriscContextDestroy(ctx);
+	fclose(fp);
+
+	ret = jriscDecompress(data, size, compression, DATA_SIZE, &out,
+						  &outSize);
+	for (i = 0; (ret == JRISC_success) && (i < outSize); i++) {
+		if (out[i] != PATTERN(i)) ret = JRISC_ERROR_invalidValue;
+	}
+	printf("  Whole: %d, %zu bytes\n", ret, outSize);
+	if (ret == JRISC_success) free(out);
+
+	printf("  Cut short: %d\n",
+		   jriscDecompress(data, size - 10, compression, DATA_SIZE, &out,
+						   &outSize));
+	printf("  Over the limit: %d\n",
+		   jriscDecompress(data, size, compression, DATA_SIZE - 1, &out,
+						   &outSize));
+}
+
+int
+main(int argc, char *argv[])
+{
+	const uint8_t plain[] = { 0x98, 0x1f, 0x05, 0xbc, 0x00, 0x00 };
+
+	testStream(gzipData, sizeof(gzipData));
+	testStream(xzData, sizeof(xzData));
+
+	printf("plain: %s\n",
+		   jriscCompressionName(jriscCompressionDetect(plain, sizeof(plain))));
+
+	return 0;
+}
@@ -0,0 +1,108 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_cfg.h"
+#include "jrisc_const.h"
+#include "jrisc_inst.h"
+#include "jrisc_inst_string.h"
+#include "jrisc_program.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static void
+printRegs(const struct JRISC_ConstRegs *regs)
+{
+	unsigned r;
+
+	if (!regs->known) printf(" none");
+
+	for (r = 0; r < 32; r++) {
+		if (regs->known & ((uint32_t)1 << r)) {
+			printf(" r%u=$%x", r, regs->values[r]);
+		}
+	}
+	printf("\n");
+}
+
+int
+main(int argc, char *argv[])
+{
+	const uint16_t words[] = {
+		0x980e, 0x2100, 0x00f0,		/* movei #$f02100, r14 */
+		0xbdc3,						/* store r3, (r14) */
+		0x9802, 0x301a, 0x00f0,		/* movei #sub, r2 */
+		0xa048,						/* loadw (r2), r8 */
+		0xac43,						/* load (r14+2), r3 */
+		0xd040,						/* jump (r2) */
+		0x8c85,						/* moveq #4, r5 */
+		0xe400,						/* nop */
+		0xe400,						/* nop */
+		0x8e06,						/* sub: moveq #16, r6 */
+		0x6206,						/* shlq #16, r6 */
+		0xb8c5,						/* storew r5, (r6) */
+		0x0886,						/* loop: addq #4, r6 */
+		0xbcc5,						/* store r5, (r6) */
+		0xd7a1,						/* jr NE, loop */
+		0xe400,						/* nop */
+		0x9807, 0x3000, 0x00f0,		/* movei #$f03000, r7 */
+		0xd0e0,						/* jump (r7) */
+		0xe400,						/* nop */
+	};
+	struct JRISC_Program *program;
+	struct JRISC_ConstProp *constProp;
+	struct JRISC_ConstRegs regs;
+	const struct JRISC_Cfg *cfg;
+	const struct JRISC_Block *block;
+	char inst[64];
+	size_t b, e, i, length;
+	uint32_t address;
+
+	if (jriscProgramFromWords(words, sizeof(words) / sizeof(words[0]),
+							  JRISC_GPU_RAM, JRISC_gpu, &program) !=
+		JRISC_success) {
+		printf("Failed to decode program\n");
+		return 1;
+	}
+
+	if (jriscConstPropCompute(program, &constProp) != JRISC_success) {
+		printf("Failed to propagate constants\n");
+		return 1;
+	}
+
+	cfg = constProp->cfg;
+	for (b = 0; b < cfg->numBlocks; b++) {
+		block = &cfg->blocks[b];
+		printf("block %zu: %u+%u ->", b, block->first, block->count);
+		for (e = 0; e < block->numSuccessors; e++) {
+			printf(" %u", cfg->edges[block->firstSuccessor + e]);
+		}
+		if (block->flags & JRISC_BLOCKFLAG_UNKNOWN_EXIT) printf(" ?");
+		printf("\n  known:");
+		printRegs(&constProp->blockRegs[b]);
+	}
+
+	for (i = 0; i < program->numInstructions; i++) {
+		length = sizeof(inst);
+		jriscInstructionToString(&program->instructions[i],
+								 JRISC_STRINGFLAG_ADDRESS, inst, &length);
+		if (jriscConstPropAddress(constProp, i, &address)) {
+			printf("%-28s -> $%x\n", inst, address);
+		} else {
+			printf("%s\n", inst);
+		}
+
+		jriscConstPropRegsAt(constProp, i, &regs);
+		printf("  known:");
+		printRegs(&regs);
+	}
+
+	jriscConstPropDestroy(constProp);
+	jriscProgramDestroy(program);
+
+	return 0;
+}
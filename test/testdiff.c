@@ -0,0 +1,92 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_diff.h"
+#include "jrisc_inst.h"
+#include "jrisc_program.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static const char *
+kindName(enum JRISC_DiffKind kind)
+{
+	switch (kind) {
+	case JRISC_diffEqual: return "equal";
+	case JRISC_diffChanged: return "changed";
+	case JRISC_diffDeleted: return "deleted";
+	case JRISC_diffInserted: return "inserted";
+	default: return "?";
+	}
+}
+
+int
+main(int argc, char *argv[])
+{
+	const uint16_t oldWords[] = {
+		0x9801, 0x3010, 0x00f0,		/* movei #$f03010, r1 */
+		0x0822,						/* addq #1, r2 */
+		0xd462,						/* jr EQ, $f03010 */
+		0xe400,						/* nop */
+		0x0064,						/* add r3, r4 */
+		0x10a6,						/* sub r5, r6 */
+		0x8827,						/* move r1, r7 */
+		0xe400,						/* nop */
+		0x0c00,						/* subq #32, r0 */
+	};
+	const uint16_t newWords[] = {
+		0x9801, 0x3012, 0x00f0,		/* movei #$f03012, r1: moved target */
+		0x0822,						/* addq #1, r2 */
+		0xd482,						/* jr EQ, $f03012: moved target */
+		0xe400,						/* nop */
+		0x0064,						/* add r3, r4 */
+		0x2929,						/* or r9, r9: inserted */
+		0x10a8,						/* sub r5, r8: changed */
+		0x8827,						/* move r1, r7 */
+		0xe400,						/* nop */
+		0x0c02,						/* subq #32, r2: changed */
+		0xd7e0,						/* jr *+0: inserted */
+	};
+	struct JRISC_Program *oldProgram;
+	struct JRISC_Program *newProgram;
+	struct JRISC_Diff *diff;
+	const struct JRISC_DiffHunk *hunk;
+	size_t h;
+
+	if ((jriscProgramFromWords(oldWords,
+							   sizeof(oldWords) / sizeof(oldWords[0]),
+							   JRISC_GPU_RAM, JRISC_gpu, &oldProgram) !=
+		 JRISC_success) ||
+		(jriscProgramFromWords(newWords,
+							   sizeof(newWords) / sizeof(newWords[0]),
+							   JRISC_GPU_RAM, JRISC_gpu, &newProgram) !=
+		 JRISC_success)) {
+		printf("Failed to decode programs\n");
+		return 1;
+	}
+
+	if (jriscDiffPrograms(oldProgram, newProgram, &diff) != JRISC_success) {
+		printf("Failed to diff programs\n");
+		return 1;
+	}
+
+	for (h = 0; h < diff->numHunks; h++) {
+		hunk = &diff->hunks[h];
+		printf("%-8s old %zu+%zu new %zu+%zu\n", kindName(hunk->kind),
+			   hunk->oldIndex, hunk->oldCount,
+			   hunk->newIndex, hunk->newCount);
+	}
+
+	printf("%zu changed, %zu deleted, %zu inserted\n",
+		   diff->changed, diff->deleted, diff->inserted);
+
+	jriscDiffDestroy(diff);
+	jriscProgramDestroy(oldProgram);
+	jriscProgramDestroy(newProgram);
+
+	return 0;
+}
@@ -0,0 +1,128 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_dup.h"
+#include "jrisc_program.h"
+#include "testprogram.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Copy eight longs from a hardware register, at <loop> */
+#define COPY(loop, reg) \
+	OP(38, 0, 2), 0x2100, 0x00f0,			/* movei	#$f02100, r2 */ \
+	OP(38, 0, 5), (loop) & 0xffff, 0x00f0,	/* movei	#loop, r5 */ \
+	OP(35, 8, 3),							/* moveq	#8, r3 */ \
+	OP(41, 2, (reg)),						/* loop:	load	(r2), reg */ \
+	OP(2, 4, 2),							/* addq	#4, r2 */ \
+	OP(6, 1, 3),							/* subq	#1, r3 */ \
+	OP(52, 5, 1),							/* jump	NE, (r5) */ \
+	OP(57, 0, 0),							/* nop */ \
+	OP(52, 1, 0),							/* jump	(r1) */ \
+	OP(57, 0, 0)							/* nop */
+
+/* Call the routine at <routine> */
+#define CALL(routine) \
+	OP(38, 0, 0), (routine) & 0xffff, 0x00f0,	/* movei	#routine, r0 */ \
+	OP(51, 0, 1),								/* move	pc, r1 */ \
+	OP(2, 6, 1),								/* addq	#6, r1 */ \
+	OP(52, 0, 0),								/* jump	(r0) */ \
+	OP(57, 0, 0)								/* nop */
+
+/* Loaded at $f03000: a call to one copy */
+static const uint16_t first[] = {
+	CALL(0x3012),
+	OP(53, -8, 0),					/* jr	$f03000 */
+	OP(57, 0, 0),					/* nop */
+	COPY(0x3020, 4),				/* $f03012 */
+};
+
+/* Loaded at $f03200: calls to another copy, and to one with r6 for r4 */
+static const uint16_t second[] = {
+	CALL(0x323c),
+	CALL(0x3220),
+	OP(53, -15, 0),					/* jr	$f03200 */
+	OP(57, 0, 0),					/* nop */
+	COPY(0x322e, 4),				/* $f03220 */
+	COPY(0x324a, 6),				/* $f0323c */
+};
+
+static void
+fingerprint(struct JRISC_DupIndex *index,
+			const uint16_t *words,
+			size_t numWords,
+			uint32_t baseAddress,
+			uint32_t source)
+{
+	struct JRISC_Program *program;
+	struct JRISC_DupRoutine *routines;
+	size_t numRoutines, r;
+
+	program = decodeAt(words, numWords, baseAddress);
+
+	/* Short enough to include each caller */
+	if ((jriscDupFingerprint(program, source, 2, &routines, &numRoutines) !=
+		 JRISC_success) ||
+		(jriscDupIndexAdd(index, routines, numRoutines) != JRISC_success)) {
+		printf("Failed to fingerprint program\n");
+		exit(1);
+	}
+
+	printf("Program %u:\n", (unsigned)source);
+	for (r = 0; r < numRoutines; r++) {
+		printf("  $%x, %u instructions\n", (unsigned)routines[r].address,
+			   (unsigned)routines[r].numInstructions);
+	}
+
+	free(routines);
+	jriscProgramDestroy(program);
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct JRISC_DupIndex *index;
+	struct JRISC_DupReport *report;
+	const struct JRISC_DupCluster *cluster;
+	const struct JRISC_DupMember *member;
+	const struct JRISC_DupRoutine *routine;
+	size_t c, m;
+
+	if (jriscDupIndexCreate(&index) != JRISC_success) {
+		printf("Failed to create index\n");
+		return 1;
+	}
+
+	fingerprint(index, first, sizeof(first) / sizeof(first[0]),
+				JRISC_GPU_RAM, 0);
+	fingerprint(index, second, sizeof(second) / sizeof(second[0]),
+				JRISC_GPU_RAM + 0x200, 1);
+
+	if (jriscDupIndexReport(index, &report) != JRISC_success) {
+		printf("Failed to report duplicates\n");
+		return 1;
+	}
+
+	for (c = 0; c < report->numClusters; c++) {
+		cluster = &report->clusters[c];
+		printf("Cluster: %u instructions, %u variants\n",
+			   (unsigned)cluster->numInstructions, cluster->numVariants);
+
+		for (m = 0; m < cluster->numMembers; m++) {
+			member = &report->members[cluster->firstMember + m];
+			routine = jriscDupIndexRoutine(index, member->routine);
+			printf("  Program %u $%x, variant %u\n",
+				   (unsigned)routine->source, (unsigned)routine->address,
+				   member->variant);
+		}
+	}
+
+	jriscDupReportDestroy(report);
+	jriscDupIndexDestroy(index);
+
+	return 0;
+}
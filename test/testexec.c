@@ -0,0 +1,218 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_exec.h"
+#include "jrisc_inst.h"
+#include "jrisc_program.h"
+#include "testprogram.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_STATES	1000
+
+static const char *statusNames[] = {
+	"done", "timeout", "bad address", "bad instruction"
+};
+
+/* Collatz: count the steps for r0 to reach 1 in r1. Lanes diverge often. */
+static const uint16_t collatz[] = {
+	OP(35, 0, 1),		/* 00:	moveq	#0, r1 */
+	OP(31, 1, 0),		/* 02: loop:	cmpq	#1, r0 */
+	OP(53, 10, 0x2),	/* 04:	jr	eq, done */
+	OP(13, 0, 0),		/* 06:	btst	#0, r0 */
+	OP(53, 3, 0x1),		/* 08:	jr	ne, odd */
+	OP(2, 1, 1),		/* 0a:	addq	#1, r1 */
+	OP(53, -6, 0),		/* 0c:	jr	loop */
+	OP(25, 1, 0),		/* 0e:	shrq	#1, r0 */
+	OP(34, 0, 2),		/* 10: odd:	move	r0, r2 */
+	OP(0, 0, 0),		/* 12:	add	r0, r0 */
+	OP(0, 2, 0),		/* 14:	add	r2, r0 */
+	OP(53, -11, 0),		/* 16:	jr	loop */
+	OP(2, 1, 0),		/* 18:	addq	#1, r0 */
+	OP(57, 0, 0),		/* 1a: done:	nop */
+};
+
+/* Multiply-accumulate from local RAM, then switch banks through the flags */
+static const uint16_t bank[] = {
+	OP(38, 0, 14), 0x3100, 0x00f0,	/* movei	#$f03100, r14 */
+	OP(41, 14, 1),					/* load	(r14), r1 */
+	OP(43, 1, 2),					/* load	(r14+1), r2 */
+	OP(18, 1, 2),					/* imultn	r1, r2 */
+	OP(20, 1, 2),					/* imacn	r1, r2 */
+	OP(19, 0, 3),					/* resmac	r3 */
+	OP(49, 2, 3),					/* store	r3, (r14+2) */
+	OP(38, 0, 4), 0x2100, 0x00f0,	/* movei	#$f02100, r4 */
+	OP(41, 4, 5),					/* load	(r4), r5 */
+	OP(14, 14, 5),					/* bset	#14, r5 */
+	OP(47, 4, 5),					/* store	r5, (r4) */
+	OP(35, 7, 1),					/* moveq	#7, r1 */
+	OP(37, 3, 6),					/* movefa	r3, r6 */
+	OP(35, 0, 7),					/* moveq	#0, r7 */
+	OP(21, 7, 6),					/* div	r7, r6 */
+};
+
+static void
+testCollatz(unsigned numThreads, size_t numStates)
+{
+	struct JRISC_Program *program =
+		decode(collatz, sizeof(collatz) / sizeof(collatz[0]));
+	struct JRISC_ExecState *states = calloc(numStates, sizeof(*states));
+	uint64_t totalSteps = 0;
+	size_t mismatches = 0;
+	uint32_t longest = 0;
+	uint32_t x, count;
+	size_t i;
+
+	for (i = 0; i < numStates; i++) states[i].regs[0] = (uint32_t)i + 1;
+
+	if (jriscExecRun(program, JRISC_GPU_RAM, 0, numThreads, states,
+					 numStates) != JRISC_success) {
+		printf("Failed to run\n");
+		exit(1);
+	}
+
+	for (i = 0; i < numStates; i++) {
+		for (x = (uint32_t)i + 1, count = 0; x != 1; count++) {
+			x = (x & 1) ? (x * 3 + 1) : (x / 2);
+		}
+
+		if ((states[i].status != JRISC_execDone) ||
+			(states[i].regs[0] != 1) || (states[i].regs[1] != count) ||
+			(states[i].pc != (JRISC_GPU_RAM + sizeof(collatz)))) {
+			mismatches++;
+		}
+		totalSteps += states[i].steps;
+		if (states[i].regs[1] > longest) longest = states[i].regs[1];
+	}
+
+	printf("collatz, %u threads, %zu states: %zu mismatches, "
+		   "%llu steps, longest %u\n",
+		   numThreads, numStates, mismatches,
+		   (unsigned long long)totalSteps, longest);
+
+	free(states);
+	jriscProgramDestroy(program);
+}
+
+static void
+testBank(void)
+{
+	struct JRISC_Program *program =
+		decode(bank, sizeof(bank) / sizeof(bank[0]));
+	struct JRISC_ExecState *states = calloc(NUM_STATES, sizeof(*states));
+	uint8_t *ram = calloc(NUM_STATES, JRISC_GPU_RAM_SIZE);
+	size_t mismatches = 0;
+	uint8_t *p;
+	int16_t a, b;
+	uint32_t product;
+	size_t i;
+
+	for (i = 0; i < NUM_STATES; i++) {
+		a = (int16_t)(i * 37 - 16000);
+		b = (int16_t)(12000 - i * 29);
+		p = ram + i * JRISC_GPU_RAM_SIZE + 0x100;
+		p[2] = (uint8_t)(a >> 8);
+		p[3] = (uint8_t)a;
+		p[6] = (uint8_t)(b >> 8);
+		p[7] = (uint8_t)b;
+		states[i].ram = ram + i * JRISC_GPU_RAM_SIZE;
+	}
+
+	jriscExecRun(program, JRISC_GPU_RAM, 0, 2, states, NUM_STATES);
+
+	for (i = 0; i < NUM_STATES; i++) {
+		a = (int16_t)(i * 37 - 16000);
+		b = (int16_t)(12000 - i * 29);
+		product = (uint32_t)(2 * (int32_t)a * b);
+		p = ram + i * JRISC_GPU_RAM_SIZE + 0x108;
+
+		if ((states[i].status != JRISC_execDone) ||
+			(states[i].acc != (int64_t)2 * a * b) ||
+			(states[i].altRegs[3] != product) ||
+			(((uint32_t)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3]) !=
+			 product) ||
+			(states[i].regs[1] != 7) ||
+			(states[i].regs[6] != 0xffffffff) ||
+			(states[i].altRegs[5] != (0x4000 | (product ? 0 : 0x1) |
+									   ((product >> 31) ? 0x4 : 0)))) {
+			mismatches++;
+		}
+	}
+
+	printf("bank: %zu mismatches, lane 3 acc %lld, flags $%x\n", mismatches,
+		   (long long)states[3].acc, states[3].altRegs[5]);
+
+	free(ram);
+	free(states);
+	jriscProgramDestroy(program);
+}
+
+static void
+testStop(const char *name, const uint16_t *words, size_t numWords)
+{
+	struct JRISC_Program *program = decode(words, numWords);
+	struct JRISC_ExecState state;
+
+	memset(&state, 0, sizeof(state));
+	jriscExecRun(program, JRISC_GPU_RAM, 100, 1, &state, 1);
+
+	printf("%s: %s at $%x after %llu steps\n", name,
+		   statusNames[state.status], state.pc,
+		   (unsigned long long)state.steps);
+
+	jriscProgramDestroy(program);
+}
+
+int
+main(int argc, char *argv[])
+{
+	static const uint16_t forever[] = {
+		OP(53, -1, 0),					/* jr	. */
+		OP(57, 0, 0),					/* nop */
+	};
+	static const uint16_t badLoad[] = {
+		OP(35, 4, 1),					/* moveq	#4, r1 */
+		OP(41, 1, 2),					/* load	(r1), r2 */
+	};
+	static const uint16_t mmult[] = {
+		OP(57, 0, 0),					/* nop */
+		OP(54, 1, 2),					/* mmult	r1, r2 */
+	};
+	static const uint16_t intoMovei[] = {
+		OP(38, 0, 1), 0x3002, 0x00f0,	/* movei	#$f03002, r1 */
+		OP(52, 1, 0),					/* jump	(r1) */
+		OP(57, 0, 0),					/* nop */
+	};
+	static const uint16_t jumpOut[] = {
+		OP(38, 0, 1), 0x0000, 0x00f0,	/* movei	#$f00000, r1 */
+		OP(52, 1, 0),					/* jump	(r1) */
+		OP(35, 3, 2),					/* moveq	#3, r2 */
+		OP(57, 0, 0),					/* nop */
+	};
+	static const uint16_t branchLast[] = {
+		OP(35, 1, 1),					/* moveq	#1, r1 */
+		OP(53, -2, 0),					/* jr	$f03000 */
+	};
+
+	testCollatz(1, NUM_STATES);
+	testCollatz(4, NUM_STATES);
+	testCollatz(3, 17);
+	testCollatz(2, 0);
+	testBank();
+
+	testStop("forever", forever, sizeof(forever) / sizeof(forever[0]));
+	testStop("bad load", badLoad, sizeof(badLoad) / sizeof(badLoad[0]));
+	testStop("mmult", mmult, sizeof(mmult) / sizeof(mmult[0]));
+	testStop("into movei", intoMovei, sizeof(intoMovei) / sizeof(intoMovei[0]));
+	testStop("jump out", jumpOut, sizeof(jumpOut) / sizeof(jumpOut[0]));
+	testStop("branch last", branchLast,
+			 sizeof(branchLast) / sizeof(branchLast[0]));
+
+	return 0;
+}
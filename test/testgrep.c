@@ -0,0 +1,105 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_grep.h"
+#include "jrisc_inst.h"
+#include "jrisc_program.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static void
+printMatch(void *userData, const struct JRISC_GrepMatch *match)
+{
+	const struct JRISC_Grep *grep = userData;
+	unsigned c;
+
+	printf("%08x %u: %s", match->address, match->length,
+		   jriscGrepPatternString(grep, match->pattern));
+
+	for (c = 0; c < match->numCaptures; c++) {
+		printf(" %s=$%x", jriscGrepCaptureName(grep, match->pattern, c),
+			   match->captures[c]);
+	}
+
+	printf("\n");
+}
+
+int
+main(int argc, char *argv[])
+{
+	const uint16_t words[] = {
+		0x9801, 0x2114, 0x00f0,		/* movei #$f02114, r1 */
+		0xd020,						/* jump (r1) */
+		0xe400,						/* nop */
+		0x0822,						/* addq #1, r2 */
+		0x0064,						/* add r3, r4 */
+		0x0083,						/* add r4, r3 */
+		0x0064,						/* add r3, r4 */
+	};
+	const char *patterns[] = {
+		"movei #%addr, %r; jump (%r)",
+		"movei #*, r1; jump (r2)",
+		"ADDQ #1, r*",
+		"jump (*); *",
+		"add %a, %b; add %b, %a",
+		"addq #1, r2; add r3, *; add r4, r3",
+	};
+	const char *invalidPatterns[] = {
+		"bogus r1",
+		"add r1, r2, r3",
+		"add r32, r1",
+		"movei #%a, %b; ;",
+	};
+	struct JRISC_Grep *grep;
+	struct JRISC_Program *program;
+	struct JRISC_Instruction invalid;
+	size_t i;
+
+	if (jriscProgramFromWords(words, sizeof(words) / sizeof(words[0]),
+							  JRISC_GPU_RAM, JRISC_gpu, &program) !=
+		JRISC_success) {
+		printf("Failed to decode program\n");
+		return 1;
+	}
+
+	if (jriscGrepCreate(&grep) != JRISC_success) {
+		printf("Failed to create matcher\n");
+		return 1;
+	}
+
+	for (i = 0; i < sizeof(patterns) / sizeof(patterns[0]); i++) {
+		if (jriscGrepAddPattern(grep, patterns[i], NULL) != JRISC_success) {
+			printf("Failed to add pattern %s\n", patterns[i]);
+			return 1;
+		}
+	}
+
+	for (i = 0; i < sizeof(invalidPatterns) / sizeof(invalidPatterns[0]);
+		 i++) {
+		if (jriscGrepAddPattern(grep, invalidPatterns[i], NULL) !=
+			JRISC_ERROR_invalidValue) {
+			printf("Accepted invalid pattern %s\n", invalidPatterns[i]);
+			return 1;
+		}
+	}
+
+	for (i = 0; i < program->numInstructions; i++) {
+		jriscGrepFeed(grep, &program->instructions[i], printMatch, grep);
+	}
+
+	/* An invalid instruction must break the last add pair */
+	invalid = program->instructions[program->numInstructions - 1];
+	invalid.opName = JRISC_invalidOpName;
+	jriscGrepFeed(grep, &invalid, printMatch, grep);
+	jriscGrepFeed(grep, &program->instructions[5], printMatch, grep);
+
+	jriscGrepDestroy(grep);
+	jriscProgramDestroy(program);
+
+	return 0;
+}
@@ -0,0 +1,186 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_image.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Big enough for a cartridge header and a little code after it */
+#define BUF_SIZE	0x2010
+
+static uint8_t buf[BUF_SIZE];
+
+static void
+put16(size_t offset, uint16_t value)
+{
+	buf[offset] = (uint8_t)(value >> 8);
+	buf[offset + 1] = (uint8_t)value;
+}
+
+static void
+put32(size_t offset, uint32_t value)
+{
+	put16(offset, (uint16_t)(value >> 16));
+	put16(offset + 2, (uint16_t)value);
+}
+
+static void
+show(const char *name, size_t size, enum JRISC_ImageFormat format)
+{
+	struct JRISC_Image *image;
+	const struct JRISC_Section *s;
+	enum JRISC_Error err;
+	unsigned i;
+
+	err = jriscImageFromMemory(buf, size, format, &image);
+	if (err != JRISC_success) {
+		printf("%s: error %d\n", name, err);
+		return;
+	}
+
+	printf("%s: %s, %s-endian, entry $%x\n", name,
+		   jriscImageFormatName(image->format),
+		   (image->byteOrder == JRISC_bigEndian) ? "big" : "little",
+		   image->entry);
+
+	for (i = 0; i < image->numSections; i++) {
+		s = &image->sections[i];
+		printf("  %-8s $%06x offset %llu size %llu flags %x\n", s->name,
+			   s->address, (unsigned long long)s->offset,
+			   (unsigned long long)s->size, s->flags);
+	}
+
+	if (image->symbolSize || image->stringSize) {
+		printf("  symbols at %llu size %llu, strings at %llu size %llu\n",
+			   (unsigned long long)image->symbolOffset,
+			   (unsigned long long)image->symbolSize,
+			   (unsigned long long)image->stringOffset,
+			   (unsigned long long)image->stringSize);
+	}
+
+	jriscImageDestroy(image);
+}
+
+static void
+testAout(void)
+{
+	memset(buf, 0, sizeof(buf));
+	put32(0, 0x107);				/* a_magic */
+	put32(4, 8);					/* a_text */
+	put32(8, 4);					/* a_data */
+	put32(12, 16);					/* a_bss */
+	put32(16, 12);					/* a_syms */
+	put32(20, 0x4000);				/* a_entry */
+	put32(56, 8);					/* String table size, after the symbols */
+	memcpy(&buf[60], "abc", 4);
+
+	show("a.out", 64, JRISC_imageAuto);
+	show("a.out, strings cut off", 62, JRISC_imageAuto);
+	show("a.out, text cut off", 36, JRISC_imageAuto);
+	show("a.out, header cut off", 20, JRISC_imageAuto);
+	show("a.out, header cut off, as a.out", 20, JRISC_imageAout);
+}
+
+static void
+testCoff(void)
+{
+	const size_t table = 20 + 28;
+	const size_t text = table + 2 * 40;
+
+	memset(buf, 0, sizeof(buf));
+	put16(0, 0x0150);				/* f_magic */
+	put16(2, 2);					/* f_nscns */
+	put32(8, text + 8);				/* f_symptr */
+	put32(12, 1);					/* f_nsyms */
+	put16(16, 28);					/* f_opthdr */
+	put32(20 + 16, 0xf03000);		/* Entry, in the optional header */
+
+	memcpy(&buf[table], ".text", 5);
+	put32(table + 12, 0xf03000);	/* s_vaddr */
+	put32(table + 16, 8);			/* s_size */
+	put32(table + 20, text);		/* s_scnptr */
+	put32(table + 36, 0x20);		/* s_flags: STYP_TEXT */
+
+	memcpy(&buf[table + 40], ".bss", 4);
+	put32(table + 40 + 12, 0xf03100);
+	put32(table + 40 + 16, 0x100);
+	put32(table + 40 + 36, 0x80);	/* STYP_BSS */
+
+	put32(text + 8 + 18, 4);		/* Empty string table */
+
+	show("coff", text + 8 + 18 + 4, JRISC_imageAuto);
+	show("coff, section table cut off", table + 60, JRISC_imageAuto);
+	show("coff, section cut off", text + 4, JRISC_imageAuto);
+
+	/* add r10, r16 reads as the COFF magic number, but nothing else fits */
+	put16(2, 0);
+	show("coff magic, no sections", text + 8, JRISC_imageAuto);
+	put16(2, 2);
+	put16(16, 6);
+	show("coff magic, odd optional header", text + 8, JRISC_imageAuto);
+	show("coff magic, odd optional header, as coff", text + 8,
+		 JRISC_imageCoff);
+}
+
+static void
+testAbs(void)
+{
+	memset(buf, 0, sizeof(buf));
+	put16(0, 0x601a);
+	put32(2, 4);					/* Text */
+	put32(6, 2);					/* Data */
+	put32(10, 8);					/* BSS */
+	put32(14, 14);					/* Symbols */
+	put32(22, 0x802000);			/* Text base */
+
+	show("abs", 28 + 4 + 2 + 14, JRISC_imageAuto);
+	show("abs, symbols cut off", 28 + 4 + 2, JRISC_imageAuto);
+
+	put16(0, 0x601b);
+	put32(14, 0);
+	put32(28, 0x5000);				/* Data base */
+	put32(32, 0x6000);				/* BSS base */
+	show("abs, non-contiguous", 36 + 4 + 2, JRISC_imageAuto);
+	show("abs, non-contiguous, header cut off", 30, JRISC_imageAuto);
+	show("abs magic, header cut off", 20, JRISC_imageAuto);
+}
+
+static void
+testRom(void)
+{
+	memset(buf, 0, sizeof(buf));
+	memset(&buf[0x400], 0x04, 4);	/* Bus width, in every byte */
+	put32(0x404, 0x802000);			/* Start address */
+
+	show("rom", BUF_SIZE, JRISC_imageAuto);
+	show("rom, no code", 0x2000, JRISC_imageAuto);
+
+	/* Dumped with each word's bytes swapped */
+	put32(0x404, 0x80000020);
+	show("rom, swapped", BUF_SIZE, JRISC_imageAuto);
+
+	put32(0x404, 0x4000);
+	show("rom, start outside the cartridge", BUF_SIZE, JRISC_imageAuto);
+
+	put32(0x404, 0x802000);
+	buf[0x402] = 0x02;
+	show("rom, mixed bus width", BUF_SIZE, JRISC_imageAuto);
+	show("rom, mixed bus width, as rom", BUF_SIZE, JRISC_imageRom);
+}
+
+int
+main(int argc, char *argv[])
+{
+	testAout();
+	testCoff();
+	testAbs();
+	testRom();
+
+	return 0;
+}
@@ -0,0 +1,129 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_ctx.h"
+#include "jrisc_ctx_mem.h"
+#include "jrisc_index.h"
+#include "jrisc_inst.h"
+#include "jrisc_program.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_WORDS	20000
+
+/*
+ * Seek to every word of the region and check that the index lands on the same
+ * instruction struct JRISC_Program puts the word in.
+ */
+static void
+check(const char *name,
+	  const uint8_t *bytes,
+	  size_t size,
+	  uint32_t interval)
+{
+	struct JRISC_Context *ctx;
+	struct JRISC_Program *program;
+	struct JRISC_Index *index;
+	struct JRISC_Index *loaded;
+	const struct JRISC_Index *which;
+	const struct JRISC_Instruction *inst;
+	uint8_t *saved;
+	size_t savedSize;
+	size_t mismatches = 0;
+	size_t w;
+	uint32_t start;
+	unsigned pass;
+
+	jriscContextFromMemory(bytes, size, NULL, 0, JRISC_GPU_RAM, &ctx);
+	jriscProgramDecode(ctx, size, JRISC_gpu, &program);
+	jriscContextSeek(ctx, 0);
+
+	if (jriscIndexBuild(ctx, size, JRISC_gpu, interval, &index) !=
+		JRISC_success) {
+		printf("%s: failed to build\n", name);
+		exit(1);
+	}
+
+	if ((jriscIndexSave(index, &saved, &savedSize) != JRISC_success) ||
+		(jriscIndexLoad(saved, savedSize, &loaded) != JRISC_success)) {
+		printf("%s: failed to save and load\n", name);
+		exit(1);
+	}
+
+	/* The second pass seeks with the index read back from its saved form */
+	for (pass = 0; pass < 2; pass++) {
+		which = pass ? loaded : index;
+
+		for (w = 0; w < program->numWords; w++) {
+			inst = &program->instructions[program->wordToInstruction[w]];
+			start = inst->address - JRISC_GPU_RAM;
+
+			if ((jriscIndexSeek(which, ctx, JRISC_gpu, w * 2) !=
+				 JRISC_success) ||
+				(ctx->readLocation != start) ||
+				(ctx->readAddress != (JRISC_GPU_RAM + start))) {
+				mismatches++;
+			}
+		}
+	}
+
+	printf("%s: %zu checkpoints in %zu bytes saved, %zu mismatches, "
+		   "past the end %s\n",
+		   name, index->numCheckpoints, savedSize, mismatches,
+		   (jriscIndexSeek(index, ctx, JRISC_gpu, program->numWords * 2) ==
+			JRISC_ERROR_invalidValue) ? "rejected" : "accepted");
+
+	free(saved);
+	jriscIndexDestroy(loaded);
+	jriscIndexDestroy(index);
+	jriscProgramDestroy(program);
+	jriscContextDestroy(ctx);
+}
+
+int
+main(int argc, char *argv[])
+{
+	uint8_t *bytes = malloc(NUM_WORDS * 2);
+	uint32_t seed = 4321;
+	uint16_t word;
+	size_t w;
+	uint8_t bad[8] = { 0 };
+
+	/* Dense with movei, so many straddle a checkpoint */
+	for (w = 0; w < NUM_WORDS; w++) {
+		seed = seed * 1103515245 + 12345;
+		word = (uint16_t)(seed >> 16);
+		if (!(seed & 0x300000)) word = 0x9800 | (word & 0x1f);
+		bytes[w * 2] = word >> 8;
+		bytes[w * 2 + 1] = word & 0xff;
+	}
+
+	check("interval 4096", bytes, NUM_WORDS * 2, 4096);
+	check("interval 16", bytes, NUM_WORDS * 2, 16);
+	check("interval 2", bytes, NUM_WORDS * 2, 2);
+	check("odd size", bytes, 1001, 16);
+
+	/* A movei cut short by the end of the region is a single word */
+	bytes[0] = 0x98;
+	bytes[1] = 0x01;
+	check("short movei", bytes, 4, 2);
+	check("empty", bytes, 0, 16);
+
+	free(bytes);
+
+	printf("odd interval %s\n",
+		   (jriscIndexBuild(NULL, 0, JRISC_gpu, 3, NULL) ==
+			JRISC_ERROR_invalidValue) ? "rejected" : "accepted");
+	memcpy(bad, "JRISCIDX", 8);
+	printf("truncated %s\n",
+		   (jriscIndexLoad(bad, sizeof(bad), NULL) ==
+			JRISC_ERROR_invalidFormat) ? "rejected" : "accepted");
+
+	return 0;
+}
@@ -0,0 +1,49 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_ctx.h"
+#include "jrisc_ctx_mem.h"
+#include "jrisc_inst.h"
+#include "jrisc_inst_string.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+int
+main(int argc, char *argv[])
+{
+	const uint8_t mem[] = {
+		0x1f, 0x98, 0xbc, 0x05, 0x00, 0x00, 0xe0, 0xbf, 0x9f, 0x08, 0xe0,
+		0xa7, 0x1f, 0x98, 0x14, 0x21, 0xf0, 0x00, 0x1e, 0x8c, 0xfe, 0xbf,
+		0xc0, 0xd7, 0x00, 0xe4, 0x00, 0xe4
+	};
+	size_t len = sizeof(mem);
+
+	struct JRISC_Context *ctx;
+	struct JRISC_Instruction inst;
+
+	if (jriscContextFromMemory(mem, len, NULL, 0, 0, &ctx) != JRISC_success) {
+		/* Throw some exception */
+		printf("Failed to create context\n");
+		return 1;
+	}
+
+	/* Same code as testmem, but stored as byte-swapped 16-bit words */
+	jriscContextSetByteOrder(ctx, JRISC_littleEndian);
+
+	while (jriscInstructionRead(ctx, JRISC_gpu, &inst) == JRISC_success) {
+		jriscInstructionPrint(&inst,
+							  JRISC_STRINGFLAG_ADDRESS |
+							  JRISC_STRINGFLAG_MACHINE_CODE);
+	}
+
+	jriscContextDestroy(ctx);
+
+	return 0;
+}
@@ -0,0 +1,73 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_ctx.h"
+#include "jrisc_ctx_mem.h"
+#include "jrisc_inst.h"
+#include "jrisc_listing.h"
+#include "jrisc_sym.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+int
+main(int argc, char *argv[])
+{
+	const uint8_t mem[] = {
+		0x98, 0x1f, 0x05, 0xbc, 0x00, 0x00, 0xbf, 0xe0, 0x08, 0x9f, 0xa7,
+		0xe0, 0x98, 0x1f, 0x21, 0x14, 0x00, 0xf0, 0x8c, 0x1e, 0xbf, 0xfe,
+		0xd7, 0xc0, 0xe4, 0x00, 0xe4, 0x00,
+		/* movei #$f0301e (mid-movei), r1 */
+		0x98, 0x01, 0x30, 0x1e, 0x00, 0xf0,
+		/* jr back to Lf0300c, the second movei */
+		0xd6, 0x80,
+		/* neg with the unused source field set, jr with a bad condition */
+		0x20, 0x61, 0xd7, 0xe3,
+		0xe4, 0x00,
+		/* Trailing odd byte */
+		0x12
+	};
+	size_t len = sizeof(mem);
+
+	struct JRISC_SymbolTable *table;
+	struct JRISC_Context *ctx;
+	FILE *fp;
+
+	/* Save the code too, to compare with the listing reassembled */
+	if (argc > 1) {
+		fp = fopen(argv[1], "wb");
+		if (!fp || (fwrite(mem, 1, len, fp) != len) || fclose(fp)) {
+			printf("Failed to write %s\n", argv[1]);
+			return 1;
+		}
+	}
+
+	if ((jriscSymbolTableCreate(&table) != JRISC_success) ||
+		(jriscSymbolTableAdd(table, "G_CTRL", 0xf02114, 0) != JRISC_success) ||
+		(jriscSymbolTableAdd(table, "start", 0xf03000, 0) != JRISC_success) ||
+		(jriscSymbolTableFinalize(table) != JRISC_success)) {
+		printf("Failed to create symbol table\n");
+		return 1;
+	}
+
+	if (jriscContextFromMemory(mem, len, NULL, 0, JRISC_GPU_RAM, &ctx) !=
+		JRISC_success) {
+		printf("Failed to create context\n");
+		return 1;
+	}
+
+	if (jriscListingWrite(ctx, len, JRISC_gpu, table, stdout) !=
+		JRISC_success) {
+		printf("Failed to write listing\n");
+		return 1;
+	}
+
+	jriscContextDestroy(ctx);
+	jriscSymbolTableDestroy(table);
+
+	return 0;
+}
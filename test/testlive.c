@@ -0,0 +1,100 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_cfg.h"
+#include "jrisc_inst.h"
+#include "jrisc_inst_string.h"
+#include "jrisc_live.h"
+#include "jrisc_program.h"
+#include "jrisc_regs.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static const char *
+maskString(JRISC_RegMask mask, char *buf, size_t size)
+{
+	if (!mask) return "none";
+	if (mask == JRISC_REGMASK_ALL) return "all";
+
+	jriscRegMaskToString(mask, buf, &size);
+
+	return buf;
+}
+
+int
+main(int argc, char *argv[])
+{
+	const uint16_t words[] = {
+		0x8ca2,						/* moveq #5, r2 */
+		0x8c03,						/* moveq #0, r3 */
+		0x0043,						/* loop: add r2, r3 */
+		0x1822,						/* subq #1, r2 */
+		0xd7a1,						/* jr NE, loop */
+		0xe400,						/* nop */
+		0x8860,						/* move r3, r0 */
+		0xbc20,						/* store r0, (r1) */
+		0xd7e0,						/* done: jr done */
+		0xe400,						/* nop */
+	};
+	struct JRISC_Program *program;
+	struct JRISC_Liveness *live;
+	const struct JRISC_Cfg *cfg;
+	const struct JRISC_Block *block;
+	JRISC_RegMask reads, writes, in, out;
+	char inst[64];
+	char buf[4][256];
+	size_t b, e, i, length;
+
+	if (jriscProgramFromWords(words, sizeof(words) / sizeof(words[0]),
+							  JRISC_GPU_RAM, JRISC_gpu, &program) !=
+		JRISC_success) {
+		printf("Failed to decode program\n");
+		return 1;
+	}
+
+	if (jriscLivenessCompute(program, &live) != JRISC_success) {
+		printf("Failed to compute liveness\n");
+		return 1;
+	}
+
+	cfg = live->cfg;
+	for (b = 0; b < cfg->numBlocks; b++) {
+		block = &cfg->blocks[b];
+		printf("block %zu: %u+%u ->", b, block->first, block->count);
+		for (e = 0; e < block->numSuccessors; e++) {
+			printf(" %u", cfg->edges[block->firstSuccessor + e]);
+		}
+		if (block->flags & JRISC_BLOCKFLAG_UNKNOWN_EXIT) printf(" ?");
+		printf("\n  in:  %s\n  out: %s\n",
+			   maskString(live->liveIn[b], buf[0], sizeof(buf[0])),
+			   maskString(live->liveOut[b], buf[1], sizeof(buf[1])));
+	}
+
+	for (i = 0; i < program->numInstructions; i++) {
+		length = sizeof(inst);
+		jriscInstructionToString(&program->instructions[i],
+								 JRISC_STRINGFLAG_ADDRESS, inst, &length);
+		jriscInstructionRegMasks(&program->instructions[i], &reads, &writes);
+		jriscLivenessAtIndex(live, i, &in, &out);
+		printf("%-28s reads [%s] writes [%s] live [%s] -> [%s]\n", inst,
+			   maskString(reads, buf[0], sizeof(buf[0])),
+			   maskString(writes, buf[1], sizeof(buf[1])),
+			   maskString(in, buf[2], sizeof(buf[2])),
+			   maskString(out, buf[3], sizeof(buf[3])));
+	}
+
+	if (jriscLivenessAt(live, JRISC_GPU_RAM + 0x100, &in, &out) !=
+		JRISC_ERROR_notFound) {
+		printf("Found liveness outside the program\n");
+	}
+
+	jriscLivenessDestroy(live);
+	jriscProgramDestroy(program);
+
+	return 0;
+}
@@ -0,0 +1,180 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_exec.h"
+#include "jrisc_inst.h"
+#include "jrisc_inst_string.h"
+#include "jrisc_opt.h"
+#include "jrisc_program.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_STATES	64
+
+static void
+printProgram(const struct JRISC_Program *program)
+{
+	size_t i;
+
+	for (i = 0; i < program->numInstructions; i++) {
+		jriscInstructionPrint(&program->instructions[i],
+							  JRISC_STRINGFLAG_ADDRESS);
+	}
+}
+
+/* Run both programs over the same inputs and count the states that differ */
+static size_t
+compare(const struct JRISC_Program *a, const struct JRISC_Program *b)
+{
+	struct JRISC_ExecState states[2][NUM_STATES];
+	uint8_t ram[2][NUM_STATES][JRISC_GPU_RAM_SIZE];
+	size_t differences = 0;
+	unsigned s, r, v;
+
+	memset(states, 0, sizeof(states));
+	memset(ram, 0, sizeof(ram));
+
+	for (v = 0; v < 2; v++) {
+		for (s = 0; s < NUM_STATES; s++) {
+			for (r = 0; r < 32; r++) {
+				states[v][s].regs[r] = (s + 1) * 0x9e3779b9u * (r + 1);
+			}
+			ram[v][s][0x103] = (uint8_t)(s * 7);
+			ram[v][s][0x107] = (uint8_t)(s * 13);
+			states[v][s].ram = ram[v][s];
+		}
+
+		jriscExecRun(v ? b : a, JRISC_GPU_RAM, 1000, 1, states[v],
+					 NUM_STATES);
+	}
+
+	for (s = 0; s < NUM_STATES; s++) {
+		if ((states[0][s].status != states[1][s].status) ||
+			(states[0][s].pc != states[1][s].pc) ||
+			memcmp(states[0][s].regs, states[1][s].regs,
+				   sizeof(states[0][s].regs)) ||
+			(states[0][s].z != states[1][s].z) ||
+			(states[0][s].c != states[1][s].c) ||
+			(states[0][s].n != states[1][s].n)) {
+			differences++;
+		}
+	}
+
+	return differences;
+}
+
+static void
+optimize(const uint16_t *words, size_t numWords, uint32_t rules)
+{
+	struct JRISC_Program *program;
+	struct JRISC_Program *optimized;
+	struct JRISC_OptReport report;
+	unsigned r;
+
+	if (jriscProgramFromWords(words, numWords, JRISC_GPU_RAM, JRISC_gpu,
+							  &program) != JRISC_success) {
+		printf("Failed to decode program\n");
+		exit(1);
+	}
+
+	if (jriscOptimize(program, rules, &optimized, &report) != JRISC_success) {
+		printf("Failed to optimize program\n");
+		exit(1);
+	}
+
+	printProgram(optimized);
+
+	for (r = 0; r < JRISC_optNumRules; r++) {
+		printf("%s: %zu\n", jriscOptRuleName(r), report.applied[r]);
+	}
+	printf("%zu -> %zu bytes, %zu cycles\n", report.bytesBefore,
+		   report.bytesAfter, report.cyclesSaved);
+
+	jriscProgramDestroy(optimized);
+	jriscProgramDestroy(program);
+}
+
+int
+main(int argc, char *argv[])
+{
+	const uint16_t words[] = {
+		0x9802, 0x0005, 0x0000,		/* movei #5, r2: fits in a moveq */
+		0x8863,						/* move r3, r3: does nothing */
+		0x8ce4,						/* moveq #7, r4: dead */
+		0x0043,						/* loop: add r2, r3 */
+		0x1822,						/* subq #1, r2: sets the flags jr tests */
+		0xd7a1,						/* jr NE, loop */
+		0xe400,						/* nop */
+		0x8c04,						/* moveq #0, r4 */
+		0x9805, 0x3020, 0x00f0,		/* movei #done, r5: must follow done */
+		0x8860,						/* move r3, r0: can fill the delay slot */
+		0xd0a0,						/* jump (r5) */
+		0xe400,						/* nop */
+		0xbc20,						/* done: store r0, (r1) */
+		0xd7c0,						/* jr done */
+		0xe400,						/* nop */
+	};
+	const uint16_t deadTarget[] = {
+		0x8c22,						/* moveq #1, r2 */
+		0x1822,						/* subq #1, r2 */
+		0xd441,						/* jr NE, skip */
+		0xe400,						/* nop */
+		0x8c63,						/* moveq #3, r3 */
+		0x8ce4,						/* skip: moveq #7, r4: dead */
+		0x8860,						/* move r3, r0: skip's label moves here */
+		0xd420,						/* jr done */
+		0xe400,						/* nop: can't take the move */
+		0x8c04,						/* done: moveq #0, r4 */
+		0xbc20,						/* store r0, (r1) */
+		0xd7e0,						/* jr . */
+		0xe400,						/* nop */
+	};
+	const uint16_t stalls[] = {
+		0x980e, 0x3100, 0x00f0,		/* movei #$f03100, r14 */
+		0x8c68,						/* moveq #3, r8 */
+		0xa5c1,						/* loop: load (r14), r1 */
+		0x0022,						/* add r1, r2: waits for the load */
+		0xac23,						/* load (r14+1), r3 */
+		0x0064,						/* add r3, r4: waits for the load */
+		0x8ca5,						/* moveq #5, r5 */
+		0x54a6,						/* div r5, r6 */
+		0x00c7,						/* add r6, r7: waits for the div */
+		0x2d29,						/* xor r9, r9: its flags are dead */
+		0x1828,						/* subq #1, r8: sets the flags jr tests */
+		0xd6c1,						/* jr NE, loop */
+		0xe400,						/* nop */
+		0x296b,						/* or r11, r11 */
+		0x980a, 0x0000, 0x00f0,		/* movei #$f00000, r10 */
+		0xd140,						/* jump (r10) */
+		0xe400,						/* nop */
+	};
+	struct JRISC_Program *program;
+	struct JRISC_Program *optimized;
+
+	optimize(words, sizeof(words) / sizeof(words[0]), JRISC_OPT_ALL_RULES);
+	printf("\n");
+	optimize(deadTarget, sizeof(deadTarget) / sizeof(deadTarget[0]),
+			 JRISC_OPT_ALL_RULES);
+
+	/* Without the scheduler, only the instruction before a branch moves */
+	printf("\n");
+	optimize(stalls, sizeof(stalls) / sizeof(stalls[0]),
+			 JRISC_OPT_ALL_RULES & ~JRISC_OPT_RULE(JRISC_optSchedule));
+	printf("\n");
+	optimize(stalls, sizeof(stalls) / sizeof(stalls[0]), JRISC_OPT_ALL_RULES);
+
+	jriscProgramFromWords(stalls, sizeof(stalls) / sizeof(stalls[0]),
+						  JRISC_GPU_RAM, JRISC_gpu, &program);
+	jriscOptimize(program, JRISC_OPT_ALL_RULES, &optimized, NULL);
+	printf("%zu states differ when run\n", compare(program, optimized));
+	jriscProgramDestroy(optimized);
+	jriscProgramDestroy(program);
+
+	return 0;
+}
@@ -0,0 +1,132 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_overlay.h"
+#include "jrisc_program.h"
+#include "testprogram.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* The same routine in both small overlays, followed by a halt */
+#define SHARED \
+	OP(35, 1, 3),					/* moveq	#1, r3 */ \
+	OP(0, 2, 3),					/* add	r2, r3 */ \
+	OP(2, 4, 3),					/* addq	#4, r3 */ \
+	OP(4, 3, 4),					/* sub	r3, r4 */ \
+	OP(35, 7, 5),					/* moveq	#7, r5 */ \
+	OP(0, 5, 4),					/* add	r5, r4 */ \
+	OP(2, 2, 4),					/* addq	#2, r4 */ \
+	OP(0, 4, 2),					/* add	r4, r2 */ \
+	OP(53, -1, 0),					/* halt:	jr	halt */ \
+	OP(57, 0, 0)					/* nop */
+
+/* Reads a table at its end */
+static const uint16_t overlayA[] = {
+	OP(38, 0, 1), 0x3020, 0x00f0,	/* movei	#table, r1 */
+	OP(41, 1, 2),					/* load	(r1), r2 */
+	SHARED,
+	0x0000, 0x0001, 0x0000, 0x0002,	/* table:	dc.l	1, 2 */
+};
+
+/* Has code that nothing reaches */
+static const uint16_t overlayB[] = {
+	OP(35, 3, 2),					/* moveq	#3, r2 */
+	OP(35, 9, 4),					/* moveq	#9, r4 */
+	SHARED,
+	OP(57, 0, 0),					/* nop */
+	OP(57, 0, 0),					/* nop */
+};
+
+#define NUM_NOPS		2004
+
+static void
+printOverlays(const struct JRISC_Overlay *overlays, size_t numOverlays)
+{
+	struct JRISC_OverlayPlan *plan;
+	struct JRISC_Overlay copies[3];
+	size_t i;
+
+	for (i = 0; i < numOverlays; i++) copies[i] = overlays[i];
+
+	if (jriscOverlayPlan(copies, numOverlays, &plan) != JRISC_success) {
+		printf("Failed to plan\n");
+		exit(1);
+	}
+
+	if (jriscOverlayPlanWrite(copies, plan, stdout) != JRISC_success) {
+		printf("Failed to write plan\n");
+		exit(1);
+	}
+
+	jriscOverlayPlanDestroy(plan);
+	printf("\n");
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct JRISC_Program *programs[3];
+	struct JRISC_Overlay overlays[3];
+	struct JRISC_OverlayPlan *plan;
+	uint16_t *overlayC;
+	size_t numWords = 0;
+	size_t i;
+
+	/* Large, with work RAM at the end of local RAM */
+	overlayC = malloc((NUM_NOPS + 6) * sizeof(*overlayC));
+	if (!overlayC) return 1;
+	overlayC[numWords++] = OP(38, 0, 14);	/* movei	#$f03ff0, r14 */
+	overlayC[numWords++] = 0x3ff0;
+	overlayC[numWords++] = 0x00f0;
+	overlayC[numWords++] = OP(47, 14, 0);	/* store	r0, (r14) */
+	for (i = 0; i < NUM_NOPS; i++) {
+		overlayC[numWords++] = OP(57, 0, 0);	/* nop */
+	}
+	overlayC[numWords++] = OP(53, -1, 0);	/* halt:	jr	halt */
+	overlayC[numWords++] = OP(57, 0, 0);	/* nop */
+
+	programs[0] = decode(overlayA, sizeof(overlayA) / sizeof(overlayA[0]));
+	programs[1] = decode(overlayB, sizeof(overlayB) / sizeof(overlayB[0]));
+	programs[2] = decode(overlayC, numWords);
+
+	overlays[0].name = "a";
+	overlays[1].name = "b";
+	overlays[2].name = "c";
+	for (i = 0; i < 3; i++) {
+		overlays[i].program = programs[i];
+		overlays[i].entry = JRISC_GPU_RAM;
+	}
+
+	/* Two small overlays fit side by side */
+	printOverlays(overlays, 2);
+
+	/* The large one only leaves room for both with their code in common */
+	printOverlays(overlays, 3);
+
+	/* Two large ones take turns, each clobbering the other */
+	jriscProgramDestroy(programs[1]);
+	for (i = 4; i < numWords - 2; i++) {
+		overlayC[i] = OP(35, 1, 1);		/* moveq	#1, r1 */
+	}
+	programs[1] = decode(overlayC, numWords);
+	overlays[0] = overlays[2];
+	overlays[1].name = "d";
+	overlays[1].program = programs[1];
+	printOverlays(overlays, 2);
+
+	/* An entry point outside the code is rejected */
+	overlays[0].entry = JRISC_DSP_RAM;
+	printf("Bad entry point: %s\n",
+		   (jriscOverlayPlan(overlays, 3, &plan) ==
+			JRISC_ERROR_invalidValue) ? "rejected" : "accepted");
+
+	for (i = 0; i < 3; i++) jriscProgramDestroy(programs[i]);
+	free(overlayC);
+
+	return 0;
+}
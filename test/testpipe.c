@@ -0,0 +1,150 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_ctx.h"
+#include "jrisc_ctx_mem.h"
+#include "jrisc_inst.h"
+#include "jrisc_pipe.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_WORDS	100000
+
+struct Expected {
+	struct JRISC_Instruction *instructions;
+	size_t count;
+	size_t seen;
+	size_t mismatches;
+	size_t stopAfter;
+};
+
+static enum JRISC_Error
+check(const struct JRISC_Instruction *inst, void *arg)
+{
+	struct Expected *expected = arg;
+	const struct JRISC_Instruction *want;
+
+	if (expected->seen == expected->stopAfter) return JRISC_ERROR_ioError;
+
+	if (expected->seen >= expected->count) {
+		expected->mismatches++;
+	} else {
+		want = &expected->instructions[expected->seen];
+		if ((inst->opName != want->opName) ||
+			(inst->address != want->address) ||
+			(jriscInstructionToRaw(inst) != jriscInstructionToRaw(want)) ||
+			((inst->opName == JRISC_op_movei) &&
+			 (inst->longImmediate != want->longImmediate))) {
+			expected->mismatches++;
+		}
+	}
+
+	expected->seen++;
+
+	return JRISC_success;
+}
+
+/* Compare the pipeline against jriscInstructionRead on the same bytes */
+static void
+run(const char *name, const uint8_t *bytes, size_t size, size_t stopAfter)
+{
+	struct JRISC_Context *ctx;
+	struct Expected expected;
+	enum JRISC_Error err;
+
+	memset(&expected, 0, sizeof(expected));
+	expected.instructions = malloc((size / 2 + 1) *
+								   sizeof(*expected.instructions));
+	expected.stopAfter = stopAfter;
+
+	jriscContextFromMemory(bytes, size, NULL, 0, JRISC_GPU_RAM, &ctx);
+	while (jriscInstructionRead(ctx, JRISC_gpu,
+								&expected.instructions[expected.count]) ==
+		   JRISC_success) {
+		expected.count++;
+	}
+	jriscContextDestroy(ctx);
+
+	jriscContextFromMemory(bytes, size, NULL, 0, JRISC_GPU_RAM, &ctx);
+	err = jriscPipeDecode(ctx, size, JRISC_gpu, check, &expected);
+	jriscContextDestroy(ctx);
+
+	printf("%s: %zu expected, %zu seen, %zu mismatched, %s\n", name,
+		   expected.count, expected.seen, expected.mismatches,
+		   (err == JRISC_success) ? "success" : "stopped");
+
+	free(expected.instructions);
+}
+
+static void
+setNops(uint8_t *bytes, size_t first, size_t end)
+{
+	for (; first < end; first++) {
+		bytes[first * 2] = 0xe4;
+		bytes[first * 2 + 1] = 0x00;
+	}
+}
+
+int
+main(int argc, char *argv[])
+{
+	uint8_t *bytes = malloc(NUM_WORDS * 2);
+	struct JRISC_Instruction inst;
+	uint32_t seed = 12345;
+	uint16_t word;
+	uint16_t invalid = 0;
+	size_t w;
+
+	/* Any word that doesn't decode, to end the code early */
+	for (w = 0; w < 0x10000; w++) {
+		if (jriscInstructionDecode((uint16_t)w, JRISC_gpu, 0, &inst) !=
+			JRISC_success) {
+			invalid = (uint16_t)w;
+			break;
+		}
+	}
+
+	for (w = 0; w < NUM_WORDS; w++) {
+		seed = seed * 1103515245 + 12345;
+		word = (uint16_t)(seed >> 16);
+		if (jriscInstructionDecode(word, JRISC_gpu, 0, &inst) !=
+			JRISC_success) {
+			word = 0xe400;					/* nop */
+		}
+		bytes[w * 2] = word >> 8;
+		bytes[w * 2 + 1] = word & 0xff;
+	}
+
+	/* A movei whose value straddles the first batch boundary */
+	bytes[4095 * 2] = 0x98;
+	bytes[4095 * 2 + 1] = 0x01;
+
+	run("whole", bytes, NUM_WORDS * 2, (size_t)-1);
+	run("small", bytes, 20, (size_t)-1);
+	run("empty", bytes, 0, (size_t)-1);
+	run("cancelled", bytes, NUM_WORDS * 2, 10000);
+
+	/*
+	 * A movei cut short by the end of the code. The nops before it make sure
+	 * it isn't itself the value of another movei.
+	 */
+	setNops(bytes, NUM_WORDS - 10, NUM_WORDS - 2);
+	bytes[NUM_WORDS * 2 - 4] = 0x98;
+	bytes[NUM_WORDS * 2 - 3] = 0x01;
+	run("short movei", bytes, NUM_WORDS * 2, (size_t)-1);
+
+	setNops(bytes, 49990, 50000);
+	bytes[50000 * 2] = invalid >> 8;
+	bytes[50000 * 2 + 1] = invalid & 0xff;
+	run("invalid", bytes, NUM_WORDS * 2, (size_t)-1);
+
+	free(bytes);
+
+	return 0;
+}
@@ -0,0 +1,43 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#ifndef TEST_PROGRAM_H_
+#define TEST_PROGRAM_H_
+
+#include "jrisc_base.h"
+#include "jrisc_inst.h"
+#include "jrisc_program.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Assemble an instruction word from its opcode and operand fields */
+#define OP(op, src, dst) \
+	(uint16_t)(((op) << 10) | (((src) & 0x1f) << 5) | (dst))
+
+/* Decode GPU code loaded at <baseAddress>, or exit */
+static inline struct JRISC_Program *
+decodeAt(const uint16_t *words, size_t numWords, uint32_t baseAddress)
+{
+	struct JRISC_Program *program;
+
+	if (jriscProgramFromWords(words, numWords, baseAddress, JRISC_gpu,
+							  &program) != JRISC_success) {
+		printf("Failed to decode\n");
+		exit(1);
+	}
+
+	return program;
+}
+
+/* Decode GPU code loaded at the start of local RAM, or exit */
+static inline struct JRISC_Program *
+decode(const uint16_t *words, size_t numWords)
+{
+	return decodeAt(words, numWords, JRISC_GPU_RAM);
+}
+
+#endif /* TEST_PROGRAM_H_ */
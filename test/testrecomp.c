@@ -0,0 +1,296 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_exec.h"
+#include "jrisc_program.h"
+#include "jrisc_recomp.h"
+#include "testprogram.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Built twice: first to write the routines below as C, then with that C
+ * included, to run them natively and through jriscExecRun and compare.
+ */
+#ifdef TESTRECOMP_GENERATED
+#include "testrecomp_gen.c"
+#endif
+
+#define NUM_STATES	1000
+
+/* Collatz: count the steps for r0 to reach 1 in r1 */
+static const uint16_t collatz[] = {
+	OP(35, 0, 1),		/* 00:	moveq	#0, r1 */
+	OP(31, 1, 0),		/* 02: loop:	cmpq	#1, r0 */
+	OP(53, 10, 0x2),	/* 04:	jr	eq, done */
+	OP(13, 0, 0),		/* 06:	btst	#0, r0 */
+	OP(53, 3, 0x1),		/* 08:	jr	ne, odd */
+	OP(2, 1, 1),		/* 0a:	addq	#1, r1 */
+	OP(53, -6, 0),		/* 0c:	jr	loop */
+	OP(25, 1, 0),		/* 0e:	shrq	#1, r0 */
+	OP(34, 0, 2),		/* 10: odd:	move	r0, r2 */
+	OP(0, 0, 0),		/* 12:	add	r0, r0 */
+	OP(0, 2, 0),		/* 14:	add	r2, r0 */
+	OP(53, -11, 0),		/* 16:	jr	loop */
+	OP(2, 1, 0),		/* 18:	addq	#1, r0 */
+	OP(57, 0, 0),		/* 1a: done:	nop */
+};
+
+/*
+ * Sum and multiply-accumulate four longs from local RAM, call a subroutine
+ * through a register, switch banks through the flags and jump out
+ */
+static const uint16_t mixed[] = {
+	OP(38, 0, 14), 0x3100, 0x00f0,	/* 00:	movei	#$f03100, r14 */
+	OP(35, 4, 3),					/* 06:	moveq	#4, r3 */
+	OP(35, 0, 4),					/* 08:	moveq	#0, r4 */
+	OP(18, 4, 4),					/* 0a:	imultn	r4, r4 */
+	OP(41, 14, 1),					/* 0c: loop:	load	(r14), r1 */
+	OP(2, 4, 14),					/* 0e:	addq	#4, r14 */
+	OP(20, 1, 1),					/* 10:	imacn	r1, r1 */
+	OP(6, 1, 3),					/* 12:	subq	#1, r3 */
+	OP(53, -5, 0x1),				/* 14:	jr	ne, loop */
+	OP(0, 1, 4),					/* 16:	add	r1, r4 */
+	OP(19, 0, 5),					/* 18:	resmac	r5 */
+	OP(49, 1, 5),					/* 1a:	store	r5, (r14+1) */
+	OP(38, 0, 6), 0x3046, 0x00f0,	/* 1c:	movei	#sub, r6 */
+	OP(51, 0, 7),					/* 22:	move	pc, r7 */
+	OP(2, 10, 7),					/* 24:	addq	#10, r7 */
+	OP(52, 6, 0),					/* 26:	jump	(r6) */
+	OP(35, 3, 8),					/* 28:	moveq	#3, r8 */
+	OP(57, 0, 0),					/* 2a:	nop */
+	OP(38, 0, 9), 0x2100, 0x00f0,	/* 2c:	movei	#$f02100, r9 */
+	OP(41, 9, 10),					/* 32:	load	(r9), r10 */
+	OP(14, 14, 10),					/* 34:	bset	#14, r10 */
+	OP(47, 9, 10),					/* 36:	store	r10, (r9) */
+	OP(35, 9, 1),					/* 38:	moveq	#9, r1 */
+	OP(37, 4, 11),					/* 3a:	movefa	r4, r11 */
+	OP(38, 0, 12), 0x0000, 0x00f0,	/* 3c:	movei	#$f00000, r12 */
+	OP(52, 12, 0),					/* 42:	jump	(r12) */
+	OP(0, 11, 1),					/* 44:	add	r11, r1 */
+	OP(34, 5, 13),					/* 46: sub:	move	r5, r13 */
+	OP(24, 29, 13),					/* 48:	shlq	#3, r13 */
+	OP(27, 2, 13),					/* 4a:	sharq	#2, r13 */
+	OP(23, 8, 13),					/* 4c:	sh	r8, r13 */
+	OP(29, 7, 13),					/* 4e:	rorq	#7, r13 */
+	OP(16, 8, 13),					/* 50:	mult	r8, r13 */
+	OP(52, 7, 0),					/* 52:	jump	(r7) */
+	OP(22, 0, 13),					/* 54:	abs	r13 */
+};
+
+#ifndef TESTRECOMP_GENERATED
+
+int
+main(int argc, char *argv[])
+{
+	struct JRISC_Program *program;
+
+	program = decode(collatz, sizeof(collatz) / sizeof(collatz[0]));
+	if (jriscRecompWrite(program, "collatzNative", false, stdout) !=
+		JRISC_success) {
+		return 1;
+	}
+	jriscProgramDestroy(program);
+
+	printf("\n");
+
+	program = decode(mixed, sizeof(mixed) / sizeof(mixed[0]));
+	if (jriscRecompWrite(program, "mixedNative", false, stdout) !=
+		JRISC_success) {
+		return 1;
+	}
+	jriscProgramDestroy(program);
+
+	return 0;
+}
+
+#else
+
+static const char *statusNames[] = {
+	"done", "timeout", "bad address", "bad instruction"
+};
+
+/* A fixed sequence, so the gold file doesn't depend on the C library */
+static uint32_t
+next(uint32_t *seed)
+{
+	*seed = *seed * 1664525 + 1013904223;
+	return *seed ^ (*seed >> 16);
+}
+
+/*
+ * Run <numStates> states from <entry> through both the interpreter and the
+ * recompiled <routine>, and count those that end differently. States with
+ * the same index start the same, including their local RAM.
+ */
+static void
+compare(const char *name,
+		const uint16_t *words,
+		size_t numWords,
+		void (*routine)(struct JRISC_RecompState *st),
+		uint32_t entry,
+		uint64_t maxSteps,
+		struct JRISC_ExecState *states,
+		size_t numStates)
+{
+	struct JRISC_Program *program = decode(words, numWords);
+	struct JRISC_RecompState *native = calloc(numStates, sizeof(*native));
+	uint8_t *ram = malloc(numStates * JRISC_GPU_RAM_SIZE);
+	size_t counts[4] = { 0, 0, 0, 0 };
+	size_t mismatches = 0;
+	uint64_t steps = 0;
+	size_t i;
+
+	if (!native || !ram) {
+		printf("Out of memory\n");
+		exit(1);
+	}
+
+	for (i = 0; i < numStates; i++) {
+		memcpy(native[i].regs, states[i].regs, sizeof(native[i].regs));
+		memcpy(native[i].altRegs, states[i].altRegs,
+			   sizeof(native[i].altRegs));
+		native[i].z = states[i].z;
+		native[i].c = states[i].c;
+		native[i].n = states[i].n;
+		native[i].acc = states[i].acc;
+		native[i].pc = entry;
+		native[i].maxSteps = maxSteps;
+		if (states[i].ram) {
+			native[i].ram = ram + i * JRISC_GPU_RAM_SIZE;
+			memcpy(native[i].ram, states[i].ram, JRISC_GPU_RAM_SIZE);
+		}
+
+		routine(&native[i]);
+	}
+
+	if (jriscExecRun(program, entry, maxSteps, 1, states, numStates) !=
+		JRISC_success) {
+		printf("Failed to run\n");
+		exit(1);
+	}
+
+	for (i = 0; i < numStates; i++) {
+		counts[states[i].status]++;
+		steps += states[i].steps;
+
+		if ((int)native[i].status != (int)states[i].status) {
+			mismatches++;
+		} else if (maxSteps) {
+			/* Only checked at branches, so may stop a little later */
+			continue;
+		} else if (memcmp(native[i].regs, states[i].regs,
+						  sizeof(native[i].regs)) ||
+				   memcmp(native[i].altRegs, states[i].altRegs,
+						  sizeof(native[i].altRegs)) ||
+				   (native[i].z != states[i].z) ||
+				   (native[i].c != states[i].c) ||
+				   (native[i].n != states[i].n) ||
+				   (native[i].acc != states[i].acc) ||
+				   (native[i].pc != states[i].pc) ||
+				   (native[i].steps != states[i].steps) ||
+				   (states[i].ram &&
+					memcmp(native[i].ram, states[i].ram,
+						   JRISC_GPU_RAM_SIZE))) {
+			mismatches++;
+		}
+	}
+
+	printf("%s from $%x: %zu mismatches, %llu steps, %zu %s, %zu %s, "
+		   "%zu %s, %zu %s\n", name, entry, mismatches,
+		   (unsigned long long)steps, counts[0], statusNames[0], counts[1],
+		   statusNames[1], counts[2], statusNames[2], counts[3],
+		   statusNames[3]);
+
+	free(ram);
+	free(native);
+	jriscProgramDestroy(program);
+}
+
+/* Random registers, flags and RAM, with r14 and r7 as each test needs */
+static void
+randomize(struct JRISC_ExecState *states, uint8_t *ram, uint32_t seed)
+{
+	size_t i, b;
+	unsigned r;
+
+	memset(states, 0, NUM_STATES * sizeof(*states));
+
+	for (i = 0; i < NUM_STATES; i++) {
+		for (r = 0; r < 32; r++) {
+			states[i].regs[r] = next(&seed);
+			states[i].altRegs[r] = next(&seed);
+		}
+		states[i].z = next(&seed) & 1;
+		states[i].c = next(&seed) & 1;
+		states[i].n = next(&seed) & 1;
+		states[i].acc = (int32_t)next(&seed);
+
+		states[i].ram = ram + i * JRISC_GPU_RAM_SIZE;
+		for (b = 0; b < JRISC_GPU_RAM_SIZE; b++) {
+			states[i].ram[b] = (uint8_t)next(&seed);
+		}
+	}
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct JRISC_ExecState *states = calloc(NUM_STATES, sizeof(*states));
+	uint8_t *ram = malloc(NUM_STATES * JRISC_GPU_RAM_SIZE);
+	size_t i;
+
+	if (!states || !ram) {
+		printf("Out of memory\n");
+		return 1;
+	}
+
+	for (i = 0; i < NUM_STATES; i++) {
+		memset(&states[i], 0, sizeof(states[i]));
+		states[i].regs[0] = (uint32_t)i + 1;
+	}
+	compare("collatz", collatz, sizeof(collatz) / sizeof(collatz[0]),
+			collatzNative, JRISC_GPU_RAM, 0, states, NUM_STATES);
+
+	for (i = 0; i < NUM_STATES; i++) {
+		memset(&states[i], 0, sizeof(states[i]));
+		states[i].regs[0] = (uint32_t)i + 1;
+	}
+	compare("collatz, 60 steps", collatz, sizeof(collatz) / sizeof(collatz[0]),
+			collatzNative, JRISC_GPU_RAM, 60, states, NUM_STATES);
+
+	randomize(states, ram, 1);
+	compare("mixed", mixed, sizeof(mixed) / sizeof(mixed[0]), mixedNative,
+			JRISC_GPU_RAM, 0, states, NUM_STATES);
+
+	/* Returning into a movei, to the bank switch, or out of the program */
+	randomize(states, ram, 2);
+	for (i = 0; i < NUM_STATES; i++) {
+		if ((i % 3) == 0) states[i].regs[7] = JRISC_GPU_RAM + 0x02;
+		if ((i % 3) == 1) states[i].regs[7] = JRISC_GPU_RAM + 0x2c;
+	}
+	compare("mixed", mixed, sizeof(mixed) / sizeof(mixed[0]), mixedNative,
+			JRISC_GPU_RAM + 0x46, 0, states, NUM_STATES);
+
+	/* Loading through r14 wherever it points, sometimes a few longs of RAM */
+	randomize(states, ram, 3);
+	for (i = 0; i < NUM_STATES; i += 2) {
+		states[i].regs[14] = JRISC_GPU_RAM + (states[i].regs[14] & 0xfe0);
+		states[i].regs[3] = (uint32_t)(i % 6) + 1;
+	}
+	compare("mixed", mixed, sizeof(mixed) / sizeof(mixed[0]), mixedNative,
+			JRISC_GPU_RAM + 0x0c, 0, states, NUM_STATES);
+
+	free(ram);
+	free(states);
+
+	return 0;
+}
+
+#endif
@@ -0,0 +1,915 @@
+/* Recompiled from Jaguar RISC code by jrecomp */
+
+#include <stdint.h>
+
+#ifndef JRISC_RECOMP_STATE_
+#define JRISC_RECOMP_STATE_
+
+enum JRISC_RecompStatus {
+	JRISC_recompDone,			/* Ran off the end of the code or left it */
+	JRISC_recompTimeout,		/* Still running after maxSteps */
+	JRISC_recompBadAddress,		/* Load or store outside local RAM and flags */
+	JRISC_recompBadInstruction	/* Not supported, or jumped into a movei */
+};
+
+/*
+ * A routine's state. Everything but the status is read on entry, and all of
+ * it is written on return.
+ */
+struct JRISC_RecompState {
+	uint32_t regs[32];			/* The current bank */
+	uint32_t altRegs[32];		/* The other bank */
+	uint32_t z, c, n;			/* The flags, 0 or 1 */
+	uint32_t regpage;			/* REGPAGE, 0 or 1 */
+	int64_t acc;				/* imultn/imacn/resmac's accumulator */
+	uint8_t *ram;				/* Local RAM as big-endian bytes, or NULL */
+	uint32_t pc;				/* Where to start, then where it stopped */
+	uint64_t steps;				/* Instructions executed */
+	uint64_t maxSteps;			/* Stop once past this many, if not 0 */
+	enum JRISC_RecompStatus status;
+};
+
+#endif /* JRISC_RECOMP_STATE_ */
+
+/*
+ * $f03000-$f0301b, for the GPU. ram must be 4096 bytes, from $f03000.
+ */
+extern void
+collatzNative(struct JRISC_RecompState *st);
+
+#ifndef JRISC_RECOMP_GPU_ACCESS_
+#define JRISC_RECOMP_GPU_ACCESS_
+
+static inline int
+jriscRecompGpuLoad(const struct JRISC_RecompState *st, uint32_t address,
+				   unsigned size, uint32_t *value)
+{
+	const uint8_t *p;
+	uint32_t offset;
+
+	address &= ~(uint32_t)(size - 1);
+	if ((size == 4) && (address == 0xf02100u)) return 2;
+
+	offset = address - 0xf03000u;
+	if (!st->ram || (address < 0xf03000u) || (offset >= 0x1000u)) return 1;
+
+	p = st->ram + offset;
+	*value = 0;
+	while (size--) *value = (*value << 8) | *p++;
+
+	return 0;
+}
+
+static inline int
+jriscRecompGpuStore(struct JRISC_RecompState *st, uint32_t address,
+					unsigned size, uint32_t value)
+{
+	uint8_t *p;
+	uint32_t offset;
+
+	address &= ~(uint32_t)(size - 1);
+	if ((size == 4) && (address == 0xf02100u)) return 2;
+
+	offset = address - 0xf03000u;
+	if (!st->ram || (address < 0xf03000u) || (offset >= 0x1000u)) return 1;
+
+	p = st->ram + offset;
+	while (size--) *p++ = (uint8_t)(value >> (size * 8));
+
+	return 0;
+}
+
+#endif
+
+void
+collatzNative(struct JRISC_RecompState *st)
+{
+	uint32_t r0 = st->regs[0];
+	uint32_t r1 = st->regs[1];
+	uint32_t r2 = st->regs[2];
+	uint32_t r3 = st->regs[3];
+	uint32_t r4 = st->regs[4];
+	uint32_t r5 = st->regs[5];
+	uint32_t r6 = st->regs[6];
+	uint32_t r7 = st->regs[7];
+	uint32_t r8 = st->regs[8];
+	uint32_t r9 = st->regs[9];
+	uint32_t r10 = st->regs[10];
+	uint32_t r11 = st->regs[11];
+	uint32_t r12 = st->regs[12];
+	uint32_t r13 = st->regs[13];
+	uint32_t r14 = st->regs[14];
+	uint32_t r15 = st->regs[15];
+	uint32_t r16 = st->regs[16];
+	uint32_t r17 = st->regs[17];
+	uint32_t r18 = st->regs[18];
+	uint32_t r19 = st->regs[19];
+	uint32_t r20 = st->regs[20];
+	uint32_t r21 = st->regs[21];
+	uint32_t r22 = st->regs[22];
+	uint32_t r23 = st->regs[23];
+	uint32_t r24 = st->regs[24];
+	uint32_t r25 = st->regs[25];
+	uint32_t r26 = st->regs[26];
+	uint32_t r27 = st->regs[27];
+	uint32_t r28 = st->regs[28];
+	uint32_t r29 = st->regs[29];
+	uint32_t r30 = st->regs[30];
+	uint32_t r31 = st->regs[31];
+	uint32_t z = st->z, c = st->c, n = st->n;
+	int64_t acc = st->acc;
+	uint64_t steps = st->steps;
+	const uint64_t maxSteps = st->maxSteps;
+	enum JRISC_RecompStatus status = JRISC_recompDone;
+	uint32_t dest = st->pc;
+	uint32_t t = 0, u = 0, value = 0, target = 0;
+	int32_t shift = 0;
+	int taken = 0;
+
+	(void)t; (void)u; (void)value; (void)target; (void)shift; (void)taken;
+
+	goto dispatch;
+
+dispatch:
+	if ((dest - 0xf03000u) >= 0x1cu) goto leave;
+	if (maxSteps && (steps >= maxSteps)) {
+		status = JRISC_recompTimeout;
+		goto leave;
+	}
+	switch (dest) {
+	case 0xf03000u: goto L_f03000;
+	case 0xf03002u: goto L_f03002;
+	case 0xf03004u: goto L_f03004;
+	case 0xf03006u: goto L_f03006;
+	case 0xf03008u: goto L_f03008;
+	case 0xf0300au: goto L_f0300a;
+	case 0xf0300cu: goto L_f0300c;
+	case 0xf0300eu: goto L_f0300e;
+	case 0xf03010u: goto L_f03010;
+	case 0xf03012u: goto L_f03012;
+	case 0xf03014u: goto L_f03014;
+	case 0xf03016u: goto L_f03016;
+	case 0xf03018u: goto L_f03018;
+	case 0xf0301au: goto L_f0301a;
+	default: break;
+	}
+	status = JRISC_recompBadInstruction;
+	goto leave;
+
+L_f03000:
+	t = 0x0u;
+	r1 = t;
+	steps++;
+
+L_f03002:
+	t = r0 - 0x1u;
+	c = r0 < 0x1u;
+	z = t == 0;
+	n = t >> 31;
+	steps++;
+
+L_f03004:
+	taken = !(!z);
+	target = 0xf0301au;
+	steps++;
+	t = r0 & 0x1u;
+	z = t == 0;
+	steps++;
+	if (taken) {
+		if (maxSteps && (steps >= maxSteps)) {
+			dest = 0xf0301au;
+			status = JRISC_recompTimeout;
+			goto leave;
+		}
+		goto L_f0301a;
+	}
+	goto L_f03008;
+
+L_f03006:
+	t = r0 & 0x1u;
+	z = t == 0;
+	steps++;
+
+L_f03008:
+	taken = !(z);
+	target = 0xf03010u;
+	steps++;
+	t = r1 + 0x1u;
+	c = t < r1;
+	r1 = t;
+	z = t == 0;
+	n = t >> 31;
+	steps++;
+	if (taken) {
+		if (maxSteps && (steps >= maxSteps)) {
+			dest = 0xf03010u;
+			status = JRISC_recompTimeout;
+			goto leave;
+		}
+		goto L_f03010;
+	}
+	goto L_f0300c;
+
+L_f0300a:
+	t = r1 + 0x1u;
+	c = t < r1;
+	r1 = t;
+	z = t == 0;
+	n = t >> 31;
+	steps++;
+
+L_f0300c:
+	taken = 1;
+	target = 0xf03002u;
+	steps++;
+	c = r0 & 1;
+	t = r0 >> 1;
+	r0 = t;
+	z = t == 0;
+	n = t >> 31;
+	steps++;
+	if (taken) {
+		if (maxSteps && (steps >= maxSteps)) {
+			dest = 0xf03002u;
+			status = JRISC_recompTimeout;
+			goto leave;
+		}
+		goto L_f03002;
+	}
+	goto L_f03010;
+
+L_f0300e:
+	c = r0 & 1;
+	t = r0 >> 1;
+	r0 = t;
+	z = t == 0;
+	n = t >> 31;
+	steps++;
+
+L_f03010:
+	t = r0;
+	r2 = t;
+	steps++;
+
+L_f03012:
+	t = r0 + r0;
+	c = t < r0;
+	r0 = t;
+	z = t == 0;
+	n = t >> 31;
+	steps++;
+
+L_f03014:
+	t = r0 + r2;
+	c = t < r0;
+	r0 = t;
+	z = t == 0;
+	n = t >> 31;
+	steps++;
+
+L_f03016:
+	taken = 1;
+	target = 0xf03002u;
+	steps++;
+	t = r0 + 0x1u;
+	c = t < r0;
+	r0 = t;
+	z = t == 0;
+	n = t >> 31;
+	steps++;
+	if (taken) {
+		if (maxSteps && (steps >= maxSteps)) {
+			dest = 0xf03002u;
+			status = JRISC_recompTimeout;
+			goto leave;
+		}
+		goto L_f03002;
+	}
+	goto L_f0301a;
+
+L_f03018:
+	t = r0 + 0x1u;
+	c = t < r0;
+	r0 = t;
+	z = t == 0;
+	n = t >> 31;
+	steps++;
+
+L_f0301a:
+	steps++;
+	dest = 0xf0301cu;
+	goto leave;
+
+leave:
+	st->regs[0] = r0;
+	st->regs[1] = r1;
+	st->regs[2] = r2;
+	st->regs[3] = r3;
+	st->regs[4] = r4;
+	st->regs[5] = r5;
+	st->regs[6] = r6;
+	st->regs[7] = r7;
+	st->regs[8] = r8;
+	st->regs[9] = r9;
+	st->regs[10] = r10;
+	st->regs[11] = r11;
+	st->regs[12] = r12;
+	st->regs[13] = r13;
+	st->regs[14] = r14;
+	st->regs[15] = r15;
+	st->regs[16] = r16;
+	st->regs[17] = r17;
+	st->regs[18] = r18;
+	st->regs[19] = r19;
+	st->regs[20] = r20;
+	st->regs[21] = r21;
+	st->regs[22] = r22;
+	st->regs[23] = r23;
+	st->regs[24] = r24;
+	st->regs[25] = r25;
+	st->regs[26] = r26;
+	st->regs[27] = r27;
+	st->regs[28] = r28;
+	st->regs[29] = r29;
+	st->regs[30] = r30;
+	st->regs[31] = r31;
+	st->z = z;
+	st->c = c;
+	st->n = n;
+	st->acc = acc;
+	st->pc = dest;
+	st->steps = steps;
+	st->status = status;
+}
+
+/* Recompiled from Jaguar RISC code by jrecomp */
+
+#include <stdint.h>
+
+#ifndef JRISC_RECOMP_STATE_
+#define JRISC_RECOMP_STATE_
+
+enum JRISC_RecompStatus {
+	JRISC_recompDone,			/* Ran off the end of the code or left it */
+	JRISC_recompTimeout,		/* Still running after maxSteps */
+	JRISC_recompBadAddress,		/* Load or store outside local RAM and flags */
+	JRISC_recompBadInstruction	/* Not supported, or jumped into a movei */
+};
+
+/*
+ * A routine's state. Everything but the status is read on entry, and all of
+ * it is written on return.
+ */
+struct JRISC_RecompState {
+	uint32_t regs[32];			/* The current bank */
+	uint32_t altRegs[32];		/* The other bank */
+	uint32_t z, c, n;			/* The flags, 0 or 1 */
+	uint32_t regpage;			/* REGPAGE, 0 or 1 */
+	int64_t acc;				/* imultn/imacn/resmac's accumulator */
+	uint8_t *ram;				/* Local RAM as big-endian bytes, or NULL */
+	uint32_t pc;				/* Where to start, then where it stopped */
+	uint64_t steps;				/* Instructions executed */
+	uint64_t maxSteps;			/* Stop once past this many, if not 0 */
+	enum JRISC_RecompStatus status;
+};
+
+#endif /* JRISC_RECOMP_STATE_ */
+
+/*
+ * $f03000-$f03055, for the GPU. ram must be 4096 bytes, from $f03000.
+ */
+extern void
+mixedNative(struct JRISC_RecompState *st);
+
+#ifndef JRISC_RECOMP_GPU_ACCESS_
+#define JRISC_RECOMP_GPU_ACCESS_
+
+static inline int
+jriscRecompGpuLoad(const struct JRISC_RecompState *st, uint32_t address,
+				   unsigned size, uint32_t *value)
+{
+	const uint8_t *p;
+	uint32_t offset;
+
+	address &= ~(uint32_t)(size - 1);
+	if ((size == 4) && (address == 0xf02100u)) return 2;
+
+	offset = address - 0xf03000u;
+	if (!st->ram || (address < 0xf03000u) || (offset >= 0x1000u)) return 1;
+
+	p = st->ram + offset;
+	*value = 0;
+	while (size--) *value = (*value << 8) | *p++;
+
+	return 0;
+}
+
+static inline int
+jriscRecompGpuStore(struct JRISC_RecompState *st, uint32_t address,
+					unsigned size, uint32_t value)
+{
+	uint8_t *p;
+	uint32_t offset;
+
+	address &= ~(uint32_t)(size - 1);
+	if ((size == 4) && (address == 0xf02100u)) return 2;
+
+	offset = address - 0xf03000u;
+	if (!st->ram || (address < 0xf03000u) || (offset >= 0x1000u)) return 1;
+
+	p = st->ram + offset;
+	while (size--) *p++ = (uint8_t)(value >> (size * 8));
+
+	return 0;
+}
+
+#endif
+
+void
+mixedNative(struct JRISC_RecompState *st)
+{
+	uint32_t r0 = st->regs[0];
+	uint32_t r1 = st->regs[1];
+	uint32_t r2 = st->regs[2];
+	uint32_t r3 = st->regs[3];
+	uint32_t r4 = st->regs[4];
+	uint32_t r5 = st->regs[5];
+	uint32_t r6 = st->regs[6];
+	uint32_t r7 = st->regs[7];
+	uint32_t r8 = st->regs[8];
+	uint32_t r9 = st->regs[9];
+	uint32_t r10 = st->regs[10];
+	uint32_t r11 = st->regs[11];
+	uint32_t r12 = st->regs[12];
+	uint32_t r13 = st->regs[13];
+	uint32_t r14 = st->regs[14];
+	uint32_t r15 = st->regs[15];
+	uint32_t r16 = st->regs[16];
+	uint32_t r17 = st->regs[17];
+	uint32_t r18 = st->regs[18];
+	uint32_t r19 = st->regs[19];
+	uint32_t r20 = st->regs[20];
+	uint32_t r21 = st->regs[21];
+	uint32_t r22 = st->regs[22];
+	uint32_t r23 = st->regs[23];
+	uint32_t r24 = st->regs[24];
+	uint32_t r25 = st->regs[25];
+	uint32_t r26 = st->regs[26];
+	uint32_t r27 = st->regs[27];
+	uint32_t r28 = st->regs[28];
+	uint32_t r29 = st->regs[29];
+	uint32_t r30 = st->regs[30];
+	uint32_t r31 = st->regs[31];
+	uint32_t z = st->z, c = st->c, n = st->n;
+	int64_t acc = st->acc;
+	uint64_t steps = st->steps;
+	const uint64_t maxSteps = st->maxSteps;
+	enum JRISC_RecompStatus status = JRISC_recompDone;
+	uint32_t dest = st->pc;
+	uint32_t t = 0, u = 0, value = 0, target = 0;
+	int32_t shift = 0;
+	int taken = 0;
+
+	(void)t; (void)u; (void)value; (void)target; (void)shift; (void)taken;
+
+	goto dispatch;
+
+dispatch:
+	if ((dest - 0xf03000u) >= 0x56u) goto leave;
+	if (maxSteps && (steps >= maxSteps)) {
+		status = JRISC_recompTimeout;
+		goto leave;
+	}
+	switch (dest) {
+	case 0xf03000u: goto L_f03000;
+	case 0xf03006u: goto L_f03006;
+	case 0xf03008u: goto L_f03008;
+	case 0xf0300au: goto L_f0300a;
+	case 0xf0300cu: goto L_f0300c;
+	case 0xf0300eu: goto L_f0300e;
+	case 0xf03010u: goto L_f03010;
+	case 0xf03012u: goto L_f03012;
+	case 0xf03014u: goto L_f03014;
+	case 0xf03016u: goto L_f03016;
+	case 0xf03018u: goto L_f03018;
+	case 0xf0301au: goto L_f0301a;
+	case 0xf0301cu: goto L_f0301c;
+	case 0xf03022u: goto L_f03022;
+	case 0xf03024u: goto L_f03024;
+	case 0xf03026u: goto L_f03026;
+	case 0xf03028u: goto L_f03028;
+	case 0xf0302au: goto L_f0302a;
+	case 0xf0302cu: goto L_f0302c;
+	case 0xf03032u: goto L_f03032;
+	case 0xf03034u: goto L_f03034;
+	case 0xf03036u: goto L_f03036;
+	case 0xf03038u: goto L_f03038;
+	case 0xf0303au: goto L_f0303a;
+	case 0xf0303cu: goto L_f0303c;
+	case 0xf03042u: goto L_f03042;
+	case 0xf03044u: goto L_f03044;
+	case 0xf03046u: goto L_f03046;
+	case 0xf03048u: goto L_f03048;
+	case 0xf0304au: goto L_f0304a;
+	case 0xf0304cu: goto L_f0304c;
+	case 0xf0304eu: goto L_f0304e;
+	case 0xf03050u: goto L_f03050;
+	case 0xf03052u: goto L_f03052;
+	case 0xf03054u: goto L_f03054;
+	default: break;
+	}
+	status = JRISC_recompBadInstruction;
+	goto leave;
+
+L_f03000:
+	t = 0xf03100u;
+	r14 = t;
+	steps++;
+
+L_f03006:
+	t = 0x4u;
+	r3 = t;
+	steps++;
+
+L_f03008:
+	t = 0x0u;
+	r4 = t;
+	steps++;
+
+L_f0300a:
+	acc = (int32_t)(uint32_t)((int32_t)(int16_t)r4 * (int32_t)(int16_t)r4);
+	t = (uint32_t)acc;
+	z = t == 0;
+	n = t >> 31;
+	steps++;
+
+L_f0300c:
+	switch (jriscRecompGpuLoad(st, r14, 4, &value)) {
+	case 0:
+		r1 = value;
+		break;
+	case 2:
+		r1 = z | (c << 1) | (n << 2) | (st->regpage << 14);
+		break;
+	default:
+		dest = 0xf0300cu;
+		status = JRISC_recompBadAddress;
+		goto leave;
+	}
+	steps++;
+
+L_f0300e:
+	t = r14 + 0x4u;
+	c = t < r14;
+	r14 = t;
+	z = t == 0;
+	n = t >> 31;
+	steps++;
+
+L_f03010:
+	acc = acc + (int32_t)(uint32_t)((int32_t)(int16_t)r1 * (int32_t)(int16_t)r1);
+	t = (uint32_t)acc;
+	z = t == 0;
+	n = t >> 31;
+	steps++;
+
+L_f03012:
+	t = r3 - 0x1u;
+	c = r3 < 0x1u;
+	r3 = t;
+	z = t == 0;
+	n = t >> 31;
+	steps++;
+
+L_f03014:
+	taken = !(z);
+	target = 0xf0300cu;
+	steps++;
+	t = r4 + r1;
+	c = t < r4;
+	r4 = t;
+	z = t == 0;
+	n = t >> 31;
+	steps++;
+	if (taken) {
+		if (maxSteps && (steps >= maxSteps)) {
+			dest = 0xf0300cu;
+			status = JRISC_recompTimeout;
+			goto leave;
+		}
+		goto L_f0300c;
+	}
+	goto L_f03018;
+
+L_f03016:
+	t = r4 + r1;
+	c = t < r4;
+	r4 = t;
+	z = t == 0;
+	n = t >> 31;
+	steps++;
+
+L_f03018:
+	t = (uint32_t)acc;
+	r5 = t;
+	z = t == 0;
+	n = t >> 31;
+	steps++;
+
+L_f0301a:
+	switch (jriscRecompGpuStore(st, r14 + 0x4u, 4, r5)) {
+	case 0:
+		break;
+	case 2:
+		value = r5;
+		steps++;
+		dest = 0xf0301cu;
+		goto setflags;
+	default:
+		dest = 0xf0301au;
+		status = JRISC_recompBadAddress;
+		goto leave;
+	}
+	steps++;
+
+L_f0301c:
+	t = 0xf03046u;
+	r6 = t;
+	steps++;
+
+L_f03022:
+	t = 0xf03022u;
+	r7 = t;
+	steps++;
+
+L_f03024:
+	t = r7 + 0xau;
+	c = t < r7;
+	r7 = t;
+	z = t == 0;
+	n = t >> 31;
+	steps++;
+
+L_f03026:
+	taken = 1;
+	target = r6;
+	steps++;
+	t = 0x3u;
+	r8 = t;
+	steps++;
+	if (taken) {
+		dest = target;
+		goto dispatch;
+	}
+	goto L_f0302a;
+
+L_f03028:
+	t = 0x3u;
+	r8 = t;
+	steps++;
+
+L_f0302a:
+	steps++;
+
+L_f0302c:
+	t = 0xf02100u;
+	r9 = t;
+	steps++;
+
+L_f03032:
+	switch (jriscRecompGpuLoad(st, r9, 4, &value)) {
+	case 0:
+		r10 = value;
+		break;
+	case 2:
+		r10 = z | (c << 1) | (n << 2) | (st->regpage << 14);
+		break;
+	default:
+		dest = 0xf03032u;
+		status = JRISC_recompBadAddress;
+		goto leave;
+	}
+	steps++;
+
+L_f03034:
+	t = r10 | 0x4000u;
+	r10 = t;
+	z = t == 0;
+	n = t >> 31;
+	steps++;
+
+L_f03036:
+	switch (jriscRecompGpuStore(st, r9, 4, r10)) {
+	case 0:
+		break;
+	case 2:
+		value = r10;
+		steps++;
+		dest = 0xf03038u;
+		goto setflags;
+	default:
+		dest = 0xf03036u;
+		status = JRISC_recompBadAddress;
+		goto leave;
+	}
+	steps++;
+
+L_f03038:
+	t = 0x9u;
+	r1 = t;
+	steps++;
+
+L_f0303a:
+	t = st->altRegs[4];
+	r11 = t;
+	steps++;
+
+L_f0303c:
+	t = 0xf00000u;
+	r12 = t;
+	steps++;
+
+L_f03042:
+	taken = 1;
+	target = r12;
+	steps++;
+	t = r1 + r11;
+	c = t < r1;
+	r1 = t;
+	z = t == 0;
+	n = t >> 31;
+	steps++;
+	if (taken) {
+		dest = target;
+		goto dispatch;
+	}
+	goto L_f03046;
+
+L_f03044:
+	t = r1 + r11;
+	c = t < r1;
+	r1 = t;
+	z = t == 0;
+	n = t >> 31;
+	steps++;
+
+L_f03046:
+	t = r5;
+	r13 = t;
+	steps++;
+
+L_f03048:
+	c = r13 >> 31;
+	t = r13 << 3;
+	r13 = t;
+	z = t == 0;
+	n = t >> 31;
+	steps++;
+
+L_f0304a:
+	c = r13 & 1;
+	t = (uint32_t)((int32_t)r13 >> 2);
+	r13 = t;
+	z = t == 0;
+	n = t >> 31;
+	steps++;
+
+L_f0304c:
+	shift = (int32_t)r8;
+	if (shift >= 0) {
+		c = r13 & 1;
+		t = (shift > 31) ? 0 : (r13 >> shift);
+	} else {
+		c = r13 >> 31;
+		t = (shift < -31) ? 0 : (r13 << -shift);
+	}
+	r13 = t;
+	z = t == 0;
+	n = t >> 31;
+	steps++;
+
+L_f0304e:
+	u = 0x7u % 32;
+	c = r13 >> 31;
+	t = u ? ((r13 >> u) | (r13 << (32 - u))) : r13;
+	r13 = t;
+	z = t == 0;
+	n = t >> 31;
+	steps++;
+
+L_f03050:
+	t = (r13 & 0xffffu) * (r8 & 0xffffu);
+	r13 = t;
+	z = t == 0;
+	n = t >> 31;
+	steps++;
+
+L_f03052:
+	taken = 1;
+	target = r7;
+	steps++;
+	c = r13 >> 31;
+	t = c ? (0 - r13) : r13;
+	r13 = t;
+	z = t == 0;
+	n = t >> 31;
+	steps++;
+	if (taken) {
+		dest = target;
+		goto dispatch;
+	}
+	dest = 0xf03056u;
+	goto leave;
+
+L_f03054:
+	c = r13 >> 31;
+	t = c ? (0 - r13) : r13;
+	r13 = t;
+	z = t == 0;
+	n = t >> 31;
+	steps++;
+	dest = 0xf03056u;
+	goto leave;
+
+setflags:
+	z = value & 1;
+	c = (value >> 1) & 1;
+	n = (value >> 2) & 1;
+	if (((value >> 14) & 1) != st->regpage) {
+		t = r0; r0 = st->altRegs[0]; st->altRegs[0] = t;
+		t = r1; r1 = st->altRegs[1]; st->altRegs[1] = t;
+		t = r2; r2 = st->altRegs[2]; st->altRegs[2] = t;
+		t = r3; r3 = st->altRegs[3]; st->altRegs[3] = t;
+		t = r4; r4 = st->altRegs[4]; st->altRegs[4] = t;
+		t = r5; r5 = st->altRegs[5]; st->altRegs[5] = t;
+		t = r6; r6 = st->altRegs[6]; st->altRegs[6] = t;
+		t = r7; r7 = st->altRegs[7]; st->altRegs[7] = t;
+		t = r8; r8 = st->altRegs[8]; st->altRegs[8] = t;
+		t = r9; r9 = st->altRegs[9]; st->altRegs[9] = t;
+		t = r10; r10 = st->altRegs[10]; st->altRegs[10] = t;
+		t = r11; r11 = st->altRegs[11]; st->altRegs[11] = t;
+		t = r12; r12 = st->altRegs[12]; st->altRegs[12] = t;
+		t = r13; r13 = st->altRegs[13]; st->altRegs[13] = t;
+		t = r14; r14 = st->altRegs[14]; st->altRegs[14] = t;
+		t = r15; r15 = st->altRegs[15]; st->altRegs[15] = t;
+		t = r16; r16 = st->altRegs[16]; st->altRegs[16] = t;
+		t = r17; r17 = st->altRegs[17]; st->altRegs[17] = t;
+		t = r18; r18 = st->altRegs[18]; st->altRegs[18] = t;
+		t = r19; r19 = st->altRegs[19]; st->altRegs[19] = t;
+		t = r20; r20 = st->altRegs[20]; st->altRegs[20] = t;
+		t = r21; r21 = st->altRegs[21]; st->altRegs[21] = t;
+		t = r22; r22 = st->altRegs[22]; st->altRegs[22] = t;
+		t = r23; r23 = st->altRegs[23]; st->altRegs[23] = t;
+		t = r24; r24 = st->altRegs[24]; st->altRegs[24] = t;
+		t = r25; r25 = st->altRegs[25]; st->altRegs[25] = t;
+		t = r26; r26 = st->altRegs[26]; st->altRegs[26] = t;
+		t = r27; r27 = st->altRegs[27]; st->altRegs[27] = t;
+		t = r28; r28 = st->altRegs[28]; st->altRegs[28] = t;
+		t = r29; r29 = st->altRegs[29]; st->altRegs[29] = t;
+		t = r30; r30 = st->altRegs[30]; st->altRegs[30] = t;
+		t = r31; r31 = st->altRegs[31]; st->altRegs[31] = t;
+		st->regpage ^= 1;
+	}
+	goto dispatch;
+
+leave:
+	st->regs[0] = r0;
+	st->regs[1] = r1;
+	st->regs[2] = r2;
+	st->regs[3] = r3;
+	st->regs[4] = r4;
+	st->regs[5] = r5;
+	st->regs[6] = r6;
+	st->regs[7] = r7;
+	st->regs[8] = r8;
+	st->regs[9] = r9;
+	st->regs[10] = r10;
+	st->regs[11] = r11;
+	st->regs[12] = r12;
+	st->regs[13] = r13;
+	st->regs[14] = r14;
+	st->regs[15] = r15;
+	st->regs[16] = r16;
+	st->regs[17] = r17;
+	st->regs[18] = r18;
+	st->regs[19] = r19;
+	st->regs[20] = r20;
+	st->regs[21] = r21;
+	st->regs[22] = r22;
+	st->regs[23] = r23;
+	st->regs[24] = r24;
+	st->regs[25] = r25;
+	st->regs[26] = r26;
+	st->regs[27] = r27;
+	st->regs[28] = r28;
+	st->regs[29] = r29;
+	st->regs[30] = r30;
+	st->regs[31] = r31;
+	st->z = z;
+	st->c = c;
+	st->n = n;
+	st->acc = acc;
+	st->pc = dest;
+	st->steps = steps;
+	st->status = status;
+}
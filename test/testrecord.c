@@ -0,0 +1,105 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_inst.h"
+#include "jrisc_program.h"
+#include "jrisc_record.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+int
+main(int argc, char *argv[])
+{
+	const uint16_t words[] = {
+		0x9802, 0x301a, 0x00f0,		/* movei #$f0301a, r2 */
+		0x0886,						/* addq #4, r6 */
+		0x0806,						/* addq #32, r6 */
+		0x6206,						/* shlq #16, r6 */
+		0x8c05,						/* moveq #0, r5 */
+		0xac43,						/* load (r14+2), r3 */
+		0x7fe4,						/* cmpq #-1, r4 */
+		0xd7a1,						/* jr NE, *-4 */
+		0xe400,						/* nop */
+	};
+	struct JRISC_Program *program;
+	struct JRISC_RecordWriter *writer;
+	struct JRISC_Record record;
+	enum JRISC_CPU cpu;
+	uint8_t header[JRISC_RECORD_HEADER_SIZE];
+	uint8_t bytes[JRISC_RECORD_SIZE];
+	FILE *fp;
+	size_t i;
+
+	if (jriscProgramFromWords(words, sizeof(words) / sizeof(words[0]),
+							  JRISC_GPU_RAM, JRISC_gpu, &program) !=
+		JRISC_success) {
+		printf("Failed to decode program\n");
+		return 1;
+	}
+
+	fp = tmpfile();
+	if (!fp ||
+		(jriscRecordWriteHeader(fp, JRISC_gpu) != JRISC_success) ||
+		(jriscRecordWriterCreate(fp, JRISC_recordBinary, &writer) !=
+		 JRISC_success)) {
+		printf("Failed to create binary writer\n");
+		return 1;
+	}
+
+	for (i = 0; i < program->numInstructions; i++) {
+		jriscRecordWriterAdd(writer, &program->instructions[i]);
+	}
+	if (jriscRecordWriterFlush(writer) != JRISC_success) {
+		printf("Failed to write records\n");
+		return 1;
+	}
+	jriscRecordWriterDestroy(writer);
+
+	printf("binary: %ld bytes\n", ftell(fp));
+	rewind(fp);
+
+	if ((fread(header, sizeof(header), 1, fp) != 1) ||
+		(jriscRecordReadHeader(header, sizeof(header), &cpu) !=
+		 JRISC_success)) {
+		printf("Bad header\n");
+		return 1;
+	}
+	printf("header: cpu %d\n", (int)cpu);
+
+	header[8]++;
+	if (jriscRecordReadHeader(header, sizeof(header), NULL) !=
+		JRISC_ERROR_invalidFormat) {
+		printf("Accepted a different version\n");
+	}
+
+	while (fread(bytes, sizeof(bytes), 1, fp) == 1) {
+		jriscRecordDecode(bytes, &record);
+		printf("%08x %u [%04x %04x %04x] op %u src %u:%d dst %u:%d imm $%x\n",
+			   record.address, record.numWords, record.words[0],
+			   record.words[1], record.words[2], record.opName,
+			   record.srcType, (int)record.srcValue,
+			   record.dstType, (int)record.dstValue, record.longImmediate);
+	}
+	fclose(fp);
+
+	if (jriscRecordWriterCreate(stdout, JRISC_recordJson, &writer) !=
+		JRISC_success) {
+		printf("Failed to create JSON writer\n");
+		return 1;
+	}
+
+	for (i = 0; i < program->numInstructions; i++) {
+		jriscRecordWriterAdd(writer, &program->instructions[i]);
+	}
+	jriscRecordWriterFlush(writer);
+	jriscRecordWriterDestroy(writer);
+
+	jriscProgramDestroy(program);
+
+	return 0;
+}
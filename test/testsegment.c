@@ -0,0 +1,80 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_program.h"
+#include "jrisc_segment.h"
+#include "testprogram.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static const uint16_t code[] = {
+	OP(38, 0, 1), 0x3018, 0x00f0,	/* movei	#table, r1 */
+	OP(38, 0, 2), 0x3024, 0x00f0,	/* movei	#second, r2 */
+	OP(41, 1, 3),					/* load	(r1), r3 */
+	OP(52, 2, 0),					/* jump	(r2) */
+	OP(57, 0, 0),					/* nop */
+	OP(0, 1, 2),					/* add	r1, r2, only reached indirectly */
+	OP(57, 0, 0),					/* nop */
+	OP(57, 0, 0),					/* nop */
+	0x0000, 0x0001,					/* table:	dc.l	1 */
+	0xffe0, 0xffe0,					/* dc.l	$ffe0ffe0 */
+	0x1234, 0x5678,					/* dc.l	$12345678 */
+	OP(35, 1, 4),					/* second:	moveq	#1, r4 */
+	OP(53, -2, 0),					/* jr	second */
+	OP(57, 0, 0),					/* nop */
+	0xffe0, 0xffe0,					/* dc.l	$ffe0ffe0 */
+};
+
+static void
+printSegments(const char *name,
+			  const struct JRISC_Program *program,
+			  const uint32_t *entries,
+			  size_t numEntries)
+{
+	struct JRISC_SegmentMap *map;
+	const struct JRISC_Segment *segment;
+	size_t k;
+
+	if (jriscSegmentProgram(program, entries, numEntries, &map) !=
+		JRISC_success) {
+		printf("Failed to segment program\n");
+		exit(1);
+	}
+
+	printf("%s:\n", name);
+	for (k = 0; k < map->numSegments; k++) {
+		segment = &map->segments[k];
+		printf("  $%x-$%x %s\n",
+			   program->baseAddress + segment->firstWord * 2,
+			   program->baseAddress +
+			   (segment->firstWord + segment->numWords) * 2 - 1,
+			   segment->code ? "code" : "data");
+	}
+
+	jriscSegmentMapDestroy(map);
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct JRISC_Program *program;
+	const uint32_t table = JRISC_GPU_RAM + 0x18;
+	const uint32_t outside = JRISC_GPU_RAM - 2;
+
+	program = decode(code, sizeof(code) / sizeof(code[0]));
+
+	printSegments("From the start", program, NULL, 0);
+	printSegments("Entry outside the program", program, &outside, 1);
+
+	/* Told the table is code, it is, and so is what it falls into */
+	printSegments("Entry at the table", program, &table, 1);
+
+	jriscProgramDestroy(program);
+
+	return 0;
+}
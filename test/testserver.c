@@ -0,0 +1,99 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_image.h"
+#include "jrisc_inst.h"
+#include "jrisc_server.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SCRATCH_FILE	"testserver.bin"
+
+static void
+request(struct JRISC_Server *server, const char *text)
+{
+	char *response;
+	size_t size;
+
+	printf("> %s\n", text);
+
+	if (jriscServerHandle(server, text, strlen(text), &response, &size) !=
+		JRISC_success) {
+		printf("No response\n");
+		return;
+	}
+
+	fwrite(response, 1, size, stdout);
+	free(response);
+}
+
+static void
+writeScratch(const uint8_t *bytes, size_t size)
+{
+	FILE *fp = fopen(SCRATCH_FILE, "wb");
+
+	if (!fp || (fwrite(bytes, 1, size, fp) != size) || fclose(fp)) {
+		printf("Failed to write " SCRATCH_FILE "\n");
+		exit(1);
+	}
+}
+
+int
+main(int argc, char *argv[])
+{
+	static const uint8_t first[] = {
+		0x98, 0x01, 0x12, 0x34, 0x56, 0x78,	/* movei #$56781234, r1 */
+		0xe4, 0x00,							/* nop */
+	};
+	static const uint8_t second[] = {
+		0x08, 0x86,							/* addq #4, r6 */
+		0xff, 0xff,							/* not an instruction */
+		0xe4, 0x00,							/* nop */
+		0xe4, 0x00,							/* nop */
+		0xe4, 0x00,							/* nop */
+	};
+	struct JRISC_ServerOptions options;
+	struct JRISC_Server *server;
+
+	memset(&options, 0, sizeof(options));
+	options.cpu = JRISC_gpu;
+	options.format = JRISC_imageRaw;
+	options.maxImages = 1;
+
+	if (jriscServerCreate(&options, &server) != JRISC_success) {
+		printf("Failed to create the server\n");
+		return 1;
+	}
+
+	request(server, "stats");
+	request(server, "disassemble\ttest.bin\t0xf03000\t0xf03010");
+	request(server, "lookup\ttest.bin\t0xf03007");
+	request(server, "lookup\ttest.bin\t0xf03000");
+
+	request(server, "disassemble\ttest.bin\t0xf03000");
+	request(server, "disassemble\ttest.bin\t0xf03010\t0xf03000");
+	request(server, "disassemble\ttest.bin\t0\t0x100000");
+	request(server, "lookup\ttest.bin\t0x100");
+	request(server, "lookup\tno such file\t0xf03000");
+	request(server, "frobnicate");
+
+	/* A changed file is decoded again */
+	writeScratch(first, sizeof(first));
+	request(server, "disassemble\t" SCRATCH_FILE "\t0xf03000\t0xf03100");
+	writeScratch(second, sizeof(second));
+	request(server, "disassemble\t" SCRATCH_FILE "\t0xf03000\t0xf03100");
+
+	/* Only one image fits, so test.bin has been evicted */
+	request(server, "stats");
+
+	remove(SCRATCH_FILE);
+	jriscServerDestroy(server);
+
+	return 0;
+}
@@ -0,0 +1,66 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_inst.h"
+#include "jrisc_program.h"
+#include "jrisc_stats.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+int
+main(int argc, char *argv[])
+{
+	const uint16_t words[] = {
+		0x9801, 0x2114, 0x00f0,		/* movei #$f02114, r1 */
+		0xd020,						/* jump (r1) */
+		0xe400,						/* nop */
+		0x0822,						/* addq #1, r2 */
+		0x0064,						/* add r3, r4 */
+		0x0083,						/* add r4, r3 */
+		0xd462,						/* jr EQ, *+8 */
+		0xe400,						/* nop */
+	};
+	struct JRISC_Program *program;
+	struct JRISC_Stats *total;
+	struct JRISC_Stats *half;
+	size_t i;
+
+	if (jriscProgramFromWords(words, sizeof(words) / sizeof(words[0]),
+							  JRISC_GPU_RAM, JRISC_gpu, &program) !=
+		JRISC_success) {
+		printf("Failed to decode program\n");
+		return 1;
+	}
+
+	total = malloc(sizeof(*total));
+	half = malloc(sizeof(*half));
+	if (!total || !half) {
+		printf("Out of memory\n");
+		return 1;
+	}
+
+	/* Count the program in two parts, as two threads would, then merge */
+	jriscStatsInit(total);
+	jriscStatsInit(half);
+	for (i = 0; i < program->numInstructions; i++) {
+		jriscStatsAdd((i < 4) ? total : half, &program->instructions[i]);
+	}
+	jriscStatsAddInvalid(half);
+	jriscStatsMerge(total, half);
+
+	if (jriscStatsWrite(total, JRISC_statsCsv, stdout) != JRISC_success) {
+		printf("Failed to write statistics\n");
+		return 1;
+	}
+
+	free(half);
+	free(total);
+	jriscProgramDestroy(program);
+
+	return 0;
+}
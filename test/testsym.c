@@ -0,0 +1,97 @@
+/*
+ * SPDX-License-Identifier: CC0-1.0
+ *
+ * Author: James Jones
+ */
+
+#include "jrisc_base.h"
+#include "jrisc_ctx.h"
+#include "jrisc_ctx_mem.h"
+#include "jrisc_inst.h"
+#include "jrisc_inst_string.h"
+#include "jrisc_sym.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static void
+lookup(const struct JRISC_SymbolTable *table, uint32_t address)
+{
+	const struct JRISC_Symbol *sym;
+	uint32_t offset;
+
+	sym = jriscSymbolTableLookup(table, address, &offset);
+
+	if (sym) {
+		printf("%08x: %s+%u\n", address, sym->name, offset);
+	} else {
+		printf("%08x: <none>\n", address);
+	}
+}
+
+int
+main(int argc, char *argv[])
+{
+	const uint8_t mem[] = {
+		0x98, 0x1f, 0x05, 0xbc, 0x00, 0x00, 0xbf, 0xe0, 0x08, 0x9f, 0xa7,
+		0xe0, 0x98, 0x1f, 0x21, 0x14, 0x00, 0xf0, 0x8c, 0x1e, 0xbf, 0xfe,
+		0xd7, 0xc0, 0xe4, 0x00, 0xe4, 0x00,
+		/* movei #$1008, r1: past unsized fill0, so just a number */
+		0x98, 0x01, 0x10, 0x08, 0x00, 0x00
+	};
+	size_t len = sizeof(mem);
+
+	struct JRISC_SymbolTable *table;
+	struct JRISC_Context *ctx;
+	struct JRISC_Instruction inst;
+	uint32_t i;
+
+	if (jriscSymbolTableCreate(&table) != JRISC_success) {
+		printf("Failed to create symbol table\n");
+		return 1;
+	}
+
+	/* Added out of order, with a duplicate address */
+	jriscSymbolTableAdd(table, "store_r30", 0x14, 0);
+	jriscSymbolTableAdd(table, "start", 0x0, 0);
+	jriscSymbolTableAdd(table, "G_END", 0xf02114, 0);
+	jriscSymbolTableAdd(table, "also_start", 0x0, 0);
+	jriscSymbolTableAdd(table, "counter", 0x5b8, 8);
+
+	/* Enough filler to give the lookup tree a few levels */
+	for (i = 0; i < 100; i++) {
+		char name[16];
+
+		snprintf(name, sizeof(name), "fill%u", i);
+		jriscSymbolTableAdd(table, name, 0x1000 + i * 0x10, 0);
+	}
+
+	if (jriscSymbolTableFinalize(table) != JRISC_success) {
+		printf("Failed to finalize symbol table\n");
+		return 1;
+	}
+
+	lookup(table, 0x0);
+	lookup(table, 0x12);
+	lookup(table, 0x5b7);
+	lookup(table, 0x5bc);
+	lookup(table, 0x5c0);
+	lookup(table, 0x1000);
+	lookup(table, 0x1633);
+	lookup(table, 0xf02114);
+	lookup(table, 0xf02118);
+
+	if (jriscContextFromMemory(mem, len, NULL, 0, 0, &ctx) != JRISC_success) {
+		printf("Failed to create context\n");
+		return 1;
+	}
+
+	while (jriscInstructionRead(ctx, JRISC_gpu, &inst) == JRISC_success) {
+		jriscInstructionPrintSymbolic(&inst, JRISC_STRINGFLAG_ADDRESS, table);
+	}
+
+	jriscContextDestroy(ctx);
+	jriscSymbolTableDestroy(table);
+
+	return 0;
+}